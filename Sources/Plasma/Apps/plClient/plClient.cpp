@@ -80,6 +80,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plAgeLoader/plAgeLoader.h"
 #include "plAgeLoader/plResPatcher.h"
 #include "plAnimation/plAGAnimInstance.h"
+#include "plAnimation/plAGMasterMod.h"
 #include "plAudio/plAudioSystem.h"
 #include "plAvatar/plArmatureMod.h"
 #include "plAvatar/plAvatarClothing.h"
@@ -1599,15 +1600,25 @@ bool plClient::IUpdate()
     plgDispatch::MsgSend(msg);
     plProfile_EndTiming(TimeMsg);
 
+    // A step left running on the physics threads last frame comes in here, so the
+    // avatar corrections it sends are evaluated and land in the main transform pass,
+    // before the next step picks the avatars' transforms back up.
+    plProfile_BeginTiming(Simulation);
+    plSimulationMgr::GetInstance()->FinishStep();
+    plProfile_EndTiming(Simulation);
+
+    // Animation masters can leave their pose math for after the eval pass, so
+    // it can run across threads; it all lands before the transform pass.
     plProfile_BeginTiming(EvalMsg);
+    plAGMasterMod::BeginDeferredEvals();
     plEvalMsg* eval = new plEvalMsg(nullptr, nullptr, nullptr, nullptr);
     plgDispatch::MsgSend(eval);
+    plAGMasterMod::FlushDeferredEvals();
     plProfile_EndTiming(EvalMsg);
 
     char *xFormLap1 = "Main";
     plProfile_BeginLap(TransformMsg, xFormLap1);
-    plTransformMsg* xform = new plTransformMsg(nullptr, nullptr, nullptr, nullptr);
-    plgDispatch::MsgSend(xform);
+    plCoordinateInterface::UpdateTransforms(plCoordinateInterface::kTransformPhaseNormal);
     plProfile_EndLap(TransformMsg, xFormLap1);
 
     plCoordinateInterface::SetTransformPhase(plCoordinateInterface::kTransformPhaseDelayed);    
@@ -1619,21 +1630,19 @@ bool plClient::IUpdate()
     plSimulationMgr::GetInstance()->Advance(delSecs);
     plProfile_EndTiming(Simulation);
             
-    // At this point, we just register for a plDelayedTransformMsg when dirtied.
+    // At this point, anything dirtied waits for the delayed transform pass.
     if (!plCoordinateInterface::GetDelayedTransformsEnabled())
     {
         char *xFormLap2 = "Simulation";
         plProfile_BeginLap(TransformMsg, xFormLap2);
-        xform = new plTransformMsg(nullptr, nullptr, nullptr, nullptr);
-        plgDispatch::MsgSend(xform);
+        plCoordinateInterface::UpdateTransforms(plCoordinateInterface::kTransformPhaseNormal);
         plProfile_EndLap(TransformMsg, xFormLap2);
     }
     else
     {
         char *xFormLap3 = "Delayed";
         plProfile_BeginLap(TransformMsg, xFormLap3);
-        xform = new plDelayedTransformMsg(nullptr, nullptr, nullptr, nullptr);
-        plgDispatch::MsgSend(xform);
+        plCoordinateInterface::UpdateTransforms(plCoordinateInterface::kTransformPhaseDelayed);
         plProfile_EndLap(TransformMsg, xFormLap3);
     }
 
@@ -41,30 +41,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 *==LICENSE==*/
 #include "HeadSpin.h"
 
-#include "pnFactory/plCreator.h"
-
-#include "plAudible.h"
-REGISTER_NONCREATABLE( plAudible );
-
-#include "plDrawable.h"
-REGISTER_NONCREATABLE( plDrawable );
-
-#include "plPhysical.h"
-REGISTER_NONCREATABLE( plPhysical );
-
-#include "plgDispatch.h"
-REGISTER_NONCREATABLE( plDispatchBase );
-
-#include "pnDispatch/pnDispatchCreatable.h"
-#include "pnKeyedObject/pnKeyedObjectCreatable.h"
-#include "pnMessage/pnMessageCreatable.h"
-#include "pnModifier/pnModifierCreatable.h"
-#include "pnNetCommon/pnNetCommonCreatable.h"
-#include "pnTimerCreatable.h"
-
-#include "plAudioCore/plAudioCoreCreatable.h"
-
-#include "plMessage/plResMgrHelperMsg.h"
-REGISTER_CREATABLE(plResMgrHelperMsg);
-
-#include "plResMgr/plResMgrCreatable.h"
+// The profiler reads every object through the ResManager, so it needs
+// to be able to create everything the client can
+#include "pnNucleusCreatables.h"
+#include "plAllCreatables.h"
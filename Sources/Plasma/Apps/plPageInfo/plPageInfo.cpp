@@ -40,10 +40,14 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 *==LICENSE==*/
 
+#include "plPageProfiler.h"
+
 #include "plProduct.h"
 #include "hsStream.h"
 #include "hsTimer.h"
 
+#include <string_theory/stdio>
+
 #include "pnKeyedObject/plKeyImp.h"
 
 #include "plAgeDescription/plAgeManifest.h"
@@ -60,6 +64,7 @@ plResManager* gResMgr = nullptr;
 
 bool DumpStats(const plFileName& patchDir);
 bool DumpSounds();
+bool DumpProfile(const plFileName& dataDir, bool json);
 
 //// PrintVersion ///////////////////////////////////////////////////////////////
 void PrintVersion()
@@ -75,11 +80,15 @@ int PrintHelp()
     PrintVersion();
     puts("");
     puts("Usage: plPageInfo [-s -i] pageFile");
+    puts("       plPageInfo -p [-j] dataDir");
     puts("       plPageInfo -v");
     puts("Where:" );
     puts("       -v print version and exit.");
     puts("       -s dump sounds in page to the console");
     puts("       -i dump object size info to .csv files");
+    puts("       -p read every page in dataDir and write per-class size and load");
+    puts("          time info to PageProfile_*.csv files in dataDir");
+    puts("       -j write the -p results to PageProfile.json instead");
     puts("       pageFile is the path to the .prp file");
     puts("");
 
@@ -101,6 +110,8 @@ int main(int argc, char* argv[])
 
     bool sounds = false;
     bool stats = false;
+    bool profile = false;
+    bool json = false;
 
     int arg = 1;
     for (arg = 1; arg < argc; arg++)
@@ -109,6 +120,10 @@ int main(int argc, char* argv[])
             sounds = true;
         else if (strcmp(argv[arg], "-i") == 0)
             stats = true;
+        else if (strcmp(argv[arg], "-p") == 0)
+            profile = true;
+        else if (strcmp(argv[arg], "-j") == 0)
+            json = true;
         else
             break;
     }
@@ -126,12 +141,21 @@ int main(int argc, char* argv[])
     plResMgrSettings::Get().SetLoadPagesOnInit(false);
     gResMgr = new plResManager;
     hsgResMgr::Init(gResMgr);
-    gResMgr->AddSinglePage(pageFile);
 
-    if (sounds)
-        DumpSounds();
-    if (stats)
-        DumpStats(pageFile.StripFileName());
+    if (profile)
+    {
+        // The profiler adds every page in the directory itself
+        DumpProfile(pageFile, json);
+    }
+    else
+    {
+        gResMgr->AddSinglePage(pageFile);
+
+        if (sounds)
+            DumpSounds();
+        if (stats)
+            DumpStats(pageFile.StripFileName());
+    }
 
     hsgResMgr::Shutdown();
 
@@ -255,3 +279,22 @@ bool DumpStats(const plFileName& patchDir)
     gResMgr->IterateAllPages(&statDump);
     return true;
 }
+
+//////////////////////////////////////////////////////////////////////////
+
+bool DumpProfile(const plFileName& dataDir, bool json)
+{
+    plPageProfiler profiler;
+    if (!profiler.Profile(dataDir))
+        return false;
+
+    bool result;
+    if (json)
+        result = profiler.WriteJSON(plFileName::Join(dataDir, "PageProfile.json"));
+    else
+        result = profiler.WriteCSV(dataDir);
+
+    if (!result)
+        ST::printf(stderr, "Couldn't write the profile to {}\n", dataDir);
+    return result;
+}
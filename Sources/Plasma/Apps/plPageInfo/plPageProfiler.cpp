@@ -0,0 +1,342 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+#include "plPageProfiler.h"
+
+#include "hsStream.h"
+#include "hsTimer.h"
+
+#include <string_theory/stdio>
+
+#include "pnFactory/plFactory.h"
+#include "pnKeyedObject/hsKeyedObject.h"
+#include "pnKeyedObject/plKeyImp.h"
+
+#include "plCompression/plZlibCompress.h"
+#include "plDrawable/plDrawableSpans.h"
+#include "plDrawable/plGBufferGroup.h"
+#include "plGImage/plCubicEnvironmap.h"
+#include "plGImage/plMipmap.h"
+#include "plResMgr/plRegistryHelpers.h"
+#include "plResMgr/plRegistryNode.h"
+#include "plResMgr/plResManager.h"
+
+plPageProfiler* plPageProfiler::fInstance = nullptr;
+
+plPageProfiler::plPageProfiler()
+    : fLastReadTicks()
+{
+    fInstance = this;
+    fResMgr = (plResManager*)hsgResMgr::ResMgr();
+}
+
+plPageProfiler::~plPageProfiler()
+{
+    fResMgr->SetProgressBarProc(nullptr);
+    fInstance = nullptr;
+}
+
+bool plPageProfiler::Profile(const plFileName& dataDir)
+{
+    std::vector<plFileName> pagePaths = plFileSystem::ListDir(dataDir, "*.prp");
+    if (pagePaths.empty())
+    {
+        ST::printf(stderr, "No pages found in {}\n", dataDir);
+        return false;
+    }
+
+    // Every page has to be registered before we read anything, since objects
+    // reference things in other pages (mostly textures)
+    for (const plFileName& path : pagePaths)
+        fResMgr->AddSinglePage(path);
+
+    // The ResManager reads one object at a time, and calls us back as each one
+    // finishes.  Whatever time passed since the last callback was spent on it.
+    fResMgr->SetProgressBarProc(IObjectRead);
+
+    for (const plFileName& path : pagePaths)
+    {
+        plRegistryPageNode* page = fResMgr->FindSinglePage(path);
+        if (page && page->IsValid())
+        {
+            ST::printf("Profiling {}...\n", path.GetFileName());
+            IProfilePage(page);
+        }
+        else
+        {
+            ST::printf(stderr, "Skipping invalid page {}\n", path.GetFileName());
+        }
+    }
+
+    fResMgr->SetProgressBarProc(nullptr);
+    return true;
+}
+
+void plPageProfiler::IProfilePage(plRegistryPageNode* page)
+{
+    fResMgr->LoadPageKeys(page);
+
+    std::vector<plKey> keys;
+    class plVecKeyCollector : public plRegistryKeyIterator
+    {
+    public:
+        std::vector<plKey>& fKeys;
+        plVecKeyCollector(std::vector<plKey>& keys) : fKeys(keys) {}
+        bool EatKey(const plKey& key) override { fKeys.push_back(key); return true; }
+    };
+    plVecKeyCollector keyIt(keys);
+    page->IterateKeys(&keyIt);
+
+    // Sizes come straight from the page file, so they're measured the same
+    // whether or not we know how to read the object
+    hsUNIXStream pageStream;
+    if (pageStream.Open(page->GetPagePath()))
+    {
+        for (const plKey& key : keys)
+            IMeasureData(&pageStream, key);
+        pageStream.Close();
+    }
+
+    for (const plKey& key : keys)
+    {
+        // Anything the factory can't create would just fail to read
+        if (!plFactory::CanCreate(key->GetUoid().GetClassType()))
+            continue;
+
+        fLastReadTicks = hsTimer::GetTicks();
+        hsKeyedObject* ko = key->RefObject();
+        if (ko)
+            IInspectObject(ko);
+    }
+
+    // Drop everything before moving on, so we don't run out of memory on big
+    // data sets, and so the next page has to read its shared objects again
+    for (const plKey& key : keys)
+    {
+        if (plFactory::CanCreate(key->GetUoid().GetClassType()))
+            key->UnRefObject();
+    }
+}
+
+void plPageProfiler::IObjectRead(plKey key)
+{
+    uint64_t now = hsTimer::GetTicks();
+
+    ClassStats& stats = fInstance->fClasses[key->GetUoid().GetClassType()];
+    stats.fReads++;
+    stats.fReadTicks += now - fInstance->fLastReadTicks;
+
+    fInstance->fLastReadTicks = now;
+}
+
+void plPageProfiler::IMeasureData(hsStream* pageStream, const plKey& key)
+{
+    plKeyImp* imp = (plKeyImp*)key;
+
+    ClassStats& stats = fClasses[imp->GetUoid().GetClassType()];
+    stats.fObjects++;
+
+    uint32_t len = imp->GetDataLen();
+    if (len == 0 || len == uint32_t(-1))
+        return;
+    stats.fBytes += len;
+
+    if (fReadBuf.size() < len)
+        fReadBuf.resize(len);
+    pageStream->SetPosition(imp->GetStartPos());
+    pageStream->Read(len, fReadBuf.data());
+
+    // Same worst case headroom zlib needs
+    uint32_t compressedLen = len + (len / 1000) + 12;
+    if (fCompressBuf.size() < compressedLen)
+        fCompressBuf.resize(compressedLen);
+
+    plZlibCompress compress;
+    if (compress.Compress(fCompressBuf.data(), &compressedLen, fReadBuf.data(), len))
+        stats.fCompressedBytes += compressedLen;
+    else
+        stats.fCompressedBytes += len;
+}
+
+void plPageProfiler::IInspectObject(hsKeyedObject* ko)
+{
+    if (plMipmap* mip = plMipmap::ConvertNoRef(ko))
+    {
+        IAddMipmap(mip, "");
+    }
+    else if (plCubicEnvironmap* cubic = plCubicEnvironmap::ConvertNoRef(ko))
+    {
+        for (uint8_t i = 0; i < 6; i++)
+        {
+            if (cubic->GetFace(i))
+                IAddMipmap(cubic->GetFace(i), "Cube ");
+        }
+    }
+    else if (plDrawableSpans* spans = plDrawableSpans::ConvertNoRef(ko))
+    {
+        ClassStats& stats = fClasses[ko->GetKey()->GetUoid().GetClassType()];
+        for (size_t i = 0; i < spans->GetNumBufferGroups(); i++)
+        {
+            plGBufferGroup* group = spans->GetBufferGroup(i);
+            for (uint32_t j = 0; j < group->GetNumVertexBuffers(); j++)
+                stats.fVertices += group->GetVertBufferCount(j);
+            for (uint32_t j = 0; j < group->GetNumIndexBuffers(); j++)
+                stats.fIndices += group->GetIndexBufferCount(j);
+        }
+    }
+}
+
+void plPageProfiler::IAddMipmap(const plMipmap* mip, const char* prefix)
+{
+    const char* format = "Unknown";
+    switch (mip->fCompressionType)
+    {
+    case plBitmap::kDirectXCompression:
+        if (mip->fDirectXInfo.fCompressionType == plBitmap::DirectXInfo::kDXT1)
+            format = "DXT1";
+        else if (mip->fDirectXInfo.fCompressionType == plBitmap::DirectXInfo::kDXT5)
+            format = "DXT5";
+        break;
+    case plBitmap::kJPEGCompression:
+        format = "JPEG";
+        break;
+    case plBitmap::kPNGCompression:
+        format = "PNG";
+        break;
+    case plBitmap::kUncompressed:
+        switch (mip->fUncompressedInfo.fType)
+        {
+        case plBitmap::UncompressedInfo::kRGB8888:
+            format = "ARGB8888";
+            break;
+        case plBitmap::UncompressedInfo::kRGB4444:
+            format = "ARGB4444";
+            break;
+        case plBitmap::UncompressedInfo::kRGB1555:
+            format = "ARGB1555";
+            break;
+        case plBitmap::UncompressedInfo::kInten8:
+            format = "I8";
+            break;
+        case plBitmap::UncompressedInfo::kAInten88:
+            format = "AI88";
+            break;
+        }
+        break;
+    }
+
+    MipmapStats& stats = fMipmaps[MipmapKey(ST::format("{}{}", prefix, format),
+                                            mip->GetWidth(), mip->GetHeight())];
+    stats.fCount++;
+    stats.fLevels += mip->GetNumLevels();
+    stats.fBytes += mip->GetTotalSize();
+}
+
+bool plPageProfiler::WriteCSV(const plFileName& outputDir) const
+{
+    hsUNIXStream stream;
+    if (!stream.Open(plFileName::Join(outputDir, "PageProfile_Classes.csv"), "wt"))
+        return false;
+
+    stream.WriteString("Class,Objects,Bytes,Compressed Bytes,Reads,Read Time (ms),Vertices,Indices\n");
+    for (const auto& it : fClasses)
+    {
+        const ClassStats& stats = it.second;
+        stream.WriteString(ST::format("{},{},{},{},{},{.3f},{},{}\n",
+                           plFactory::GetNameOfClass(it.first),
+                           stats.fObjects, stats.fBytes, stats.fCompressedBytes,
+                           stats.fReads, hsTimer::GetMilliSeconds<double>(stats.fReadTicks),
+                           stats.fVertices, stats.fIndices));
+    }
+    stream.Close();
+
+    if (!stream.Open(plFileName::Join(outputDir, "PageProfile_Mipmaps.csv"), "wt"))
+        return false;
+
+    stream.WriteString("Format,Width,Height,Count,Levels,Bytes\n");
+    for (const auto& it : fMipmaps)
+    {
+        const MipmapStats& stats = it.second;
+        stream.WriteString(ST::format("{},{},{},{},{},{}\n",
+                           std::get<0>(it.first), std::get<1>(it.first), std::get<2>(it.first),
+                           stats.fCount, stats.fLevels, stats.fBytes));
+    }
+    stream.Close();
+
+    return true;
+}
+
+bool plPageProfiler::WriteJSON(const plFileName& outputPath) const
+{
+    hsUNIXStream stream;
+    if (!stream.Open(outputPath, "wt"))
+        return false;
+
+    // Class and format names are plain identifiers, so nothing needs escaping
+    stream.WriteString("{\n  \"classes\": [\n");
+    for (auto it = fClasses.begin(); it != fClasses.end(); ++it)
+    {
+        const ClassStats& stats = it->second;
+        stream.WriteString(ST::format("    {{ \"class\": \"{}\", \"objects\": {}, \"bytes\": {}, "
+                           "\"compressedBytes\": {}, \"reads\": {}, \"readMs\": {.3f}, "
+                           "\"vertices\": {}, \"indices\": {} }{}\n",
+                           plFactory::GetNameOfClass(it->first),
+                           stats.fObjects, stats.fBytes, stats.fCompressedBytes,
+                           stats.fReads, hsTimer::GetMilliSeconds<double>(stats.fReadTicks),
+                           stats.fVertices, stats.fIndices,
+                           std::next(it) != fClasses.end() ? "," : ""));
+    }
+
+    stream.WriteString("  ],\n  \"mipmaps\": [\n");
+    for (auto it = fMipmaps.begin(); it != fMipmaps.end(); ++it)
+    {
+        const MipmapStats& stats = it->second;
+        stream.WriteString(ST::format("    {{ \"format\": \"{}\", \"width\": {}, \"height\": {}, "
+                           "\"count\": {}, \"levels\": {}, \"bytes\": {} }{}\n",
+                           std::get<0>(it->first), std::get<1>(it->first), std::get<2>(it->first),
+                           stats.fCount, stats.fLevels, stats.fBytes,
+                           std::next(it) != fMipmaps.end() ? "," : ""));
+    }
+    stream.WriteString("  ]\n}\n");
+
+    stream.Close();
+    return true;
+}
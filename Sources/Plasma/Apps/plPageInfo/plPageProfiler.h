@@ -0,0 +1,119 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+#ifndef plPageProfiler_h_inc
+#define plPageProfiler_h_inc
+
+#include "HeadSpin.h"
+#include "plFileSystem.h"
+
+#include <map>
+#include <string_theory/string>
+#include <tuple>
+#include <vector>
+
+class hsKeyedObject;
+class hsStream;
+class plKey;
+class plMipmap;
+class plRegistryPageNode;
+class plResManager;
+
+// Reads every object in every page of a data directory through the ResManager,
+// and collects what each class costs to store and to load.
+class plPageProfiler
+{
+public:
+    struct ClassStats
+    {
+        uint32_t fObjects;          // Number of keys in the page indices
+        uint64_t fBytes;            // Size of their data in the pages
+        uint64_t fCompressedBytes;  // Size of their data after zlib compression
+        uint32_t fReads;            // Number of times the ResManager read one in
+        uint64_t fReadTicks;        // Time spent reading them
+        uint64_t fVertices;         // For drawables, the vertices in their buffer groups
+        uint64_t fIndices;
+
+        ClassStats()
+            : fObjects(), fBytes(), fCompressedBytes(), fReads(), fReadTicks(),
+              fVertices(), fIndices() { }
+    };
+
+    struct MipmapStats
+    {
+        uint32_t fCount;
+        uint32_t fLevels;
+        uint64_t fBytes;
+
+        MipmapStats() : fCount(), fLevels(), fBytes() { }
+    };
+
+    // Format, width, height
+    typedef std::tuple<ST::string, uint32_t, uint32_t> MipmapKey;
+
+protected:
+    plResManager* fResMgr;
+
+    std::map<uint16_t, ClassStats> fClasses;
+    std::map<MipmapKey, MipmapStats> fMipmaps;
+    std::vector<uint8_t> fReadBuf;
+    std::vector<uint8_t> fCompressBuf;
+    uint64_t fLastReadTicks;
+
+    static plPageProfiler* fInstance;
+    static void IObjectRead(plKey key);
+
+    void IProfilePage(plRegistryPageNode* page);
+    void IMeasureData(hsStream* pageStream, const plKey& key);
+    void IInspectObject(hsKeyedObject* ko);
+    void IAddMipmap(const plMipmap* mip, const char* prefix);
+
+public:
+    plPageProfiler();
+    ~plPageProfiler();
+
+    bool Profile(const plFileName& dataDir);
+
+    bool WriteCSV(const plFileName& outputDir) const;
+    bool WriteJSON(const plFileName& outputPath) const;
+};
+
+#endif // plPageProfiler_h_inc
@@ -40,25 +40,75 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 *==LICENSE==*/
 
+#include "plAgeOptimizer.h"
 #include "plPageOptimizer.h"
 
 #include <string_theory/stdio>
 #include <vector>
 
+#include "plCmdParser.h"
+
 #include "pnNetCommon/plSynchedObject.h"
 
 #include "plResMgr/plResManager.h"
 
+enum CmdLineArgs
+{
+    kArgPath,
+    kArgAge,
+    kArgThreads,
+    kArgAlign,
+    kArgAlignThreshold,
+    kArgReport,
+};
+
+static const plCmdArgDef s_cmdLineArgs[] = {
+    { (kCmdTypeString | kCmdArgRequired), "Path", kArgPath },
+    { (kCmdTypeString | kCmdArgFlagged), "Age", kArgAge },
+    { (kCmdTypeUint | kCmdArgFlagged), "Threads", kArgThreads },
+    { (kCmdTypeUint | kCmdArgFlagged), "Align", kArgAlign },
+    { (kCmdTypeUint | kCmdArgFlagged), "AlignThreshold", kArgAlignThreshold },
+    { (kCmdTypeString | kCmdArgFlagged), "Report", kArgReport },
+};
+
+static void PrintHelp()
+{
+    puts("Usage: plPageOptimizer [options] pageFile");
+    puts("       plPageOptimizer --age AgeName [options] dataDir");
+    puts("Where:");
+    puts("       --age optimizes every page of AgeName in dataDir together");
+    puts("       --threads number of pages to rewrite at once (default: one per core)");
+    puts("       --align start objects of at least --alignthreshold bytes");
+    puts("               (default: 65536) on this byte boundary");
+    puts("       --report write a before/after layout report for the age to this .csv file");
+}
+
 int main(int argc, char* argv[])
 {
-    if (argc != 2)
+    std::vector<ST::string> args;
+    for (int i = 0; i < argc; ++i)
+        args.emplace_back(argv[i]);
+
+    plCmdParser parser(s_cmdLineArgs, std::size(s_cmdLineArgs));
+    if (!parser.Parse(args))
     {
         puts("plPageOptimizer: wrong number of arguments");
+        PrintHelp();
         return 1;
     }
 
-    plFileName filename = argv[1];
-    ST::printf("Optimizing {}...", filename);
+    plPageOptimizer::Options options;
+    if (parser.IsSpecified(kArgAlign))
+        options.fAlignment = parser.GetUint(kArgAlign);
+    if (parser.IsSpecified(kArgAlignThreshold))
+        options.fAlignThreshold = parser.GetUint(kArgAlignThreshold);
+
+    plFileName filename = parser.GetString(kArgPath);
+    ST::string ageName = parser.GetString(kArgAge);
+    if (ageName.empty())
+        ST::printf("Optimizing {}...", filename);
+    else
+        ST::printf("Optimizing age {} in {}...\n", ageName, filename);
 
 #ifndef _DEBUG
     try {
@@ -75,12 +125,31 @@ int main(int argc, char* argv[])
     }
 #endif
 
+    int result = 0;
+
 #ifndef _DEBUG
     try
 #endif
     {
-        plPageOptimizer optimizer(argv[1]);
-        optimizer.Optimize();
+        if (ageName.empty())
+        {
+            plPageOptimizer optimizer(filename, options);
+            optimizer.Optimize();
+        }
+        else
+        {
+            plAgeOptimizer optimizer(filename, ageName, options, parser.GetUint(kArgThreads));
+            if (!optimizer.Optimize())
+                result = 3;
+            optimizer.PrintReport();
+
+            if (parser.IsSpecified(kArgReport))
+            {
+                plFileName reportPath = parser.GetString(kArgReport);
+                if (!optimizer.WriteReport(reportPath))
+                    ST::printf("Couldn't write report to {}\n", reportPath);
+            }
+        }
     }
 #ifndef _DEBUG
     catch (std::exception &e) {
@@ -113,5 +182,5 @@ int main(int argc, char* argv[])
     }
 #endif
 
-    return 0;
+    return result;
 }
@@ -0,0 +1,177 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+#include "plAgeOptimizer.h"
+
+#include "hsStream.h"
+
+#include <algorithm>
+#include <atomic>
+#include <string_theory/stdio>
+#include <thread>
+
+#include "plResMgr/plResManager.h"
+
+plAgeOptimizer::plAgeOptimizer(const plFileName& dataDir, const ST::string& ageName,
+                               const plPageOptimizer::Options& options, unsigned numThreads)
+    : fDataDir(dataDir), fAgeName(ageName), fOptions(options), fNumThreads(numThreads)
+{
+    if (fNumThreads == 0)
+        fNumThreads = std::max(std::thread::hardware_concurrency(), 1U);
+}
+
+bool plAgeOptimizer::Optimize()
+{
+    plResManager* resMgr = (plResManager*)hsgResMgr::ResMgr();
+
+    ST::string pattern = ST::format("{}_District_*.prp", fAgeName);
+    std::vector<plFileName> pagePaths = plFileSystem::ListDir(fDataDir, pattern.c_str());
+    if (pagePaths.empty())
+    {
+        ST::printf("No pages found for age {} in {}\n", fAgeName, fDataDir);
+        return false;
+    }
+
+    // Skip the output of any previous runs that didn't clean up after themselves
+    for (const plFileName& path : pagePaths)
+    {
+        if (path.GetFileNameNoExt().ends_with("_opt"))
+            continue;
+
+        resMgr->AddSinglePage(path);
+
+        PageEntry entry;
+        entry.fOptimizer = std::make_unique<plPageOptimizer>(path, fOptions);
+        entry.fResult = plPageOptimizer::kNotLoaded;
+        fPages.push_back(std::move(entry));
+    }
+
+    for (PageEntry& page : fPages)
+        page.fOptimizer->Prepare();
+
+    for (PageEntry& page : fPages)
+    {
+        ST::printf("Loading {}...\n", page.fOptimizer->GetPagePath().GetFileName());
+        page.fOptimizer->LoadPage();
+    }
+
+    for (PageEntry& page : fPages)
+        page.fOptimizer->BuildLayout();
+
+    IRewritePages();
+
+    bool result = true;
+    for (const PageEntry& page : fPages)
+    {
+        if (page.fResult == plPageOptimizer::kFailed)
+            result = false;
+    }
+    return result;
+}
+
+void plAgeOptimizer::IRewritePages()
+{
+    std::atomic<size_t> nextPage(0);
+    auto worker = [this, &nextPage]() {
+        for (size_t i = nextPage++; i < fPages.size(); i = nextPage++)
+            fPages[i].fResult = fPages[i].fOptimizer->Rewrite();
+    };
+
+    size_t numThreads = std::min<size_t>(fNumThreads, fPages.size());
+    std::vector<std::thread> threads;
+    threads.reserve(numThreads);
+    for (size_t i = 0; i < numThreads; i++)
+        threads.emplace_back(worker);
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+void plAgeOptimizer::PrintReport() const
+{
+    plPageOptimizer::LayoutStats oldTotal, newTotal;
+
+    ST::printf("{<40} {>12} {>12} {>14} {>14}  {}\n", "Page", "Seeks", "(before)",
+               "Bytes Read", "(before)", "Result");
+    for (const PageEntry& page : fPages)
+    {
+        const plPageOptimizer::LayoutStats& oldStats = page.fOptimizer->GetOldStats();
+        const plPageOptimizer::LayoutStats& newStats = page.fOptimizer->GetNewStats();
+
+        ST::printf("{<40} {>12} {>12} {>14} {>14}  {}\n",
+                   page.fOptimizer->GetPagePath().GetFileName(),
+                   newStats.fSeeks, oldStats.fSeeks,
+                   newStats.fBytesRead, oldStats.fBytesRead,
+                   plPageOptimizer::GetResultString(page.fResult));
+
+        oldTotal.fSeeks += oldStats.fSeeks;
+        oldTotal.fBytesRead += oldStats.fBytesRead;
+        newTotal.fSeeks += newStats.fSeeks;
+        newTotal.fBytesRead += newStats.fBytesRead;
+    }
+    ST::printf("{<40} {>12} {>12} {>14} {>14}\n", "Total",
+               newTotal.fSeeks, oldTotal.fSeeks,
+               newTotal.fBytesRead, oldTotal.fBytesRead);
+}
+
+bool plAgeOptimizer::WriteReport(const plFileName& csvPath) const
+{
+    hsUNIXStream stream;
+    if (!stream.Open(csvPath, "wt"))
+        return false;
+
+    stream.WriteString("Page,Objects Loaded,Seeks Before,Seeks After,Bytes Read Before,Bytes Read After,Padding,Result\n");
+    for (const PageEntry& page : fPages)
+    {
+        const plPageOptimizer::LayoutStats& oldStats = page.fOptimizer->GetOldStats();
+        const plPageOptimizer::LayoutStats& newStats = page.fOptimizer->GetNewStats();
+
+        stream.WriteString(ST::format("{},{},{},{},{},{},{},{}\n",
+                           page.fOptimizer->GetPagePath().GetFileName(),
+                           page.fOptimizer->GetNumLoaded(),
+                           oldStats.fSeeks, newStats.fSeeks,
+                           oldStats.fBytesRead, newStats.fBytesRead,
+                           page.fOptimizer->GetPadding(),
+                           plPageOptimizer::GetResultString(page.fResult)));
+    }
+
+    stream.Close();
+    return true;
+}
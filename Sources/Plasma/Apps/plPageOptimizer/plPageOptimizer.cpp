@@ -43,6 +43,9 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 #include "hsStream.h"
 
+#include <algorithm>
+#include <string_theory/stdio>
+
 #include "pnFactory/plFactory.h"
 #include "pnKeyedObject/plKeyImp.h"
 #include "pnKeyedObject/plUoid.h"
@@ -53,230 +56,370 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plResMgr/plRegistryNode.h"
 
 
-plPageOptimizer* plPageOptimizer::fInstance = nullptr;
+std::map<plLocation, plPageOptimizer*> plPageOptimizer::fInstances;
 
-plPageOptimizer::plPageOptimizer(const plFileName& pagePath) :
+plPageOptimizer::plPageOptimizer(const plFileName& pagePath, const Options& options) :
+    fNewIndexStart(),
+    fPadding(),
+    fOptions(options),
     fOptimized(true),
     fPageNode(),
     fPagePath(pagePath)
 {
-    fInstance = this;
-
     fTempPagePath = fPagePath.StripFileExt() + "_opt.prp";
 
     fResMgr = (plResManager*)hsgResMgr::ResMgr();
 }
 
-void plPageOptimizer::IFindLoc()
+plPageOptimizer::~plPageOptimizer()
 {
-    class plPageIt : public plRegistryPageIterator 
-    {
-    public:
-        plLocation fLoc;
-
-        bool EatPage(plRegistryPageNode* keyNode) override
-        {
-            fLoc = keyNode->GetPageInfo().GetLocation();
-            return true;
-        }
-    };
+    if (fLoc.IsValid())
+        fInstances.erase(fLoc);
+}
 
-    plPageIt it;
-    fResMgr->IterateAllPages(&it);
-    fLoc = it.fLoc;
+const char* plPageOptimizer::GetResultString(Result result)
+{
+    switch (result)
+    {
+    case kNotLoaded:
+        return "nothing loaded";
+    case kAlreadyOptimized:
+        return "already optimized";
+    case kOptimized:
+        return "complete";
+    case kFailed:
+    default:
+        return "failed";
+    }
 }
 
-void plPageOptimizer::Optimize()
+void plPageOptimizer::Prepare()
 {
-    fResMgr->AddSinglePage(fPagePath);
+    fPageNode = fResMgr->FindSinglePage(fPagePath);
+    if (!fPageNode)
+        return;
 
     // Get the location of the page we're optimizing
-    IFindLoc();
+    fLoc = fPageNode->GetPageInfo().GetLocation();
 
-    bool loaded = true;
+    // Load all the keys
+    fResMgr->LoadPageKeys(fPageNode);
+
+    // Put all the keys in a vector, so they won't get unreffed
+    class plVecKeyCollector : public plRegistryKeyIterator
+    {
+    public:
+        KeyVec& fKeys;
+        plVecKeyCollector(KeyVec& keys) : fKeys(keys) {}
+        bool EatKey(const plKey& key) override { fKeys.push_back(key); return true; }
+    };
+    plVecKeyCollector keyIt(fAllKeys);
+    fResMgr->IterateKeys(&keyIt, fLoc);
+
+    // Set our load proc, which will track the order that objects are loaded
+    fInstances[fLoc] = this;
+    fResMgr->SetProgressBarProc(KeyedObjectProc);
+}
+
+bool plPageOptimizer::LoadPage()
+{
+    if (!fPageNode)
+        return false;
 
     // Get the key for the scene node, we'll load it to force a load on all the objects
     plKey snKey = plKeyFinder::Instance().FindSceneNodeKey(fLoc);
-    if (snKey)
-    {
-        // Load all the keys
-        fPageNode = fResMgr->FindPage(fLoc);
-        fResMgr->LoadPageKeys(fPageNode);
+    if (!snKey)
+        return false;
+
+    // Load the page
+    snKey->VerifyLoaded();
 
-        // Put all the keys in a vector, so they won't get unreffed
-        class plVecKeyCollector : public plRegistryKeyIterator
+    // Unload everything
+    snKey->RefObject();
+    snKey->UnRefObject();
+    snKey = nullptr;
+
+    return true;
+}
+
+void plPageOptimizer::KeyedObjectProc(plKey key)
+{
+    // Ignore any key that isn't in a page we're looking at.  That means stuff like
+    // textures when we're only optimizing a single page.
+    auto instIt = fInstances.find(key->GetUoid().GetLocation());
+    if (instIt == fInstances.end())
+        return;
+
+    KeySet& loadedKeys = instIt->second->fLoadedKeys;
+    KeyVec& loadOrder = instIt->second->fKeyLoadOrder;
+
+    KeySet::iterator it = loadedKeys.lower_bound(key);
+    if (it != loadedKeys.end() && *it == key)
+    {
+        // Expected in age mode, where several pages may pull in the same shared objects
+        if (fInstances.size() == 1)
         {
-        public:
-            KeyVec& fKeys;
-            plVecKeyCollector(KeyVec& keys) : fKeys(keys) {}
-            bool EatKey(const plKey& key) override { fKeys.push_back(key); return true; }
-        };
-        plVecKeyCollector keyIt(fAllKeys);
-        fResMgr->IterateKeys(&keyIt);
-
-        // Set our load proc, which will track the order that objects are loaded
-        fResMgr->SetProgressBarProc(KeyedObjectProc);
-
-        // Load the page
-        snKey->VerifyLoaded();
-
-        // Unload everything
-        snKey->RefObject();
-        snKey->UnRefObject();
-        snKey = nullptr;
+            ST::string keyName = key->GetName();
+            const char* className = plFactory::GetNameOfClass(key->GetUoid().GetClassType());
+            printf("Keyed object %s(%s) loaded more than once\n", keyName.c_str(), className);
+        }
     }
     else
     {
-        loaded = false;
+        loadedKeys.insert(it, key);
+        loadOrder.push_back(key);
     }
+}
 
-    if (loaded)
-        IRewritePage();
+void plPageOptimizer::IAddSpan(const plKey& key)
+{
+    plKeyImp* keyImp = (plKeyImp*)key;
+
+    ObjectSpan span;
+    span.fClassType = keyImp->GetUoid().GetClassType();
+    span.fObjectID = keyImp->GetUoid().GetObjectID();
+    span.fOldStart = keyImp->GetStartPos();
+    span.fNewStart = span.fOldStart;
+    span.fLen = keyImp->GetDataLen();
+    fLayout.push_back(span);
+}
 
-    uint64_t oldSize = plFileInfo(fPagePath).FileSize();
-    uint64_t newSize = plFileInfo(fTempPagePath).FileSize();
+void plPageOptimizer::BuildLayout()
+{
+    if (fLoc.IsValid())
+        fInstances.erase(fLoc);
+    if (!fPageNode)
+        return;
 
-    if (!loaded)
-    {
-        puts("no scene node.");
-    }
-    else if (fOptimized)
+    fPageInfo = fPageNode->GetPageInfo();
+
+    fLayout.clear();
+    fLayout.reserve(fAllKeys.size());
+    for (const plKey& key : fKeyLoadOrder)
+        IAddSpan(key);
+
+    // If there are any objects that we didn't load (because nothing referenced
+    // them), put them at the end, grouped by class so similar data stays together
+    KeyVec unloaded;
+    for (const plKey& key : fAllKeys)
     {
-        plFileSystem::Unlink(fTempPagePath);
-        puts("already optimized.");
+        if (fLoadedKeys.find(key) == fLoadedKeys.end())
+            unloaded.push_back(key);
     }
-    else if (oldSize == newSize)
+    std::stable_sort(unloaded.begin(), unloaded.end(), [](const plKey& a, const plKey& b) {
+        return a->GetUoid().GetClassType() < b->GetUoid().GetClassType();
+    });
+    for (const plKey& key : unloaded)
+        IAddSpan(key);
+
+    // Lay the objects out back to back, padding in front of any large objects
+    // (mipmaps, drawable vertex data) so they start on an aligned boundary
+    uint32_t pos = fPageInfo.GetDataStart();
+    fPadding = 0;
+    fOptimized = true;
+    for (ObjectSpan& span : fLayout)
     {
-        plFileSystem::Unlink(fPagePath);
-        plFileSystem::Move(fTempPagePath, fPagePath);
+        if (fOptions.fAlignment > 1 && span.fLen >= fOptions.fAlignThreshold)
+        {
+            uint32_t misalign = pos % fOptions.fAlignment;
+            if (misalign != 0)
+            {
+                fPadding += fOptions.fAlignment - misalign;
+                pos += fOptions.fAlignment - misalign;
+            }
+        }
 
-        puts("complete");
+        // If we move any buffers, this page wasn't optimized already
+        span.fNewStart = pos;
+        if (span.fNewStart != span.fOldStart)
+            fOptimized = false;
+
+        pos += span.fLen;
     }
-    else
+    fNewIndexStart = pos;
+
+    fOldStats = ISimulateLoad(false);
+    fNewStats = ISimulateLoad(true);
+}
+
+plPageOptimizer::LayoutStats plPageOptimizer::ISimulateLoad(bool newLayout) const
+{
+    // Walks the objects in the order they were loaded, assuming the stream only
+    // buffers the last block it read.  Any read that doesn't continue from that
+    // buffer is a seek.
+    LayoutStats stats;
+    uint32_t bufStart = 0;
+    uint32_t bufEnd = 0;
+    bool haveBuf = false;
+
+    for (size_t i = 0; i < fKeyLoadOrder.size(); i++)
     {
-        plFileSystem::Unlink(fTempPagePath);
-        puts("failed.  File sizes different");
+        const ObjectSpan& span = fLayout[i];
+        uint32_t start = newLayout ? span.fNewStart : span.fOldStart;
+        uint32_t end = start + span.fLen;
+
+        if (!haveBuf || start < bufStart || start > bufEnd)
+        {
+            stats.fSeeks++;
+            bufStart = bufEnd = start - (start % kSimReadBlockSize);
+            haveBuf = true;
+        }
+
+        while (bufEnd < end)
+        {
+            stats.fBytesRead += kSimReadBlockSize;
+            bufEnd += kSimReadBlockSize;
+        }
+        bufStart = std::max(bufStart, bufEnd - kSimReadBlockSize);
     }
+
+    return stats;
 }
 
-void plPageOptimizer::KeyedObjectProc(plKey key)
+plPageOptimizer::Result plPageOptimizer::Rewrite()
 {
-    ST::string keyName = key->GetName();
-    const char* className = plFactory::GetNameOfClass(key->GetUoid().GetClassType());
+    if (fKeyLoadOrder.empty())
+        return kNotLoaded;
 
-    // For now, ignore any key that isn't in the location we're looking at.  That means stuff like textures.
-    if (fInstance->fLoc != key->GetUoid().GetLocation())
-        return;
-
-    KeySet& loadedKeys = fInstance->fLoadedKeys;
-    KeyVec& loadOrder = fInstance->fKeyLoadOrder;
+    // Nothing moves, so don't bother writing it all out
+    if (fOptimized)
+        return kAlreadyOptimized;
 
-    KeySet::iterator it = loadedKeys.lower_bound(key);
-    if (it != loadedKeys.end() && *it == key)
+    if (!IRewritePage())
     {
-        printf("Keyed object %s(%s) loaded more than once\n", keyName.c_str(), className);
+        plFileSystem::Unlink(fTempPagePath);
+        return kFailed;
     }
-    else
+
+    // Everything past the data section is the index, which doesn't change size
+    uint64_t oldSize = plFileInfo(fPagePath).FileSize();
+    uint64_t newSize = plFileInfo(fTempPagePath).FileSize();
+    uint64_t indexSize = oldSize - fPageInfo.GetIndexStart();
+
+    if (newSize == fNewIndexStart + indexSize)
     {
-        loadedKeys.insert(it, key);
-        loadOrder.push_back(key);
+        plFileSystem::Unlink(fPagePath);
+        plFileSystem::Move(fTempPagePath, fPagePath);
+        return kOptimized;
     }
+
+    plFileSystem::Unlink(fTempPagePath);
+    return kFailed;
 }
 
-void plPageOptimizer::IWriteKeyData(hsStream* oldPage, hsStream* newPage, plKey key)
+void plPageOptimizer::Optimize()
 {
-    class plUpdateKeyImp : public plKeyImp
-    {
-    public:
-        void SetStartPos(uint32_t startPos) { fStartPos = startPos; }
-    };
+    fResMgr->AddSinglePage(fPagePath);
 
-    plUpdateKeyImp* keyImp = (plUpdateKeyImp*)(plKeyImp*)key;
-    uint32_t startPos = keyImp->GetStartPos();
-    uint32_t len = keyImp->GetDataLen();
+    Prepare();
+    bool loaded = LoadPage();
+    BuildLayout();
 
-    oldPage->SetPosition(startPos);
-    if (len > fBuf.size())
-        fBuf.resize(len);
-    oldPage->Read(len, &fBuf[0]);
+    if (!loaded)
+    {
+        puts("no scene node.");
+        return;
+    }
 
-    uint32_t newStartPos = newPage->GetPosition();
+    Result result = Rewrite();
+    ST::printf("{}.  seeks {} -> {}, bytes read {} -> {}\n", GetResultString(result),
+               fOldStats.fSeeks, fNewStats.fSeeks, fOldStats.fBytesRead, fNewStats.fBytesRead);
+}
 
-    // If we move any buffers, this page wasn't optimized already
-    if (newStartPos != startPos)
-        fOptimized = false;
+void plPageOptimizer::IWriteKeyData(hsStream* oldPage, hsStream* newPage, const ObjectSpan& span)
+{
+    oldPage->SetPosition(span.fOldStart);
+    if (span.fLen > fBuf.size())
+        fBuf.resize(span.fLen);
+    oldPage->Read(span.fLen, fBuf.data());
+
+    // Zero fill any alignment padding
+    uint32_t pos = newPage->GetPosition();
+    if (pos < span.fNewStart)
+    {
+        std::vector<uint8_t> padding(span.fNewStart - pos, 0);
+        newPage->Write(padding.size(), padding.data());
+    }
 
-    keyImp->SetStartPos(newStartPos);
-    newPage->Write(len, &fBuf[0]);
+    newPage->Write(span.fLen, fBuf.data());
 }
 
-void plPageOptimizer::IRewritePage()
+bool plPageOptimizer::IRewritePage()
 {
     hsUNIXStream newPage;
+    if (!newPage.Open(fTempPagePath, "wb"))
+        return false;
 
-    if (newPage.Open(fTempPagePath, "wb"))
-    {
-        hsUNIXStream oldPage;
-        oldPage.Open(fPagePath);
+    hsUNIXStream oldPage;
+    if (!oldPage.Open(fPagePath))
+        return false;
 
-        const plPageInfo& pageInfo = fPageNode->GetPageInfo();
+    uint32_t dataStart = fPageInfo.GetDataStart();
 
-        uint32_t dataStart = pageInfo.GetDataStart();
+    fBuf.resize(dataStart);
 
-        fBuf.resize(dataStart);
+    oldPage.Read(dataStart, fBuf.data());
+    newPage.Write(dataStart, fBuf.data());
 
-        oldPage.Read(dataStart, &fBuf[0]);
-        newPage.Write(dataStart, &fBuf[0]);
+    std::map<std::pair<uint16_t, uint32_t>, uint32_t> newStarts;
+    for (const ObjectSpan& span : fLayout)
+    {
+        IWriteKeyData(&oldPage, &newPage, span);
+        newStarts[std::make_pair(span.fClassType, span.fObjectID)] = span.fNewStart;
+    }
 
-        int size = (int)fKeyLoadOrder.size();
-        for (int i = 0; i < size; i++)
-            IWriteKeyData(&oldPage, &newPage, fKeyLoadOrder[i]);
+    oldPage.SetPosition(fPageInfo.GetIndexStart());
 
-        // If there are any objects that we didn't write (because they didn't load for
-        // some reason), put them at the end
-        for (int i = 0; i < fAllKeys.size(); i++)
-        {
-            bool found = (fLoadedKeys.find(fAllKeys[i]) != fLoadedKeys.end());
-            if (!found)
-                IWriteKeyData(&oldPage, &newPage, fAllKeys[i]);
-        }
+    uint32_t numTypes = oldPage.ReadLE32();
+    newPage.WriteLE32(numTypes);
 
-        uint32_t oldKeyStart = pageInfo.GetIndexStart();
-        oldPage.SetPosition(oldKeyStart);
+    for (uint32_t i = 0; i < numTypes; i++)
+    {
+        uint16_t classType = oldPage.ReadLE16();
+        uint32_t len = oldPage.ReadLE32();
+        uint8_t flags = oldPage.ReadByte();
+        uint32_t numKeys = oldPage.ReadLE32();
 
-        uint32_t numTypes = oldPage.ReadLE32();
-        newPage.WriteLE32(numTypes);
+        newPage.WriteLE16(classType);
+        newPage.WriteLE32(len);
+        newPage.WriteByte(flags);
+        newPage.WriteLE32(numKeys);
 
-        for (uint32_t i = 0; i < numTypes; i++)
+        for (uint32_t j = 0; j < numKeys; j++)
         {
-            uint16_t classType = oldPage.ReadLE16();
-            uint32_t len = oldPage.ReadLE32();
-            uint8_t flags = oldPage.ReadByte();
-            uint32_t numKeys = oldPage.ReadLE32();
+            plUoid uoid;
+            uoid.Read(&oldPage);
+            uint32_t startPos = oldPage.ReadLE32();
+            uint32_t dataLen = oldPage.ReadLE32();
+
+            // Get the new start pos
+            auto it = newStarts.find(std::make_pair(uoid.GetClassType(), uoid.GetObjectID()));
+            if (it != newStarts.end())
+                startPos = it->second;
+
+            uoid.Write(&newPage);
+            newPage.WriteLE32(startPos);
+            newPage.WriteLE32(dataLen);
+        }
+    }
 
-            newPage.WriteLE16(classType);
-            newPage.WriteLE32(len);
-            newPage.WriteByte(flags);
-            newPage.WriteLE32(numKeys);
+    bool result = true;
 
-            for (uint32_t j = 0; j < numKeys; j++)
-            {
-                plUoid uoid;
-                uoid.Read(&oldPage);
-                uint32_t startPos = oldPage.ReadLE32();
-                uint32_t dataLen = oldPage.ReadLE32();
-
-                // Get the new start pos
-                plKeyImp* key = (plKeyImp*)fResMgr->FindKey(uoid);
-                startPos = key->GetStartPos();
-
-                uoid.Write(&newPage);
-                newPage.WriteLE32(startPos);
-                newPage.WriteLE32(dataLen);
-            }
-        }
+    // Padding moved the index, so the header needs the new offset and checksum.
+    // This only works if we write the same header version we read.
+    if (fNewIndexStart != fPageInfo.GetIndexStart())
+    {
+        plPageInfo pageInfo = fPageInfo;
+        pageInfo.SetIndexStart(fNewIndexStart);
+        pageInfo.SetChecksum(newPage.GetPosition() - dataStart);
 
-        newPage.Close();
-        oldPage.Close();
+        newPage.Rewind();
+        pageInfo.Write(&newPage);
+        result = (newPage.GetPosition() == dataStart);
     }
+
+    newPage.Close();
+    oldPage.Close();
+
+    return result;
 }
@@ -44,24 +44,75 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 #include "pnKeyedObject/plUoid.h"
 #include "plFileSystem.h"
+#include "plResMgr/plPageInfo.h"
+#include <map>
 #include <vector>
 #include <set>
 
+class hsStream;
 class plKey;
 class plRegistryPageNode;
 class plResManager;
 
 class plPageOptimizer
 {
+public:
+    struct Options
+    {
+        uint32_t fAlignment;        // Boundary to start large objects on, 0 to disable
+        uint32_t fAlignThreshold;   // Objects at least this many bytes get aligned
+
+        Options() : fAlignment(0), fAlignThreshold(64 * 1024) { }
+    };
+
+    // Cost of reading the objects in load order, the way PageInRoom would
+    struct LayoutStats
+    {
+        uint32_t fSeeks;
+        uint64_t fBytesRead;
+
+        LayoutStats() : fSeeks(0), fBytesRead(0) { }
+    };
+
+    enum Result
+    {
+        kNotLoaded,
+        kAlreadyOptimized,
+        kOptimized,
+        kFailed
+    };
+
 protected:
     typedef std::vector<plKey> KeyVec;
     typedef std::set<plKey> KeySet;
 
+    struct ObjectSpan
+    {
+        uint16_t fClassType;
+        uint32_t fObjectID;
+        uint32_t fOldStart;
+        uint32_t fNewStart;
+        uint32_t fLen;
+    };
+
+    // Size of the buffered reads assumed when simulating a page load
+    static constexpr uint32_t kSimReadBlockSize = 4096;
+
     KeyVec fKeyLoadOrder;   // The order objects were loaded in
     KeySet fLoadedKeys;     // Keys we've loaded objects for, for quick lookup
     KeyVec fAllKeys;        // All the keys in the page
+
+    std::vector<ObjectSpan> fLayout;    // Objects in the order they'll be written
     std::vector<uint8_t> fBuf;
 
+    plPageInfo fPageInfo;   // Copy of the header, so we don't need the registry to rewrite
+    uint32_t fNewIndexStart;
+    uint32_t fPadding;      // Bytes of alignment padding added to the data section
+
+    LayoutStats fOldStats;
+    LayoutStats fNewStats;
+
+    Options fOptions;
     bool fOptimized;        // True after optimization if the page was already optimized
 
     plFileName fPagePath;           // Path to our page
@@ -71,17 +122,38 @@ protected:
 
     plResManager* fResMgr;
 
-    static plPageOptimizer* fInstance;
+    // Every page being recorded, so objects loaded through references from
+    // other pages (eg, the textures page) are tracked in the right one
+    static std::map<plLocation, plPageOptimizer*> fInstances;
     static void KeyedObjectProc(plKey key);
 
-    void IWriteKeyData(hsStream* oldPage, hsStream* newPage, plKey key);
-    void IFindLoc();
-    void IRewritePage();
+    void IAddSpan(const plKey& key);
+    LayoutStats ISimulateLoad(bool newLayout) const;
+    void IWriteKeyData(hsStream* oldPage, hsStream* newPage, const ObjectSpan& span);
+    bool IRewritePage();
 
 public:
-    plPageOptimizer(const plFileName& pagePath);
+    static const char* GetResultString(Result result);
+
+    plPageOptimizer(const plFileName& pagePath, const Options& options = Options());
+    ~plPageOptimizer();
+
+    // These touch the ResManager and must be called from the main thread, in order
+    void Prepare();
+    bool LoadPage();
+    void BuildLayout();
 
+    // Only works off the layout, so pages can be rewritten concurrently
+    Result Rewrite();
+
+    // Single page version of all of the above
     void Optimize();
+
+    const plFileName& GetPagePath() const { return fPagePath; }
+    const LayoutStats& GetOldStats() const { return fOldStats; }
+    const LayoutStats& GetNewStats() const { return fNewStats; }
+    uint32_t GetPadding() const { return fPadding; }
+    size_t GetNumLoaded() const { return fKeyLoadOrder.size(); }
 };
 
 #endif // plPageOptimizer_h_inc
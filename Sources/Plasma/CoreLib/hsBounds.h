@@ -266,6 +266,7 @@ public:
     void MakeSymmetric(const hsPoint3* p) override; // Expands bounds to be symmetric about p
     void InscribeSphere() override;
     virtual void Unalign();
+    bool IsAxisAligned() const { return 0 != (fExtFlags & kAxisAligned); }
 
     void Transform(const hsMatrix44 *m) override;
     virtual void Translate(const hsVector3 &v);
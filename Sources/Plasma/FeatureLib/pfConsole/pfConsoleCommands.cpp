@@ -72,6 +72,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "pnMessage/plClientMsg.h"
 #include "pnMessage/plEnableMsg.h"
 #include "pnMessage/plEventCallbackMsg.h"
+#include "pnMessage/plMessagePool.h"
 #include "pnMessage/plNodeChangeMsg.h"
 #include "pnMessage/plNodeRefMsg.h"
 #include "pnMessage/plNotifyMsg.h"
@@ -86,6 +87,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 #include "plAgeDescription/plAgeDescription.h"
 #include "plAgeLoader/plAgeLoader.h"
+#include "plAnimation/plAGMasterMod.h"
 #include "plAudio/plAudioSystem.h"
 #include "plAudio/plVoiceChat.h"
 #include "plAvatar/plArmatureMod.h"
@@ -130,7 +132,9 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plParticleSystem/plParticleEffect.h"
 #include "plParticleSystem/plParticleGenerator.h"
 #include "plParticleSystem/plParticleSystem.h"
+#include "plPhysX/plLOSDispatch.h"
 #include "plPhysX/plPXPhysicalControllerCore.h"
+#include "plPhysX/plPXSimulation.h"
 #include "plPhysX/plSimulationMgr.h"
 #include "plPhysical/plPhysicalSDLModifier.h"
 #include "plPipeline/plDebugText.h"
@@ -990,6 +994,22 @@ PF_CONSOLE_CMD( Graphics_VisSet, Toggle, "", "Toggle using VisSets" )
     pfConsolePrintF(PrintString, "Visibility Sets {}", turnOn ? "Enabled" : "Disabled");
 }
 
+PF_CONSOLE_CMD( Graphics, SoftOcclusion, "bool enable", "Cull spans hidden behind occluders with a CPU depth buffer" )
+{
+    bool enable = (bool)params[0];
+    plPageTreeMgr::EnableSoftOcclusion(enable);
+
+    pfConsolePrintF(PrintString, "Software occlusion {}", enable ? "Enabled" : "Disabled");
+}
+
+PF_CONSOLE_CMD( Graphics, HarvestThreads, "int numThreads", "Threads to harvest visible scene nodes with (0 = one per core, 1 = off)" )
+{
+    int numThreads = (int)params[0];
+    plPageTreeMgr::SetHarvestThreads(numThreads < 0 ? 1 : (uint32_t)numThreads);
+
+    pfConsolePrintF(PrintString, "Scene node harvest threads set to {}", plPageTreeMgr::GetHarvestThreads());
+}
+
 PF_CONSOLE_CMD( Graphics, BumpNormal, "", "Set bump mapping method to default for your hardware." )
 {
     PF_SANITY_CHECK( pfConsole::GetPipeline(), "This command MUST be used in an .fni file (after pipeline initialization)" );
@@ -2465,6 +2485,14 @@ PF_CONSOLE_CMD( Dispatch_Log,       // groupName
     plDispatchLog::GetInstance()->SetFlags(plDispatchLog::GetInstance()->GetFlags() & ~plDispatchLog::kInclude);
 }
 
+PF_CONSOLE_CMD( Dispatch, PoolMessages, "bool enable", "Recycle message memory through per-thread freelists" )
+{
+    bool enable = (bool)params[0];
+    plMessagePool::SetPooling(enable);
+
+    pfConsolePrintF(PrintString, "Message pooling {}", enable ? "Enabled" : "Disabled");
+}
+
 #endif // LIMIT_CONSOLE_COMMANDS
 
 //////////////////////////////////////////////////////////////////////////////
@@ -5075,6 +5103,28 @@ PF_CONSOLE_CMD(Physics,
     plSimulationMgr::GetInstance()->ResetKickables();
 }
 
+PF_CONSOLE_CMD(Physics,
+               LOSThreads,
+               "int numThreads",
+               "Run each frame's line of sight requests across threads (0 = one per core, 1 = off)")
+{
+    int numThreads = (int)params[0];
+    plLOSDispatch::SetQueryThreads(numThreads < 0 ? 1 : (uint32_t)numThreads);
+
+    pfConsolePrintF(PrintString, "Line of sight threads set to {}", plLOSDispatch::GetQueryThreads());
+}
+
+PF_CONSOLE_CMD(Physics,
+               StepThreads,
+               "int numThreads",
+               "Run the simulation step alongside the rest of the frame (0 = one per core, 1 = off)")
+{
+    int numThreads = (int)params[0];
+    plPXSimulation::SetStepThreads(numThreads < 0 ? 1 : (uint32_t)numThreads);
+
+    pfConsolePrintF(PrintString, "Simulation step threads set to {}", plPXSimulation::GetStepThreads());
+}
+
 #endif // LIMIT_CONSOLE_COMMANDS
 
 
@@ -5708,6 +5758,17 @@ PF_CONSOLE_CMD( Animation,
     pfConsolePrintF(PrintString, "Potential delay of transform eval is now {}", (enabled ? "ENABLED" : "DISABLED"));
 }
 
+PF_CONSOLE_CMD( Animation,
+               EvalThreads,
+               "int numThreads",
+               "Evaluate animation poses across threads (0 = one per core, 1 = off)" )
+{
+    int numThreads = (int)params[0];
+    plAGMasterMod::SetEvalThreads(numThreads < 0 ? 1 : (uint32_t)numThreads);
+
+    pfConsolePrintF(PrintString, "Animation eval threads set to {}", plAGMasterMod::GetEvalThreads());
+}
+
 #endif // LIMIT_CONSOLE_COMMANDS
 
 ////////////////////////////////////////////////////////////////////////
@@ -680,6 +680,43 @@ PF_CONSOLE_CMD( Net_Log,        // groupName
 
 #endif
 
+///////////////////////////////////////
+#ifndef LIMIT_CONSOLE_COMMANDS
+
+PF_CONSOLE_SUBGROUP( Net, Compression )     // Creates sub-group Net.Compression
+
+PF_CONSOLE_CMD( Net_Compression,            // groupName
+               Level,                       // fxnName
+               "int level",                 // paramList
+               "Set the zlib level (1-9, -1 for default) net message streams are compressed at" )   // helpString
+{
+    int level = params[0];
+    PF_SANITY_CHECK( level >= -1 && level <= 9, "Level must be between 1 and 9, or -1 for the default" );
+    plNetMsgStreamHelper::SetCompressionLevel(level);
+}
+
+PF_CONSOLE_CMD( Net_Compression,            // groupName
+               Threshold,                   // fxnName
+               "int bytes",                 // paramList
+               "Set the size net message streams must exceed to be compressed" )    // helpString
+{
+    int bytes = params[0];
+    PF_SANITY_CHECK( bytes >= 0, "Threshold must not be negative" );
+    plNetMsgStreamHelper::SetDefaultCompressionThreshold(bytes);
+}
+
+PF_CONSOLE_CMD( Net_Compression,            // groupName
+               FastThreshold,               // fxnName
+               "int bytes",                 // paramList
+               "Set the size at which net message streams use LZ4, if the shard allows it" )    // helpString
+{
+    int bytes = params[0];
+    PF_SANITY_CHECK( bytes >= 0, "Threshold must not be negative" );
+    plNetMsgStreamHelper::SetFastCompressionThreshold(bytes);
+}
+
+#endif
+
 ///////////////////////////////////////
 // Account Authentication
 PF_CONSOLE_SUBGROUP( Net, Auth )        // Creates an AUTH sub-group under a given group
@@ -741,6 +778,16 @@ PF_CONSOLE_CMD( Net_Vault,      // groupName
 
 ///////////////////////////////////////
 
+PF_CONSOLE_CMD( Net_Vault,      // groupName
+               EnableNodeCache,     // fxnName
+               "bool enable", // paramList
+               "Keep downloaded vaults on disk to speed up the next download" )  // helpString
+{
+    VaultSetNodeCacheEnabled((bool)params[0]);
+}
+
+///////////////////////////////////////
+
 PF_CONSOLE_CMD( Net_Vault,      // groupName
                InMyPersonalAge,     // fxnName
                "", // paramList
@@ -236,6 +236,16 @@ PF_CONSOLE_CMD(
     kGameDhGValue = (int)params[0];
 }
 
+//============================================================================
+PF_CONSOLE_CMD(
+    Server_Game,
+    FastCompression,
+    "bool enable",
+    "Allow LZ4 compressed message streams (every client on the shard must support them)"
+    ) {
+    SetGameSrvFastCompression((bool)params[0]);
+}
+
 
 //============================================================================
 // Server.Gate group
@@ -51,6 +51,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plgDispatch.h"
 #include "hsResMgr.h"
 
+#include <algorithm>
 #include <memory>
 
 #include "pfGameGUIMgr.h"
@@ -392,6 +393,10 @@ void    pfGUIMultiLineEditCtrl::IUpdate( int32_t startLine, int32_t endLine )
 
     // Start at our line
     uint16_t y = (uint16_t)((startLine - fScrollPos) * fLineHeight + fTopMargin);
+    // Find the color and style once, then carry them from line to line
+    LineState state{};
+    if (startLine <= endLine)
+        state = IGetLineState(fLineStarts[startLine]);
     // And loop!
 
     int32_t line;
@@ -409,13 +414,13 @@ void    pfGUIMultiLineEditCtrl::IUpdate( int32_t startLine, int32_t endLine )
                       ? (int32_t)fBuffer.size() : fLineStarts[line + 1];
 
         // Render the actual text
-        IRenderLine(fLeftMargin, y, start, end);
+        IRenderLine(fLeftMargin, y, start, end, state);
 
         // Render the cursor
         if( fCursorPos >= start && fCursorPos < end && IsFocused() )
         {
             uint16_t x = (fCursorPos > start)
-                         ? (uint16_t)IRenderLine(fLeftMargin, y, start, fCursorPos, true)
+                         ? (uint16_t)IRenderLine(fLeftMargin, y, start, fCursorPos, state, true)
                          : (uint16_t)fLeftMargin;
 
             fDynTextMap->FrameRect(x, y, 2, fLineHeight, GetColorScheme()->fSelForeColor);
@@ -426,6 +431,7 @@ void    pfGUIMultiLineEditCtrl::IUpdate( int32_t startLine, int32_t endLine )
             fCurrCursorX = x;
             fCurrCursorY = y;
         }
+        IAdvanceLineState(state, start, end);
         y += fLineHeight;
     }
     if (clearEachLine && line >= (int32_t)fLineStarts.size() && y < fDynTextMap->GetVisibleHeight() - fBottomMargin)
@@ -515,22 +521,53 @@ bool    pfGUIMultiLineEditCtrl::IFindLastStyleCode( int32_t pos, uint8_t &style,
     return false;
 }
 
+//// IGetLineState ///////////////////////////////////////////////////////////
+//  Returns the color and style in effect at the given position, i.e. what
+//  the last codes at or before that position set them to.
+
+pfGUIMultiLineEditCtrl::LineState pfGUIMultiLineEditCtrl::IGetLineState( int32_t pos ) const
+{
+    LineState state;
+    IFindLastColorCode( pos, state.fColor );
+    IFindLastStyleCode( pos, state.fStyle );
+    return state;
+}
+
+//// IAdvanceLineState ///////////////////////////////////////////////////////
+//  Given the state at one position, walks forward to get the state at a later
+//  one. Same result as IGetLineState( to ), but only costs the distance
+//  walked instead of a search back through everything before it.
+
+void    pfGUIMultiLineEditCtrl::IAdvanceLineState( LineState &state, int32_t from, int32_t to ) const
+{
+    to = std::min(to, (int32_t)fBuffer.size() - 1);
+    for (int32_t pos = from; pos < to; )
+    {
+        pos += IOffsetToNextChar( fBuffer[ pos ] );
+        if( pos > to )
+            break;
+
+        int32_t codePos = pos;
+        if (fBuffer[pos] == kColorCodeChar)
+            IReadColorCode( codePos, state.fColor );
+        else if (fBuffer[pos] == kStyleCodeChar)
+            IReadStyleCode( codePos, state.fStyle );
+    }
+}
+
 //// IRenderLine /////////////////////////////////////////////////////////////
 //  Renders a null-terminated string to the dynamic text map at the location
 //  given. Takes into account style codes and special characters (like returns
-//  and tabs). Returns the final X value after rendering.
+//  and tabs). The state must be the one at the start position (see
+//  IGetLineState()). Returns the final X value after rendering.
 
-uint32_t  pfGUIMultiLineEditCtrl::IRenderLine( uint16_t x, uint16_t y, int32_t start, int32_t end, bool dontRender )
+uint32_t  pfGUIMultiLineEditCtrl::IRenderLine( uint16_t x, uint16_t y, int32_t start, int32_t end, const LineState &state, bool dontRender )
 {
     int32_t       pos;
-    hsColorRGBA currColor = fFontColor;
-    uint8_t       currStyle;
+    hsColorRGBA currColor = state.fColor;
+    uint8_t       currStyle = state.fStyle;
     const wchar_t *buffer = fBuffer.data();
 
-    // First, gotta go back from our starting position and find a color and style code to use
-    IFindLastColorCode( start, currColor );
-    IFindLastStyleCode( start, currStyle );
-
     fDynTextMap->SetTextColor( currColor, HasFlag( kXparentBgnd ) ? true : false );
     fDynTextMap->SetFont( fFontFace, fFontSize, GetColorScheme()->fFontFlags | currStyle,
                             HasFlag( kXparentBgnd ) ? false : true );
@@ -663,10 +700,11 @@ int32_t   pfGUIMultiLineEditCtrl::IPointToPosition( int16_t ptX, int16_t ptY, bo
             int32_t end = (line == (int32_t)fLineStarts.size() - 1)
                           ? (int32_t)fBuffer.size() - 1 : fLineStarts[line + 1];
 
+            LineState state = IGetLineState(start);
             int32_t pos;
             for (pos = start; pos < end; pos++)
             {
-                int16_t x = (int16_t)IRenderLine(fLeftMargin, 0, start, pos, true);
+                int16_t x = (int16_t)IRenderLine(fLeftMargin, 0, start, pos, state, true);
                 if( x > ptX )
                     break;
             }
@@ -761,6 +799,7 @@ int32_t   pfGUIMultiLineEditCtrl::IRecalcLineStarts( int32_t startingLine, bool
     // Precalculate some helper values
     wrapWidth = fDynTextMap->GetVisibleWidth() - fRightMargin;
     wchar_t* buffer = fBuffer.data();
+    LineState state = IGetLineState(charPos);
 
     for (; charPos < (int32_t)fBuffer.size(); currLine++)
     {
@@ -808,7 +847,7 @@ int32_t   pfGUIMultiLineEditCtrl::IRecalcLineStarts( int32_t startingLine, bool
                 nextPos += IOffsetToNextChar( buffer[ nextPos ] );
 
             // Now see how much width this is
-            widthCounter = (uint16_t)IRenderLine( fLeftMargin, 0, startPos, nextPos, true );
+            widthCounter = (uint16_t)IRenderLine( fLeftMargin, 0, startPos, nextPos, state, true );
             
             // Now we loop. If wrapWidth is too much, we'll break the loop with charPos pointing to the
             // end of our line. If not, charPos will advance to start the search again
@@ -822,12 +861,15 @@ int32_t   pfGUIMultiLineEditCtrl::IRecalcLineStarts( int32_t startingLine, bool
             while( widthCounter >= wrapWidth && nextPos > startPos )
             {
                 nextPos -= IOffsetToNextChar( buffer[ nextPos - 1 ] );
-                widthCounter = (uint16_t)IRenderLine( fLeftMargin, 0, startPos, nextPos, true );
+                widthCounter = (uint16_t)IRenderLine( fLeftMargin, 0, startPos, nextPos, state, true );
             }
 
             charPos = nextPos;
         }
 
+        // Carry our color and style over to the start of the next line
+        IAdvanceLineState(state, startPos, charPos);
+
         // Continue on!     
     }
 
@@ -872,18 +914,15 @@ bool    pfGUIMultiLineEditCtrl::IStoreLineStart(int32_t line, int32_t start)
 
 int32_t   pfGUIMultiLineEditCtrl::IFindCursorLine( int32_t cursorPos ) const
 {
-    int32_t   line;
-
-
     if( cursorPos == -1 )
         cursorPos = fCursorPos;
 
-    for (line = 0; line < (int32_t)fLineStarts.size() - 1; line++)
-    {
-        if( fLineStarts[ line + 1 ] > cursorPos )
-            break;
-    }
-    return line;
+    if (fLineStarts.size() < 2)
+        return 0;
+
+    // Line starts are sorted, so find the first line that starts past the cursor
+    auto next = std::upper_bound(fLineStarts.cbegin() + 1, fLineStarts.cend(), cursorPos);
+    return (int32_t)(next - fLineStarts.cbegin()) - 1;
 }
 
 //// IRecalcFromCursor ///////////////////////////////////////////////////////
@@ -926,8 +965,9 @@ void    pfGUIMultiLineEditCtrl::IOffsetLineStarts( uint32_t position, int32_t of
         }
     }
 
-    // Offset all lines past our given position
-    for (line = 0; line < (int32_t)fLineStarts.size(); line++)
+    // Offset all lines past our given position. Nothing before the line we
+    // found can start past it, so don't bother looking there.
+    for (; line < (int32_t)fLineStarts.size(); line++)
     {
         if( fLineStarts[ line ] > position )
             fLineStarts[ line ] += offset;
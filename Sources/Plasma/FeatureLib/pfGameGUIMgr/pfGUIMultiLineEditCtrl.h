@@ -98,6 +98,12 @@ class pfGUIMultiLineEditCtrl : public pfGUIControlMod
 
     protected:
 
+        // One contiguous, null-terminated run, since rendering, word wrap and
+        // plStringSlicer all read slices of it in place, and linked controls
+        // get a full copy of it on every edit anyway. There's no limit by
+        // default (fBufferLimit is -1), so an insert or erase moves everything
+        // after the cursor. plTextEditBenchmark times that against a gap
+        // buffer on documents of 1 to 256 KB.
         std::vector<wchar_t> fBuffer;
         std::vector<int32_t> fLineStarts;
         uint16_t        fLineHeight, fCurrCursorX, fCurrCursorY;
@@ -156,9 +162,20 @@ class pfGUIMultiLineEditCtrl : public pfGUIControlMod
         int32_t   IPointToPosition( int16_t x, int16_t y, bool searchOutsideBounds = false );
         int32_t   ICalcNumVisibleLines() const;
 
+        // Color and style in effect at a buffer position. Computed once per
+        // line and carried forward, rather than searched for backward from
+        // every position we measure or draw.
+        struct LineState
+        {
+            hsColorRGBA fColor;
+            uint8_t     fStyle;
+        };
+
         void    IReadColorCode( int32_t &pos, hsColorRGBA &color ) const;
         void    IReadStyleCode( int32_t &pos, uint8_t &fontStyle ) const;
-        uint32_t  IRenderLine( uint16_t x, uint16_t y, int32_t start, int32_t end, bool dontRender = false );
+        LineState   IGetLineState( int32_t pos ) const;
+        void    IAdvanceLineState( LineState &state, int32_t from, int32_t to ) const;
+        uint32_t  IRenderLine( uint16_t x, uint16_t y, int32_t start, int32_t end, const LineState &state, bool dontRender = false );
         bool    IFindLastColorCode( int32_t pos, hsColorRGBA &color, bool ignoreFirstCharacter = false ) const;
         bool    IFindLastStyleCode( int32_t pos, uint8_t &style, bool ignoreFirstCharacter = false ) const;
 
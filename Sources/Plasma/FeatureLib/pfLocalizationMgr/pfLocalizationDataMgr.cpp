@@ -47,6 +47,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 //////////////////////////////////////////////////////////////////////
 
 #include "HeadSpin.h"
+#include "hsStream.h"
 
 #include "plFile/plEncryptedStream.h"
 #include "plResMgr/plLocalization.h"
@@ -58,6 +59,9 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 #include <expat.h>
 
+#include <algorithm>
+#include <cstring>
+#include <memory>
 #include <stack>
 #include <unordered_set>
 
@@ -666,29 +670,31 @@ void pfLocalizationDataMgr::pf3PartMap<mapT>::ISplitString(ST::string key, ST::s
         name = tokens[2];
 }
 
-//// exists() ////////////////////////////////////////////////////////
+//// IFind() /////////////////////////////////////////////////////////
 
 template<class mapT>
-bool pfLocalizationDataMgr::pf3PartMap<mapT>::exists(const ST::string & key)
+typename pfLocalizationDataMgr::pf3PartMap<mapT>::Entry *pfLocalizationDataMgr::pf3PartMap<mapT>::IFind(const ST::string &key)
 {
+    // Almost everyone asks for a well formed "Age.Set.Name", which is exactly how we store it
+    auto curEntry = fData.find(key);
+    if (curEntry != fData.end() && curEntry->second.IsComplete())
+        return &curEntry->second;
+
+    // Otherwise, see what the key means once it's split up the way it always has been
     ST::string age, set, name;
     ISplitString(key, age, set, name);
-    if (age.empty() || set.empty() || name.empty()) // if any are missing, it's invalid, so we don't have it
-        return false;
+    curEntry = fData.find(ST::format("{}.{}.{}", age, set, name));
+    if (curEntry == fData.end())
+        return nullptr;
+    return &curEntry->second;
+}
 
-    // now check individually
-    auto curAge = fData.find(age);
-    if (curAge == fData.end()) // age doesn't exist
-        return false;
-    auto curSet = curAge->second.find(set);
-    if (curSet == curAge->second.end()) // set doesn't exist
-        return false;
-    auto curElement = curSet->second.find(name);
-    if (curElement == curSet->second.end()) // name doesn't exist
-        return false;
+//// exists() ////////////////////////////////////////////////////////
 
-    // we passed all the tests, return true!
-    return true;
+template<class mapT>
+bool pfLocalizationDataMgr::pf3PartMap<mapT>::exists(const ST::string & key)
+{
+    return find(key) != nullptr;
 }
 
 //// setExists() /////////////////////////////////////////////////////
@@ -702,8 +708,8 @@ bool pfLocalizationDataMgr::pf3PartMap<mapT>::setExists(const ST::string & key)
         return false;
 
     // now check individually
-    auto curAge = fData.find(age);
-    if (curAge == fData.end()) // age doesn't exist
+    auto curAge = fNames.find(age);
+    if (curAge == fNames.end()) // age doesn't exist
         return false;
     auto curSet = curAge->second.find(set);
     if (curSet == curAge->second.end()) // set doesn't exist
@@ -718,28 +724,41 @@ bool pfLocalizationDataMgr::pf3PartMap<mapT>::setExists(const ST::string & key)
 template<class mapT>
 void pfLocalizationDataMgr::pf3PartMap<mapT>::erase(const ST::string & key)
 {
-    ST::string age, set, name;
-    ISplitString(key, age, set, name);
-    if (age.empty() || set.empty() || name.empty()) // if any are missing, it's invalid, so we don't delete it
+    Entry *entry = IFind(key);
+    if (!entry || !entry->IsComplete()) // if any part is missing, it's invalid, so we don't delete it
         return;
 
-    // now check individually
-    auto curAge = fData.find(age);
-    if (curAge == fData.end()) // age doesn't exist
-        return;
-    auto curSet = curAge->second.find(set);
-    if (curSet == curAge->second.end()) // set doesn't exist
-        return;
-    auto curElement = curSet->second.find(name);
-    if (curElement == curSet->second.end()) // name doesn't exist
-        return;
+    // ok, so now we want to nuke it! (the entry goes first, since its name parts live in fNames)
+    ST::string age = *entry->fAge, set = *entry->fSet, name = *entry->fName;
+    fData.erase(ST::format("{}.{}.{}", age, set, name));
 
-    // ok, so now we want to nuke it!
+    auto curAge = fNames.find(age);
+    auto curSet = curAge->second.find(set);
     curSet->second.erase(name);
     if (curSet->second.size() == 0) // is the set now empty?
         curAge->second.erase(curSet); // nuke it!
     if (curAge->second.size() == 0) // is the age now empty?
-        fData.erase(curAge); // nuke it!
+        fNames.erase(curAge); // nuke it!
+}
+
+//// clear() /////////////////////////////////////////////////////////
+
+template<class mapT>
+void pfLocalizationDataMgr::pf3PartMap<mapT>::clear()
+{
+    fData.clear();
+    fNames.clear();
+}
+
+//// find() //////////////////////////////////////////////////////////
+
+template<class mapT>
+mapT *pfLocalizationDataMgr::pf3PartMap<mapT>::find(const ST::string &key)
+{
+    Entry *entry = IFind(key);
+    if (!entry || !entry->IsComplete()) // if any part is missing, it's invalid, so we don't have it
+        return nullptr;
+    return &entry->fData;
 }
 
 //// operator[]() ////////////////////////////////////////////////////
@@ -749,7 +768,25 @@ mapT &pfLocalizationDataMgr::pf3PartMap<mapT>::operator[](const ST::string &key)
 {
     ST::string age, set, name;
     ISplitString(key, age, set, name);
-    return fData[age][set][name];
+    return add(age, set, name);
+}
+
+//// add() ///////////////////////////////////////////////////////////
+
+template<class mapT>
+mapT &pfLocalizationDataMgr::pf3PartMap<mapT>::add(const ST::string &age, const ST::string &set, const ST::string &name)
+{
+    auto result = fData.try_emplace(ST::format("{}.{}.{}", age, set, name));
+    Entry &entry = result.first->second;
+    if (result.second)
+    {
+        auto curAge = fNames.try_emplace(age).first;
+        auto curSet = curAge->second.try_emplace(set).first;
+        entry.fAge = &curAge->first;
+        entry.fSet = &curSet->first;
+        entry.fName = &*curSet->second.emplace(name).first;
+    }
+    return entry.fData;
 }
 
 //// getAgeList() ////////////////////////////////////////////////////
@@ -759,7 +796,7 @@ std::vector<ST::string> pfLocalizationDataMgr::pf3PartMap<mapT>::getAgeList()
 {
     std::vector<ST::string> retVal;
 
-    for (const auto& curAge : fData)
+    for (const auto& curAge : fNames)
         retVal.push_back(curAge.first);
 
     return retVal;
@@ -772,8 +809,8 @@ std::vector<ST::string> pfLocalizationDataMgr::pf3PartMap<mapT>::getSetList(cons
 {
     std::vector<ST::string> retVal;
 
-    auto curAge = fData.find(age);
-    if (curAge == fData.end())
+    auto curAge = fNames.find(age);
+    if (curAge == fNames.end())
         return retVal; // return an empty list, the age doesn't exist
 
     for (const auto& curSet : curAge->second)
@@ -789,8 +826,8 @@ std::vector<ST::string> pfLocalizationDataMgr::pf3PartMap<mapT>::getNameList(con
 {
     std::vector<ST::string> retVal;
 
-    auto curAge = fData.find(age);
-    if (curAge == fData.end())
+    auto curAge = fNames.find(age);
+    if (curAge == fNames.end())
         return retVal; // return an empty list, the age doesn't exist
 
     auto curSet = curAge->second.find(set);
@@ -798,7 +835,7 @@ std::vector<ST::string> pfLocalizationDataMgr::pf3PartMap<mapT>::getNameList(con
         return retVal; // return an empty list, the set doesn't exist
 
     for (const auto& curName : curSet->second)
-        retVal.push_back(curName.first);
+        retVal.push_back(curName);
 
     return retVal;
 }
@@ -809,6 +846,11 @@ std::vector<ST::string> pfLocalizationDataMgr::pf3PartMap<mapT>::getNameList(con
 
 pfLocalizationDataMgr   *pfLocalizationDataMgr::fInstance = nullptr;
 plStatusLog             *pfLocalizationDataMgr::fLog = nullptr; // output logfile
+bool                    pfLocalizationDataMgr::fUseCache = true;
+
+// Bump this whenever the cache layout or pfLocalizedString::Write() changes
+static constexpr uint32_t kLocCacheMagic = 0x434C4C50; // 'PLLC'
+static constexpr uint32_t kLocCacheVersion = 1;
 
 //// Constructor/Destructor //////////////////////////////////////////
 
@@ -972,6 +1014,141 @@ void pfLocalizationDataMgr::IWriteText(const plFileName & filename, const ST::st
     }
 }
 
+//// Cache Functions /////////////////////////////////////////////////
+//  The cache holds the fully converted data, so loading it skips the
+//  XML parsing, merging, verification and string conversion entirely.
+//  The header records every source file's size and modification time;
+//  if anything differs from what's on disk now, we ignore the cache and
+//  rebuild it from the XML.
+
+plFileName pfLocalizationDataMgr::IGetCacheFile() const
+{
+    return plFileName::Join(plFileSystem::GetUserDataPath(), "Localization.cache");
+}
+
+void pfLocalizationDataMgr::IWriteCacheHeader(hsStream *stream, const std::vector<plFileName> &sourceFiles)
+{
+    stream->WriteLE32(kLocCacheMagic);
+    stream->WriteLE32(kLocCacheVersion);
+    stream->WriteLE32(plLocalization::GetNumLocales());
+    WriteUtf8String(stream, fDataPath.AsString());
+
+    stream->WriteLE32((uint32_t)sourceFiles.size());
+    for (const auto& file : sourceFiles)
+    {
+        plFileInfo info(file);
+        WriteUtf8String(stream, file.GetFileName());
+        stream->WriteLE32((uint32_t)((uint64_t)info.FileSize() & 0xFFFFFFFF));
+        stream->WriteLE32((uint32_t)((uint64_t)info.FileSize() >> 32));
+        stream->WriteLE32((uint32_t)(info.ModifyTime() & 0xFFFFFFFF));
+        stream->WriteLE32((uint32_t)(info.ModifyTime() >> 32));
+    }
+}
+
+bool pfLocalizationDataMgr::IReadCache(const plFileName &cacheFile, const std::vector<plFileName> &sourceFiles)
+{
+    // What the header should look like if the cache is still good
+    hsRAMStream expected;
+    IWriteCacheHeader(&expected, sourceFiles);
+    uint32_t headerSize = expected.GetEOF();
+    std::unique_ptr<uint8_t[]> header = std::make_unique<uint8_t[]>(headerSize);
+    expected.CopyToMem(header.get());
+
+    hsUNIXStream file;
+    if (!file.Open(cacheFile, "rb"))
+        return false;
+    uint32_t fileSize = file.GetEOF();
+    if (fileSize < headerSize + sizeof(uint32_t) * 2)
+        return false;
+    std::unique_ptr<uint8_t[]> data = std::make_unique<uint8_t[]>(fileSize);
+    uint32_t read = file.Read(fileSize, data.get());
+    file.Close();
+    if (read != fileSize || memcmp(data.get(), header.get(), headerSize) != 0)
+        return false;
+
+    hsReadOnlyStream stream(fileSize - headerSize, data.get() + headerSize);
+    if (stream.ReadLE32() != stream.GetSizeLeft()) // truncated?
+        return false;
+
+    bool valid = true;
+    try
+    {
+        uint32_t numElements = stream.ReadLE32();
+        for (uint32_t curElement = 0; valid && curElement < numElements; curElement++)
+        {
+            ST::string ageName, setName, elementName;
+            valid = ReadUtf8String(&stream, ageName) && ReadUtf8String(&stream, setName) &&
+                    ReadUtf8String(&stream, elementName);
+            if (!valid)
+                break;
+
+            localizedElement &element = fLocalizedElements.add(ageName, setName, elementName);
+            uint32_t numTranslations = stream.ReadLE32();
+            for (uint32_t curTranslation = 0; valid && curTranslation < numTranslations; curTranslation++)
+            {
+                ST::string languageName;
+                valid = ReadUtf8String(&stream, languageName) && element[languageName].Read(&stream);
+            }
+        }
+    }
+    catch (...)
+    {
+        valid = false; // ran off the end of the data
+    }
+
+    if (!valid)
+    {
+        fLog->AddLine("ERROR: Localization cache is corrupt, ignoring it");
+        fLocalizedElements.clear();
+    }
+    return valid;
+}
+
+void pfLocalizationDataMgr::IWriteCache(const plFileName &cacheFile, const std::vector<plFileName> &sourceFiles)
+{
+    hsRAMStream elements;
+    uint32_t numElements = 0;
+    for (const auto& ageName : GetAgeList())
+    {
+        for (const auto& setName : GetSetList(ageName))
+        {
+            for (const auto& elementName : GetElementList(ageName, setName))
+            {
+                const localizedElement *element = fLocalizedElements.find(ST::format("{}.{}.{}", ageName, setName, elementName));
+                if (!element)
+                    continue;
+
+                WriteUtf8String(&elements, ageName);
+                WriteUtf8String(&elements, setName);
+                WriteUtf8String(&elements, elementName);
+                elements.WriteLE32((uint32_t)element->size());
+                for (const auto& curTranslation : *element)
+                {
+                    WriteUtf8String(&elements, curTranslation.first);
+                    curTranslation.second.Write(&elements);
+                }
+                numElements++;
+            }
+        }
+    }
+
+    hsUNIXStream file;
+    if (!file.Open(cacheFile, "wb"))
+    {
+        fLog->AddLineF("WARNING: Can't write the localization cache to {}", cacheFile);
+        return;
+    }
+
+    IWriteCacheHeader(&file, sourceFiles);
+    uint32_t dataSize = elements.GetEOF();
+    std::unique_ptr<uint8_t[]> data = std::make_unique<uint8_t[]>(dataSize);
+    elements.CopyToMem(data.get());
+    file.WriteLE32(dataSize + sizeof(uint32_t)); // everything after this, so a partial write is caught
+    file.WriteLE32(numElements);
+    file.Write(dataSize, data.get());
+    file.Close();
+}
+
 //// Initialize //////////////////////////////////////////////////////
 
 void pfLocalizationDataMgr::Initialize(const plFileName & path)
@@ -1008,6 +1185,19 @@ void pfLocalizationDataMgr::SetupData()
 {
     if (fDatabase)
         delete fDatabase;
+    fDatabase = nullptr;
+
+    std::vector<plFileName> sourceFiles = plFileSystem::ListDir(fDataPath, "*.loc");
+    std::sort(sourceFiles.begin(), sourceFiles.end(),
+              [](const plFileName& a, const plFileName& b) { return a.AsString() < b.AsString(); });
+
+    plFileName cacheFile = IGetCacheFile();
+    if (fUseCache && IReadCache(cacheFile, sourceFiles))
+    {
+        fLog->AddLineF("Loaded localization data from cache {}", cacheFile);
+        OutputTreeToLog();
+        return;
+    }
 
     fDatabase = new LocalizationDatabase();
     fDatabase->Parse(fDataPath);
@@ -1025,6 +1215,9 @@ void pfLocalizationDataMgr::SetupData()
         IConvertAge(&ageInfo, curAge.first);
     }
 
+    if (fUseCache)
+        IWriteCache(cacheFile, sourceFiles);
+
     OutputTreeToLog();
 }
 
@@ -1034,17 +1227,18 @@ pfLocalizedString pfLocalizationDataMgr::GetElement(const ST::string & name)
 {
     pfLocalizedString retVal; // if this returns before we initialize it, it will be empty, indicating failure
 
-    if (!fLocalizedElements.exists(name)) // does the requested element exist?
+    localizedElement *element = fLocalizedElements.find(name);
+    if (!element) // does the requested element exist?
         return retVal; // nope, so return failure
 
-    ST::string languageName = IGetCurrentLanguageName();
-    if (fLocalizedElements[name].find(languageName) == fLocalizedElements[name].end()) // current language isn't specified
+    auto translation = element->find(IGetCurrentLanguageName());
+    if (translation == element->end()) // current language isn't specified
     {
-        languageName = "English"; // force to english
-        if (fLocalizedElements[name].find(languageName) == fLocalizedElements[name].end()) // make sure english exists
+        translation = element->find("English"); // force to english
+        if (translation == element->end()) // make sure english exists
             return retVal; // language doesn't exist
     }
-    retVal = fLocalizedElements[name][languageName];
+    retVal = translation->second;
     return retVal;
 }
 
@@ -1054,13 +1248,15 @@ pfLocalizedString pfLocalizationDataMgr::GetSpecificElement(const ST::string & n
 {
     pfLocalizedString retVal; // if this returns before we initialize it, it will have an ID of 0, indicating failure
 
-    if (!fLocalizedElements.exists(name)) // does the requested subtitle exist?
+    localizedElement *element = fLocalizedElements.find(name);
+    if (!element) // does the requested subtitle exist?
         return retVal; // nope, so return failure
 
-    if (fLocalizedElements[name].find(language) == fLocalizedElements[name].end())
+    auto translation = element->find(language);
+    if (translation == element->end())
         return retVal; // language doesn't exist
 
-    retVal = fLocalizedElements[name][language];
+    retVal = translation->second;
     return retVal;
 }
 
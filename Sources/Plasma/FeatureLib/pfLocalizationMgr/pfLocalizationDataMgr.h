@@ -53,11 +53,14 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plFileSystem.h"
 
 #include <map>
+#include <set>
+#include <unordered_map>
 #include <vector>
 
 #include "pfLocalizedString.h"
 
 
+class hsStream;
 class plStatusLog;
 
 // Helper classes/structs that are only used in this main class
@@ -72,6 +75,8 @@ private:
     static pfLocalizationDataMgr*   fInstance;
     static plStatusLog*             fLog;
 
+    static bool                     fUseCache;
+
 protected:
     // This is a special case map class that will deconstruct the "Age.Set.Name" key into component parts
     // and store them so that a list of each part given it's parent part is easy to grab. I.e. I can grab
@@ -81,18 +86,39 @@ protected:
     class pf3PartMap
     {
     protected:
-        // Outer map is Age, then Set, finally Name
-        typedef std::map<ST::string, std::map<ST::string, std::map<ST::string, mapT> > > ThreePartMap;
-        ThreePartMap fData;
+        // The name parts point at their copies in fNames, so each age and set name is
+        // stored once however many elements share it
+        struct Entry
+        {
+            const ST::string *fAge, *fSet, *fName;
+            mapT fData;
+
+            Entry() : fAge(), fSet(), fName() { }
+
+            bool IsComplete() const { return fAge && !fAge->empty() && fSet && !fSet->empty() && fName && !fName->empty(); }
+        };
+
+        // All the data lives in one table keyed by the full "Age.Set.Name" path, so lookups
+        // don't have to split the key or walk three levels of maps
+        std::unordered_map<ST::string, Entry> fData;
+
+        // Outer map is Age, then Set, finally Name. Backs the list functions and owns the
+        // name parts every Entry points at
+        typedef std::map<ST::string, std::map<ST::string, std::set<ST::string> > > ThreePartNames;
+        ThreePartNames fNames;
 
         void ISplitString(ST::string key, ST::string &age, ST::string &set, ST::string &name);
+        Entry *IFind(const ST::string &key);
     public:
         // We will just have very basic functionality
         bool exists(const ST::string & key); // returns true if the key exists
         bool setExists(const ST::string & key); // returns true if the age.set exists (ignores name if passed in)
         void erase(const ST::string & key); // erases the key from the map
+        void clear();
 
+        mapT *find(const ST::string &key); // returns the item referenced by the key, or nullptr if it doesn't exist
         mapT &operator[](const ST::string &key); // returns the item referenced by the key (and creates if necessary)
+        mapT &add(const ST::string &age, const ST::string &set, const ST::string &name); // same, with the key already split
 
         std::vector<ST::string> getAgeList(); // returns a list of all ages in this map
         std::vector<ST::string> getSetList(const ST::string & age); // returns a list of all sets in the specified age
@@ -119,6 +145,12 @@ protected:
 
     void IWriteText(const plFileName & filename, const ST::string & ageName, const ST::string & languageName); // Write localization text to the specified file
 
+    // Binary cache of the converted data, so we can skip the XML entirely if the .loc files haven't changed
+    plFileName IGetCacheFile() const;
+    void IWriteCacheHeader(hsStream *stream, const std::vector<plFileName> &sourceFiles);
+    bool IReadCache(const plFileName &cacheFile, const std::vector<plFileName> &sourceFiles);
+    void IWriteCache(const plFileName &cacheFile, const std::vector<plFileName> &sourceFiles);
+
     pfLocalizationDataMgr(const plFileName & path);
 public:
     virtual ~pfLocalizationDataMgr();
@@ -129,6 +161,9 @@ public:
     static bool InstanceValid() { return fInstance != nullptr; }
     static plStatusLog* GetLog() { return fLog; }
 
+    // Whether SetupData() may load from and save to the binary cache (on by default)
+    static void SetUseCache(bool useCache) { fUseCache = useCache; }
+
     void SetupData();
 
     pfLocalizedString GetElement(const ST::string & name);
@@ -50,6 +50,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "HeadSpin.h"
 
 #include "pfLocalizedString.h"
+#include "hsStream.h"
 #include <string_theory/string_stream>
 
 
@@ -228,6 +229,66 @@ void pfLocalizedString::FromXML(const ST::string & xml)
     IConvertFromXML(xml);
 }
 
+//// Read/Write //////////////////////////////////////////////////////
+//  Strings are stored as raw UTF-8 with a 32-bit length. The "safe"
+//  string functions in hsStream can't round trip text that starts with
+//  a non-ASCII character.
+
+bool ReadUtf8String(hsStream *stream, ST::string &string)
+{
+    uint32_t size = stream->ReadLE32();
+    if (size > stream->GetSizeLeft())
+        return false;
+
+    ST::char_buffer buffer;
+    buffer.allocate(size);
+    stream->Read(size, buffer.data());
+    string = ST::string::from_utf8(buffer);
+    return true;
+}
+
+void WriteUtf8String(hsStream *stream, const ST::string &string)
+{
+    stream->WriteLE32((uint32_t)string.size());
+    stream->WriteString(string);
+}
+
+bool pfLocalizedString::Read(hsStream *stream)
+{
+    fNumArguments = stream->ReadLE16();
+    if (!ReadUtf8String(stream, fXMLRep) || !ReadUtf8String(stream, fPlainTextRep))
+        return false;
+
+    uint32_t numBlocks = stream->ReadLE32();
+    if (numBlocks > stream->GetSizeLeft())
+        return false;
+
+    fText.resize(numBlocks);
+    for (textBlock &block : fText)
+    {
+        block.fIsParam = stream->ReadBool();
+        block.fParamIndex = stream->ReadByte();
+        if (!ReadUtf8String(stream, block.fText))
+            return false;
+    }
+    return true;
+}
+
+void pfLocalizedString::Write(hsStream *stream) const
+{
+    stream->WriteLE16(fNumArguments);
+    WriteUtf8String(stream, fXMLRep);
+    WriteUtf8String(stream, fPlainTextRep);
+
+    stream->WriteLE32((uint32_t)fText.size());
+    for (const textBlock &block : fText)
+    {
+        stream->WriteBool(block.fIsParam);
+        stream->WriteByte(block.fParamIndex);
+        WriteUtf8String(stream, block.fText);
+    }
+}
+
 //// Operators ///////////////////////////////////////////////////////
 
 bool pfLocalizedString::operator<(pfLocalizedString &obj)
@@ -54,6 +54,8 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include <string_theory/string>
 #include <vector>
 
+class hsStream;
+
 //// pfLocalizedString Class Definition //////////////////////////////
 //  a small class to handle localized strings and which can take
 //  parameters (like %s or %1s) and also can be easily translated to
@@ -93,6 +95,11 @@ public:
 
     uint16_t GetArgumentCount() {return fNumArguments;}
 
+    // Binary form of the already-parsed string, for the localization cache.
+    // Read returns false if the stream doesn't hold a valid string.
+    bool Read(hsStream *stream);
+    void Write(hsStream *stream) const;
+
     // Various operators, they all work pretty much the same as the standard string or wstring operators
     // but note that the all work on the plain text representation (not the XML representation)
     bool operator<(pfLocalizedString &obj);
@@ -112,4 +119,9 @@ public:
     ST::string operator%(const std::vector<ST::string> & arguments);
 };
 
+// Raw UTF-8 with a 32-bit length, as used by pfLocalizedString::Read/Write and the
+// localization cache. Read returns false if the length runs past the end of the stream.
+bool ReadUtf8String(hsStream *stream, ST::string &string);
+void WriteUtf8String(hsStream *stream, const ST::string &string);
+
 #endif
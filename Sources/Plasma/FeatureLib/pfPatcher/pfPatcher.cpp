@@ -208,6 +208,10 @@ class pfPatcherStream : public plZlibStream
     uint64_t fBytesWritten;
     float fDLStartTime;
 
+    // Downloaded files are hashed on the way through, rather than read back
+    plMD5Checksum fExpected;
+    plMD5Checksum fHash;
+
     ST::string IMakeStatusMsg() const
     {
         float secs = hsTimer::GetSeconds<float>() - fDLStartTime;
@@ -225,6 +229,14 @@ class pfPatcherStream : public plZlibStream
             fParent->fProgressTick(fParent->fCurrBytes, fParent->fTotalBytes, IMakeStatusMsg());
     }
 
+protected:
+    // Called on the decompression thread for zipped files
+    void IOnInflated(const uint8_t* buf, uint32_t count) override
+    {
+        if (fExpected.IsValid())
+            fHash.AddTo(count, buf);
+    }
+
 public:
     pfPatcherStream(pfPatcherWorker* parent, const plFileName& filename, uint64_t size)
         : fParent(parent), fFilename(filename), fFlags(), fBytesWritten(), fDLStartTime(), plZlibStream()
@@ -234,12 +246,16 @@ public:
     }
 
     pfPatcherStream(pfPatcherWorker* parent, const pfPatcherQueuedFile& file)
-        : fParent(parent), fFilename(file.fClientPath.Normalize()), fFlags(file.fFlags), fBytesWritten(), fDLStartTime(), plZlibStream()
+        : fParent(parent), fFilename(file.fClientPath.Normalize()), fFlags(file.fFlags), fBytesWritten(), fDLStartTime(),
+          fExpected(file.fChecksum), plZlibStream()
     {
         // ugh. eap removed the compressed flag in his fail manifests
         if (file.fServerPath.GetFileExt().compare_i("gz") == 0) {
             fFlags |= kFlagZipped;
             parent->fTotalBytes += file.fZipSize;
+
+            // inflate and write to disk while the next chunk is on its way
+            SetAsync(true);
         } else {
             parent->fTotalBytes += file.fFileSize;
         }
@@ -248,6 +264,8 @@ public:
     void Begin()
     {
         fDLStartTime = hsTimer::GetSeconds<float>();
+        if (fExpected.IsValid())
+            fHash.Start();
         if (!fOutput)
             Open(fFilename, "wb");
     }
@@ -269,8 +287,21 @@ public:
         // write the appropriate blargs
         if (hsCheckBits(fFlags, kFlagZipped))
             return plZlibStream::Write(count, buf);
-        else
-            return fOutput->Write(count, buf);
+
+        if (fExpected.IsValid())
+            fHash.AddTo(count, (const uint8_t*)buf);
+        return fOutput->Write(count, buf);
+    }
+
+    /** Checks what we wrote against the manifest. Only valid after Close(). */
+    bool VerifyChecksum()
+    {
+        if (!fExpected.IsValid())
+            return true;
+        if (hsCheckBits(fFlags, kFlagZipped) && !DecompressedOk())
+            return false;
+        fHash.Finish();
+        return fHash == fExpected;
     }
 
     bool AtEnd() override { return fOutput->AtEnd(); }
@@ -389,6 +420,11 @@ static void IFileThingDownloadCB(ENetError result, void* param, const plFileName
     pfPatcherStream* stream = static_cast<pfPatcherStream*>(writer);
     stream->Close();
 
+    if (IS_NET_SUCCESS(result) && !stream->VerifyChecksum()) {
+        PatcherLogRed("\tChecksum Mismatch: File '{}'", stream->GetFileName());
+        result = kNetErrInternalError;
+    }
+
     if (IS_NET_SUCCESS(result)) {
         PatcherLogGreen("\tDownloaded File '{}'", stream->GetFileName());
         patcher->WhitelistFile(stream->GetFileName(), true);
@@ -240,6 +240,10 @@ public:
     virtual bool                        TestVisibleWorld(const hsBounds3Ext& wBnd) = 0;
     virtual bool                        TestVisibleWorld(const plSceneObject* sObj) = 0;
     virtual bool                        HarvestVisible(plSpaceTree* space, std::vector<int16_t>& visList) = 0;
+    // HarvestVisible split in two. Prepare each tree on the render thread,
+    // then the prepared trees can be harvested from any thread at once.
+    virtual void                        PrepareHarvest(plSpaceTree* space) = 0;
+    virtual bool                        HarvestPrepared(const plSpaceTree* space, std::vector<int16_t>& visList) const = 0;
     virtual bool                        SubmitOccluders(const std::vector<const plCullPoly*>& polyList) = 0;
     
     virtual void                        SetDebugFlag( uint32_t flag, bool on ) = 0;
@@ -45,6 +45,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plDispatch.h"
 #define PLMESSAGE_PRIVATE
 #include "pnMessage/plMessage.h"
+#include "pnMessage/plMessagePool.h"
 #include "pnKeyedObject/hsKeyedObject.h"
 #include "hsTimer.h"
 #include "pnMessage/plTimeMsg.h"
@@ -55,6 +56,10 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "pnNetCommon/pnNetCommon.h"
 #include "hsThread.h"
 #include "plProfile.h"
+#include "plCreatableIndex.h"
+#include "pnFactory/plFactory.h"
+
+#include <atomic>
 
 plProfile_CreateTimer("MsgReceive", "Update", MsgReceive);
 plProfile_CreateTimer("  TimeMsg", "Update", TimeMsg);
@@ -76,6 +81,10 @@ public:
     { hsRefCnt_SafeRef(msg); }
     virtual ~plMsgWrap() { hsRefCnt_SafeUnRef(fMsg); }
 
+    // One of these goes with every message sent, so they come from the message pool too
+    static void* operator new(size_t size) { return plMessagePool::Alloc(size); }
+    static void operator delete(void* ptr, size_t size) { plMessagePool::Free(ptr, size); }
+
     plMsgWrap&      ClearReceivers() { fReceivers.clear(); return *this; }
     plMsgWrap&      AddReceiver(plKey rcv)
                     {
@@ -98,6 +107,34 @@ MsgRecieveCallback      plDispatch::fMsgRecieveCallback = nullptr;
 std::mutex              plDispatch::fMsgCurrentMutex; // mutex for fMsgCurrent
 std::mutex              plDispatch::fMsgDispatchLock; // mutex for IMsgDispatch
 
+#ifdef PL_PROFILE_ENABLED
+// How many of each class of message get sent. Any thread can send, so the counts
+// are kept here, and the profile vars for them are only made and bumped from
+// MsgQueueProcess() on the main thread, where they can't race the profiler.
+// The pool can't count by class, since operator new only sees the size.
+static std::atomic<uint32_t> s_msgClassSends[plCreatableIndex::plNumClassIndices];
+static plProfileVar* s_msgClassCounters[plCreatableIndex::plNumClassIndices];
+
+static void CountMsgClass(const plMessage* msg)
+{
+    uint16_t idx = msg->ClassIndex();
+    if (idx < plCreatableIndex::plNumClassIndices)
+        s_msgClassSends[idx].fetch_add(1, std::memory_order_relaxed);
+}
+
+static void PublishMsgClassCounts()
+{
+    for (uint16_t idx = 0; idx < plCreatableIndex::plNumClassIndices; idx++) {
+        uint32_t sends = s_msgClassSends[idx].exchange(0, std::memory_order_relaxed);
+        if (!sends)
+            continue;
+        if (!s_msgClassCounters[idx])
+            s_msgClassCounters[idx] = new plProfileVar(plFactory::GetNameOfClass(idx), "Messages Sent", plProfileVar::kDisplayCount);
+        s_msgClassCounters[idx]->Inc(sends);
+    }
+}
+#endif // PL_PROFILE_ENABLED
+
 
 plDispatch::plDispatch()
 : fOwner(), fFutureMsgQueue(), fQueuedMsgOn(true)
@@ -238,6 +275,10 @@ void plDispatch::IMsgEnqueue(plMsgWrap* msgWrap, bool async)
             fMsgWatch.emplace_back(msgWrap->fMsg);
 #endif // HS_DEBUGGING
 
+#ifdef PL_PROFILE_ENABLED
+        CountMsgClass(msgWrap->fMsg);
+#endif // PL_PROFILE_ENABLED
+
         if (fMsgTail)
             fMsgTail = IInsertToQueue(&fMsgTail->fNext, msgWrap);
         else
@@ -515,6 +556,10 @@ void plDispatch::MsgQueue(plMessage* msg)
 
 void plDispatch::MsgQueueProcess()
 {
+#ifdef PL_PROFILE_ENABLED
+    PublishMsgClassCounts();
+#endif // PL_PROFILE_ENABLED
+
     // Process all messages on Queue, unlock while sending them
     // this would allow other threads to put new messages on the list while we send()
     bool empty = false;
@@ -45,6 +45,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 #include "pnFactory/plCreatable.h"
 #include "pnKeyedObject/plKey.h"
+#include "plMessagePool.h"
 
 class plKey;
 class hsStream;
@@ -109,6 +110,10 @@ public:
 
     virtual ~plMessage();
 
+    // Every message, whatever its class, comes out of the message pool
+    static void* operator new(size_t size) { return plMessagePool::Alloc(size); }
+    static void operator delete(void* ptr, size_t size) { plMessagePool::Free(ptr, size); }
+
     CLASSNAME_REGISTER(plMessage);
     GETINTERFACE_ANY(plMessage, plCreatable);
 
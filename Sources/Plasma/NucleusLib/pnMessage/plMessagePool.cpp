@@ -0,0 +1,137 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "plMessagePool.h"
+
+#include "plProfile.h"
+
+#include <new>
+
+plProfile_CreateCounter("Msgs Recycled", "Messages", MsgsRecycled);
+plProfile_CreateCounter("Msgs Allocated", "Messages", MsgsAllocated);
+
+// Blocks are rounded up to a multiple of kBlockAlign. Anything bigger than
+// kMaxPooledSize, which no message in the tree comes close to, isn't pooled.
+constexpr size_t kBlockAlign = 16;
+constexpr size_t kMaxPooledSize = 512;
+constexpr size_t kNumSizes = kMaxPooledSize / kBlockAlign;
+
+// Past this many free blocks of a size, a thread hands them back to the heap, so
+// a thread that only ever frees what others allocated doesn't hoard them.
+constexpr uint32_t kMaxFreeBlocks = 256;
+
+std::atomic<bool> plMessagePool::fPooling = true;
+
+struct plMessagePoolThread
+{
+    void*       fFree[kNumSizes];
+    uint32_t    fNumFree[kNumSizes];
+
+    plMessagePoolThread() : fFree(), fNumFree() { }
+    ~plMessagePoolThread();
+};
+
+// Messages can still be freed on the main thread after its pool is gone, by
+// statics going away at exit. Those go straight back to the heap.
+static thread_local bool s_poolGone = false;
+
+plMessagePoolThread::~plMessagePoolThread()
+{
+    for (void* block : fFree) {
+        while (block) {
+            void* next = *static_cast<void**>(block);
+            ::operator delete(block);
+            block = next;
+        }
+    }
+    s_poolGone = true;
+}
+
+static plMessagePoolThread* IGetThreadPool()
+{
+    if (s_poolGone)
+        return nullptr;
+    static thread_local plMessagePoolThread pool;
+    return &pool;
+}
+
+void* plMessagePool::Alloc(size_t size)
+{
+    size_t sizeIdx = (size + kBlockAlign - 1) / kBlockAlign - 1;
+    if (size == 0 || sizeIdx >= kNumSizes)
+        return ::operator new(size);
+
+    if (fPooling) {
+        plMessagePoolThread* pool = IGetThreadPool();
+        if (pool && pool->fFree[sizeIdx]) {
+            void* block = pool->fFree[sizeIdx];
+            pool->fFree[sizeIdx] = *static_cast<void**>(block);
+            pool->fNumFree[sizeIdx]--;
+            plProfile_Inc(MsgsRecycled);
+            return block;
+        }
+    }
+
+    // Always the whole block, so it can go on the freelist later even if pooling
+    // gets turned on in the meantime.
+    plProfile_Inc(MsgsAllocated);
+    return ::operator new((sizeIdx + 1) * kBlockAlign);
+}
+
+void plMessagePool::Free(void* ptr, size_t size)
+{
+    if (!ptr)
+        return;
+
+    size_t sizeIdx = (size + kBlockAlign - 1) / kBlockAlign - 1;
+    if (fPooling && size != 0 && sizeIdx < kNumSizes) {
+        plMessagePoolThread* pool = IGetThreadPool();
+        if (pool && pool->fNumFree[sizeIdx] < kMaxFreeBlocks) {
+            *static_cast<void**>(ptr) = pool->fFree[sizeIdx];
+            pool->fFree[sizeIdx] = ptr;
+            pool->fNumFree[sizeIdx]++;
+            return;
+        }
+    }
+
+    ::operator delete(ptr);
+}
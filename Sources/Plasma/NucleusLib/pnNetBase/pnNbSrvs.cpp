@@ -150,3 +150,19 @@ ST::string GetServerDisplayName () {
 void SetServerDisplayName (const ST::string& name) {
     s_serverName = name;
 }
+
+
+//============================================================================
+// Game Server Capabilities
+//============================================================================
+static bool s_gameSrvFastCompression = false;
+
+//============================================================================
+bool GetGameSrvFastCompression () {
+    return s_gameSrvFastCompression;
+}
+
+//============================================================================
+void SetGameSrvFastCompression (bool enable) {
+    s_gameSrvFastCompression = enable;
+}
@@ -107,4 +107,16 @@ void SetServerSignupUrl (const ST::string& url);
 ST::string GetServerDisplayName ();
 void SetServerDisplayName (const ST::string& name);
 
+
+/*****************************************************************************
+*
+*   Game server capabilities
+*
+***/
+
+// The game server relays message streams to the rest of the age as is, so
+// LZ4 compression may only be used when the whole shard has opted in.
+bool GetGameSrvFastCompression ();
+void SetGameSrvFastCompression (bool enable);
+
 #endif // pnNbSrvs_inc
@@ -293,9 +293,11 @@ void NetVaultNode::Clear()
 {
     // Sneaky -- we're just going to set the fields to empty.
     // If a field is neither used nor dirty, it doesn't matter what value it actually has.
+    uint64_t oldFields = fUsedFields;
     fUsedFields = 0;
     fDirtyFields = 0;
     fRevision = kNilUuid;
+    IFieldsChanged(oldFields);
 }
 
 //============================================================================
@@ -327,6 +329,7 @@ inline void IZero<NetVaultNode::Blob>(NetVaultNode::Blob& blob)
 
 void NetVaultNode::CopyFrom(const NetVaultNode* node)
 {
+    uint64_t oldFields = fUsedFields;
     fUsedFields = node->fUsedFields;
     fDirtyFields = node->fDirtyFields;
     fRevision = node->fRevision;
@@ -371,63 +374,71 @@ void NetVaultNode::CopyFrom(const NetVaultNode* node)
     COPYORZERO(Blob_2);
 
 #undef COPYORZERO
+
+    IFieldsChanged(oldFields | fUsedFields);
 }
 
 //============================================================================
 bool NetVaultNode::Matches(const NetVaultNode* rhs) const
 {
-    for (uint64_t bit = 1; bit; bit <<= 1) {
-        // If we have tested all fields on the other node, we obviously match.
-        if (bit > rhs->fUsedFields)
-            return true;
-
-         // If the other node does not have the field, then continue to next field
-        if (!(bit & rhs->fUsedFields))
-            continue;
-
-        // If we don't have this field, but the other node does, we are obviously not the same.
-        if (!(bit & fUsedFields))
-            return false;
-
-#define COMPARE(field) if (k##field == bit && f##field != rhs->f##field) return false;
-#define COMPARE_ISTRING(field) if (k##field == bit && f##field.compare_i(rhs->f##field) != 0) return false;
-    COMPARE(NodeId);
-    COMPARE(CreateTime);
-    COMPARE(ModifyTime);
-    COMPARE_ISTRING(CreateAgeName);
-    COMPARE(CreateAgeUuid);
-    COMPARE(CreatorAcct);
-    COMPARE(CreatorId);
-    COMPARE(NodeType);
-    COMPARE(Int32_1);
-    COMPARE(Int32_2);
-    COMPARE(Int32_3);
-    COMPARE(Int32_4);
-    COMPARE(UInt32_1);
-    COMPARE(UInt32_2);
-    COMPARE(UInt32_3);
-    COMPARE(UInt32_4);
-    COMPARE(Uuid_1);
-    COMPARE(Uuid_2);
-    COMPARE(Uuid_3);
-    COMPARE(Uuid_4);
-    COMPARE(String64_1);
-    COMPARE(String64_2);
-    COMPARE(String64_3);
-    COMPARE(String64_4);
-    COMPARE(String64_5);
-    COMPARE(String64_6);
-    COMPARE_ISTRING(IString64_1);
-    COMPARE_ISTRING(IString64_2);
-    COMPARE(Text_1);
-    COMPARE(Text_2);
-    COMPARE(Blob_1);
-    COMPARE(Blob_2);
+    // If the other node has a field we don't, we are obviously not the same.
+    uint64_t fields = rhs->fUsedFields;
+    if ((fUsedFields & fields) != fields)
+        return false;
+
+    // Most templates are looking for a node type, and most nodes aren't it,
+    // so get that out of the way before anything else.
+    if ((fields & kNodeType) && fNodeType != rhs->fNodeType)
+        return false;
+    fields &= ~uint64_t(kNodeType);
+
+    // Now just visit the fields the other node actually has
+    while (fields) {
+        uint64_t bit = fields & (~fields + 1);
+        fields &= fields - 1;
+
+        switch (bit) {
+#define COMPARE(field) case k##field: if (f##field != rhs->f##field) return false; break;
+#define COMPARE_ISTRING(field) case k##field: if (f##field.compare_i(rhs->f##field) != 0) return false; break;
+        COMPARE(NodeId);
+        COMPARE(CreateTime);
+        COMPARE(ModifyTime);
+        COMPARE_ISTRING(CreateAgeName);
+        COMPARE(CreateAgeUuid);
+        COMPARE(CreatorAcct);
+        COMPARE(CreatorId);
+        COMPARE(Int32_1);
+        COMPARE(Int32_2);
+        COMPARE(Int32_3);
+        COMPARE(Int32_4);
+        COMPARE(UInt32_1);
+        COMPARE(UInt32_2);
+        COMPARE(UInt32_3);
+        COMPARE(UInt32_4);
+        COMPARE(Uuid_1);
+        COMPARE(Uuid_2);
+        COMPARE(Uuid_3);
+        COMPARE(Uuid_4);
+        COMPARE(String64_1);
+        COMPARE(String64_2);
+        COMPARE(String64_3);
+        COMPARE(String64_4);
+        COMPARE(String64_5);
+        COMPARE(String64_6);
+        COMPARE_ISTRING(IString64_1);
+        COMPARE_ISTRING(IString64_2);
+        COMPARE(Text_1);
+        COMPARE(Text_2);
+        COMPARE(Blob_1);
+        COMPARE(Blob_2);
 #undef COMPARE
 #undef COMPARE_ISTRING
+        default:
+            // Not a field we know about, so nothing to compare
+            break;
+        }
     }
 
-    // We should never get here, but this silences a warning.
     return true;
 }
 
@@ -468,6 +479,7 @@ inline void IRead<NetVaultNode::Blob>(const uint8_t*& buf, NetVaultNode::Blob& b
 
 void NetVaultNode::Read(const uint8_t* buf, size_t size)
 {
+    uint64_t oldFields = fUsedFields;
     fUsedFields= *(reinterpret_cast<const uint64_t*>(buf));
     buf += sizeof(uint64_t);
 
@@ -507,6 +519,7 @@ void NetVaultNode::Read(const uint8_t* buf, size_t size)
 #undef READ
 
     fDirtyFields = 0;
+    IFieldsChanged(oldFields | fUsedFields);
 }
 
 //============================================================================
@@ -604,4 +617,5 @@ void NetVaultNode::ISetVaultBlob(uint64_t bits, NetVaultNode::Blob& blob, const
 
     fUsedFields |= bits;
     fDirtyFields |= bits;
+    IFieldsChanged(bits);
 }
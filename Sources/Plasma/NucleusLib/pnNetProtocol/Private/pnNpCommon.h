@@ -268,6 +268,7 @@ private:
         field = value;
         fUsedFields |= bits;
         fDirtyFields |= bits;
+        IFieldsChanged(bits);
     }
 
     template<typename T>
@@ -275,6 +276,7 @@ private:
     {
         field = value;
         fUsedFields |= bits;
+        IFieldsChanged(bits);
     }
 
     void ISetVaultBlob(uint64_t bits, Blob& blob, const uint8_t* buf, size_t size);
@@ -316,9 +318,18 @@ public:
 protected:
     uint64_t GetFieldFlags() const { return fUsedFields; }
 
+    /**
+     * Called after the fields in \a fields were set, copied or read, so
+     * subclasses can keep anything derived from them up to date
+     */
+    virtual void IFieldsChanged(uint64_t fields) { }
+
 public:
     bool IsDirty() const { return fDirtyFields != 0; }
     bool IsUsed() const { return fUsedFields != 0; }
+    bool HasNodeType() const { return (fUsedFields & kNodeType) != 0; }
+    bool HasInt32_1() const { return (fUsedFields & kInt32_1) != 0; }
+    bool HasString64_1() const { return (fUsedFields & kString64_1) != 0; }
 
     plUUID GetRevision() const { return fRevision; }
     void GenerateRevision() { fRevision = plUUID::Generate(); }
@@ -46,21 +46,27 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plSimulationInterface.h"
 #include "plAudioInterface.h"
 #include "pnMessage/plWarpMsg.h"
-#include "pnMessage/plTimeMsg.h"
 #include "pnMessage/plCorrectionMsg.h"
 #include "pnMessage/plIntRefMsg.h"
 #include "pnNetCommon/plSDLTypes.h"
 #include "plSceneObject.h"
 #include "hsResMgr.h"
-#include "plgDispatch.h"
 #include "pnKeyedObject/plKey.h"
 #include "hsStream.h"
 
 #include "plProfile.h"
 
+#include <algorithm>
+
 uint8_t plCoordinateInterface::fTransformPhase = plCoordinateInterface::kTransformPhaseNormal;
 bool plCoordinateInterface::fDelayedTransformsEnabled = true;
 
+std::vector<plCoordinateInterface*> plCoordinateInterface::fDirtyRoots[2];
+std::vector<plCoordinateInterface*> plCoordinateInterface::fUpdatingRoots;
+bool plCoordinateInterface::fUpdatingTransforms = false;
+std::vector<plCoordinateInterface::plTransformNode> plCoordinateInterface::fTransformNodes;
+std::vector<plCoordinateInterface*> plCoordinateInterface::fRecalcBatch;
+
 plCoordinateInterface::plCoordinateInterface()
 : fParent(),
   fReason(kReasonUnknown)
@@ -76,6 +82,9 @@ plCoordinateInterface::plCoordinateInterface()
 
 plCoordinateInterface::~plCoordinateInterface()
 {
+    IDequeueRoot(kTransformPhaseNormal);
+    IDequeueRoot(kTransformPhaseDelayed);
+
     if( fParent )
         fParent->IRemoveChild(IGetOwner());
     for (hsSsize_t i = fChildren.size() - 1; i >= 0; i--)
@@ -214,8 +223,8 @@ void plCoordinateInterface::IDetachChild(plSceneObject* child, uint8_t flags)
  *  A few notes on the delay transform properties...
  *
  *      The kCanEverDelayTransform prop is independent of any parents/children.
- *  It means this particular node must always update its transform in response
- *  to a plTransformMsg. It is intended for objects with physics, because they
+ *  It means this particular node must always update its transform in the
+ *  normal transform pass. It is intended for objects with physics, because they
  *  need to be up-to-date before the simulationMgr updates the physical world.
  *
  *      The kDelayedTransformEval prop is for nodes that are free of physics. (So no
@@ -261,16 +270,39 @@ void plCoordinateInterface::IRegisterForTransformMessage(bool delayed)
     if( IGetOwner() )
     {
         if ((delayed || fTransformPhase == kTransformPhaseDelayed) && fDelayedTransformsEnabled)
-            plgDispatch::Dispatch()->RegisterForExactType(plDelayedTransformMsg::Index(), IGetOwner()->GetKey());
+            IQueueRoot(kTransformPhaseDelayed);
         else
-            plgDispatch::Dispatch()->RegisterForExactType(plTransformMsg::Index(), IGetOwner()->GetKey());
+            IQueueRoot(kTransformPhaseNormal);
     }
 }
 
 void plCoordinateInterface::IUnRegisterForTransformMessage()
 {
-    if( IGetOwner() )
-        plgDispatch::Dispatch()->UnRegisterForExactType(plTransformMsg::Index(), IGetOwner()->GetKey());
+    IDequeueRoot(kTransformPhaseNormal);
+}
+
+void plCoordinateInterface::IQueueRoot(uint8_t phase)
+{
+    uint16_t queued = phase == kTransformPhaseDelayed ? kQueuedDelayed : kQueuedNormal;
+    if( fState & queued )
+        return;
+
+    fState |= queued;
+    fDirtyRoots[phase].push_back(this);
+}
+
+void plCoordinateInterface::IDequeueRoot(uint8_t phase)
+{
+    uint16_t queued = phase == kTransformPhaseDelayed ? kQueuedDelayed : kQueuedNormal;
+    if( !(fState & queued) )
+        return;
+
+    fState &= ~queued;
+
+    // We may be on the list the current pass is working through, rather
+    // than the one for the next pass. Leave a hole so the pass skips us.
+    std::replace(fDirtyRoots[phase].begin(), fDirtyRoots[phase].end(), this, (plCoordinateInterface*)nullptr);
+    std::replace(fUpdatingRoots.begin(), fUpdatingRoots.end(), this, (plCoordinateInterface*)nullptr);
 }
 
 
@@ -439,6 +471,30 @@ static inline hsMatrix44 IMatrixMul34(const hsMatrix44& lhs, const hsMatrix44& r
     return ret;
 }
 
+void plCoordinateInterface::recalc_batch_fpu(plCoordinateInterface* const* cis, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        plCoordinateInterface* ci = cis[i];
+        if( ci->fParent )
+        {
+            ci->fLocalToWorld = IMatrixMul34(ci->fParent->GetLocalToWorld(), ci->fLocalToParent);
+            ci->fWorldToLocal = IMatrixMul34(ci->fParentToLocal, ci->fParent->GetWorldToLocal());
+        }
+        else
+        {
+            ci->fLocalToWorld = ci->fLocalToParent;
+            ci->fWorldToLocal = ci->fParentToLocal;
+        }
+    }
+}
+
+hsCpuFunctionDispatcher<plCoordinateInterface::recalc_batch_ptr> plCoordinateInterface::recalc_batch {
+    &plCoordinateInterface::recalc_batch_fpu,
+    nullptr,            // SSE1
+    &plCoordinateInterface::recalc_batch_sse2
+};
+
 void plCoordinateInterface::IRecalcTransforms()
 {
     plProfile_IncCount(CIRecalc, 1);
@@ -510,6 +566,154 @@ void plCoordinateInterface::ITransformChanged(bool force, uint16_t reasons, bool
     }       
 }
 
+// Same as ITransformChanged, except that the hierarchy is flattened first, so
+// that all the matrix math can be done in one go before anybody hears about it.
+void plCoordinateInterface::IFlattenHierarchy(bool force, uint16_t reasons, bool checkForDelay)
+{
+    uint32_t idx = (uint32_t)fTransformNodes.size();
+    fTransformNodes.emplace_back();
+
+    fReason |= reasons;
+    uint16_t propagateReasons = fReason;
+
+    bool process = !(checkForDelay && GetProperty(kDelayedTransformEval)) || !fDelayedTransformsEnabled;
+    bool wasDirty = (fState & kTransformDirty) != 0;
+
+    plTransformNode& node = fTransformNodes[idx];
+    node.fCI = this;
+    node.fReasons = reasons;
+    node.fParentForce = force;
+    node.fProcess = process;
+    node.fWasDirty = wasDirty;
+    node.fForce = force || (process && wasDirty);
+
+    if (process)
+    {
+        bool childForce = node.fForce;
+        for (plSceneObject* child : fChildren)
+        {
+            if (child && child->GetVolatileCoordinateInterface())
+                child->GetVolatileCoordinateInterface()->IFlattenHierarchy(childForce, propagateReasons, checkForDelay);
+        }
+    }
+
+    fTransformNodes[idx].fEnd = (uint32_t)fTransformNodes.size();
+}
+
+void plCoordinateInterface::IFlushRecalcBatch()
+{
+    if (fRecalcBatch.empty())
+        return;
+
+    plProfile_IncCount(CIRecalc, fRecalcBatch.size());
+    plProfile_BeginTiming(CIRecalcT);
+    recalc_batch.call(fRecalcBatch.data(), fRecalcBatch.size());
+    plProfile_EndTiming(CIRecalcT);
+    fRecalcBatch.clear();
+}
+
+void plCoordinateInterface::IUpdateHierarchy(bool checkForDelay)
+{
+    fTransformNodes.clear();
+    IFlattenHierarchy(false, 0, checkForDelay);
+
+    // Parents come before their children, so by the time we get to a node
+    // its parent's world transforms are already final. Subclasses with their
+    // own idea of IRecalcTransforms break the batch up around themselves,
+    // and time themselves the same as they always have.
+    for (plTransformNode& node : fTransformNodes)
+    {
+        if (!node.fForce)
+            continue;
+
+        if (node.fCI->ClassIndex() == plCoordinateInterface::Index())
+        {
+            fRecalcBatch.push_back(node.fCI);
+        }
+        else
+        {
+            IFlushRecalcBatch();
+            node.fCI->IRecalcTransforms();
+        }
+        node.fCI->fState &= ~kTransformDirty;
+    }
+    IFlushRecalcBatch();
+
+    plProfile_BeginTiming(CITransT);
+    for (size_t i = 0; i < fTransformNodes.size(); )
+    {
+        plTransformNode& node = fTransformNodes[i];
+        plCoordinateInterface* ci = node.fCI;
+        plProfile_IncCount(CITrans, 1);
+
+        // Somebody's ISetTransform has moved this one since we did the math.
+        // ITransformChanged would have seen that when it got here, so let it
+        // take care of this branch.
+        bool dirty = (ci->fState & kTransformDirty) != 0;
+        if (dirty && (node.fForce || !node.fWasDirty))
+        {
+            ci->ITransformChanged(node.fParentForce, node.fReasons, checkForDelay);
+            i = node.fEnd;
+            continue;
+        }
+
+        if (node.fForce)
+        {
+            plProfile_IncCount(CISet, 1);
+            plProfile_BeginTiming(CISetT);
+            if( ci->IGetOwner() )
+            {
+                ci->IGetOwner()->ISetTransform(ci->fLocalToWorld, ci->fWorldToLocal);
+            }
+            plProfile_EndTiming(CISetT);
+
+            if (!node.fProcess)
+            {
+                // Our parent is dirty and we're bailing out on evaluating right now.
+                // Need to ensure we'll be evaluated in the delay pass
+                plProfile_IncCount(CIDirty, 1);
+                plProfile_BeginTiming(CIDirtyT);
+                ci->IDirtyTransform();
+                plProfile_EndTiming(CIDirtyT);
+            }
+        }
+        i++;
+    }
+    plProfile_EndTiming(CITransT);
+}
+
+void plCoordinateInterface::UpdateTransforms(uint8_t phase)
+{
+    // Anything dirtied from here on goes on the list for the next pass, just
+    // as registering for a transform message that has already gone out would.
+    if (fUpdatingTransforms)
+    {
+        hsAssert(false, "Transform passes can't be nested");
+        return;
+    }
+    fUpdatingTransforms = true;
+    fUpdatingRoots.swap(fDirtyRoots[phase]);
+
+    uint16_t queued = phase == kTransformPhaseDelayed ? kQueuedDelayed : kQueuedNormal;
+    bool checkForDelay = phase == kTransformPhaseNormal;
+    for (size_t i = 0; i < fUpdatingRoots.size(); i++)
+    {
+        plCoordinateInterface* root = fUpdatingRoots[i];
+        if (!root)
+            continue;
+
+        root->fState &= ~queued;
+        fUpdatingRoots[i] = nullptr;
+
+        // The message went to our owner, so without one nothing happened.
+        if (root->IGetOwner())
+            root->IUpdateHierarchy(checkForDelay);
+    }
+
+    fUpdatingRoots.clear();
+    fUpdatingTransforms = false;
+}
+
 void plCoordinateInterface::FlushTransform(bool fromRoot)
 {
     if( fromRoot )
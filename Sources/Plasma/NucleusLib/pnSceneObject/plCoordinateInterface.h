@@ -45,8 +45,11 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #define plCoordinateInterface_inc
 
 #include "plObjInterface.h"
+#include "hsCpuID.h"
 #include "hsMatrix44.h"
 
+#include <vector>
+
 class hsStream;
 class hsResMgr;
 
@@ -73,6 +76,8 @@ protected:
     enum {
         kTransformDirty     = 0x1,
         kWarp               = 0x2,
+        kQueuedNormal       = 0x4,      // in fDirtyRoots[kTransformPhaseNormal]
+        kQueuedDelayed      = 0x8,      // in fDirtyRoots[kTransformPhaseDelayed]
 
         kMaxState           = 0xffff
     };
@@ -94,6 +99,28 @@ protected:
     // Temp debugging tool, so we can quickly (dis/en)able delayed transforms at runtime.
     static bool                             fDelayedTransformsEnabled;
 
+    // Roots of hierarchies with something dirty in them, waiting for the
+    // UpdateTransforms pass of each phase. Takes the place of registering
+    // our owner for the plTransformMsg or plDelayedTransformMsg.
+    static std::vector<plCoordinateInterface*> fDirtyRoots[2];
+    static std::vector<plCoordinateInterface*> fUpdatingRoots;
+    static bool                             fUpdatingTransforms;
+
+    // One hierarchy, flattened parent before child, with the decisions
+    // ITransformChanged would make for each node.
+    struct plTransformNode
+    {
+        plCoordinateInterface*  fCI;
+        uint32_t                fEnd;           // one past our last descendant
+        uint16_t                fReasons;       // handed down by our parent
+        bool                    fParentForce;
+        bool                    fForce;
+        bool                    fProcess;
+        bool                    fWasDirty;
+    };
+    static std::vector<plTransformNode>     fTransformNodes;
+    static std::vector<plCoordinateInterface*> fRecalcBatch;
+
     uint16_t                                fState;
     uint16_t                                fReason;        // why we've changed position (if we have)
 
@@ -130,8 +157,14 @@ protected:
     void                    IDirtyTransform();
     void                    IRegisterForTransformMessage(bool delayed);
     void                    IUnRegisterForTransformMessage();
+    void                    IQueueRoot(uint8_t phase);
+    void                    IDequeueRoot(uint8_t phase);
     plCoordinateInterface*  IGetRoot();
 
+    void                    IFlattenHierarchy(bool force, uint16_t reasons, bool checkForDelay);
+    void                    IUpdateHierarchy(bool checkForDelay);
+    static void             IFlushRecalcBatch();
+
     friend class plSceneObject;
 
 public:
@@ -195,6 +228,19 @@ public:
 
     static bool     GetDelayedTransformsEnabled() { return fDelayedTransformsEnabled; }
     static void     SetDelayedTransformsEnabled(bool val) { fDelayedTransformsEnabled = val; }
+
+    // Bring every hierarchy dirtied for the given phase up to date. This is
+    // what sending the plTransformMsg (kTransformPhaseNormal) or the
+    // plDelayedTransformMsg (kTransformPhaseDelayed) used to do.
+    static void     UpdateTransforms(uint8_t phase);
+
+    // Recomputes local to world and world to local from the parent's, for
+    // each of a run of plain coordinate interfaces.
+    typedef void(*recalc_batch_ptr)(plCoordinateInterface* const* cis, size_t count);
+    static hsCpuFunctionDispatcher<recalc_batch_ptr> recalc_batch;
+
+    static void recalc_batch_fpu(plCoordinateInterface* const* cis, size_t count);
+    static void recalc_batch_sse2(plCoordinateInterface* const* cis, size_t count);
 };
 
 
@@ -0,0 +1,99 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "HeadSpin.h"
+#include "plCoordinateInterface.h"
+
+#ifdef HAVE_SSE2
+#   include <emmintrin.h>
+#endif // HAVE_SSE2
+
+#ifdef HAVE_SSE2
+// Row r of lhs times the upper three rows of rhs, summed in the same order as
+// IMatrixMul34 does it. The translation gets added on its own afterwards, so
+// the rotation columns never pick up a stray +0 from it.
+static inline void IRowMul34(const hsMatrix44& lhs, int r, const __m128 rhs0, const __m128 rhs1, const __m128 rhs2, hsMatrix44& ret)
+{
+    __m128 row = _mm_mul_ps(_mm_set1_ps(lhs.fMap[r][0]), rhs0);
+    row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(lhs.fMap[r][1]), rhs1));
+    row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(lhs.fMap[r][2]), rhs2));
+    _mm_storeu_ps(ret.fMap[r], row);
+    ret.fMap[r][3] += lhs.fMap[r][3];
+}
+
+static inline void IMatrixMul34(const hsMatrix44& lhs, const hsMatrix44& rhs, hsMatrix44& ret)
+{
+    const __m128 rhs0 = _mm_loadu_ps(rhs.fMap[0]);
+    const __m128 rhs1 = _mm_loadu_ps(rhs.fMap[1]);
+    const __m128 rhs2 = _mm_loadu_ps(rhs.fMap[2]);
+
+    IRowMul34(lhs, 0, rhs0, rhs1, rhs2, ret);
+    IRowMul34(lhs, 1, rhs0, rhs1, rhs2, ret);
+    IRowMul34(lhs, 2, rhs0, rhs1, rhs2, ret);
+
+    ret.fMap[3][0] = ret.fMap[3][1] = ret.fMap[3][2] = 0;
+    ret.fMap[3][3] = 1.f;
+    ret.NotIdentity();
+}
+#endif // HAVE_SSE2
+
+void plCoordinateInterface::recalc_batch_sse2(plCoordinateInterface* const* cis, size_t count)
+{
+#ifdef HAVE_SSE2
+    for (size_t i = 0; i < count; i++)
+    {
+        plCoordinateInterface* ci = cis[i];
+        if( ci->fParent )
+        {
+            IMatrixMul34(ci->fParent->GetLocalToWorld(), ci->fLocalToParent, ci->fLocalToWorld);
+            IMatrixMul34(ci->fParentToLocal, ci->fParent->GetWorldToLocal(), ci->fWorldToLocal);
+        }
+        else
+        {
+            ci->fLocalToWorld = ci->fLocalToParent;
+            ci->fWorldToLocal = ci->fParentToLocal;
+        }
+    }
+#else
+    recalc_batch_fpu(cis, count);
+#endif
+}
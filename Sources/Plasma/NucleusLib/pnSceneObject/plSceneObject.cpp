@@ -454,7 +454,6 @@ bool plSceneObject::MsgReceive(plMessage* msg)
 
     bool retVal = false;
     // If it's a bcast, let our own dispatcher find who's interested.
-    plTransformMsg* trans;
     plEvalMsg* eval = plEvalMsg::ConvertNoRef(msg);
     plAttachMsg* att = nullptr;
     if( eval )
@@ -466,16 +465,6 @@ bool plSceneObject::MsgReceive(plMessage* msg)
         return true;
     }
     else
-    if((trans = plTransformMsg::ConvertNoRef(msg))) // also catches the derived plDelayedTransformMsg
-    {
-        if( fCoordinateInterface )
-        {
-            // flush any dirty transforms
-            fCoordinateInterface->ITransformChanged(false, 0, trans->ClassIndex() == plTransformMsg::Index());
-        }
-        return true;
-    }
-    else
     if((att = plAttachMsg::ConvertNoRef(msg)))
     {
         if( fCoordinateInterface )
@@ -46,6 +46,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plAGAnim.h"
 #include "plAGAnimInstance.h"
 #include "plAGModifier.h"
+#include "plAGPoseProgram.h"
 #include "plMatrixChannel.h"
 
 // global
@@ -64,6 +65,8 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "pnSceneObject/plSceneObject.h"
 #include "pnSceneObject/plCoordinateInterface.h"
 
+#include <algorithm>
+
 ////////////////
 // PLAGMASTERMOD
 ////////////////
@@ -77,15 +80,28 @@ plAGMasterMod::plAGMasterMod()
   fFirstEval(true),
   fAGMasterSDLMod(),
   fNeedCompile(false),
+  fPoseProgram(),
+  fPoseDirty(true),
+  fPoseQueued(false),
+  fPoseTime(),
   fIsGrouped(false),
   fIsGroupMaster(false),
   fMsgForwarder()
 {
 }
 
+bool plAGMasterMod::fCompiledPoses = true;
+uint32_t plAGMasterMod::fEvalThreads = 1;
+bool plAGMasterMod::fDeferEvals = false;
+bool plAGMasterMod::fDeferredOpsDone = false;
+std::vector<plAGMasterMod*> plAGMasterMod::fDeferred;
+
 // DTOR
 plAGMasterMod::~plAGMasterMod()
 {
+    if (fPoseQueued)
+        std::replace(fDeferred.begin(), fDeferred.end(), this, (plAGMasterMod*)nullptr);
+    delete fPoseProgram;
 }
 
 void plAGMasterMod::Write(hsStream *stream, hsResMgr *mgr)
@@ -193,6 +209,7 @@ void plAGMasterMod::RemoveTarget(plSceneObject* o)
 {
     hsAssert(o == fTarget, "Removing target I don't have");
 
+    IFlushPose();
     DetachAllAnimations();
 
     // remove sdl modifier
@@ -217,6 +234,9 @@ plProfile_CreateTimer("  AffineCompose", "Animation", AffineCompose);
 plProfile_CreateTimer("  AffineApplicator", "Animation", MatrixApplicator);
 plProfile_CreateTimer("AnimatingPhysicals", "Animation", AnimatingPhysicals);
 plProfile_CreateTimer("StoppedAnimPhysicals", "Animation", StoppedAnimPhysicals);
+plProfile_CreateTimer("PoseJobs", "Animation", PoseJobs);
+plProfile_CreateCounter("PoseJobs", "Animation", PoseJobCount);
+plProfile_CreateTimer("PoseCommit", "Animation", PoseCommit);
 
 // IEVAL
 bool plAGMasterMod::IEval(double secs, float del, uint32_t dirty)
@@ -257,8 +277,15 @@ void plAGMasterMod::ApplyAnimations(double time, float elapsed)
 
 void plAGMasterMod::AdvanceAnimsToTime(double time)
 {
+    // Anything still waiting from an earlier apply goes out first, so this
+    // master's updates land in the order they were asked for.
+    IFlushPose();
+
     if(fNeedCompile)
         Compile(time);
+
+    if (fCompiledPoses && IApplyCompiledPoses(time))
+        return;
     
     for(plChannelModMap::iterator j = fChannelMods.begin(); j != fChannelMods.end(); j++)
     {
@@ -267,6 +294,195 @@ void plAGMasterMod::AdvanceAnimsToTime(double time)
     }
 }
 
+// IBUILDPOSEPROGRAM
+// Compile every plain transform applicator's graph into one program. Anything
+// else (difference and correction applicators, non-transform pins) keeps going
+// through plAGApplicator::Apply.
+void plAGMasterMod::IBuildPoseProgram(double time)
+{
+    if (!fPoseProgram)
+        fPoseProgram = new plAGPoseProgram;
+
+    fPoseProgram->Reset();
+    fPoseBindings.clear();
+    fPoseDirty = false;
+
+    for (plChannelModMap::iterator j = fChannelMods.begin(); j != fChannelMods.end(); j++)
+    {
+        plAGModifier *mod = (*j).second;
+        for (size_t i = 0; i < mod->GetNumApplicators(); i++)
+        {
+            plAGApplicator *app = mod->GetApplicatorAt(i);
+            if (app->ClassIndex() != plMatrixChannelApplicator::Index())
+                continue;
+
+            plMatrixChannel *matChan = plMatrixChannel::ConvertNoRef(app->GetChannel());
+            if (!matChan)
+                continue;
+
+            int output = fPoseProgram->AddChannel(matChan, time);
+            if (output < 0)
+                continue;
+
+            plPoseBinding binding;
+            binding.fMod = mod;
+            binding.fApp = app;
+            binding.fChannel = matChan;
+            binding.fOutput = output;
+            fPoseBindings.push_back(binding);
+        }
+    }
+}
+
+// IAPPLYCOMPILEDPOSES
+// Same visiting order and results as calling Apply on each modifier, but the
+// transform graphs are all evaluated up front by the pose program.
+bool plAGMasterMod::IApplyCompiledPoses(double time)
+{
+    if (!IEvalPoseSlots(time))
+        return false;
+
+    if (fDeferEvals && fPoseProgram->IsThreadSafe())
+    {
+        fPoseQueued = true;
+        fPoseTime = time;
+        fDeferred.push_back(this);
+        return true;
+    }
+
+    plProfile_BeginTiming(AffineValue);
+    fPoseProgram->EvalOps();
+    plProfile_EndTiming(AffineValue);
+
+    ICommitPoses(time);
+    return true;
+}
+
+// IEVALPOSESLOTS
+// Everything about evaluating the program that has to happen on this thread:
+// rebuilding it, and running the time sources, which may fire callbacks.
+bool plAGMasterMod::IEvalPoseSlots(double time)
+{
+    if (fPoseDirty)
+        IBuildPoseProgram(time);
+
+    plProfile_BeginTiming(AffineValue);
+    bool evaluated = fPoseProgram->EvalSlots(time);
+    if (!evaluated)
+    {
+        // A blend bias moved to or from 0 or 1 without a Compile; rebuild
+        // around the branches the graph will actually take now.
+        IBuildPoseProgram(time);
+        evaluated = fPoseProgram->EvalSlots(time);
+    }
+    plProfile_EndTiming(AffineValue);
+
+    if (!evaluated)
+        fPoseDirty = true;
+    return evaluated;
+}
+
+// ICOMMITPOSES
+// Hand the program's results to the applicators, and apply everything the
+// program doesn't cover.
+void plAGMasterMod::ICommitPoses(double time)
+{
+    size_t next = 0;
+    for (plChannelModMap::iterator j = fChannelMods.begin(); j != fChannelMods.end(); j++)
+    {
+        plAGModifier *mod = (*j).second;
+        if (mod->IsEnabled())
+        {
+            for (size_t i = 0; i < mod->GetNumApplicators(); i++)
+            {
+                plAGApplicator *app = mod->GetApplicatorAt(i);
+                if (next < fPoseBindings.size() &&
+                    fPoseBindings[next].fMod == mod &&
+                    fPoseBindings[next].fApp == app &&
+                    fPoseBindings[next].fChannel == app->GetChannel() &&
+                    app->ClassIndex() == plMatrixChannelApplicator::Index())
+                {
+                    const hsAffineParts &ap = fPoseProgram->GetParts(fPoseBindings[next].fOutput);
+                    static_cast<plMatrixChannelApplicator *>(app)->ApplyParts(mod, ap);
+                    next++;
+                }
+                else
+                    app->Apply(mod, time);
+            }
+        }
+
+        // Bindings left over for an enabled modifier mean its applicators
+        // changed under us; they were applied the slow way, so just rebuild.
+        while (next < fPoseBindings.size() && fPoseBindings[next].fMod == mod)
+        {
+            if (mod->IsEnabled())
+                fPoseDirty = true;
+            next++;
+        }
+    }
+
+}
+
+// IFLUSHPOSE
+// Finish a deferred evaluation of this master right now.
+void plAGMasterMod::IFlushPose()
+{
+    if (!fPoseQueued)
+        return;
+
+    std::replace(fDeferred.begin(), fDeferred.end(), this, (plAGMasterMod*)nullptr);
+    fPoseQueued = false;
+
+    if (!fDeferredOpsDone)
+        fPoseProgram->EvalOps();
+    ICommitPoses(fPoseTime);
+}
+
+void plAGMasterMod::BeginDeferredEvals()
+{
+    hsAssert(fDeferred.empty(), "Deferred evals weren't flushed");
+    fDeferEvals = fCompiledPoses && fEvalThreads != 1;
+    fDeferredOpsDone = false;
+}
+
+void plAGMasterMod::FlushDeferredEvals()
+{
+    fDeferEvals = false;
+    if (fDeferred.empty())
+        return;
+
+    plProfile_BeginTiming(PoseJobs);
+    static std::vector<plAGPoseProgram*> programs;
+    programs.clear();
+    for (plAGMasterMod* master : fDeferred)
+    {
+        if (master)
+            programs.push_back(master->fPoseProgram);
+    }
+    plProfile_IncCount(PoseJobCount, programs.size());
+    plAGPoseProgram::EvalOpsParallel(programs, fEvalThreads);
+    fDeferredOpsDone = true;
+    plProfile_EndTiming(PoseJobs);
+
+    // Applying can send messages that come straight back to a master further
+    // down the list, which then flushes itself; so check each one as we go.
+    plProfile_BeginTiming(PoseCommit);
+    for (size_t i = 0; i < fDeferred.size(); i++)
+    {
+        plAGMasterMod* master = fDeferred[i];
+        if (master)
+        {
+            fDeferred[i] = nullptr;
+            master->fPoseQueued = false;
+            master->ICommitPoses(master->fPoseTime);
+        }
+    }
+    plProfile_EndTiming(PoseCommit);
+
+    fDeferred.clear();
+    fDeferredOpsDone = false;
+}
+
 void plAGMasterMod::SetNeedCompile(bool needCompile)
 {
     fNeedCompile = true;
@@ -276,6 +492,7 @@ void plAGMasterMod::Compile(double time)
 {
     plChannelModMap::iterator end = fChannelMods.end();
     fNeedCompile = false;
+    fPoseDirty = true;
 
     for(plChannelModMap::iterator j = fChannelMods.begin(); j != end; j++)
     {
@@ -396,7 +613,9 @@ plAGAnimInstance * plAGMasterMod::AttachAnimationBlended(plAGAnim *anim,
     plAnimVector::iterator i;
     if(anim)
     {
+        IFlushPose();
         fNeedCompile = true;    // need to recompile the graph since we're editing it...
+        fPoseDirty = true;
         for (i = fPrivateAnims.begin(); i != fPrivateAnims.end(); i++) 
         {
             if (*i == anim)
@@ -549,7 +768,9 @@ void plAGMasterMod::DetachAnimation(plAGAnimInstance *anim)
     plInstanceVector::iterator i;
     plAnimVector::iterator j;
     
+    IFlushPose();
     fNeedCompile = true;    // need to recompile the graph since we're editing it...
+    fPoseDirty = true;
 
     for ( i = fAnimInstances.begin(); i != fAnimInstances.end(); i++)
     {
@@ -736,10 +957,12 @@ bool plAGMasterMod::MsgReceive(plMessage* msg)
         plAGModifier *agmod = plAGModifier::ConvertNoRef(genRefMsg->GetRef());
         if (agmod)
         {
+            IFlushPose();
             if (genRefMsg->GetContext() & (plRefMsg::kOnCreate|plRefMsg::kOnRequest))
                 fChannelMods[agmod->GetChannelName()] = agmod;
             else
                 fChannelMods.erase(agmod->GetChannelName());
+            fPoseDirty = true;
 
             return true;
         }
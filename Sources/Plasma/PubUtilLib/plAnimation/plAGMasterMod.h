@@ -54,6 +54,9 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 
 class plAGModifier;
+class plAGApplicator;
+class plAGChannel;
+class plAGPoseProgram;
 class plAGAnimInstance;
 class plAGAnim;
 class plATCAnim;
@@ -177,6 +180,29 @@ public:
     /** We've done something that invalidates the cached connectivity in the graph.
         Mark this for fixup. */
     void SetNeedCompile(bool needCompile);
+
+    /** Evaluate transform channels through a compiled plAGPoseProgram, one pass per
+        master, instead of walking each modifier's channel graph separately.
+        The results are identical either way; this is on by default. */
+    static void SetCompiledPoses(bool on) { fCompiledPoses = on; }
+    static bool GetCompiledPoses() { return fCompiledPoses; }
+
+    /** Threads to evaluate compiled poses on between BeginDeferredEvals and
+        FlushDeferredEvals. 0 means one per core, and 1 (the default) evaluates
+        each master as it's applied, the way it always has. */
+    static void SetEvalThreads(uint32_t numThreads) { fEvalThreads = numThreads; }
+    static uint32_t GetEvalThreads() { return fEvalThreads; }
+
+    /** Until the next FlushDeferredEvals, masters whose compiled poses are thread
+        safe do their time and blend bookkeeping as usual when applied, but leave
+        the interpolating and blending for later. Does nothing unless
+        SetEvalThreads asked for more than one thread. */
+    static void BeginDeferredEvals();
+
+    /** Evaluate every deferred master's poses across the eval threads, then
+        hand the results to their scene objects one master at a time, in the
+        order they were applied. */
+    static void FlushDeferredEvals();
     
     /** List the animationg graph to stdOut, with a ASCII representation of the tree
         structure. Done by recursively dumping the graph; some types of nodes will have
@@ -219,6 +245,12 @@ protected:
     // Find markers in an anim for environment effects (footsteps)
     virtual void ISetupMarkerCallbacks(plATCAnim *anim, plAnimTimeConvert *atc) {}
 
+    void IBuildPoseProgram(double time);
+    bool IApplyCompiledPoses(double time);
+    bool IEvalPoseSlots(double time);
+    void ICommitPoses(double time);
+    void IFlushPose();
+
     // -- members
     plSceneObject*  fTarget;
 
@@ -246,6 +278,27 @@ protected:
 
     bool fNeedCompile;
 
+    // compiled pose evaluation: one binding per transform applicator in the program,
+    // in the same order AdvanceAnimsToTime visits them
+    struct plPoseBinding
+    {
+        plAGModifier *fMod;
+        plAGApplicator *fApp;
+        plAGChannel *fChannel;
+        int fOutput;
+    };
+    std::vector<plPoseBinding> fPoseBindings;
+    plAGPoseProgram *fPoseProgram;
+    bool fPoseDirty;
+    bool fPoseQueued;           // waiting on FlushDeferredEvals
+    double fPoseTime;
+
+    static bool fCompiledPoses;
+    static uint32_t fEvalThreads;
+    static bool fDeferEvals;
+    static bool fDeferredOpsDone;
+    static std::vector<plAGMasterMod*> fDeferred;
+
     bool fIsGrouped;
     bool fIsGroupMaster;
     plMsgForwarder* fMsgForwarder;
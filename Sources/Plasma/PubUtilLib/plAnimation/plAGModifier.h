@@ -122,7 +122,12 @@ public:
     /** Get the channel tied to our ith applicator */
     plAGChannel * GetChannel(int i) { return fApps[i]->GetChannel(); }
 
+    /** Get our applicators in the order Apply fires them. */
+    size_t GetNumApplicators() const { return fApps.size(); }
+    plAGApplicator *GetApplicatorAt(size_t i) const { return fApps[i]; }
+
     void Enable(bool val);
+    bool IsEnabled() const { return fEnabled; }
 
     // PERSISTENCE
     void Read(hsStream *stream, hsResMgr *mgr) override;
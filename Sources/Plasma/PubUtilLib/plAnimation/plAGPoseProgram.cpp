@@ -0,0 +1,446 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//
+// INCLUDES
+//
+/////////////////////////////////////////////////////////////////////////////////////////
+
+// singular
+#include "plAGPoseProgram.h"
+
+// local
+#include "plMatrixChannel.h"
+#include "plScalarChannel.h"
+
+// other
+#include "plInterp/hsInterp.h"
+#include "plInterp/plAnimTimeConvert.h"
+#include "plInterp/plController.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+// Caches the program makes for itself stand in for an uncached Interp, which
+// always searches forwards
+static plAnimTimeConvert sForwardConvert;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//
+// plAGPoseProgram
+//
+/////////////////////////////////////////////////////////////////////////////////////////
+
+// ctor --------------------
+// -----
+plAGPoseProgram::plAGPoseProgram()
+: fNumSharedOps()
+{
+    Reset();
+}
+
+// dtor --------------------
+// -----
+plAGPoseProgram::~plAGPoseProgram()
+{
+    ITrimCaches(0);
+}
+
+// Reset --------------------
+// ------
+void plAGPoseProgram::Reset()
+{
+    fOps.clear();
+    fTimeSlots.clear();
+    fBiasSlots.clear();
+    fOutputs.clear();
+    fParts.clear();
+    fBiases.clear();
+    fResults.clear();
+    fTimes.assign(1, 0.0);
+    ITrimCaches(0);
+    fNumSharedOps = 0;
+
+    plPoseTimeSlot frameTime;
+    frameTime.fSource = nullptr;
+    frameTime.fParent = -1;
+    fTimeSlots.push_back(frameTime);
+}
+
+// AddChannel -------------------------------------------------------
+// -----------
+int plAGPoseProgram::AddChannel(plMatrixChannel *channel, double time)
+{
+    size_t numOps = fOps.size();
+    size_t numTimes = fTimeSlots.size();
+    size_t numBiases = fBiasSlots.size();
+    size_t numParts = fParts.size();
+    size_t numCaches = fOwnedCaches.size();
+    size_t numShared = fNumSharedOps;
+
+    int32_t op = ICompile(channel, 0, time);
+    if (op < 0)
+    {
+        // Leave the program exactly as it was before this channel.
+        fOps.resize(numOps);
+        fTimeSlots.resize(numTimes);
+        fBiasSlots.resize(numBiases);
+        fParts.resize(numParts);
+        ITrimCaches(numCaches);
+        fNumSharedOps = numShared;
+        return -1;
+    }
+
+    // Generic channels hand back their own storage, which the next graph may
+    // overwrite before we get around to reading it.
+    if (fOps[op].fType == kChannel)
+    {
+        int32_t copy = IAddOp(kCopy, 0);
+        fOps[copy].fA = op;
+        fOps[copy].fParts = IAddParts();
+        op = copy;
+    }
+
+    fOutputs.push_back(op);
+
+    fTimes.resize(fTimeSlots.size());
+    fBiases.resize(fBiasSlots.size());
+    fResults.resize(fOps.size());
+
+    return int(fOutputs.size() - 1);
+}
+
+// Eval ------------------------------
+// -----
+bool plAGPoseProgram::Eval(double time)
+{
+    if (!EvalSlots(time))
+        return false;
+
+    EvalOps();
+    return true;
+}
+
+// EvalSlots ------------------------------
+// ----------
+bool plAGPoseProgram::EvalSlots(double time)
+{
+    // Time sources first; a slot's parent always precedes it.
+    fTimes[0] = time;
+    for (size_t i = 1; i < fTimeSlots.size(); i++)
+    {
+        const plPoseTimeSlot &slot = fTimeSlots[i];
+        fTimes[i] = slot.fSource->Value(fTimes[slot.fParent]);
+    }
+
+    for (size_t i = 0; i < fBiasSlots.size(); i++)
+    {
+        const plPoseBiasSlot &slot = fBiasSlots[i];
+        float bias = slot.fSource->Value(fTimes[slot.fTime]);
+        if (IBiasCase(bias) != slot.fCase)
+            return false;
+        fBiases[i] = bias;
+    }
+
+    return true;
+}
+
+// EvalOps ----------------
+// --------
+void plAGPoseProgram::EvalOps()
+{
+    for (size_t i = 0; i < fOps.size(); i++)
+    {
+        const plPoseOp &op = fOps[i];
+        switch (op.fType)
+        {
+        case kSample:
+            // Fields the controller has no keys for keep the values they
+            // were seeded with, just as they do in the channel's own parts.
+            op.fController->Interp((float)fTimes[op.fTime], &fParts[op.fParts], op.fCache);
+            fResults[i] = &fParts[op.fParts];
+            break;
+
+        case kChannel:
+            fResults[i] = &op.fChannel->AffineValue(fTimes[op.fTime], false);
+            break;
+
+        case kCopy:
+            fParts[op.fParts] = *fResults[op.fA];
+            fResults[i] = &fParts[op.fParts];
+            break;
+
+        case kBlend:
+            hsInterp::LinInterp(fResults[op.fA], fResults[op.fB], fBiases[op.fBias], &fParts[op.fParts]);
+            fResults[i] = &fParts[op.fParts];
+            break;
+        }
+    }
+}
+
+// EvalOpsParallel ---------------------------------------------------------------------------------
+// ----------------
+void plAGPoseProgram::EvalOpsParallel(const std::vector<plAGPoseProgram *> &programs, uint32_t numThreads)
+{
+    if (numThreads == 0)
+        numThreads = std::max(std::thread::hardware_concurrency(), 1U);
+    numThreads = (uint32_t)std::min<size_t>(numThreads, programs.size());
+
+    if (numThreads <= 1)
+    {
+        for (plAGPoseProgram *program : programs)
+            program->EvalOps();
+        return;
+    }
+
+    // A fully dressed avatar has a lot more to do than a swinging door, so
+    // hand the programs out one at a time rather than in fixed bands.
+    std::atomic<size_t> next(0);
+    auto evalJobs = [&programs, &next]()
+    {
+        for (size_t i = next++; i < programs.size(); i = next++)
+        {
+            hsAssert(programs[i]->IsThreadSafe(), "Pose program can't run off the main thread");
+            programs[i]->EvalOps();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(numThreads - 1);
+    for (uint32_t i = 1; i < numThreads; i++)
+        threads.emplace_back(evalJobs);
+
+    evalJobs();
+
+    for (std::thread &thread : threads)
+        thread.join();
+}
+
+// IBiasCase ------------------------------
+// ----------
+uint8_t plAGPoseProgram::IBiasCase(float bias)
+{
+    // Same tests, in the same order, as plMatrixBlend::AffineValue
+    if (bias == 0)
+        return kBiasA;
+    if (bias == 1)
+        return kBiasB;
+    return kBiasMixed;
+}
+
+// ITimeSlot ------------------------------------------------------------
+// ----------
+int32_t plAGPoseProgram::ITimeSlot(plScalarChannel *source, int32_t parent)
+{
+    for (size_t i = 1; i < fTimeSlots.size(); i++)
+    {
+        if (fTimeSlots[i].fSource == source && fTimeSlots[i].fParent == parent)
+            return int32_t(i);
+    }
+
+    plPoseTimeSlot slot;
+    slot.fSource = source;
+    slot.fParent = parent;
+    fTimeSlots.push_back(slot);
+    return int32_t(fTimeSlots.size() - 1);
+}
+
+// IBiasSlot ------------------------------------------------------------------------------
+// ----------
+int32_t plAGPoseProgram::IBiasSlot(plScalarChannel *source, int32_t time, double frameTime)
+{
+    for (size_t i = 0; i < fBiasSlots.size(); i++)
+    {
+        if (fBiasSlots[i].fSource == source && fBiasSlots[i].fTime == time)
+            return int32_t(i);
+    }
+
+    // Classify the way plMatrixBlend::Optimize does, but peek so that
+    // compiling never advances a time convert.
+    plPoseBiasSlot slot;
+    slot.fSource = source;
+    slot.fTime = time;
+    slot.fCase = IBiasCase(source->Value(frameTime, true));
+    fBiasSlots.push_back(slot);
+    return int32_t(fBiasSlots.size() - 1);
+}
+
+// IAddOp --------------------------------------------
+// -------
+int32_t plAGPoseProgram::IAddOp(uint8_t type, int32_t time)
+{
+    plPoseOp op;
+    op.fType = type;
+    op.fTime = time;
+    op.fA = -1;
+    op.fB = -1;
+    op.fBias = -1;
+    op.fParts = -1;
+    op.fChannel = nullptr;
+    op.fController = nullptr;
+    op.fCache = nullptr;
+    fOps.push_back(op);
+    return int32_t(fOps.size() - 1);
+}
+
+// IAddParts ----------------------
+// ----------
+int32_t plAGPoseProgram::IAddParts()
+{
+    fParts.emplace_back();
+    return int32_t(fParts.size() - 1);
+}
+
+// IAddSample ---------------------------------------------------------------------------------------------
+// -----------
+int32_t plAGPoseProgram::IAddSample(plMatrixControllerChannel *channel, plControllerCacheInfo *cache, int32_t time)
+{
+    if (!channel->fController)
+        return -1;
+
+    // Without a cache, Interp keeps its place in the keys on the controller,
+    // which every avatar playing the animation shares.
+    if (!cache)
+    {
+        cache = channel->fController->CreateCache();
+        if (cache)
+        {
+            cache->SetATC(&sForwardConvert);
+            fOwnedCaches.push_back(cache);
+        }
+        else
+            fNumSharedOps++;
+    }
+
+    int32_t op = IAddOp(kSample, time);
+    fOps[op].fController = channel->fController;
+    fOps[op].fCache = cache;
+    fOps[op].fParts = IAddParts();
+    fParts[fOps[op].fParts] = channel->fAP;
+    return op;
+}
+
+// ITrimCaches ---------------------------------
+// ------------
+void plAGPoseProgram::ITrimCaches(size_t numCaches)
+{
+    for (size_t i = numCaches; i < fOwnedCaches.size(); i++)
+        delete fOwnedCaches[i];
+    fOwnedCaches.resize(numCaches);
+}
+
+// ICompile -----------------------------------------------------------------------------------
+// ---------
+// Mirrors the AffineValue implementations of the channel types we know about;
+// anything else is called through AffineValue as-is.
+int32_t plAGPoseProgram::ICompile(plMatrixChannel *channel, int32_t time, double frameTime)
+{
+    if (!channel)
+        return -1;
+
+    uint16_t classIdx = channel->ClassIndex();
+
+    if (classIdx == plMatrixBlend::Index())
+    {
+        plMatrixBlend *blend = static_cast<plMatrixBlend *>(channel);
+        if (!blend->fChannelBias)
+            return -1;
+
+        int32_t bias = IBiasSlot(blend->fChannelBias, time, frameTime);
+        switch (fBiasSlots[bias].fCase)
+        {
+        case kBiasA:
+            return ICompile(blend->fOptimizedA, time, frameTime);
+        case kBiasB:
+            return ICompile(blend->fOptimizedB, time, frameTime);
+        }
+
+        int32_t a = ICompile(blend->fChannelA, time, frameTime);
+        if (a < 0)
+            return -1;
+        int32_t b = ICompile(blend->fChannelB, time, frameTime);
+        if (b < 0)
+            return -1;
+
+        int32_t op = IAddOp(kBlend, time);
+        fOps[op].fA = a;
+        fOps[op].fB = b;
+        fOps[op].fBias = bias;
+        fOps[op].fParts = IAddParts();
+        return op;
+    }
+
+    if (classIdx == plMatrixTimeScale::Index())
+    {
+        plMatrixTimeScale *scale = static_cast<plMatrixTimeScale *>(channel);
+        if (!scale->fTimeSource)
+            return -1;
+
+        int32_t in = ICompile(scale->fChannelIn, ITimeSlot(scale->fTimeSource, time), frameTime);
+        if (in < 0 || fOps[in].fType != kChannel)
+            return in;
+
+        int32_t op = IAddOp(kCopy, time);
+        fOps[op].fA = in;
+        fOps[op].fParts = IAddParts();
+        return op;
+    }
+
+    if (classIdx == plMatrixControllerCacheChannel::Index())
+    {
+        plMatrixControllerCacheChannel *cached = static_cast<plMatrixControllerCacheChannel *>(channel);
+        if (!cached->fControllerChannel)
+            return -1;
+
+        return IAddSample(cached->fControllerChannel, cached->fCache, time);
+    }
+
+    if (classIdx == plMatrixControllerChannel::Index())
+        return IAddSample(static_cast<plMatrixControllerChannel *>(channel), nullptr, time);
+
+    int32_t op = IAddOp(kChannel, time);
+    fOps[op].fChannel = channel;
+    fNumSharedOps++;
+    return op;
+}
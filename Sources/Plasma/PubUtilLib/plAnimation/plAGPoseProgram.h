@@ -0,0 +1,197 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+/** \file plAGPoseProgram.h
+    \brief Flattened evaluation of matrix channel graphs
+
+    \ingroup Avatar
+    \ingroup AniGraph
+*/
+#ifndef PLAGPOSEPROGRAM_INC
+#define PLAGPOSEPROGRAM_INC
+
+#include "HeadSpin.h"
+#include "plTransform/hsAffineParts.h"
+
+#include <vector>
+
+class plController;
+class plControllerCacheInfo;
+class plMatrixChannel;
+class plMatrixControllerChannel;
+class plScalarChannel;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//
+// DEFINITIONS
+//
+/////////////////////////////////////////////////////////////////////////////////////////
+/** \class plAGPoseProgram
+    A linear evaluation program for a set of matrix channel graphs, usually all
+    of the transform channels driven by one plAGMasterMod.
+
+    Compiling walks each graph the way plMatrixChannel::AffineValue would,
+    taking the branch of every blend that its current bias selects, and records
+    the visited nodes as a flat list of ops in evaluation order. Time sources
+    and blend biases shared between graphs (one per animation instance, rather
+    than one per bone) become slots that are evaluated once per frame.
+
+    The program is specialized on whether each bias was 0, 1 or in between when
+    it was compiled. If a bias has since crossed into a different case, Eval
+    returns false and the program must be rebuilt before it matches the graph
+    again. Any change to the connectivity of the graph also requires a rebuild.
+
+    Eval comes in two halves. EvalSlots runs the time sources, which can fire
+    animation callbacks, and belongs on the main thread. EvalOps does the
+    interpolating and blending; if the program IsThreadSafe, that only touches
+    storage the program owns, so many programs can run their ops at once.
+    */
+class plAGPoseProgram
+{
+public:
+    plAGPoseProgram();
+    ~plAGPoseProgram();
+
+    plAGPoseProgram(const plAGPoseProgram &) = delete;
+    plAGPoseProgram &operator=(const plAGPoseProgram &) = delete;
+
+    /** Forget all compiled channels. */
+    void Reset();
+
+    /** Compile the graph under the given channel and append it to the program.
+        Returns the output index to pass to GetParts, or -1 if the graph
+        contains something the program can't represent. */
+    int AddChannel(plMatrixChannel *channel, double time);
+
+    /** Evaluate every compiled graph at the given time.
+        Returns false, without running any ops, if a blend bias no longer
+        selects the branch it was compiled for. */
+    bool Eval(double time);
+
+    /** The first half of Eval: evaluate the time and bias slots.
+        Returns false if a blend bias no longer selects its compiled branch. */
+    bool EvalSlots(double time);
+
+    /** The second half of Eval: run the ops against the last EvalSlots. */
+    void EvalOps();
+
+    /** True if EvalOps stays within the program's own storage, so that it
+        can run on any thread. False if it has to call into a channel. */
+    bool IsThreadSafe() const { return fNumSharedOps == 0; }
+
+    /** Run EvalOps for each of the given programs, which must all be thread
+        safe, spread over numThreads threads. 0 means one per core, and 1 runs
+        them all on the calling thread. */
+    static void EvalOpsParallel(const std::vector<plAGPoseProgram *> &programs, uint32_t numThreads);
+
+    /** The result of the given output after the last successful Eval. */
+    const hsAffineParts &GetParts(int output) const { return *fResults[fOutputs[output]]; }
+
+    size_t GetNumOps() const { return fOps.size(); }
+    size_t GetNumOutputs() const { return fOutputs.size(); }
+
+protected:
+    enum OpType
+    {
+        kSample,        // interpolate a controller into fParts
+        kChannel,       // any other channel, through AffineValue
+        kCopy,          // snapshot a kChannel result before something overwrites it
+        kBlend,         // interpolate two op results by a bias slot
+    };
+
+    enum BiasCase
+    {
+        kBiasA,
+        kBiasB,
+        kBiasMixed,
+    };
+
+    struct plPoseOp
+    {
+        uint8_t fType;
+        int32_t fTime;                  // time slot the op is evaluated at
+        int32_t fA;                     // input op (kCopy, kBlend)
+        int32_t fB;                     // second input op (kBlend)
+        int32_t fBias;                  // bias slot (kBlend)
+        int32_t fParts;                 // index into fParts for kSample, kCopy and kBlend results
+        plMatrixChannel *fChannel;      // kChannel
+        const plController *fController;    // kSample
+        plControllerCacheInfo *fCache;  // kSample
+    };
+
+    struct plPoseTimeSlot
+    {
+        plScalarChannel *fSource;
+        int32_t fParent;
+    };
+
+    struct plPoseBiasSlot
+    {
+        plScalarChannel *fSource;
+        int32_t fTime;
+        uint8_t fCase;
+    };
+
+    std::vector<plPoseOp> fOps;
+    std::vector<plPoseTimeSlot> fTimeSlots;     // slot 0 is the frame time
+    std::vector<plPoseBiasSlot> fBiasSlots;
+    std::vector<int32_t> fOutputs;              // op index of each compiled channel
+    std::vector<plControllerCacheInfo *> fOwnedCaches;  // for samples compiled without one
+    size_t fNumSharedOps;                       // ops that write outside the program
+
+    // per-frame scratch
+    std::vector<double> fTimes;
+    std::vector<float> fBiases;
+    std::vector<hsAffineParts> fParts;
+    std::vector<const hsAffineParts *> fResults;
+
+    static uint8_t IBiasCase(float bias);
+
+    int32_t ITimeSlot(plScalarChannel *source, int32_t parent);
+    int32_t IBiasSlot(plScalarChannel *source, int32_t time, double frameTime);
+    int32_t IAddOp(uint8_t type, int32_t time);
+    int32_t IAddParts();
+    int32_t IAddSample(plMatrixControllerChannel *channel, plControllerCacheInfo *cache, int32_t time);
+    void ITrimCaches(size_t numCaches);
+    int32_t ICompile(plMatrixChannel *channel, int32_t time, double frameTime);
+};
+
+#endif // PLAGPOSEPROGRAM_INC
@@ -741,28 +741,33 @@ void plMatrixChannelApplicator::IApply(const plAGModifier *mod, double time)
 
         if(matChan)
         {
-            hsMatrix44 inverse;
-
             plProfile_BeginTiming(AffineValue);
             const hsAffineParts &ap = matChan->AffineValue(time);
             plProfile_EndTiming(AffineValue);
-            
-            hsMatrix44 result;
-
-            plProfile_BeginTiming(AffineCompose);
-            ap.ComposeMatrix(&result);
-            ap.ComposeInverseMatrix(&inverse);
-            //result.GetInverse(&inverse);
-            plProfile_EndTiming(AffineCompose);
 
-            plProfile_BeginTiming(MatrixApplicator);
-            plCoordinateInterface *CI = IGetCI(mod);
-            CI->SetLocalToParent(result, inverse);
-            plProfile_EndTiming(MatrixApplicator);  
+            ISetParts(mod, ap);
         }
     }
 }
 
+// ISETPARTS
+void plMatrixChannelApplicator::ISetParts(const plAGModifier *mod, const hsAffineParts &ap)
+{
+    hsMatrix44 inverse;
+    hsMatrix44 result;
+
+    plProfile_BeginTiming(AffineCompose);
+    ap.ComposeMatrix(&result);
+    ap.ComposeInverseMatrix(&inverse);
+    //result.GetInverse(&inverse);
+    plProfile_EndTiming(AffineCompose);
+
+    plProfile_BeginTiming(MatrixApplicator);
+    plCoordinateInterface *CI = IGetCI(mod);
+    CI->SetLocalToParent(result, inverse);
+    plProfile_EndTiming(MatrixApplicator);
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////
 //
 // plMatrixDelayedCorrectionApplicator
@@ -60,6 +60,7 @@ class hsAffineParts;
 class plAnimTimeConvert;
 class plMatrixChannelApplicator;
 class plControllerCacheInfo;
+class plAGPoseProgram;
 
 //////////////////
 // PLMATRIXCHANNEL
@@ -132,6 +133,8 @@ protected:
     plScalarChannel *fTimeSource;
     plMatrixChannel *fChannelIn;
 
+    friend class plAGPoseProgram;
+
 public:
     plMatrixTimeScale();
     plMatrixTimeScale(plMatrixChannel *channel, plScalarChannel *timeSource);
@@ -164,6 +167,8 @@ protected:
     plScalarChannel * fChannelBias;
     int fPriority;
 
+    friend class plAGPoseProgram;
+
 public:
     // xTORs
     plMatrixBlend();
@@ -214,6 +219,8 @@ class plMatrixControllerChannel : public plMatrixChannel
 protected:
     plController    *fController;
 
+    friend class plAGPoseProgram;
+
 public:
     // xTORs
     plMatrixControllerChannel();
@@ -249,6 +256,8 @@ class plMatrixControllerCacheChannel : public plMatrixChannel
 protected:
     plControllerCacheInfo *fCache;
     plMatrixControllerChannel *fControllerChannel;
+
+    friend class plAGPoseProgram;
     
 public:
     plMatrixControllerCacheChannel();
@@ -311,8 +320,13 @@ class plMatrixChannelApplicator : public plAGApplicator
 {
 protected:
     void IApply(const plAGModifier *mod, double time) override;
+    void ISetParts(const plAGModifier *mod, const hsAffineParts &ap);
 
 public:
+    /** Apply parts that have already been evaluated from our channel, exactly
+        as IApply would. Used by plAGMasterMod's compiled pose evaluation. */
+    void ApplyParts(const plAGModifier *mod, const hsAffineParts &ap) { if (fEnabled) ISetParts(mod, ap); }
+
     CLASSNAME_REGISTER( plMatrixChannelApplicator );
     GETINTERFACE_ANY( plMatrixChannelApplicator, plAGApplicator );
 
@@ -0,0 +1,166 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "plLZ4Compress.h"
+#include "hsMemory.h"
+
+#include <vector>
+
+#ifdef USE_LZ4
+#   include <lz4.h>
+#endif
+
+// Each thread keeps the compressor's hash table and a scratch output buffer
+// around, so compressing a message doesn't allocate anything but the result.
+static thread_local std::vector<uint8_t> s_scratch;
+
+#ifdef USE_LZ4
+
+struct plLZ4Context
+{
+    LZ4_stream_t fStream;
+
+    plLZ4Context() { LZ4_initStream(&fStream, sizeof(fStream)); }
+};
+
+static thread_local plLZ4Context s_context;
+
+bool plLZ4Compress::IsAvailable()
+{
+    return true;
+}
+
+bool plLZ4Compress::Uncompress(uint8_t* bufOut, uint32_t* bufLenOut, const uint8_t* bufIn, uint32_t bufLenIn)
+{
+    int result = LZ4_decompress_safe((const char*)bufIn, (char*)bufOut, bufLenIn, *bufLenOut);
+    if (result < 0)
+        return false;
+    *bufLenOut = result;
+    return true;
+}
+
+bool plLZ4Compress::Compress(uint8_t* bufOut, uint32_t* bufLenOut, const uint8_t* bufIn, uint32_t bufLenIn)
+{
+    int result = LZ4_compress_fast_extState(&s_context.fStream, (const char*)bufIn, (char*)bufOut,
+                                            bufLenIn, *bufLenOut, 1);
+    if (result <= 0)
+        return false;
+    *bufLenOut = result;
+    return true;
+}
+
+#else
+
+bool plLZ4Compress::IsAvailable()
+{
+    return false;
+}
+
+bool plLZ4Compress::Uncompress(uint8_t* bufOut, uint32_t* bufLenOut, const uint8_t* bufIn, uint32_t bufLenIn)
+{
+    hsAssert(false, "plLZ4Compress: Not built with LZ4 support");
+    return false;
+}
+
+bool plLZ4Compress::Compress(uint8_t* bufOut, uint32_t* bufLenOut, const uint8_t* bufIn, uint32_t bufLenIn)
+{
+    hsAssert(false, "plLZ4Compress: Not built with LZ4 support");
+    return false;
+}
+
+#endif  // USE_LZ4
+
+//
+// In place version
+// offset is how much to skip over when compressing
+//
+bool plLZ4Compress::Compress(uint8_t** bufIn, uint32_t* bufLenIn, int offset)
+{
+    if (!IsAvailable())
+        return false;
+
+    uint32_t adjBufLenIn = *bufLenIn - offset;
+    uint8_t* adjBufIn = *bufIn + offset;
+
+    // anything that doesn't fit in the input's own size isn't worth keeping
+    uint32_t bufLenOut = adjBufLenIn;
+    if (s_scratch.size() < bufLenOut)
+        s_scratch.resize(bufLenOut);
+
+    if (!Compress(s_scratch.data(), &bufLenOut, adjBufIn, adjBufLenIn) || bufLenOut >= adjBufLenIn)
+        return false;
+
+    uint8_t* newBuf = new uint8_t[bufLenOut + offset];
+    HSMemory::BlockMove(*bufIn, newBuf, offset);
+    HSMemory::BlockMove(s_scratch.data(), newBuf + offset, bufLenOut);
+    delete [] *bufIn;
+
+    *bufIn = newBuf;
+    *bufLenIn = bufLenOut + offset;
+    return true;
+}
+
+//
+// In place version
+//
+bool plLZ4Compress::Uncompress(uint8_t** bufIn, uint32_t* bufLenIn, uint32_t bufLenOut, int offset)
+{
+    if (!IsAvailable())
+        return false;
+
+    uint32_t adjBufLenIn = *bufLenIn - offset;
+    uint8_t* adjBufIn = *bufIn + offset;
+
+    // decompress straight into the new buffer, since we know the size
+    uint8_t* newBuf = new uint8_t[bufLenOut + offset];
+    if (!Uncompress(newBuf + offset, &bufLenOut, adjBufIn, adjBufLenIn))
+    {
+        delete [] newBuf;
+        return false;
+    }
+    HSMemory::BlockMove(*bufIn, newBuf, offset);
+    delete [] *bufIn;
+
+    *bufIn = newBuf;
+    *bufLenIn = bufLenOut + offset;
+    return true;
+}
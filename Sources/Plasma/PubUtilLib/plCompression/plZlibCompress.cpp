@@ -45,12 +45,94 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "hsStream.h"
 
 #include <memory>
+#include <vector>
+
+//// Per-Thread Contexts ////////////////////////////////////////////////////
+// zlib's compress() and uncompress() set up and tear down a few hundred KB
+// of state on every call, which adds up when every SDL and game message
+// stream goes through here.  Each thread instead keeps its streams alive,
+// resetting them between buffers, along with a scratch output buffer for
+// in place compression.
+
+class plZlibContext
+{
+    z_stream    fDeflate;
+    z_stream    fInflate;
+    int         fDeflateLevel;
+    bool        fDeflateInit;
+    bool        fInflateInit;
+
+    std::vector<uint8_t> fScratch;
+
+public:
+    plZlibContext() : fDeflate(), fInflate(), fDeflateLevel(), fDeflateInit(), fInflateInit() { }
+    ~plZlibContext()
+    {
+        if (fDeflateInit)
+            deflateEnd(&fDeflate);
+        if (fInflateInit)
+            inflateEnd(&fInflate);
+    }
+
+    z_stream* GetDeflate(int level)
+    {
+        if (fDeflateInit && fDeflateLevel != level)
+        {
+            deflateEnd(&fDeflate);
+            fDeflateInit = false;
+        }
+        if (!fDeflateInit)
+        {
+            fDeflate = z_stream();
+            if (deflateInit(&fDeflate, level) != Z_OK)
+                return nullptr;
+            fDeflateLevel = level;
+            fDeflateInit = true;
+        }
+        else if (deflateReset(&fDeflate) != Z_OK)
+            return nullptr;
+        return &fDeflate;
+    }
+
+    z_stream* GetInflate()
+    {
+        if (!fInflateInit)
+        {
+            fInflate = z_stream();
+            if (inflateInit(&fInflate) != Z_OK)
+                return nullptr;
+            fInflateInit = true;
+        }
+        else if (inflateReset(&fInflate) != Z_OK)
+            return nullptr;
+        return &fInflate;
+    }
+
+    uint8_t* GetScratch(size_t len)
+    {
+        if (fScratch.size() < len)
+            fScratch.resize(len);
+        return fScratch.data();
+    }
+};
+
+static thread_local plZlibContext s_context;
+
+//// Buffer Versions /////////////////////////////////////////////////////////
 
 bool plZlibCompress::Uncompress(uint8_t* bufOut, uint32_t* bufLenOut, const uint8_t* bufIn, uint32_t bufLenIn)
 {
-    unsigned long buflen_out = *bufLenOut;
-    bool result = (uncompress(bufOut, &buflen_out, bufIn, bufLenIn) == Z_OK);
-    *bufLenOut = buflen_out;
+    z_stream* stream = s_context.GetInflate();
+    if (!stream)
+        return false;
+
+    stream->next_in = const_cast<Bytef*>(bufIn);
+    stream->avail_in = bufLenIn;
+    stream->next_out = bufOut;
+    stream->avail_out = *bufLenOut;
+
+    bool result = (inflate(stream, Z_FINISH) == Z_STREAM_END);
+    *bufLenOut = stream->total_out;
     return result;
 }
 
@@ -58,16 +140,29 @@ bool plZlibCompress::Compress(uint8_t* bufOut, uint32_t* bufLenOut, const uint8_
 {
     // according to compress doc, the bufOut buffer should be at least .1% larger than source buffer, plus 12 bytes.
     hsAssert(*bufLenOut>=(int)(bufLenIn*1.1+12), "bufOut compress buffer is not large enough");
-    unsigned long buflen_out = *bufLenOut;
-    bool result = (compress(bufOut, &buflen_out, bufIn, bufLenIn) == Z_OK);
-    *bufLenOut = buflen_out;
+    return ICompress(bufOut, bufLenOut, bufIn, bufLenIn);
+}
+
+bool plZlibCompress::ICompress(uint8_t* bufOut, uint32_t* bufLenOut, const uint8_t* bufIn, uint32_t bufLenIn)
+{
+    z_stream* stream = s_context.GetDeflate(fLevel);
+    if (!stream)
+        return false;
+
+    stream->next_in = const_cast<Bytef*>(bufIn);
+    stream->avail_in = bufLenIn;
+    stream->next_out = bufOut;
+    stream->avail_out = *bufLenOut;
+
+    bool result = (deflate(stream, Z_FINISH) == Z_STREAM_END);
+    *bufLenOut = stream->total_out;
     return result;
 }
 
 //
 // copy bufOut to bufIn, set bufLenIn=bufLenOut
 //
-bool plZlibCompress::ICopyBuffers(uint8_t** bufIn, uint32_t* bufLenIn, char* bufOut, uint32_t bufLenOut, int offset, bool ok)
+bool plZlibCompress::ICopyBuffers(uint8_t** bufIn, uint32_t* bufLenIn, const uint8_t* bufOut, uint32_t bufLenOut, int offset, bool ok)
 {
     if (ok)
     {
@@ -77,11 +172,9 @@ bool plZlibCompress::ICopyBuffers(uint8_t** bufIn, uint32_t* bufLenIn, char* buf
         delete [] *bufIn;                               // delete original buffer
 
         HSMemory::BlockMove(bufOut, newBuf+offset, bufLenOut);  // copy compressed part
-        delete [] bufOut;
         *bufIn = newBuf;
         return true;
     }
-    delete [] bufOut;
     return false;
 }
 
@@ -94,11 +187,11 @@ bool plZlibCompress::Compress(uint8_t** bufIn, uint32_t* bufLenIn, int offset)
     uint32_t adjBufLenIn = *bufLenIn - offset;
     uint8_t* adjBufIn = *bufIn + offset;
 
-    // according to compress doc, the bufOut buffer should be at least .1% larger than source buffer, plus 12 bytes.
-    uint32_t bufLenOut = (int)(adjBufLenIn*1.1+12);
-    char* bufOut = new char[bufLenOut];
-    
-    bool ok=(Compress((uint8_t*)bufOut, &bufLenOut, (uint8_t*)adjBufIn, adjBufLenIn) && 
+    // anything that doesn't fit in the input's own size isn't worth keeping
+    uint32_t bufLenOut = adjBufLenIn;
+    uint8_t* bufOut = s_context.GetScratch(bufLenOut);
+
+    bool ok=(ICompress(bufOut, &bufLenOut, adjBufIn, adjBufLenIn) &&
         bufLenOut < adjBufLenIn);
     return ICopyBuffers(bufIn, bufLenIn, bufOut, bufLenOut, offset, ok);
 }
@@ -111,10 +204,19 @@ bool plZlibCompress::Uncompress(uint8_t** bufIn, uint32_t* bufLenIn, uint32_t bu
     uint32_t adjBufLenIn = *bufLenIn - offset;
     uint8_t* adjBufIn = *bufIn + offset;
 
-    char* bufOut = new char[bufLenOut];
-    
-    bool ok=Uncompress((uint8_t*)bufOut, &bufLenOut, (uint8_t*)adjBufIn, adjBufLenIn) ? true : false;
-    return ICopyBuffers(bufIn, bufLenIn, bufOut, bufLenOut, offset, ok);
+    // decompress straight into the new buffer, since we know the size
+    uint8_t* newBuf = new uint8_t[bufLenOut+offset];
+    if (!Uncompress(newBuf+offset, &bufLenOut, adjBufIn, adjBufLenIn))
+    {
+        delete [] newBuf;
+        return false;
+    }
+    HSMemory::BlockMove(*bufIn, newBuf, offset);    // copy offset (uncompressed) part
+    delete [] *bufIn;
+
+    *bufIn = newBuf;
+    *bufLenIn = bufLenOut+offset;
+    return true;
 }
 
 //// .gz File Versions ///////////////////////////////////////////////////////
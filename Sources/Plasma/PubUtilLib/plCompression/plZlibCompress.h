@@ -49,8 +49,22 @@ class hsStream;
 class plZlibCompress : public plCompress
 {
 protected:
-    bool ICopyBuffers(uint8_t** bufIn, uint32_t* bufLenIn, char* bufOut, uint32_t bufLenOut, int offset, bool ok );
+    int fLevel;
+
+    bool ICompress(uint8_t* bufOut, uint32_t* bufLenOut, const uint8_t* bufIn, uint32_t bufLenIn);
+    bool ICopyBuffers(uint8_t** bufIn, uint32_t* bufLenIn, const uint8_t* bufOut, uint32_t bufLenOut, int offset, bool ok );
 public:
+    enum
+    {
+        kDefaultLevel = -1,     // zlib's speed/size tradeoff, currently 6
+        kFastestLevel = 1,
+        kSmallestLevel = 9,
+    };
+
+    plZlibCompress(int level=kDefaultLevel) : fLevel(level) { }
+
+    int GetLevel() const { return fLevel; }
+
     bool Uncompress(uint8_t* bufOut, uint32_t* bufLenOut, const uint8_t* bufIn, uint32_t bufLenIn) override;
     bool Compress(uint8_t* bufOut, uint32_t* bufLenOut, const uint8_t* bufIn, uint32_t bufLenIn) override;
 
@@ -40,8 +40,11 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 *==LICENSE==*/
 #include "plZlibStream.h"
+#include "hsLockGuard.h"
 #include <zlib.h>
 
+#include <algorithm>
+
 voidpf ZlibAlloc(voidpf opaque, uInt items, uInt size)
 {
     return malloc(items*size);
@@ -52,9 +55,17 @@ void ZlibFree(voidpf opaque, voidpf address)
     free(address);
 }
 
+// Compressed data is pulled through a buffer this big when reading
+static constexpr uint32_t kReadBufferSize = 64 * 1024;
+
+// The writer blocks once this many chunks are waiting on the worker, so a
+// fast download can't get arbitrarily far ahead of the disk
+static constexpr size_t kMaxPendingChunks = 64;
+
 plZlibStream::~plZlibStream()
 {
-    hsAssert(!fOutput && !fZStream, "plZlibStream not closed");
+    IStopWorker();
+    hsAssert(!fOutput && !fInput && !fZStream, "plZlibStream not closed");
 }
 
 bool plZlibStream::Open(const plFileName& filename, const char* mode)
@@ -62,18 +73,78 @@ bool plZlibStream::Open(const plFileName& filename, const char* mode)
     fFilename = filename;
     fMode = mode;
 
+    if (mode && strchr(mode, 'r'))
+    {
+        hsUNIXStream* input = new hsUNIXStream;
+        if (!input->Open(filename, "rb"))
+        {
+            delete input;
+            return false;
+        }
+
+        // The last four bytes of a .gz are the uncompressed size (mod 4GB)
+        fUncompressedSize = 0;
+        uint32_t fileSize = input->GetEOF();
+        if (fileSize >= 18)
+        {
+            input->SetPosition(fileSize - sizeof(uint32_t));
+            fUncompressedSize = input->ReadLE32();
+            input->Rewind();
+        }
+        return Open(input, true);
+    }
+
     fOutput = new hsUNIXStream;
     return fOutput->Open(filename, "wb");
 }
 
+bool plZlibStream::Open(hsStream* compressed, bool ownStream)
+{
+    fInput = compressed;
+    fOwnsInput = ownStream;
+    fInBuffer.resize(kReadBufferSize);
+    fPosition = 0;
+
+    z_streamp zstream = new z_stream_s;
+    memset(zstream, 0, sizeof(z_stream_s));
+    zstream->zalloc = ZlibAlloc;
+    zstream->zfree = ZlibFree;
+    zstream->opaque = nullptr;
+    fZStream = zstream;
+
+    // Adding 16 to the window bits has zlib read the gzip header and trailer
+    // itself, since we're not being handed the data in bits
+    if (inflateInit2(zstream, 16 + MAX_WBITS) != Z_OK)
+    {
+        hsAssert(0, "Zip init failed");
+        fHeader = kInvalidHeader;
+        return false;
+    }
+
+    fHeader = kValidHeader;
+    return true;
+}
+
 bool plZlibStream::Close()
 {
+    IStopWorker();
+
     if (fOutput)
     {
         fOutput->Close();
         delete fOutput;
         fOutput = nullptr;
     }
+    if (fInput)
+    {
+        if (fOwnsInput)
+        {
+            fInput->Close();
+            delete fInput;
+        }
+        fInput = nullptr;
+        fOwnsInput = false;
+    }
     if (fZStream)
     {
         z_streamp zstream = (z_streamp)fZStream;
@@ -88,6 +159,7 @@ bool plZlibStream::Close()
 uint32_t plZlibStream::Write(uint32_t byteCount, const void* buffer)
 {
     uint8_t* byteBuf = (uint8_t*)buffer;
+    uint32_t totalCount = byteCount;
 
     // Check if we've read in the full gzip header yet
     if (fHeader == kNeedMoreData)
@@ -103,50 +175,121 @@ uint32_t plZlibStream::Write(uint32_t byteCount, const void* buffer)
         }
     }
 
-    if (fHeader == kInvalidHeader)
+    if (fHeader == kInvalidHeader || fInflateFailed)
         return 0;
 
-    if (fHeader == kValidHeader)
+    if (fHeader == kValidHeader && byteCount != 0)
     {
-        ASSERT(fOutput);
-        ASSERT(fZStream);
-        z_streamp zstream = (z_streamp)fZStream;
-        zstream->avail_in = byteCount;
-        zstream->next_in = byteBuf;
+        if (fAsync)
+        {
+            std::unique_lock<std::mutex> lock(fPendingMutex);
+            if (!fWorker.joinable())
+            {
+                fStopWorker = false;
+                fWorker = std::thread(&plZlibStream::IWorkerThread, this);
+            }
+
+            fPendingCondition.wait(lock, [this]() { return fPending.size() < kMaxPendingChunks; });
+            fPending.emplace_back(byteBuf, byteBuf + byteCount);
+            fPendingCondition.notify_all();
+        }
+        else if (!IInflate(byteBuf, byteCount))
+            fHeader = kInvalidHeader;
+    }
+
+    return totalCount;
+}
+
+bool plZlibStream::IInflate(const uint8_t* buffer, uint32_t byteCount)
+{
+    ASSERT(fOutput);
+    ASSERT(fZStream);
+    z_streamp zstream = (z_streamp)fZStream;
+    zstream->avail_in = byteCount;
+    zstream->next_in = const_cast<uint8_t*>(buffer);
 
-        char outBuf[2048];
-        while (zstream->avail_in != 0)
+    uint8_t outBuf[16 * 1024];
+    for (;;)
+    {
+        zstream->avail_out = sizeof(outBuf);
+        zstream->next_out = outBuf;
+
+        uint32_t amtWritten = zstream->total_out;
+
+        int ret = inflate(zstream, Z_NO_FLUSH);
+
+        // No progress with no input left just means we need the next chunk
+        if (ret == Z_BUF_ERROR && zstream->avail_in == 0)
+            break;
+
+        bool inflateErr = (ret == Z_NEED_DICT || ret == Z_DATA_ERROR ||
+                            ret == Z_STREAM_ERROR || ret == Z_MEM_ERROR || ret == Z_BUF_ERROR);
+        // If we have a decompression error, just fail
+        if (inflateErr)
         {
-            zstream->avail_out = sizeof(outBuf);
-            zstream->next_out = (uint8_t*)outBuf;
+            hsAssert(!inflateErr, "Error in inflate");
+            return false;
+        }
 
-            uint32_t amtWritten = zstream->total_out;
+        amtWritten = zstream->total_out - amtWritten;
+        IOnInflated(outBuf, amtWritten);
+        fOutput->Write(amtWritten, outBuf);
 
-            int ret = inflate(zstream, Z_NO_FLUSH);
+        // If zlib says we hit the end of the stream, ignore avail_in
+        if (ret == Z_STREAM_END)
+        {
+            fDecompressedOk = true;
+            break;
+        }
 
-            bool inflateErr = (ret == Z_NEED_DICT || ret == Z_DATA_ERROR ||
-                                ret == Z_STREAM_ERROR || ret == Z_MEM_ERROR || ret == Z_BUF_ERROR);
-            // If we have a decompression error, just fail
-            if (inflateErr)
-            {
-                hsAssert(!inflateErr, "Error in inflate");
-                fHeader = kInvalidHeader;
-                break;
-            }
+        // A full output buffer may have left more behind, so go around
+        // again until zlib has had its say
+        if (zstream->avail_in == 0 && zstream->avail_out != 0)
+            break;
+    }
 
-            amtWritten = zstream->total_out - amtWritten;
-            fOutput->Write(amtWritten, outBuf);
+    return true;
+}
 
-            // If zlib says we hit the end of the stream, ignore avail_in
-            if (ret == Z_STREAM_END)
-            {
-                fDecompressedOk = true;
-                break;
-            }
+void plZlibStream::IWorkerThread()
+{
+    for (;;)
+    {
+        std::vector<uint8_t> chunk;
+        {
+            std::unique_lock<std::mutex> lock(fPendingMutex);
+            fPendingCondition.wait(lock, [this]() { return fStopWorker || !fPending.empty(); });
+            if (fPending.empty())
+                return;     // stopping, and everything's been written
+
+            chunk = std::move(fPending.front());
+            fPending.pop_front();
+            fPendingCondition.notify_all();
         }
+
+        // Keep draining after a failure so the writer never blocks on us
+        if (!fInflateFailed && !IInflate(chunk.data(), chunk.size()))
+            fInflateFailed = true;
     }
+}
 
-    return byteCount;
+void plZlibStream::IStopWorker()
+{
+    if (!fWorker.joinable())
+        return;
+
+    {
+        hsLockGuard(fPendingMutex);
+        fStopWorker = true;
+        fPendingCondition.notify_all();
+    }
+    fWorker.join();
+
+    if (fInflateFailed)
+    {
+        fHeader = kInvalidHeader;
+        fDecompressedOk = false;
+    }
 }
 
 int plZlibStream::IValidateGzHeader(uint32_t byteCount, const void* buffer)
@@ -265,28 +408,94 @@ int plZlibStream::IValidateGzHeader(uint32_t byteCount, const void* buffer)
 
 bool plZlibStream::AtEnd()
 {
-    hsAssert(0, "AtEnd not supported");
-    return true;
+    hsAssert(fInput, "AtEnd only supported when reading");
+    return !fInput || fHeader != kValidHeader || fDecompressedOk;
 }
 
 uint32_t plZlibStream::Read(uint32_t byteCount, void* buffer)
 {
-    hsAssert(0, "Read not supported");
-    return 0;
+    hsAssert(fInput, "Read only supported when reading");
+    if (!fInput || fHeader != kValidHeader)
+        return 0;
+
+    z_streamp zstream = (z_streamp)fZStream;
+    zstream->avail_out = byteCount;
+    zstream->next_out = (uint8_t*)buffer;
+
+    while (zstream->avail_out != 0 && !fDecompressedOk)
+    {
+        // Pull in more compressed data once we've used up what we had
+        bool inputDone = false;
+        if (zstream->avail_in == 0)
+        {
+            zstream->avail_in = fInput->Read(fInBuffer.size(), fInBuffer.data());
+            zstream->next_in = fInBuffer.data();
+            inputDone = (zstream->avail_in == 0);
+        }
+
+        uint8_t* outStart = zstream->next_out;
+        int ret = inflate(zstream, Z_NO_FLUSH);
+        if (ret != Z_OK && ret != Z_STREAM_END)
+        {
+            // Z_BUF_ERROR just means no progress, which is only a problem
+            // once there's nothing left to give it
+            if (ret != Z_BUF_ERROR || inputDone)
+            {
+                hsAssert(0, "Error in inflate");
+                fHeader = kInvalidHeader;
+                break;
+            }
+        }
+
+        IOnInflated(outStart, zstream->next_out - outStart);
+
+        if (ret == Z_STREAM_END)
+            fDecompressedOk = true;
+    }
+
+    uint32_t amtRead = byteCount - zstream->avail_out;
+    fPosition += amtRead;
+    fBytesRead += amtRead;
+    return amtRead;
 }
 
 void plZlibStream::Skip(uint32_t deltaByteCount)
 {
-    hsAssert(0, "Skip not supported");
+    hsAssert(fInput, "Skip only supported when reading");
+
+    uint8_t skipBuf[4096];
+    while (deltaByteCount != 0)
+    {
+        uint32_t amt = std::min<uint32_t>(deltaByteCount, sizeof(skipBuf));
+        if (Read(amt, skipBuf) != amt)
+            break;
+        deltaByteCount -= amt;
+    }
 }
 
 void plZlibStream::Rewind()
 {
+    if (fInput)
+    {
+        // Start inflating again from the top
+        fInput->Rewind();
+        z_streamp zstream = (z_streamp)fZStream;
+        if (zstream && inflateReset(zstream) == Z_OK)
+        {
+            zstream->avail_in = 0;
+            fHeader = kValidHeader;
+        }
+        fPosition = 0;
+        fDecompressedOk = false;
+        return;
+    }
+
     // hack so rewind will work (someone thought it would be funny to not implement base class functions)
     Close();
     Open(fFilename, fMode);
     fHeader = kNeedMoreData;
     fDecompressedOk = false;
+    fInflateFailed = false;
 }
 
 void plZlibStream::FastFwd()
@@ -296,6 +505,6 @@ void plZlibStream::FastFwd()
 
 uint32_t plZlibStream::GetEOF()
 {
-    hsAssert(0, "GetEOF not supported");
-    return 0;
+    hsAssert(fUncompressedSize != 0, "GetEOF not supported");
+    return fUncompressedSize;
 }
@@ -43,11 +43,28 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #define plZlibStream_h_inc
 
 #include "hsStream.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <string>
+#include <thread>
 
 //
-// This is for reading a .gz file from a buffer, and writing the uncompressed data to a file.
-// Call open with the name of the uncompressed file, then call write with the compressed data.
+// Decompresses .gz data in a single pass, from either end:
+//
+// Writing: call open with the name of the uncompressed file, then call write
+// with the compressed data as it arrives.  With SetAsync(true), inflating and
+// writing the output move to a worker thread, so they overlap receiving the
+// next chunk; Close waits for the worker to catch up.
+//
+// Reading: open a .gz file with "rb" (or hand Open an already open stream),
+// then read the uncompressed data out of it.  Nothing is staged, the
+// compressed data is pulled through a small buffer as it's needed.
+//
+// Either way, subclasses see every chunk of uncompressed data go by in
+// IOnInflated, which is the place to hash it without reading it back.
 //
 class plZlibStream : public hsStream
 {
@@ -64,22 +81,55 @@ protected:
     plFileName fFilename;
     const char* fMode;
 
+    // read side
+    hsStream* fInput;
+    bool fOwnsInput;
+    std::vector<uint8_t> fInBuffer;
+    uint32_t fUncompressedSize;
+
+    // async write side
+    bool fAsync;
+    std::thread fWorker;
+    std::mutex fPendingMutex;
+    std::condition_variable fPendingCondition;
+    std::deque<std::vector<uint8_t>> fPending;
+    bool fStopWorker;
+    std::atomic<bool> fInflateFailed;
+
     int IValidateGzHeader(uint32_t byteCount, const void* buffer);
+    bool IInflate(const uint8_t* buffer, uint32_t byteCount);
+    void IWorkerThread();
+    void IStopWorker();
+
+    virtual void IOnInflated(const uint8_t* buffer, uint32_t byteCount) { }
 
 public:
-    plZlibStream() : fOutput(), fZStream(), fHeader(kNeedMoreData), fDecompressedOk(), fMode() { }
+    plZlibStream()
+        : fOutput(), fZStream(), fHeader(kNeedMoreData), fDecompressedOk(), fMode(),
+          fInput(), fOwnsInput(), fUncompressedSize(), fAsync(), fStopWorker(), fInflateFailed()
+    { }
     virtual ~plZlibStream();
 
     bool     Open(const plFileName& filename, const char* mode) override;
     bool     Close() override;
     uint32_t Write(uint32_t byteCount, const void* buffer) override;
 
+    // Reads the compressed data from a stream that's already open.  If
+    // ownStream is set, the stream is closed and deleted along with this one.
+    bool     Open(hsStream* compressed, bool ownStream=false);
+
+    // Inflate written data on a worker thread.  Must be set before the first
+    // Write.
+    void SetAsync(bool async) { fAsync = async; }
+    bool IsAsync() const { return fAsync; }
+
     // Since most functions don't check the return value from Write, you can
     // call this after you've passed in all your data to determine if it
-    // decompressed ok
+    // decompressed ok.  When writing asynchronously, Close first.
     bool DecompressedOk() { return fDecompressedOk; }
 
-    // You can't use these
+    // Only supported when reading.  Skip only goes forward, and GetEOF is
+    // only known for files (from the .gz trailer).
     bool     AtEnd() override;
     uint32_t Read(uint32_t byteCount, void* buffer) override;
     void     Skip(uint32_t deltaByteCount) override;
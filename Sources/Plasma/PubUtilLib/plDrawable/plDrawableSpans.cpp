@@ -105,6 +105,8 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plStatusLog/plStatusLog.h"
 
 #include <algorithm>
+#include <functional>
+#include <thread>
 
 //// Local Konstants /////////////////////////////////////////////////////////
 
@@ -113,6 +115,8 @@ const uint32_t        plDrawableSpans::kSpanIDMask            = ~kSpanTypeMask;
 const uint32_t        plDrawableSpans::kSpanTypeIcicle        = 0x00000000;
 const uint32_t        plDrawableSpans::kSpanTypeParticleSpan  = 0xc0000000;
 
+uint32_t              plDrawableSpans::fFaceSortThreads       = 0;
+
 //// Constructor & Destructor ////////////////////////////////////////////////
 
 plDrawableSpans::plDrawableSpans() :
@@ -1577,6 +1581,57 @@ void    plDrawableSpans::SortSpan( uint32_t index, plPipeline *pipe )
     plProfile_EndLap(FaceSort, "4");
 }
 
+//// Face Sort Helpers ///////////////////////////////////////////////////////
+//  Working arrays for SortVisibleSpans, kept between calls so they only
+//  grow. Tris are addressed by their position in the sort, which runs over
+//  the visible spans in visList order.
+
+struct plFaceSortChunk
+{
+    size_t      fVisBegin, fVisEnd;     // Range of visList
+    uint32_t    fTriBegin, fTriEnd;     // Range of the sort arrays
+};
+
+struct plFaceSortScratch
+{
+    std::vector<uint32_t>                   fKeys;
+    std::vector<uint32_t>                   fIndices;
+    std::vector<uint32_t>                   fKeyScratch;
+    std::vector<uint32_t>                   fIndexScratch;
+    std::vector<const plGBufferTriangle*>   fTris;
+    std::vector<uint16_t>                   fTriList;
+    std::vector<int32_t>                    fCounters;
+    std::vector<uint32_t>                   fStartIndex;
+    std::vector<plFaceSortChunk>            fChunks;
+};
+
+// Below this many tris, starting threads costs more than it saves
+static const uint32_t kMinParallelSortTris = 32768;
+
+// Splits the chunks into one band per thread and runs fn on each band
+static void IForEachSortChunk(size_t numChunks, uint32_t numThreads, const std::function<void(size_t, size_t)>& fn)
+{
+    if( numThreads == 0 )
+        numThreads = std::max(std::thread::hardware_concurrency(), 1U);
+    numThreads = (uint32_t)std::min<size_t>(numThreads, numChunks);
+
+    if( numThreads <= 1 )
+    {
+        fn(0, numChunks);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(numThreads - 1);
+    for( uint32_t i = 1; i < numThreads; i++ )
+        threads.emplace_back(fn, numChunks * i / numThreads, numChunks * (i + 1) / numThreads);
+
+    fn(0, numChunks / numThreads);
+
+    for( std::thread& thread : threads )
+        thread.join();
+}
+
 //// SortVisibleSpans ////////////////////////////////////////////////////////
 //  Sorts the visible spans's triangles in one big lump, for proper back-to-
 //  front display.
@@ -1779,16 +1834,12 @@ void plDrawableSpans::SortVisibleSpans(const std::vector<int16_t>& visList, plPi
     if (visList.empty())
         return;
 
-    plProfile_BeginTiming(FaceSort);
-
-    static std::vector<hsRadixSort::Elem> sortScratch;
-    static std::vector<uint16_t> triList;
-    static std::vector<int32_t> counters;
-    static std::vector<uint32_t> startIndex;
-    
     if( pipe->IsDebugFlagSet( plPipeDbg::kFlagDontSortFaces ) )
     {
+        plProfile_BeginTiming(FaceSort);
+
         /// Don't sort, just send unchanged
+        std::vector<uint16_t> triList;
         int     j, idx;
 
         for (int16_t visIdx : visList)
@@ -1811,19 +1862,43 @@ void plDrawableSpans::SortVisibleSpans(const std::vector<int16_t>& visList, plPi
                                                           span->fILength / 3, triList.data() );
         }
         fReadyToRender = false;
+        plProfile_EndTiming(FaceSort);
         return;
     }
 
-    plProfile_EndTiming(FaceSort);
+    SortVisibleSpans(visList, pipe->GetViewPositionWorld());
+
+#endif // MF_CHUNKSORT
+}
+
+void plDrawableSpans::SortVisibleSpans(const std::vector<int16_t>& visList, const hsPoint3& viewPosWorld)
+{
+    if (visList.empty())
+        return;
+
+    // Per thread, so drawables can be sorted from more than one thread. The
+    // chunk workers below run on other threads, so they must only ever get
+    // at this thread's arrays through the reference.
+    static thread_local plFaceSortScratch threadScratch;
+    plFaceSortScratch& scratch = threadScratch;
+    std::vector<uint16_t>& triList = scratch.fTriList;
+    std::vector<uint32_t>& startIndex = scratch.fStartIndex;
 
     plProfile_BeginLap(FaceSort, "0");
 
     startIndex.resize(fSpans.size());
 
-    // First figure out the total number of tris to deal with.
-    int totTris = 0;
-    for (int16_t idx : visList)
-    {
+    // First figure out the total number of tris to deal with, and cut the
+    // spans into chunks of about kTriCutoff tris. Each chunk is sorted on its
+    // own, which keeps the sorts cache sized and lets chunks go to different
+    // threads.
+    const uint32_t kTriCutoff = 4000;
+    std::vector<plFaceSortChunk>& chunks = scratch.fChunks;
+    chunks.clear();
+    uint32_t totTris = 0;
+    for (size_t iVis = 0; iVis < visList.size(); iVis++)
+    {
+        int16_t idx = visList[iVis];
         plIcicle* span = (plIcicle*)fSpans[idx];
         ICheckSpanForSortable(idx);
         
@@ -1831,8 +1906,12 @@ void plDrawableSpans::SortVisibleSpans(const std::vector<int16_t>& visList, plPi
         if( span->fProps & plSpan::kPropReverseSort )
             startIndex[idx] += span->fILength - 3;
 
+        if (chunks.empty() || chunks.back().fTriEnd - chunks.back().fTriBegin >= kTriCutoff)
+            chunks.push_back({ iVis, iVis, totTris, totTris });
 
         totTris += span->fILength / 3;
+        chunks.back().fVisEnd = iVis + 1;
+        chunks.back().fTriEnd = totTris;
     }
     if( totTris == 0 )
     {
@@ -1842,84 +1921,90 @@ void plDrawableSpans::SortVisibleSpans(const std::vector<int16_t>& visList, plPi
 
     plProfile_IncCount(FacesSorted, totTris);
 
-    sortScratch.resize(totTris);
+    scratch.fKeys.resize(totTris);
+    scratch.fIndices.resize(totTris);
+    scratch.fKeyScratch.resize(totTris);
+    scratch.fIndexScratch.resize(totTris);
+    scratch.fTris.resize(totTris);
     triList.resize(3 * totTris);
+    scratch.fCounters.assign(fSpans.size(), 0);
 
-    hsRadixSort::Elem* elem = sortScratch.data();
+    // Chunks never share a span, so they can all write into the same arrays
+    uint32_t numThreads = totTris < kMinParallelSortTris ? 1 : fFaceSortThreads;
 
     plProfile_EndLap(FaceSort, "0");
+    plProfile_BeginLap(FaceSort, "1");
 
-    size_t iVis = 0;
-    while (iVis < visList.size())
+    // Pack the distances into one array of keys, farthest sorting first
+    IForEachSortChunk(chunks.size(), numThreads, [&](size_t begin, size_t end)
     {
-        plProfile_BeginLap(FaceSort, "1");
-
-        // Pack them into the sort structure. We probably want to make the 
-        // plGBufferTriangle look like plTriSortData (just add span index) 
-        // which would get rid of this copy and help the data alignment.
-        // Oops, I already did.
-        const int kTriCutoff = 4000;
-        int cnt = 0;
-        while ((iVis < visList.size()) && (cnt < kTriCutoff))
+        for (size_t iChunk = begin; iChunk < end; iChunk++)
         {
-            plIcicle* span = (plIcicle*)fSpans[visList[iVis]];
-            
-            int nTris = span->fILength / 3;
-
-            hsPoint3 viewPos = span->fWorldToLocal * pipe->GetViewPositionWorld();
-
-            plGBufferTriangle*      list = span->fSortData;
-            int j;
-            for( j = 0; j < nTris; j++ )
+            uint32_t t = chunks[iChunk].fTriBegin;
+            for (size_t iVis = chunks[iChunk].fVisBegin; iVis < chunks[iChunk].fVisEnd; iVis++)
             {
-                float dist = -(viewPos - list[j].fCenter).MagnitudeSquared();
-                elem[cnt].fKey.fFloat = dist;
-                elem[cnt].fBody = &list[j];
-                elem[cnt].fNext = elem + cnt + 1;
+                plIcicle* span = (plIcicle*)fSpans[visList[iVis]];
+                hsPoint3 viewPos = span->fWorldToLocal * viewPosWorld;
 
-                cnt++;
+                const plGBufferTriangle* list = span->fSortData;
+                uint32_t nTris = span->fILength / 3;
+                for (uint32_t j = 0; j < nTris; j++, t++)
+                {
+                    float dx = viewPos.fX - list[j].fCenter.fX;
+                    float dy = viewPos.fY - list[j].fCenter.fY;
+                    float dz = viewPos.fZ - list[j].fCenter.fZ;
+                    scratch.fKeys[t] = hsRadixSort::FloatKey(-(dx * dx + dy * dy + dz * dz));
+                    scratch.fIndices[t] = t;
+                    scratch.fTris[t] = &list[j];
+                }
             }
-            iVis++;
         }
-        elem[cnt-1].fNext = nullptr;
-
-        plProfile_EndLap(FaceSort, "1");
-        plProfile_BeginLap(FaceSort, "2");
+    });
 
-        // Actual sort
-        hsRadixSort         rad;
-        hsRadixSort::Elem* sortedList = rad.Sort( elem, 0 );
+    plProfile_EndLap(FaceSort, "1");
+    plProfile_BeginLap(FaceSort, "2");
 
-        plProfile_EndLap(FaceSort, "2");
-        plProfile_BeginLap(FaceSort, "3");
+    // Actual sort
+    IForEachSortChunk(chunks.size(), numThreads, [&](size_t begin, size_t end)
+    {
+        for (size_t iChunk = begin; iChunk < end; iChunk++)
+        {
+            uint32_t first = chunks[iChunk].fTriBegin;
+            hsRadixSort::SortUnsigned(&scratch.fKeys[first], &scratch.fIndices[first],
+                                      &scratch.fKeyScratch[first], &scratch.fIndexScratch[first],
+                                      chunks[iChunk].fTriEnd - first);
+        }
+    });
 
-        counters.assign(fSpans.size(), 0);
+    plProfile_EndLap(FaceSort, "2");
+    plProfile_BeginLap(FaceSort, "3");
 
-        while( sortedList )
+    IForEachSortChunk(chunks.size(), numThreads, [&](size_t begin, size_t end)
+    {
+        for (uint32_t t = chunks[begin].fTriBegin; t < chunks[end - 1].fTriEnd; t++)
         {
-            plGBufferTriangle* data = (plGBufferTriangle*)sortedList->fBody;
+            const plGBufferTriangle* data = scratch.fTris[scratch.fIndices[t]];
             plIcicle* span = (plIcicle*)fSpans[data->fSpanIndex];
+            int32_t& counter = scratch.fCounters[data->fSpanIndex];
 
-            uint16_t* idx = &triList[startIndex[data->fSpanIndex] + counters[data->fSpanIndex]];
+            uint16_t* idx = &triList[startIndex[data->fSpanIndex] + counter];
             *idx++ = data->fIndex1;
             *idx++ = data->fIndex2;
             *idx++ = data->fIndex3;
             if( span->fProps & plSpan::kPropReverseSort )
-                counters[data->fSpanIndex] -= 3;
+                counter -= 3;
             else
-                counters[data->fSpanIndex] += 3;
-            
-            sortedList = sortedList->fNext;
+                counter += 3;
         }
+    });
 
-        plProfile_EndLap(FaceSort, "3");
-    }
+    plProfile_EndLap(FaceSort, "3");
 
     plProfile_BeginLap(FaceSort, "4");
 
     constexpr size_t kMaxBufferGroups = 20;
     constexpr size_t kMaxIndexBuffers = 20;
-    static int16_t    newStarts[kMaxBufferGroups][kMaxIndexBuffers];
+    int16_t newStarts[kMaxBufferGroups][kMaxIndexBuffers];
 
     hsAssert(kMaxBufferGroups >= GetNumBufferGroups(), "Bigger than we counted on num groups sort.");
 
@@ -1944,8 +2029,6 @@ void plDrawableSpans::SortVisibleSpans(const std::vector<int16_t>& visList, plPi
     plProfile_EndLap(FaceSort, "4");
 
     fReadyToRender = false;
-
-#endif // MF_CHUNKSORT
 }
 
 struct buffTriCmpBackToFront
@@ -176,6 +176,8 @@ class plDrawableSpans : public plDrawable
 
         uint32_t              fSkinTime;
 
+        static uint32_t     fFaceSortThreads;
+
         /// Export-only members
         std::vector<plGeometrySpan *>   fSourceSpans;
         bool                            fOptimized;
@@ -378,7 +380,14 @@ class plDrawableSpans : public plDrawable
         virtual size_t  NewDIMatrixIndex();
         void            SortSpan( uint32_t index, plPipeline *pipe );
         void            SortVisibleSpans(const std::vector<int16_t>& visList, plPipeline* pipe);
+        // The sort itself, from a viewer at viewPosWorld
+        void            SortVisibleSpans(const std::vector<int16_t>& visList, const hsPoint3& viewPosWorld);
         void            SortVisibleSpansPartial(const std::vector<int16_t>& visList, plPipeline* pipe);
+
+        // Threads used by SortVisibleSpans once there are enough faces to
+        // split up. 0 means one per core, 1 keeps it all on the calling thread.
+        static void     SetFaceSortThreads(uint32_t numThreads) { fFaceSortThreads = numThreads; }
+        static uint32_t GetFaceSortThreads() { return fFaceSortThreads; }
         void            CleanUpGarbage() { IRemoveGarbage(); }
 
         /// Funky particle system functions
@@ -49,10 +49,16 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plIntersect/plVolumeIsect.h"
 #include "plMath/hsRadixSort.h"
 
+#include <algorithm>
+#include <limits>
+
 static hsBitVector scratchTotVec;
 static hsBitVector scratchBitVec;
 
 plProfile_CreateCounter("Harvest Leaves", "Draw", HarvestLeaves);
+plProfile_CreateCounter("Space Tree Reinserts", "Draw", SpaceTreeReinserts);
+
+bool plSpaceTree::fPackedHarvest = true;
 
 void plSpaceTreeNode::Read(hsStream* s)
 {
@@ -82,7 +88,8 @@ void plSpaceTreeNode::Write(hsStream* s)
 plSpaceTree::plSpaceTree()
 :   fCullFunc(),
     fNumLeaves(),
-    fCache()
+    fCache(),
+    fPackedDirty(true)
 {
 }
 
@@ -118,7 +125,11 @@ void plSpaceTree::IRefreshRecur(int16_t which)
 void plSpaceTree::Refresh()
 {
     if( !IsEmpty() )
+    {
+        if( IsDirty() )
+            fPackedDirty = true;
         IRefreshRecur(fRoot);
+    }
 }
 
 void plSpaceTree::SetTreeFlag(uint16_t f, bool on)
@@ -316,24 +327,313 @@ void plSpaceTree::IHarvestEnabledLeaves(int16_t subIdx, const hsBitVector& cache
     }
 }
 
+void plSpaceTree::IMarkDirty(int16_t idx)
+{
+    while( idx != kRootParent )
+    {
+        if( fTree[idx].fFlags & plSpaceTreeNode::kDirty )
+        {
+            idx = kRootParent;
+        }
+        else
+        {
+            fTree[idx].fFlags |= plSpaceTreeNode::kDirty;
+            idx = fTree[idx].fParent;
+        }
+    }
+}
+
 void plSpaceTree::MoveLeaf(int16_t idx, const hsBounds3Ext& bnd)
 {
     hsAssert(idx == fTree[idx].fLeafIndex, "Some scrambling of indices");
 
     fTree[idx].fWorldBounds = bnd;
+    fPackedDirty = true;
+
+    IMarkDirty(idx);
+}
 
+//// Incremental Updates //////////////////////////////////////////////////////
+//  Leaves are added and moved by pairing them with whichever node makes the
+//  least extra surface area, the same greedy choice dynamic AABB trees use.
+//  The bounds above are only grown on the way, the next Refresh tightens
+//  them back up.
+
+// Half the surface area, treating anything but a normal box as nothing
+static inline float IHalfArea(const hsBounds3& bnd)
+{
+    if( bnd.GetType() != kBoundsNormal )
+        return 0;
+
+    hsVector3 del(&bnd.GetMaxs(), &bnd.GetMins());
+    return del.fX * del.fY + del.fY * del.fZ + del.fZ * del.fX;
+}
+
+static inline float IHalfUnionArea(const hsBounds3& a, const hsBounds3& b)
+{
+    if( a.GetType() != kBoundsNormal )
+        return IHalfArea(b);
+    if( b.GetType() != kBoundsNormal )
+        return IHalfArea(a);
+
+    hsPoint3 mins, maxs;
+    for( int i = 0; i < 3; i++ )
+    {
+        mins[i] = std::min(a.GetMins()[i], b.GetMins()[i]);
+        maxs[i] = std::max(a.GetMaxs()[i], b.GetMaxs()[i]);
+    }
+    hsVector3 del(&maxs, &mins);
+    return del.fX * del.fY + del.fY * del.fZ + del.fZ * del.fX;
+}
+
+void plSpaceTree::IUpdateDisabled(int16_t idx)
+{
+    // An interior node is disabled when both its children are
     while( idx != kRootParent )
     {
-        if( fTree[idx].fFlags & plSpaceTreeNode::kDirty )
+        plSpaceTreeNode& sub = fTree[idx];
+        uint16_t disabled = fTree[sub.fChildren[0]].fFlags & fTree[sub.fChildren[1]].fFlags & plSpaceTreeNode::kDisabled;
+        if( (sub.fFlags & plSpaceTreeNode::kDisabled) == disabled )
+            return;
+
+        sub.fFlags = (sub.fFlags & ~plSpaceTreeNode::kDisabled) | disabled;
+        idx = sub.fParent;
+    }
+}
+
+void plSpaceTree::IMoveNode(int16_t from, int16_t to)
+{
+    fTree[to] = fTree[from];
+
+    const plSpaceTreeNode& node = fTree[to];
+    if( node.fParent == kRootParent )
+    {
+        fRoot = to;
+    }
+    else
+    {
+        plSpaceTreeNode& parent = fTree[node.fParent];
+        parent.fChildren[parent.fChildren[0] == from ? 0 : 1] = to;
+    }
+    if( !node.IsLeaf() )
+    {
+        fTree[node.fChildren[0]].fParent = to;
+        fTree[node.fChildren[1]].fParent = to;
+    }
+}
+
+int16_t plSpaceTree::IFindInsertSibling(const hsBounds3Ext& bnd) const
+{
+    int16_t idx = fRoot;
+    while( !fTree[idx].IsLeaf() )
+    {
+        const plSpaceTreeNode& sub = fTree[idx];
+
+        // Cost of a new parent here, and what every node below here would
+        // have to grow by to hold the new leaf
+        float area = IHalfArea(sub.fWorldBounds);
+        float combined = IHalfUnionArea(sub.fWorldBounds, bnd);
+        float here = 2.f * combined;
+        float inherited = 2.f * (combined - area);
+
+        float costs[2];
+        for( int i = 0; i < 2; i++ )
         {
-            idx = kRootParent;
+            const plSpaceTreeNode& child = fTree[sub.fChildren[i]];
+            costs[i] = IHalfUnionArea(child.fWorldBounds, bnd) + inherited;
+            if( !child.IsLeaf() )
+                costs[i] -= IHalfArea(child.fWorldBounds);
+        }
+
+        if( here < costs[0] && here < costs[1] )
+            break;
+
+        idx = sub.fChildren[costs[0] <= costs[1] ? 0 : 1];
+    }
+    return idx;
+}
+
+void plSpaceTree::IInsertLeaf(int16_t leaf, int16_t parent)
+{
+    const hsBounds3Ext& bnd = fTree[leaf].fWorldBounds;
+
+    int16_t sibling = IFindInsertSibling(bnd);
+    int16_t grand = fTree[sibling].fParent;
+
+    plSpaceTreeNode& sub = fTree[parent];
+    sub.fWorldBounds = fTree[sibling].fWorldBounds;
+    sub.fWorldBounds.Union(&bnd);
+    sub.fFlags = fTree[sibling].fFlags & fTree[leaf].fFlags & plSpaceTreeNode::kDisabled;
+    sub.fParent = grand;
+    sub.fChildren[0] = sibling;
+    sub.fChildren[1] = leaf;
+
+    fTree[sibling].fParent = parent;
+    fTree[leaf].fParent = parent;
+
+    if( grand == kRootParent )
+    {
+        fRoot = parent;
+    }
+    else
+    {
+        plSpaceTreeNode& up = fTree[grand];
+        up.fChildren[up.fChildren[0] == sibling ? 0 : 1] = parent;
+
+        // Grown now so the next insert sees it, Refresh will tighten it
+        for( int16_t idx = grand; idx != kRootParent; idx = fTree[idx].fParent )
+            fTree[idx].fWorldBounds.Union(&bnd);
+
+        IUpdateDisabled(grand);
+    }
+    IMarkDirty(parent);
+
+    // The packed copy has the old shape of the tree
+    fPacked.clear();
+    fPackedDirty = true;
+}
+
+int16_t plSpaceTree::IRemoveLeaf(int16_t leaf)
+{
+    int16_t parent = fTree[leaf].fParent;
+    if( parent == kRootParent )
+        return kRootParent;
+
+    const plSpaceTreeNode& sub = fTree[parent];
+    int16_t sibling = sub.fChildren[sub.fChildren[0] == leaf ? 1 : 0];
+    int16_t grand = sub.fParent;
+
+    fTree[sibling].fParent = grand;
+    fTree[leaf].fParent = kRootParent;
+
+    if( grand == kRootParent )
+    {
+        fRoot = sibling;
+    }
+    else
+    {
+        plSpaceTreeNode& up = fTree[grand];
+        up.fChildren[up.fChildren[0] == parent ? 0 : 1] = sibling;
+
+        IUpdateDisabled(grand);
+        IMarkDirty(grand);
+    }
+
+    fPacked.clear();
+    fPackedDirty = true;
+
+    // Free for the caller to put back in
+    return parent;
+}
+
+void plSpaceTree::RelocateLeaf(int16_t idx, const hsBounds3Ext& bnd)
+{
+    hsAssert(idx == fTree[idx].fLeafIndex, "Some scrambling of indices");
+
+    int16_t parent = fTree[idx].fParent;
+    if( parent == kRootParent || bnd.GetType() != kBoundsNormal
+        || fTree[parent].fWorldBounds.GetType() != kBoundsNormal )
+    {
+        MoveLeaf(idx, bnd);
+        return;
+    }
+
+    const hsBounds3Ext& parentBnd = fTree[parent].fWorldBounds;
+    bool inside = true;
+    for( int i = 0; i < 3; i++ )
+    {
+        float center = (bnd.GetMins()[i] + bnd.GetMaxs()[i]) * 0.5f;
+        if( center < parentBnd.GetMins()[i] || center > parentBnd.GetMaxs()[i] )
+            inside = false;
+    }
+    if( inside )
+    {
+        MoveLeaf(idx, bnd);
+        return;
+    }
+
+    plProfile_Inc(SpaceTreeReinserts);
+
+    parent = IRemoveLeaf(idx);
+    fTree[idx].fWorldBounds = bnd;
+    IInsertLeaf(idx, parent);
+}
+
+int16_t plSpaceTree::AddLeaf(const hsBounds3Ext& worldBnd, bool disable)
+{
+    hsBounds3Ext bnd = worldBnd;
+    if( bnd.GetType() != kBoundsNormal )
+    {
+        static const hsPoint3 zero;
+        bnd.Reset(&zero);
+    }
+
+    if( IsEmpty() )
+    {
+        fTree.resize(1);
+        fRoot = 0;
+
+        plSpaceTreeNode& leaf = fTree[0];
+        leaf.fWorldBounds = bnd;
+        leaf.fFlags = plSpaceTreeNode::kIsLeaf | plSpaceTreeNode::kDirty;
+        leaf.fParent = kRootParent;
+        leaf.fLeafIndex = 0;
+        fNumLeaves = 1;
+    }
+    else
+    {
+        if( fTree.size() + 2 > size_t(std::numeric_limits<int16_t>::max()) )
+            return -1;
+
+        // Leaves come first in the array, at the same index as the leaf
+        // they hold, so the interior node in the way moves to the end.
+        int16_t idx = int16_t(fNumLeaves);
+        if( size_t(idx) < fTree.size() )
+        {
+            int16_t to = int16_t(fTree.size());
+            fTree.emplace_back();
+            IMoveNode(idx, to);
         }
         else
         {
-            fTree[idx].fFlags |= plSpaceTreeNode::kDirty;
-            idx = fTree[idx].fParent;
+            fTree.resize(idx + 1);
         }
+        int16_t parent = int16_t(fTree.size());
+        fTree.emplace_back();
+
+        plSpaceTreeNode& leaf = fTree[idx];
+        leaf.fWorldBounds = bnd;
+        leaf.fFlags = plSpaceTreeNode::kIsLeaf;
+        leaf.fLeafIndex = idx;
+        fNumLeaves++;
+
+        IInsertLeaf(idx, parent);
     }
+
+    int16_t idx = int16_t(fNumLeaves - 1);
+    if( disable )
+        SetLeafFlag(idx, plSpaceTreeNode::kDisabled, true);
+
+    fPacked.clear();
+    fPackedDirty = true;
+
+    return idx;
+}
+
+float plSpaceTree::ComputeSAHCost() const
+{
+    if( IsEmpty() )
+        return 0;
+
+    float rootArea = IHalfArea(GetWorldBounds());
+    if( rootArea <= 0 )
+        return 0;
+
+    float area = 0;
+    for (const plSpaceTreeNode& node : fTree)
+        area += IHalfArea(node.fWorldBounds);
+
+    return area / rootArea;
 }
 
 void plSpaceTree::HarvestLeaves(int16_t subRoot, hsBitVector& totList, hsBitVector& list) const
@@ -366,10 +666,20 @@ void plSpaceTree::HarvestLeaves(hsBitVector& list) const
 
 void plSpaceTree::HarvestLeaves(plVolumeIsect* cull, hsBitVector& list) const
 {
+    static thread_local std::vector<plVolumeSlab> slabs;
+
     if( !IsEmpty() )
     {
         fCullFunc = cull;
-        if (fCullFunc)
+        if (fCullFunc && fPackedHarvest && fCullFunc->GetSlabs(slabs))
+        {
+            if (fPacked.empty())
+                IBuildPacked(fRoot, -1);
+            if (fPackedDirty)
+                IUpdatePackedBounds();
+            IHarvestAndCullPacked(0, slabs.data(), slabs.size(), scratchTotVec, list);
+        }
+        else if (fCullFunc)
             IHarvestAndCullLeaves(fTree[fRoot], scratchTotVec, list);
         else
             IHarvestLeaves(fTree[fRoot], scratchTotVec, list);
@@ -524,10 +834,195 @@ void plSpaceTree::IHarvestLeaves(const plSpaceTreeNode& subRoot, std::vector<int
     }
 }
 
+//// Packed Harvest /////////////////////////////////////////////////////////
+//  Walks the same nodes in the same order as IHarvestAndCullLeaves, but each
+//  packed node's lanes are tested against the slabs in one go, rather than
+//  calling through the isect once per node.
+
+int32_t plSpaceTree::IBuildPacked(int16_t top0, int16_t top1) const
+{
+    const int kNumLanes = plSpaceTreePacked::kNumLanes;
+
+    int32_t packedIdx = (int32_t)fPacked.size();
+    fPacked.emplace_back();
+
+    int16_t nodes[kNumLanes];
+    std::fill(nodes, nodes + kNumLanes, -1);
+    nodes[0] = top0;
+    nodes[1] = top1;
+    for( int i = 0; i < 2; i++ )
+    {
+        if( nodes[i] >= 0 && !IsLeaf(nodes[i]) )
+        {
+            nodes[2 + 2 * i] = fTree[nodes[i]].fChildren[0];
+            nodes[3 + 2 * i] = fTree[nodes[i]].fChildren[1];
+        }
+    }
+
+    int32_t children[kNumLanes];
+    std::fill(children, children + kNumLanes, -1);
+    for( int i = 2; i < 6; i++ )
+    {
+        if( nodes[i] >= 0 && !IsLeaf(nodes[i]) )
+            children[i] = IBuildPacked(fTree[nodes[i]].fChildren[0], fTree[nodes[i]].fChildren[1]);
+    }
+
+    // Not a reference until here, the recursion above grows fPacked
+    plSpaceTreePacked& packed = fPacked[packedIdx];
+    std::copy(nodes, nodes + kNumLanes, packed.fNode);
+    std::copy(children, children + kNumLanes, packed.fChild);
+    packed.fExact = 0;
+
+    fPackedDirty = true;
+
+    return packedIdx;
+}
+
+void plSpaceTree::IUpdatePackedBounds() const
+{
+    for (plSpaceTreePacked& packed : fPacked)
+    {
+        packed.fExact = 0;
+        for( int i = 0; i < plSpaceTreePacked::kNumLanes; i++ )
+        {
+            const hsBounds3Ext* bnd = packed.fNode[i] >= 0 ? &fTree[packed.fNode[i]].fWorldBounds : nullptr;
+
+            // Anything else gets tested through the isect like before
+            if( bnd && bnd->GetType() == kBoundsNormal && bnd->IsAxisAligned() )
+            {
+                for( int j = 0; j < 3; j++ )
+                {
+                    packed.fMins[j][i] = bnd->GetMins()[j];
+                    packed.fExtents[j][i] = bnd->GetMaxs()[j] - bnd->GetMins()[j];
+                }
+                packed.fExact |= 1 << i;
+            }
+            else
+            {
+                for( int j = 0; j < 3; j++ )
+                {
+                    packed.fMins[j][i] = 0;
+                    packed.fExtents[j][i] = 0;
+                }
+            }
+        }
+    }
+    fPackedDirty = false;
+}
+
+void plSpaceTree::IHarvestAndCullPacked(int32_t packedIdx, const plVolumeSlab* slabs, size_t numSlabs, hsBitVector& totList, hsBitVector& list) const
+{
+    const plSpaceTreePacked& packed = fPacked[packedIdx];
+
+    uint32_t clear;
+    uint32_t culled = test_packed.call(packed, slabs, numSlabs, clear);
+
+    IHarvestPackedLane(packed, 0, culled, clear, slabs, numSlabs, totList, list);
+    IHarvestPackedLane(packed, 1, culled, clear, slabs, numSlabs, totList, list);
+}
+
+void plSpaceTree::IHarvestPackedLane(const plSpaceTreePacked& packed, int lane, uint32_t culled, uint32_t clear,
+                                     const plVolumeSlab* slabs, size_t numSlabs, hsBitVector& totList, hsBitVector& list) const
+{
+    int16_t idx = packed.fNode[lane];
+    if( idx < 0 )
+        return;
+
+    const plSpaceTreeNode& subRoot = fTree[idx];
+    if( subRoot.fFlags & plSpaceTreeNode::kDisabled )
+        return;
+
+    if( totList.IsBitSet(idx) )
+        return;
+
+    plVolumeCullResult res;
+    if( packed.fExact & (1 << lane) )
+    {
+        if( culled & (1 << lane) )
+            res = kVolumeCulled;
+        else if( clear & (1 << lane) )
+            res = kVolumeClear;
+        else
+            res = kVolumeSplit;
+    }
+    else
+    {
+        res = fCullFunc->Test(subRoot.fWorldBounds);
+    }
+    if( res == kVolumeCulled )
+        return;
+
+    if( subRoot.fFlags & plSpaceTreeNode::kIsLeaf )
+    {
+        totList.SetBit(idx);
+
+        plProfile_Inc(HarvestLeaves);
+        list.SetBit(subRoot.fLeafIndex);
+    }
+    else if( res == kVolumeClear )
+    {
+        totList.SetBit(idx);
+
+        IHarvestLeaves(fTree[subRoot.fChildren[0]], totList, list);
+        IHarvestLeaves(fTree[subRoot.fChildren[1]], totList, list);
+    }
+    else if( lane < 2 )
+    {
+        // Children are in this same packed node
+        IHarvestPackedLane(packed, 2 + 2 * lane, culled, clear, slabs, numSlabs, totList, list);
+        IHarvestPackedLane(packed, 3 + 2 * lane, culled, clear, slabs, numSlabs, totList, list);
+    }
+    else
+    {
+        IHarvestAndCullPacked(packed.fChild[lane], slabs, numSlabs, totList, list);
+    }
+}
+
+uint32_t plSpaceTree::test_packed_fpu(const plSpaceTreePacked& packed, const plVolumeSlab* slabs, size_t numSlabs, uint32_t& clear)
+{
+    uint32_t culled = 0;
+    uint32_t split = 0;
+    for( size_t s = 0; s < numSlabs; s++ )
+    {
+        const hsVector3& n = slabs[s].fNorm;
+        for( int i = 0; i < plSpaceTreePacked::kNumLanes; i++ )
+        {
+            // Same as hsBounds3::TestPlane
+            float dmax = packed.fMins[0][i] * n.fX;
+            dmax += packed.fMins[1][i] * n.fY;
+            dmax += packed.fMins[2][i] * n.fZ;
+            float dmin = dmax;
+            for( int j = 0; j < 3; j++ )
+            {
+                float dd = packed.fExtents[j][i] * n[j];
+                if( dd < 0 )
+                    dmin += dd;
+                else
+                    dmax += dd;
+            }
+
+            if( dmax < slabs[s].fMin || dmin > slabs[s].fMax )
+                culled |= 1 << i;
+            if( dmin < slabs[s].fMin || dmax > slabs[s].fMax )
+                split |= 1 << i;
+        }
+    }
+    clear = ~(culled | split) & plSpaceTreePacked::kAllLanes;
+    return culled;
+}
+
+hsCpuFunctionDispatcher<plSpaceTree::test_packed_ptr> plSpaceTree::test_packed {
+    &plSpaceTree::test_packed_fpu,
+    nullptr,            // SSE1
+    &plSpaceTree::test_packed_sse2
+};
+
 void plSpaceTree::Read(hsStream* s, hsResMgr* mgr)
 {
     plCreatable::Read(s, mgr);
 
+    fPacked.clear();
+
     fRoot = s->ReadLE16();
 
     fNumLeaves = s->ReadLE32();
@@ -46,12 +46,14 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include <vector>
 
 #include "hsBounds.h"
+#include "hsCpuID.h"
 #include "pnFactory/plCreatable.h"
 #include "hsBitVector.h"
 
 class hsStream;
 class hsResMgr;
 class plVolumeIsect;
+struct plVolumeSlab;
 
 class plSpaceTreeNode 
 {
@@ -87,6 +89,26 @@ public:
 };
 
 
+// Two levels of the tree packed together for culling. Lanes 0 and 1 are
+// a pair of sibling nodes, lanes 2,3 are lane 0's children and lanes 4,5
+// lane 1's. Bounds are stored component by component, as mins and extents
+// (maxs - mins), so four lanes can be tested against a plane at once with
+// the same arithmetic hsBounds3::TestPlane uses on one box.
+struct plSpaceTreePacked
+{
+    enum
+    {
+        kNumLanes   = 8,
+        kAllLanes   = (1 << kNumLanes) - 1
+    };
+
+    float       fMins[3][kNumLanes];
+    float       fExtents[3][kNumLanes];
+    int16_t     fNode[kNumLanes];   // Index into the tree, or -1 for an unused lane
+    int32_t     fChild[kNumLanes];  // Packed node below a lane 2-5 node, or -1
+    uint32_t    fExact;             // Lanes whose bounds are a normal axis aligned box
+};
+
 class plSpaceTree : public plCreatable
 {
 public:
@@ -111,7 +133,27 @@ private:
 
     hsPoint3                        fViewPos;
 
+    // Culling copy of the tree, built on the first packed harvest. The
+    // bounds are recopied whenever the tree's bounds have moved.
+    mutable std::vector<plSpaceTreePacked> fPacked;
+    mutable bool                    fPackedDirty;
+
+    static bool                     fPackedHarvest;
+
     void        IRefreshRecur(int16_t which);
+
+    void        IMarkDirty(int16_t idx);
+    void        IUpdateDisabled(int16_t idx);
+    void        IMoveNode(int16_t from, int16_t to);
+    int16_t     IFindInsertSibling(const hsBounds3Ext& bnd) const;
+    void        IInsertLeaf(int16_t leaf, int16_t parent);
+    int16_t     IRemoveLeaf(int16_t leaf);
+
+    int32_t     IBuildPacked(int16_t top0, int16_t top1) const;
+    void        IUpdatePackedBounds() const;
+    void        IHarvestAndCullPacked(int32_t packedIdx, const plVolumeSlab* slabs, size_t numSlabs, hsBitVector& totList, hsBitVector& list) const;
+    void        IHarvestPackedLane(const plSpaceTreePacked& packed, int lane, uint32_t culled, uint32_t clear,
+                                   const plVolumeSlab* slabs, size_t numSlabs, hsBitVector& totList, hsBitVector& list) const;
     
     void        IHarvestAndCullLeaves(const plSpaceTreeNode& subRoot, std::vector<int16_t>& list) const;
     void        IHarvestLeaves(const plSpaceTreeNode& subRoot, std::vector<int16_t>& list) const;
@@ -173,6 +215,20 @@ public:
 
     void MoveLeaf(int16_t idx, const hsBounds3Ext& newWorldBnd);
     void Refresh();
+
+    // Like MoveLeaf, but a leaf whose new center is outside its parent is
+    // taken out and put back in wherever it now fits best, rather than
+    // stretching every node above it.
+    void RelocateLeaf(int16_t idx, const hsBounds3Ext& newWorldBnd);
+
+    // Puts a new leaf into the tree without rebuilding it. Returns its index,
+    // which is always the old leaf count, or -1 if the tree is full.
+    int16_t AddLeaf(const hsBounds3Ext& worldBnd, bool disable=false);
+
+    // Surface area heuristic cost of the tree: every node's area relative to
+    // the root's, summed. Lower means a query tests fewer nodes. Only
+    // meaningful after a Refresh.
+    float ComputeSAHCost() const;
     bool IsEmpty() const { return 0 != (GetNode(GetRoot()).fFlags & plSpaceTreeNode::kEmpty); }
     bool IsDirty() const { return 0 != (GetNode(GetRoot()).fFlags & plSpaceTreeNode::kDirty); }
     void MakeDirty() { fTree[GetRoot()].fFlags |= plSpaceTreeNode::kDirty; }
@@ -184,6 +240,20 @@ public:
 
     void HarvestLevel(int level, std::vector<int16_t>& list) const;
 
+    // Harvests against volumes that can be described as slabs go through
+    // the packed copy of the tree. On by default, off falls back to testing
+    // one node at a time. Both give the same leaves.
+    static void SetPackedHarvest(bool on) { fPackedHarvest = on; }
+    static bool GetPackedHarvest() { return fPackedHarvest; }
+
+    // Classifies every lane of a packed node against the slabs. Returns the
+    // lanes outside some slab, and sets clear to the lanes inside all of them.
+    typedef uint32_t(*test_packed_ptr)(const plSpaceTreePacked& packed, const plVolumeSlab* slabs, size_t numSlabs, uint32_t& clear);
+    static hsCpuFunctionDispatcher<test_packed_ptr> test_packed;
+
+    static uint32_t test_packed_fpu(const plSpaceTreePacked& packed, const plVolumeSlab* slabs, size_t numSlabs, uint32_t& clear);
+    static uint32_t test_packed_sse2(const plSpaceTreePacked& packed, const plVolumeSlab* slabs, size_t numSlabs, uint32_t& clear);
+
     friend class plSpaceTreeMaker;
 };
 
@@ -44,11 +44,21 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plSpaceTreeMaker.h"
 #include "plMath/hsRadixSort.h"
 #include "plSpaceTree.h"
+#include "plProfile.h"
 
  // for testing, get hsRand()
 #include "hsTimer.h"
 #include "plIntersect/plVolumeIsect.h"
 
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+plProfile_CreateTimer("Space Tree Build", "Draw", SpaceTreeBuild);
+
+bool plSpaceTreeMaker::fBinnedBuild = true;
+uint32_t plSpaceTreeMaker::fBuildThreads = 1;
+
 //#define MF_DO_TIMES
 
 enum mfTimeTypes
@@ -365,8 +375,222 @@ plSpacePrepNode* plSpaceTreeMaker::IMakeTreeRecur(std::vector<plSpacePrepNode*>&
     return subRoot;
 }
 
+//// Binned Build ////////////////////////////////////////////////////////////
+//  Works on a flat array of leaf boxes, partitioned in place as it goes.
+//  Each node is split between the bins along the axis its leaf centers
+//  spread furthest on, wherever the two halves' surface areas weighted by
+//  their leaf counts add up least.
+
+struct plSpaceBuildRef
+{
+    float       fMins[3];
+    float       fMaxs[3];
+    float       fCenter[3];
+    int16_t     fLeaf;
+};
+
+// Half the surface area, which is all the comparisons need
+static inline float IHalfArea(const float* mins, const float* maxs)
+{
+    float dx = maxs[0] - mins[0];
+    float dy = maxs[1] - mins[1];
+    float dz = maxs[2] - mins[2];
+    return dx * dy + dy * dz + dz * dx;
+}
+
+static inline void IGrowBox(float* mins, float* maxs, const plSpaceBuildRef& ref)
+{
+    for( int i = 0; i < 3; i++ )
+    {
+        mins[i] = std::min(mins[i], ref.fMins[i]);
+        maxs[i] = std::max(maxs[i], ref.fMaxs[i]);
+    }
+}
+
+size_t plSpaceTreeMaker::IBinnedSplit(plSpaceBuildRef* refs, size_t numRefs, int axis, float lo, float hi)
+{
+    const int kNumBins = 16;
+
+    // All the centers in one spot, any split is as good as another.
+    if( hi - lo < 1.e-6f )
+        return numRefs / 2;
+
+    const float scale = kNumBins / (hi - lo);
+    auto binOf = [&](const plSpaceBuildRef& ref)
+    {
+        return std::min(kNumBins - 1, int((ref.fCenter[axis] - lo) * scale));
+    };
+
+    size_t counts[kNumBins] = {};
+    float binMins[kNumBins][3];
+    float binMaxs[kNumBins][3];
+    for( int b = 0; b < kNumBins; b++ )
+    {
+        std::fill(binMins[b], binMins[b] + 3, std::numeric_limits<float>::max());
+        std::fill(binMaxs[b], binMaxs[b] + 3, -std::numeric_limits<float>::max());
+    }
+    for( size_t i = 0; i < numRefs; i++ )
+    {
+        int b = binOf(refs[i]);
+        counts[b]++;
+        IGrowBox(binMins[b], binMaxs[b], refs[i]);
+    }
+
+    // Areas and counts of everything from each bin up
+    float upperArea[kNumBins];
+    size_t upperCount[kNumBins];
+    float mins[3], maxs[3];
+    std::fill(mins, mins + 3, std::numeric_limits<float>::max());
+    std::fill(maxs, maxs + 3, -std::numeric_limits<float>::max());
+    size_t count = 0;
+    for( int b = kNumBins - 1; b > 0; b-- )
+    {
+        for( int i = 0; i < 3; i++ )
+        {
+            mins[i] = std::min(mins[i], binMins[b][i]);
+            maxs[i] = std::max(maxs[i], binMaxs[b][i]);
+        }
+        count += counts[b];
+        upperCount[b] = count;
+        upperArea[b] = count ? IHalfArea(mins, maxs) : 0;
+    }
+
+    // Then sweep back up, trying a split below each bin
+    std::fill(mins, mins + 3, std::numeric_limits<float>::max());
+    std::fill(maxs, maxs + 3, -std::numeric_limits<float>::max());
+    count = 0;
+    int bestBin = -1;
+    float bestCost = std::numeric_limits<float>::max();
+    for( int b = 1; b < kNumBins; b++ )
+    {
+        for( int i = 0; i < 3; i++ )
+        {
+            mins[i] = std::min(mins[i], binMins[b-1][i]);
+            maxs[i] = std::max(maxs[i], binMaxs[b-1][i]);
+        }
+        count += counts[b-1];
+        if( !count || !upperCount[b] )
+            continue;
+
+        float cost = IHalfArea(mins, maxs) * count + upperArea[b] * upperCount[b];
+        if( cost < bestCost )
+        {
+            bestCost = cost;
+            bestBin = b;
+        }
+    }
+
+    if( bestBin >= 0 )
+    {
+        plSpaceBuildRef* mid = std::partition(refs, refs + numRefs,
+            [&](const plSpaceBuildRef& ref) { return binOf(ref) < bestBin; });
+        size_t numLower = mid - refs;
+        if( numLower > 0 && numLower < numRefs )
+            return numLower;
+    }
+
+    // Shouldn't get here, the lowest and highest centers land in different
+    // bins. But if rounding says otherwise, fall back on a median split.
+    std::nth_element(refs, refs + numRefs / 2, refs + numRefs,
+        [axis](const plSpaceBuildRef& a, const plSpaceBuildRef& b) { return a.fCenter[axis] < b.fCenter[axis]; });
+    return numRefs / 2;
+}
+
+plSpacePrepNode* plSpaceTreeMaker::IMakeBinnedTreeRecur(plSpaceBuildRef* refs, size_t numRefs, uint32_t numThreads)
+{
+    // Below this, a thread costs more to start than the subtree takes to build
+    const size_t kMinParallelBuildLeaves = 1024;
+
+    if( numRefs == 1 )
+    {
+        plSpacePrepNode* leaf = new plSpacePrepNode;
+        *leaf = *fLeaves[refs[0].fLeaf];
+        return leaf;
+    }
+
+    float mins[3], maxs[3];
+    float centerMins[3], centerMaxs[3];
+    for( int i = 0; i < 3; i++ )
+    {
+        mins[i] = refs[0].fMins[i];
+        maxs[i] = refs[0].fMaxs[i];
+        centerMins[i] = centerMaxs[i] = refs[0].fCenter[i];
+    }
+    for( size_t j = 1; j < numRefs; j++ )
+    {
+        IGrowBox(mins, maxs, refs[j]);
+        for( int i = 0; i < 3; i++ )
+        {
+            centerMins[i] = std::min(centerMins[i], refs[j].fCenter[i]);
+            centerMaxs[i] = std::max(centerMaxs[i], refs[j].fCenter[i]);
+        }
+    }
+
+    int axis = 0;
+    for( int i = 1; i < 3; i++ )
+    {
+        if( centerMaxs[i] - centerMins[i] > centerMaxs[axis] - centerMins[axis] )
+            axis = i;
+    }
+    size_t numLower = IBinnedSplit(refs, numRefs, axis, centerMins[axis], centerMaxs[axis]);
+
+    // Not INewSubRoot, that counts nodes and this can be on any thread
+    plSpacePrepNode* subRoot = new plSpacePrepNode;
+    subRoot->fDataIndex = int16_t(-1);
+    hsPoint3 lo(mins[0], mins[1], mins[2]);
+    hsPoint3 hi(maxs[0], maxs[1], maxs[2]);
+    subRoot->fWorldBounds.Reset(&lo);
+    subRoot->fWorldBounds.Union(&hi);
+
+    if( numThreads > 1 && numRefs >= kMinParallelBuildLeaves )
+    {
+        uint32_t lowerThreads = numThreads / 2;
+        std::thread lower([=]() { subRoot->fChildren[0] = IMakeBinnedTreeRecur(refs, numLower, lowerThreads); });
+        subRoot->fChildren[1] = IMakeBinnedTreeRecur(refs + numLower, numRefs - numLower, numThreads - lowerThreads);
+        lower.join();
+    }
+    else
+    {
+        subRoot->fChildren[0] = IMakeBinnedTreeRecur(refs, numLower, 1);
+        subRoot->fChildren[1] = IMakeBinnedTreeRecur(refs + numLower, numRefs - numLower, 1);
+    }
+
+    return subRoot;
+}
+
+void plSpaceTreeMaker::IMakeBinnedTree()
+{
+    std::vector<plSpaceBuildRef> refs(fLeaves.size());
+    for (size_t i = 0; i < fLeaves.size(); i++)
+    {
+        const hsBounds3Ext& bnd = fLeaves[i]->fWorldBounds;
+        for( int j = 0; j < 3; j++ )
+        {
+            refs[i].fMins[j] = bnd.GetMins()[j];
+            refs[i].fMaxs[j] = bnd.GetMaxs()[j];
+            refs[i].fCenter[j] = (refs[i].fMins[j] + refs[i].fMaxs[j]) * 0.5f;
+        }
+        refs[i].fLeaf = int16_t(i);
+    }
+
+    uint32_t numThreads = fBuildThreads;
+    if (numThreads == 0)
+        numThreads = std::max(std::thread::hardware_concurrency(), 1U);
+
+    fPrepTree = IMakeBinnedTreeRecur(refs.data(), refs.size(), numThreads);
+
+    // Every split is in two, so there's one fewer interior node than leaves
+    fTreeSize = int16_t(fLeaves.size() * 2 - 1);
+}
+
 void plSpaceTreeMaker::IMakeTree()
 {
+    if( fBinnedBuild )
+    {
+        IMakeBinnedTree();
+        return;
+    }
+
     fSortScratch = new hsRadixSort::Elem[fLeaves.size()];
 
     fPrepTree = IMakeTreeRecur(fLeaves);
@@ -522,19 +746,27 @@ plSpaceTree* plSpaceTreeMaker::MakeTree()
     // DEBUG FISH
 
     StartTimer(kMakeTreeAll);
+    plProfile_BeginTiming(SpaceTreeBuild);
 
+    plSpaceTree* retVal;
     if (fLeaves.empty())
-        return IMakeEmptyTree();
-
-    if (fLeaves.size() < 2)
-        return IMakeDegenerateTree();
-
-    IMakeTree();
+    {
+        retVal = IMakeEmptyTree();
+    }
+    else if (fLeaves.size() < 2)
+    {
+        retVal = IMakeDegenerateTree();
+    }
+    else
+    {
+        IMakeTree();
 
-    plSpaceTree* retVal = IMakeSpaceTree();
+        retVal = IMakeSpaceTree();
 
-    Cleanup();
+        Cleanup();
+    }
 
+    plProfile_EndTiming(SpaceTreeBuild);
     StopTimer(kMakeTreeAll);
 
     return retVal;
@@ -50,6 +50,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 class hsRadixSortElem;
 class plSpaceTree;
+struct plSpaceBuildRef;
  
 class plSpacePrepNode
 {
@@ -74,6 +75,9 @@ protected:
     plSpacePrepNode*                fPrepTree;
     int16_t                           fTreeSize;
 
+    static bool                     fBinnedBuild;
+    static uint32_t                 fBuildThreads;
+
     plSpacePrepNode*                INewSubRoot(const hsBounds3Ext& bnd);
     void                            IFindBigList(std::vector<plSpacePrepNode*>& nodes, float length, const hsVector3& axis, std::vector<plSpacePrepNode*>& giants, std::vector<plSpacePrepNode*>& strimp);
     void                            ISortList(std::vector<plSpacePrepNode*>& nodes, const hsVector3& axis);
@@ -83,6 +87,10 @@ protected:
     hsBounds3Ext                    IFindSplitAxis(std::vector<plSpacePrepNode*>& nodes, float& length, hsVector3& axis);
     plSpacePrepNode*                IMakeTreeRecur(std::vector<plSpacePrepNode*>& nodes);
 
+    size_t                          IBinnedSplit(plSpaceBuildRef* refs, size_t numRefs, int axis, float lo, float hi);
+    plSpacePrepNode*                IMakeBinnedTreeRecur(plSpaceBuildRef* refs, size_t numRefs, uint32_t numThreads);
+    void                            IMakeBinnedTree();
+
     void                            IMakeTree();
 
     plSpaceTree*                    IMakeEmptyTree();
@@ -103,6 +111,17 @@ public:
     plSpaceTree*                    MakeTree();
 
     void                            TestTree(); // development only - NUKE ME mf horse
+
+    // Splits each node where the surface area heuristic says is cheapest,
+    // binning the leaves along the widest axis, instead of sorting them and
+    // cutting the list in half. On by default.
+    static void     SetBinnedBuild(bool on) { fBinnedBuild = on; }
+    static bool     GetBinnedBuild() { return fBinnedBuild; }
+
+    // Threads for the top splits of a binned build. 0 means one per core,
+    // 1 keeps it on the calling thread.
+    static void     SetBuildThreads(uint32_t numThreads) { fBuildThreads = numThreads; }
+    static uint32_t GetBuildThreads() { return fBuildThreads; }
 };
 
 #endif // plSpaceTreeMaker_inc
@@ -0,0 +1,114 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "plSpaceTree.h"
+
+#include "plIntersect/plVolumeIsect.h"
+
+#ifdef HAVE_SSE2
+#   include <emmintrin.h>
+#endif // HAVE_SSE2
+
+//// Packed Test //////////////////////////////////////////////////////////////
+//  Four lanes at a time, doing the same float operations in the same order
+//  as the plain version. Adding the zeroed half of dd instead of branching
+//  leaves each depth unchanged, so both versions classify every box alike.
+
+uint32_t plSpaceTree::test_packed_sse2(const plSpaceTreePacked& packed, const plVolumeSlab* slabs, size_t numSlabs, uint32_t& clear)
+{
+#ifdef HAVE_SSE2
+    const __m128 zero = _mm_setzero_ps();
+
+    uint32_t culled = 0;
+    uint32_t split = 0;
+    for( int i = 0; i < plSpaceTreePacked::kNumLanes; i += 4 )
+    {
+        const __m128 minX = _mm_loadu_ps(&packed.fMins[0][i]);
+        const __m128 minY = _mm_loadu_ps(&packed.fMins[1][i]);
+        const __m128 minZ = _mm_loadu_ps(&packed.fMins[2][i]);
+        const __m128 extX = _mm_loadu_ps(&packed.fExtents[0][i]);
+        const __m128 extY = _mm_loadu_ps(&packed.fExtents[1][i]);
+        const __m128 extZ = _mm_loadu_ps(&packed.fExtents[2][i]);
+
+        __m128 culledMask = zero;
+        __m128 splitMask = zero;
+        for( size_t s = 0; s < numSlabs; s++ )
+        {
+            const __m128 nX = _mm_set1_ps(slabs[s].fNorm.fX);
+            const __m128 nY = _mm_set1_ps(slabs[s].fNorm.fY);
+            const __m128 nZ = _mm_set1_ps(slabs[s].fNorm.fZ);
+            const __m128 lo = _mm_set1_ps(slabs[s].fMin);
+            const __m128 hi = _mm_set1_ps(slabs[s].fMax);
+
+            __m128 dmax = _mm_mul_ps(minX, nX);
+            dmax = _mm_add_ps(dmax, _mm_mul_ps(minY, nY));
+            dmax = _mm_add_ps(dmax, _mm_mul_ps(minZ, nZ));
+            __m128 dmin = dmax;
+
+            __m128 dd = _mm_mul_ps(extX, nX);
+            __m128 neg = _mm_cmplt_ps(dd, zero);
+            dmin = _mm_add_ps(dmin, _mm_and_ps(neg, dd));
+            dmax = _mm_add_ps(dmax, _mm_andnot_ps(neg, dd));
+
+            dd = _mm_mul_ps(extY, nY);
+            neg = _mm_cmplt_ps(dd, zero);
+            dmin = _mm_add_ps(dmin, _mm_and_ps(neg, dd));
+            dmax = _mm_add_ps(dmax, _mm_andnot_ps(neg, dd));
+
+            dd = _mm_mul_ps(extZ, nZ);
+            neg = _mm_cmplt_ps(dd, zero);
+            dmin = _mm_add_ps(dmin, _mm_and_ps(neg, dd));
+            dmax = _mm_add_ps(dmax, _mm_andnot_ps(neg, dd));
+
+            culledMask = _mm_or_ps(culledMask, _mm_or_ps(_mm_cmplt_ps(dmax, lo), _mm_cmpgt_ps(dmin, hi)));
+            splitMask = _mm_or_ps(splitMask, _mm_or_ps(_mm_cmplt_ps(dmin, lo), _mm_cmpgt_ps(dmax, hi)));
+        }
+
+        culled |= uint32_t(_mm_movemask_ps(culledMask)) << i;
+        split |= uint32_t(_mm_movemask_ps(splitMask)) << i;
+    }
+    clear = ~(culled | split) & plSpaceTreePacked::kAllLanes;
+    return culled;
+#else
+    return test_packed_fpu(packed, slabs, numSlabs, clear);
+#endif
+}
@@ -0,0 +1,413 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "hsDXTKernels.h"
+
+#include <cstdlib>
+#include <utility>
+
+//// Helpers //////////////////////////////////////////////////////////////////
+//  These match hsDXTSoftwareCodec's IRGB16To32Bit, IMixTwoThirdsRGB32,
+//  IMixEqualRGB32, Color32To16 and BlendColors32 bit for bit.
+
+static inline uint32_t IRGB16To32Bit(uint16_t color)
+{
+    color = hsToLE16(color);
+    uint32_t b = (color & 31) << 3;
+    uint32_t g = ((color >> 5) & 63) << (2 + 8);
+    uint32_t r = ((color >> 11) & 31) << (3 + 16);
+    return r + g + b;
+}
+
+static inline uint32_t IMixTwoThirdsRGB32(uint32_t twoThirds, uint32_t oneThird)
+{
+    uint32_t r = (((twoThirds & 0x00ff0000) << 1) + (oneThird & 0x00ff0000)) / 3;
+    uint32_t g = (((twoThirds & 0x0000ff00) << 1) + (oneThird & 0x0000ff00)) / 3;
+    uint32_t b = (((twoThirds & 0x000000ff) << 1) + (oneThird & 0x000000ff)) / 3;
+    return (r & 0x00ff0000) + (g & 0x0000ff00) + (b & 0x000000ff);
+}
+
+static inline uint32_t IMixEqualRGB32(uint32_t color1, uint32_t color2)
+{
+    uint32_t r = ((color1 & 0x00ff0000) + (color2 & 0x00ff0000)) >> 1;
+    uint32_t g = ((color1 & 0x0000ff00) + (color2 & 0x0000ff00)) >> 1;
+    uint32_t b = ((color1 & 0x000000ff) + (color2 & 0x000000ff)) >> 1;
+    return (r & 0x00ff0000) + (g & 0x0000ff00) + (b & 0x000000ff);
+}
+
+static inline uint16_t IColor32To16(uint32_t color)
+{
+    uint32_t r = (color >> 16) & 0xf8;
+    uint32_t g = (color >> 8) & 0xfc;
+    uint32_t b = color & 0xf8;
+    return (uint16_t)((r << 8) | (g << 3) | (b >> 3));
+}
+
+// (color1 * weight1 + color2 * weight2) / (weight1 + weight2) per channel,
+// alpha 0
+static inline uint32_t IBlendColors32(uint32_t weight1, uint32_t color1, uint32_t weight2, uint32_t color2)
+{
+    uint32_t result = 0;
+    for (uint32_t shift = 0; shift < 24; shift += 8) {
+        uint32_t c = (((color1 >> shift) & 0xff) * weight1 + ((color2 >> shift) & 0xff) * weight2) / (weight1 + weight2);
+        result |= (c & 0xff) << shift;
+    }
+    return result;
+}
+
+static inline uint32_t ILoadBits24(const uint8_t* bytes)
+{
+    return ((uint32_t)bytes[2] << 16) + ((uint32_t)bytes[1] << 8) + (uint32_t)bytes[0];
+}
+
+//// DecodeRows ///////////////////////////////////////////////////////////////
+
+void hsDXTKernels::DecodeRows(Format format, const uint8_t* src, uint32_t* dst, uint32_t dstStride,
+                              uint32_t widthBlocks, uint32_t rowBegin, uint32_t rowEnd)
+{
+    const uint32_t blockSize = BlockSize(format);
+    uint32_t palette[4], alphas[8], alphaBits[2];
+
+    for (uint32_t by = rowBegin; by < rowEnd; by++) {
+        const uint8_t* block = src + by * widthBlocks * blockSize;
+        uint32_t* dstRow = dst + by * 4 * dstStride;
+
+        for (uint32_t bx = 0; bx < widthBlocks; bx++, block += blockSize) {
+            if (format == kDXT1) {
+                const uint16_t* words = reinterpret_cast<const uint16_t*>(block);
+                palette[0] = IRGB16To32Bit(words[0]) | 0xff000000;
+                palette[1] = IRGB16To32Bit(words[1]) | 0xff000000;
+
+                if (hsToLE16(words[0]) > hsToLE16(words[1])) {
+                    /// Four-color block--mix the other two
+                    palette[2] = IMixTwoThirdsRGB32(palette[0], palette[1]) | 0xff000000;
+                    palette[3] = IMixTwoThirdsRGB32(palette[1], palette[0]) | 0xff000000;
+                } else {
+                    /// Three-color block and transparent
+                    palette[2] = IMixEqualRGB32(palette[0], palette[1]) | 0xff000000;
+                    palette[3] = 0;
+                }
+
+                uint32_t colorBits = hsToLE16(words[2]) | ((uint32_t)hsToLE16(words[3]) << 16);
+                decode_block.call(dstRow + (bx << 2), dstStride, palette, colorBits, nullptr, nullptr);
+            } else {
+                /// Note that we use the preshifted alphas really as fixed point.
+                /// The result: more accuracy, and no need to shift the alphas afterwards
+                alphas[0] = (uint32_t)block[0] << 24;
+                alphas[1] = (uint32_t)block[1] << 24;
+                uint32_t aTemp = alphas[0];
+                if (block[0] > block[1]) {
+                    /// 8-alpha block: interpolate 6 others
+                    uint32_t a0 = (aTemp / 7) & 0xff000000;
+                    uint32_t a1 = (alphas[1] / 7) & 0xff000000;
+                    for (int j = 2; j < 8; j++) {
+                        aTemp += a1 - a0;
+                        alphas[j] = aTemp;
+                    }
+                } else {
+                    /// 6-alpha block: interpolate 4 others, then the last 2 are 0 and 255
+                    uint32_t a0 = (alphas[1] - aTemp) / 5;
+                    for (int j = 2; j < 6; j++) {
+                        aTemp += a0;
+                        alphas[j] = aTemp & 0xff000000;
+                    }
+                    alphas[6] = 0;
+                    alphas[7] = 255 << 24;
+                }
+                alphaBits[0] = ILoadBits24(block + 2);
+                alphaBits[1] = ILoadBits24(block + 5);
+
+                const uint16_t* words = reinterpret_cast<const uint16_t*>(block + 8);
+                palette[0] = IRGB16To32Bit(words[0]);
+                palette[1] = IRGB16To32Bit(words[1]);
+                palette[2] = IMixTwoThirdsRGB32(palette[0], palette[1]);
+                palette[3] = IMixTwoThirdsRGB32(palette[1], palette[0]);
+
+                uint32_t colorBits = hsToLE16(words[2]) | ((uint32_t)hsToLE16(words[3]) << 16);
+                decode_block.call(dstRow + (bx << 2), dstStride, palette, colorBits, alphas, alphaBits);
+            }
+        }
+    }
+}
+
+//// EncodeRows ///////////////////////////////////////////////////////////////
+//  Same algorithm as the original hsDXTSoftwareCodec::CompressMipmapLevel:
+//  the endpoints are the two pixels furthest apart, each pixel gets the
+//  closest palette entry, and DXT5 alpha uses the block's alpha range.
+
+void hsDXTKernels::EncodeRows(Format format, const uint32_t* src, uint32_t srcStride, uint8_t* dst,
+                              uint32_t widthBlocks, uint32_t rowBegin, uint32_t rowEnd)
+{
+    const uint32_t blockSize = BlockSize(format);
+    uint32_t pixels[16], palette[4];
+    uint8_t alpha[8], colorIndices[16], alphaIndices[16];
+
+    for (uint32_t by = rowBegin; by < rowEnd; by++) {
+        for (uint32_t bx = 0; bx < widthBlocks; bx++) {
+            const uint32_t* srcBlock = src + (by << 2) * srcStride + (bx << 2);
+
+            uint8_t maxAlpha = 0;
+            uint8_t minAlpha = 255;
+            uint8_t oldMaxAlpha = 0;
+            uint8_t oldMinAlpha = 255;
+            bool hasTransparency = false;
+
+            for (uint32_t xx = 0; xx < 4; ++xx) {
+                for (uint32_t yy = 0; yy < 4; ++yy) {
+                    uint32_t pixel = srcBlock[yy * srcStride + xx];
+                    pixels[(xx << 2) + yy] = pixel;
+
+                    uint8_t pixelAlpha = (uint8_t)(pixel >> 24);
+                    if (pixelAlpha != 255)
+                        hasTransparency = true;
+
+                    if (format == kDXT5) {
+                        if (pixelAlpha > maxAlpha)
+                            maxAlpha = pixelAlpha;
+                        if ((pixelAlpha > oldMaxAlpha) && (pixelAlpha < 255))
+                            oldMaxAlpha = pixelAlpha;
+                        if (pixelAlpha < minAlpha)
+                            minAlpha = pixelAlpha;
+                        if ((pixelAlpha < oldMinAlpha) && (pixelAlpha > 0))
+                            oldMinAlpha = minAlpha;
+                    }
+                }
+            }
+
+            uint32_t color[4];
+            find_endpoints.call(pixels, color[0], color[1]);
+
+            if (oldMinAlpha == 255) {
+                oldMinAlpha = 0;
+                oldMaxAlpha = 255;
+            }
+
+            if (format == kDXT5) {
+                if (((maxAlpha == 255) && (minAlpha == 0)) || (maxAlpha == minAlpha)) {
+                    if (maxAlpha == minAlpha) {
+                        alpha[0] = minAlpha;
+                        alpha[1] = maxAlpha;
+                    } else {
+                        alpha[0] = oldMinAlpha;
+                        alpha[1] = oldMaxAlpha;
+                    }
+                    alpha[2] = (4 * alpha[0] + alpha[1]) / 5;      // Bit code 010
+                    alpha[3] = (3 * alpha[0] + 2 * alpha[1]) / 5;  // Bit code 011
+                    alpha[4] = (2 * alpha[0] + 3 * alpha[1]) / 5;  // Bit code 100
+                    alpha[5] = (alpha[0] + 4 * alpha[1]) / 5;      // Bit code 101
+                    alpha[6] = 0;                                  // Bit code 110
+                    alpha[7] = 255;                                // Bit code 111
+                } else {
+                    alpha[0] = maxAlpha;
+                    alpha[1] = minAlpha;
+                    alpha[2] = (6 * alpha[0] + alpha[1]) / 7;      // bit code 010
+                    alpha[3] = (5 * alpha[0] + 2 * alpha[1]) / 7;  // Bit code 011
+                    alpha[4] = (4 * alpha[0] + 3 * alpha[1]) / 7;  // Bit code 100
+                    alpha[5] = (3 * alpha[0] + 4 * alpha[1]) / 7;  // Bit code 101
+                    alpha[6] = (2 * alpha[0] + 5 * alpha[1]) / 7;  // Bit code 110
+                    alpha[7] = (alpha[0] + 6 * alpha[1]) / 7;      // Bit code 111
+                }
+            }
+
+            uint16_t shortColor[2];
+            shortColor[0] = IColor32To16(color[0]);
+            shortColor[1] = IColor32To16(color[1]);
+
+            uint32_t paletteSize;
+            if ((shortColor[0] == shortColor[1]) || ((format == kDXT1) && hasTransparency)) {
+                paletteSize = 3;
+                if (shortColor[0] > shortColor[1]) {
+                    std::swap(shortColor[0], shortColor[1]);
+                    std::swap(color[0], color[1]);
+                }
+                color[2] = IBlendColors32(1, color[0], 1, color[1]);
+                color[3] = 0;
+            } else {
+                paletteSize = 4;
+                if (shortColor[0] < shortColor[1]) {
+                    std::swap(shortColor[0], shortColor[1]);
+                    std::swap(color[0], color[1]);
+                }
+                color[2] = IBlendColors32(2, color[0], 1, color[1]);
+                color[3] = IBlendColors32(1, color[0], 2, color[1]);
+            }
+            for (int i = 0; i < 4; i++)
+                palette[i] = color[i];
+
+            select_indices.call(pixels, palette, paletteSize, format == kDXT5 ? alpha : nullptr,
+                                colorIndices, alphaIndices);
+
+            // Pack the indices, row by row
+            uint32_t colorBits = 0;
+            uint32_t alphaBits[2] = { 0, 0 };
+            for (uint32_t xx = 0; xx < 4; ++xx) {
+                for (uint32_t yy = 0; yy < 4; ++yy) {
+                    uint32_t p = (xx << 2) + yy;
+                    colorBits |= (uint32_t)colorIndices[p] << (2 * (4 * yy + xx));
+                    alphaBits[yy >> 1] |= (uint32_t)alphaIndices[p] << (3 * (4 * (yy & 1) + xx));
+                }
+            }
+
+            uint8_t* block = dst + (bx + widthBlocks * by) * blockSize;
+            uint16_t* colorBlock;
+            if (format == kDXT5) {
+                block[0] = alpha[0];
+                block[1] = alpha[1];
+                for (int i = 0; i < 3; i++) {
+                    block[2 + i] = (uint8_t)(alphaBits[0] >> (i << 3));
+                    block[5 + i] = (uint8_t)(alphaBits[1] >> (i << 3));
+                }
+                colorBlock = reinterpret_cast<uint16_t*>(block + 8);
+            } else {
+                colorBlock = reinterpret_cast<uint16_t*>(block);
+            }
+            colorBlock[0] = shortColor[0];
+            colorBlock[1] = shortColor[1];
+            colorBlock[2] = (uint16_t)(colorBits & 0xffff);
+            colorBlock[3] = (uint16_t)(colorBits >> 16);
+        }
+    }
+}
+
+//// Block Kernels ////////////////////////////////////////////////////////////
+
+void hsDXTKernels::decode_block_fpu(uint32_t* dst, uint32_t dstStride, const uint32_t* palette,
+                                    uint32_t colorBits, const uint32_t* alphas, const uint32_t* alphaBits)
+{
+    for (uint32_t p = 0; p < 16; p++) {
+        uint32_t pixel = palette[(colorBits >> (p << 1)) & 0x03];
+        if (alphas)
+            pixel |= alphas[(alphaBits[p >> 3] >> (3 * (p & 7))) & 0x07];
+        dst[(p >> 2) * dstStride + (p & 3)] = hsToLE32(pixel);
+    }
+}
+
+void hsDXTKernels::find_endpoints_fpu(const uint32_t* pixels, uint32_t& color0, uint32_t& color1)
+{
+    int32_t maxDistance = 0;
+    for (uint32_t i = 0; i < 16; i++) {
+        for (uint32_t j = 0; j < 16; j++) {
+            int32_t distance = ColorDistanceSquared(pixels[i], pixels[j]);
+            if (distance >= maxDistance) {
+                maxDistance = distance;
+                color0 = pixels[i];
+                color1 = pixels[j];
+            }
+        }
+    }
+}
+
+void hsDXTKernels::select_indices_fpu(const uint32_t* pixels, const uint32_t* palette, uint32_t paletteSize,
+                                      const uint8_t* alphas, uint8_t* colorIndices, uint8_t* alphaIndices)
+{
+    for (uint32_t p = 0; p < 16; p++) {
+        uint8_t pixelAlpha = (uint8_t)(pixels[p] >> 24);
+
+        if (alphas) {
+            uint32_t alphaIndex = 0;
+            uint32_t alphaDistance = abs(pixelAlpha - alphas[0]);
+            for (uint32_t i = 1; i < 8; i++) {
+                uint32_t distance = abs(pixelAlpha - alphas[i]);
+                if (distance < alphaDistance) {
+                    alphaIndex = i;
+                    alphaDistance = distance;
+                }
+            }
+            alphaIndices[p] = (uint8_t)alphaIndex;
+        } else {
+            alphaIndices[p] = 0;
+        }
+
+        uint32_t colorIndex = 0;
+        if ((paletteSize == 3) && (pixelAlpha == 0)) {
+            colorIndex = 3;
+        } else {
+            uint32_t colorDistance = ColorDistanceSquared(pixels[p], palette[0]);
+            for (uint32_t i = 1; i < paletteSize; i++) {
+                uint32_t distance = ColorDistanceSquared(pixels[p], palette[i]);
+                if (distance < colorDistance) {
+                    colorIndex = i;
+                    colorDistance = distance;
+                }
+            }
+        }
+        colorIndices[p] = (uint8_t)colorIndex;
+    }
+}
+
+//// Dispatchers //////////////////////////////////////////////////////////////
+
+hsCpuFunctionDispatcher<hsDXTKernels::decode_block_ptr> hsDXTKernels::decode_block {
+    &hsDXTKernels::decode_block_fpu,
+    nullptr,            // SSE1
+    nullptr,            // SSE2
+    nullptr,            // SSE3
+    nullptr,            // SSSE3
+    nullptr,            // SSE4.1
+    nullptr,            // SSE4.2
+    nullptr,            // AVX
+    &hsDXTKernels::decode_block_avx2
+};
+
+hsCpuFunctionDispatcher<hsDXTKernels::find_endpoints_ptr> hsDXTKernels::find_endpoints {
+    &hsDXTKernels::find_endpoints_fpu,
+    nullptr,            // SSE1
+    &hsDXTKernels::find_endpoints_sse2,
+    nullptr,            // SSE3
+    nullptr,            // SSSE3
+    nullptr,            // SSE4.1
+    nullptr,            // SSE4.2
+    nullptr,            // AVX
+    &hsDXTKernels::find_endpoints_avx2
+};
+
+hsCpuFunctionDispatcher<hsDXTKernels::select_indices_ptr> hsDXTKernels::select_indices {
+    &hsDXTKernels::select_indices_fpu,
+    nullptr,            // SSE1
+    &hsDXTKernels::select_indices_sse2,
+    nullptr,            // SSE3
+    nullptr,            // SSSE3
+    nullptr,            // SSE4.1
+    nullptr,            // SSE4.2
+    nullptr,            // AVX
+    &hsDXTKernels::select_indices_avx2
+};
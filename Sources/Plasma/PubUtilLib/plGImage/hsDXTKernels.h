@@ -0,0 +1,132 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+//  hsDXTKernels - Block kernels for hsDXTSoftwareCodec                      //
+//                                                                           //
+//  The row functions work on a band of block rows [rowBegin, rowEnd) so     //
+//  that the codec can hand separate bands of a large level to separate      //
+//  threads. Inside them, the per-block work that dominates (endpoint       //
+//  search and index selection when encoding, palette lookups when          //
+//  decoding) goes through hsCpuFunctionDispatcher. Every version produces   //
+//  exactly the same output as the original per-pixel code did.             //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef _hsDXTKernels_h
+#define _hsDXTKernels_h
+
+#include "HeadSpin.h"
+#include "hsCpuID.h"
+
+class hsDXTKernels
+{
+public:
+    enum Format
+    {
+        kDXT1,
+        kDXT5
+    };
+
+    //// Level Rows ////
+
+    // Decodes block rows into a 32-bit ARGB level. dstStride is in pixels.
+    static void DecodeRows(Format format, const uint8_t* src, uint32_t* dst, uint32_t dstStride,
+                           uint32_t widthBlocks, uint32_t rowBegin, uint32_t rowEnd);
+
+    // Encodes block rows of a 32-bit ARGB level. srcStride is in pixels.
+    static void EncodeRows(Format format, const uint32_t* src, uint32_t srcStride, uint8_t* dst,
+                           uint32_t widthBlocks, uint32_t rowBegin, uint32_t rowEnd);
+
+    static uint32_t BlockSize(Format format) { return format == kDXT1 ? 8 : 16; }
+
+    //// Block Kernels ////
+
+    // Writes one decoded block: palette holds the four colors, alphas the
+    // eight alpha values (already in the top byte) or nullptr for DXT1.
+    // colorBits/alphaBits hold the 2- and 3-bit indices for pixels 0-7 and
+    // 8-15, in that order.
+    typedef void(*decode_block_ptr)(uint32_t* dst, uint32_t dstStride, const uint32_t* palette,
+                                    uint32_t colorBits, const uint32_t* alphas,
+                                    const uint32_t* alphaBits);
+    static hsCpuFunctionDispatcher<decode_block_ptr> decode_block;
+
+    // Picks the two block pixels furthest apart in RGB. Pixels are in column
+    // order (x * 4 + y); ties go to the last pair found, as they always have.
+    typedef void(*find_endpoints_ptr)(const uint32_t* pixels, uint32_t& color0, uint32_t& color1);
+    static hsCpuFunctionDispatcher<find_endpoints_ptr> find_endpoints;
+
+    // Picks the closest palette entry for each pixel (first one wins ties).
+    // With a three-color palette, fully transparent pixels get index 3. If
+    // alphas is non-null, also picks the closest of its eight entries.
+    typedef void(*select_indices_ptr)(const uint32_t* pixels, const uint32_t* palette,
+                                      uint32_t paletteSize, const uint8_t* alphas,
+                                      uint8_t* colorIndices, uint8_t* alphaIndices);
+    static hsCpuFunctionDispatcher<select_indices_ptr> select_indices;
+
+    static void decode_block_fpu(uint32_t* dst, uint32_t dstStride, const uint32_t* palette,
+                                 uint32_t colorBits, const uint32_t* alphas, const uint32_t* alphaBits);
+    static void decode_block_avx2(uint32_t* dst, uint32_t dstStride, const uint32_t* palette,
+                                  uint32_t colorBits, const uint32_t* alphas, const uint32_t* alphaBits);
+
+    static void find_endpoints_fpu(const uint32_t* pixels, uint32_t& color0, uint32_t& color1);
+    static void find_endpoints_sse2(const uint32_t* pixels, uint32_t& color0, uint32_t& color1);
+    static void find_endpoints_avx2(const uint32_t* pixels, uint32_t& color0, uint32_t& color1);
+
+    static void select_indices_fpu(const uint32_t* pixels, const uint32_t* palette, uint32_t paletteSize,
+                                   const uint8_t* alphas, uint8_t* colorIndices, uint8_t* alphaIndices);
+    static void select_indices_sse2(const uint32_t* pixels, const uint32_t* palette, uint32_t paletteSize,
+                                    const uint8_t* alphas, uint8_t* colorIndices, uint8_t* alphaIndices);
+    static void select_indices_avx2(const uint32_t* pixels, const uint32_t* palette, uint32_t paletteSize,
+                                    const uint8_t* alphas, uint8_t* colorIndices, uint8_t* alphaIndices);
+
+    // Squared RGB distance, ignoring alpha
+    static int32_t ColorDistanceSquared(uint32_t color1, uint32_t color2)
+    {
+        int32_t r = (int32_t)((color1 >> 16) & 0xff) - (int32_t)((color2 >> 16) & 0xff);
+        int32_t g = (int32_t)((color1 >> 8) & 0xff) - (int32_t)((color2 >> 8) & 0xff);
+        int32_t b = (int32_t)(color1 & 0xff) - (int32_t)(color2 & 0xff);
+        return r * r + g * g + b * b;
+    }
+};
+
+#endif // _hsDXTKernels_h
@@ -0,0 +1,200 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "hsDXTKernels.h"
+
+#ifdef HAVE_AVX2
+#   include <immintrin.h>
+
+// See the SSE2 version; eight pixels at a time.
+static inline void ISplitRGB(__m256i pixels, __m256i& rg, __m256i& b)
+{
+    const __m256i mask = _mm256_set1_epi32(0xff);
+    rg = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(pixels, 16), mask),
+                         _mm256_slli_epi32(_mm256_and_si256(_mm256_srli_epi32(pixels, 8), mask), 16));
+    b = _mm256_and_si256(pixels, mask);
+}
+
+static inline __m256i IDistance(__m256i rg, __m256i b, __m256i refRG, __m256i refB)
+{
+    __m256i dRG = _mm256_sub_epi16(rg, refRG);
+    __m256i dB = _mm256_sub_epi16(b, refB);
+    return _mm256_add_epi32(_mm256_madd_epi16(dRG, dRG), _mm256_madd_epi16(dB, dB));
+}
+#endif // HAVE_AVX2
+
+//// decode_block /////////////////////////////////////////////////////////////
+//  Variable shifts pull out eight indices at once, and a cross-lane permute
+//  looks them up in the palette.
+
+void hsDXTKernels::decode_block_avx2(uint32_t* dst, uint32_t dstStride, const uint32_t* palette,
+                                     uint32_t colorBits, const uint32_t* alphas, const uint32_t* alphaBits)
+{
+#ifdef HAVE_AVX2
+    const __m256i pal = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(palette)));
+    const __m256i colorShifts = _mm256_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14);
+    const __m256i colorMask = _mm256_set1_epi32(0x03);
+    const __m256i bits = _mm256_set1_epi32(static_cast<int>(colorBits));
+
+    __m256i half[2];
+    half[0] = _mm256_permutevar8x32_epi32(pal, _mm256_and_si256(_mm256_srlv_epi32(bits, colorShifts), colorMask));
+    half[1] = _mm256_permutevar8x32_epi32(pal, _mm256_and_si256(_mm256_srli_epi32(_mm256_srlv_epi32(bits, colorShifts), 16), colorMask));
+
+    if (alphas) {
+        const __m256i alphaTable = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(alphas));
+        const __m256i alphaShifts = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+        const __m256i alphaMask = _mm256_set1_epi32(0x07);
+        for (int k = 0; k < 2; k++) {
+            __m256i idx = _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32(static_cast<int>(alphaBits[k])), alphaShifts), alphaMask);
+            half[k] = _mm256_or_si256(half[k], _mm256_permutevar8x32_epi32(alphaTable, idx));
+        }
+    }
+
+    for (int k = 0; k < 2; k++) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm256_castsi256_si128(half[k]));
+        dst += dstStride;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm256_extracti128_si256(half[k], 1));
+        dst += dstStride;
+    }
+#else
+    decode_block_fpu(dst, dstStride, palette, colorBits, alphas, alphaBits);
+#endif
+}
+
+//// find_endpoints ///////////////////////////////////////////////////////////
+
+void hsDXTKernels::find_endpoints_avx2(const uint32_t* pixels, uint32_t& color0, uint32_t& color1)
+{
+#ifdef HAVE_AVX2
+    __m256i rg[2], b[2];
+    for (int k = 0; k < 2; k++)
+        ISplitRGB(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pixels + (k << 3))), rg[k], b[k]);
+
+    alignas(32) int32_t distances[16][16];
+    __m256i maxDist = _mm256_setzero_si256();
+    for (int i = 0; i < 16; i++) {
+        __m256i refRG, refB;
+        ISplitRGB(_mm256_set1_epi32(static_cast<int>(pixels[i])), refRG, refB);
+        for (int k = 0; k < 2; k++) {
+            __m256i d = IDistance(rg[k], b[k], refRG, refB);
+            maxDist = _mm256_max_epi32(maxDist, d);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(&distances[i][k << 3]), d);
+        }
+    }
+
+    __m128i m = _mm_max_epi32(_mm256_castsi256_si128(maxDist), _mm256_extracti128_si256(maxDist, 1));
+    m = _mm_max_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+    m = _mm_max_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+    const __m256i best = _mm256_broadcastd_epi32(m);
+
+    for (int i = 15; i >= 0; i--) {
+        __m256i hi = _mm256_load_si256(reinterpret_cast<const __m256i*>(&distances[i][8]));
+        __m256i lo = _mm256_load_si256(reinterpret_cast<const __m256i*>(&distances[i][0]));
+        uint32_t mask = (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(hi, best))) << 8
+                      | (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(lo, best)));
+        if (mask) {
+            int j = 15;
+            while (!(mask & (1u << j)))
+                j--;
+            color0 = pixels[i];
+            color1 = pixels[j];
+            return;
+        }
+    }
+#else
+    find_endpoints_fpu(pixels, color0, color1);
+#endif
+}
+
+//// select_indices ///////////////////////////////////////////////////////////
+
+void hsDXTKernels::select_indices_avx2(const uint32_t* pixels, const uint32_t* palette, uint32_t paletteSize,
+                                       const uint8_t* alphas, uint8_t* colorIndices, uint8_t* alphaIndices)
+{
+#ifdef HAVE_AVX2
+    __m256i refRG[4], refB[4];
+    for (uint32_t i = 0; i < paletteSize; i++)
+        ISplitRGB(_mm256_set1_epi32(static_cast<int>(palette[i])), refRG[i], refB[i]);
+
+    alignas(32) uint32_t colorIndex[16], alphaIndex[16];
+    for (int k = 0; k < 2; k++) {
+        __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pixels + (k << 3)));
+        __m256i rg, b;
+        ISplitRGB(p, rg, b);
+
+        __m256i best = IDistance(rg, b, refRG[0], refB[0]);
+        __m256i index = _mm256_setzero_si256();
+        for (uint32_t i = 1; i < paletteSize; i++) {
+            __m256i d = IDistance(rg, b, refRG[i], refB[i]);
+            __m256i closer = _mm256_cmpgt_epi32(best, d);
+            best = _mm256_min_epi32(best, d);
+            index = _mm256_blendv_epi8(index, _mm256_set1_epi32(i), closer);
+        }
+
+        __m256i a = _mm256_srli_epi32(p, 24);
+        if (paletteSize == 3) {
+            __m256i clear = _mm256_cmpeq_epi32(a, _mm256_setzero_si256());
+            index = _mm256_blendv_epi8(index, _mm256_set1_epi32(3), clear);
+        }
+        _mm256_store_si256(reinterpret_cast<__m256i*>(colorIndex + (k << 3)), index);
+
+        __m256i aIndex = _mm256_setzero_si256();
+        if (alphas) {
+            __m256i aBest = _mm256_abs_epi32(_mm256_sub_epi32(a, _mm256_set1_epi32(alphas[0])));
+            for (int i = 1; i < 8; i++) {
+                __m256i d = _mm256_abs_epi32(_mm256_sub_epi32(a, _mm256_set1_epi32(alphas[i])));
+                __m256i closer = _mm256_cmpgt_epi32(aBest, d);
+                aBest = _mm256_min_epi32(aBest, d);
+                aIndex = _mm256_blendv_epi8(aIndex, _mm256_set1_epi32(i), closer);
+            }
+        }
+        _mm256_store_si256(reinterpret_cast<__m256i*>(alphaIndex + (k << 3)), aIndex);
+    }
+
+    for (int p = 0; p < 16; p++) {
+        colorIndices[p] = (uint8_t)colorIndex[p];
+        alphaIndices[p] = (uint8_t)alphaIndex[p];
+    }
+#else
+    select_indices_fpu(pixels, palette, paletteSize, alphas, colorIndices, alphaIndices);
+#endif
+}
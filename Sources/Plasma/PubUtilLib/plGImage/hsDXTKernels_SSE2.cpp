@@ -0,0 +1,176 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "hsDXTKernels.h"
+
+#include <algorithm>
+
+#ifdef HAVE_SSE2
+#   include <emmintrin.h>
+
+// Splits four pixels into (r | g << 16) and (b) 32-bit lanes, so that after
+// a 16-bit subtract, _mm_madd_epi16(x, x) gives the squared distance terms.
+static inline void ISplitRGB(__m128i pixels, __m128i& rg, __m128i& b)
+{
+    const __m128i mask = _mm_set1_epi32(0xff);
+    rg = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(pixels, 16), mask),
+                      _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(pixels, 8), mask), 16));
+    b = _mm_and_si128(pixels, mask);
+}
+
+static inline __m128i IDistance(__m128i rg, __m128i b, __m128i refRG, __m128i refB)
+{
+    __m128i dRG = _mm_sub_epi16(rg, refRG);
+    __m128i dB = _mm_sub_epi16(b, refB);
+    return _mm_add_epi32(_mm_madd_epi16(dRG, dRG), _mm_madd_epi16(dB, dB));
+}
+
+static inline __m128i ISelect(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+#endif // HAVE_SSE2
+
+//// find_endpoints ///////////////////////////////////////////////////////////
+//  Fills in the whole 16x16 distance table four entries at a time, then
+//  walks it backwards for the last pair at the maximum, which is the pair the
+//  plain version ends up with.
+
+void hsDXTKernels::find_endpoints_sse2(const uint32_t* pixels, uint32_t& color0, uint32_t& color1)
+{
+#ifdef HAVE_SSE2
+    __m128i rg[4], b[4];
+    for (int k = 0; k < 4; k++)
+        ISplitRGB(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + (k << 2))), rg[k], b[k]);
+
+    alignas(16) int32_t distances[16][16];
+    __m128i maxDist = _mm_setzero_si128();
+    for (int i = 0; i < 16; i++) {
+        __m128i refRG, refB;
+        ISplitRGB(_mm_set1_epi32(static_cast<int>(pixels[i])), refRG, refB);
+        for (int k = 0; k < 4; k++) {
+            __m128i d = IDistance(rg[k], b[k], refRG, refB);
+            maxDist = ISelect(_mm_cmpgt_epi32(d, maxDist), d, maxDist);
+            _mm_store_si128(reinterpret_cast<__m128i*>(&distances[i][k << 2]), d);
+        }
+    }
+
+    int32_t lanes[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), maxDist);
+    int32_t best = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+
+    for (int i = 15; i >= 0; i--) {
+        for (int j = 15; j >= 0; j--) {
+            if (distances[i][j] == best) {
+                color0 = pixels[i];
+                color1 = pixels[j];
+                return;
+            }
+        }
+    }
+#else
+    find_endpoints_fpu(pixels, color0, color1);
+#endif
+}
+
+//// select_indices ///////////////////////////////////////////////////////////
+
+void hsDXTKernels::select_indices_sse2(const uint32_t* pixels, const uint32_t* palette, uint32_t paletteSize,
+                                       const uint8_t* alphas, uint8_t* colorIndices, uint8_t* alphaIndices)
+{
+#ifdef HAVE_SSE2
+    __m128i refRG[4], refB[4];
+    for (uint32_t i = 0; i < paletteSize; i++)
+        ISplitRGB(_mm_set1_epi32(static_cast<int>(palette[i])), refRG[i], refB[i]);
+
+    __m128i index[4];
+    for (int k = 0; k < 4; k++) {
+        __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + (k << 2)));
+        __m128i rg, b;
+        ISplitRGB(p, rg, b);
+
+        __m128i best = IDistance(rg, b, refRG[0], refB[0]);
+        index[k] = _mm_setzero_si128();
+        for (uint32_t i = 1; i < paletteSize; i++) {
+            __m128i d = IDistance(rg, b, refRG[i], refB[i]);
+            __m128i closer = _mm_cmpgt_epi32(best, d);
+            best = ISelect(closer, d, best);
+            index[k] = ISelect(closer, _mm_set1_epi32(i), index[k]);
+        }
+
+        if (paletteSize == 3) {
+            __m128i clear = _mm_cmpeq_epi32(_mm_srli_epi32(p, 24), _mm_setzero_si128());
+            index[k] = ISelect(clear, _mm_set1_epi32(3), index[k]);
+        }
+    }
+    __m128i packed = _mm_packus_epi16(_mm_packs_epi32(index[0], index[1]), _mm_packs_epi32(index[2], index[3]));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(colorIndices), packed);
+
+    if (!alphas) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(alphaIndices), _mm_setzero_si128());
+        return;
+    }
+
+    // Alphas as 16-bit lanes, pixels 0-7 and 8-15
+    __m128i a[2], aIndex[2];
+    for (int k = 0; k < 2; k++) {
+        __m128i lo = _mm_srli_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + (k << 3))), 24);
+        __m128i hi = _mm_srli_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + (k << 3) + 4)), 24);
+        a[k] = _mm_packs_epi32(lo, hi);
+    }
+    for (int k = 0; k < 2; k++) {
+        __m128i ref = _mm_set1_epi16(alphas[0]);
+        __m128i best = _mm_max_epi16(_mm_sub_epi16(a[k], ref), _mm_sub_epi16(ref, a[k]));
+        aIndex[k] = _mm_setzero_si128();
+        for (int i = 1; i < 8; i++) {
+            ref = _mm_set1_epi16(alphas[i]);
+            __m128i d = _mm_max_epi16(_mm_sub_epi16(a[k], ref), _mm_sub_epi16(ref, a[k]));
+            __m128i closer = _mm_cmpgt_epi16(best, d);
+            best = _mm_min_epi16(best, d);
+            aIndex[k] = ISelect(closer, _mm_set1_epi16(i), aIndex[k]);
+        }
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(alphaIndices), _mm_packus_epi16(aIndex[0], aIndex[1]));
+#else
+    select_indices_fpu(pixels, palette, paletteSize, alphas, colorIndices, alphaIndices);
+#endif
+}
@@ -43,9 +43,14 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "HeadSpin.h"
 #include "hsColorRGBA.h"
 #include "hsDXTSoftwareCodec.h"
+#include "hsDXTKernels.h"
 #include "plMipmap.h"
 #include "hsCodecManager.h"
 
+#include <algorithm>
+#include <thread>
+#include <vector>
+
 #define SWAPVARS( x, y, t ) { t = x; x = y; y = t; }
 
 // This is the color depth that we decompress to by default if we're not told otherwise
@@ -62,6 +67,7 @@ hsDXTSoftwareCodec& hsDXTSoftwareCodec::Instance()
 }
 
 hsDXTSoftwareCodec::hsDXTSoftwareCodec()
+    : fNumThreads()
 {
 }
 
@@ -886,157 +892,28 @@ void    hsDXTSoftwareCodec::IUncompressMipmapDXT5To16Weird( plMipmap *destBMap,
 
 void    hsDXTSoftwareCodec::IUncompressMipmapDXT5To32( plMipmap *destBMap, plMipmap *srcBMap )
 {
-    uint16_t      *srcData;
-    uint32_t      *destData, destBlock[ 16 ];
-    uint32_t      blockSize;
-    uint32_t      x, y, bMapStride;
-    uint32_t      colors[ 4 ];
-    int32_t       numBlocks, i, j;
-    uint8_t       *bytePtr;
-    uint32_t      alphas[ 8 ], aTemp, a0, a1;
-
-    uint32_t      aBitSrc1, aBitSrc2;
-    uint16_t      cBitSrc1, cBitSrc2;
-
-
     /// Setup some nifty stuff
     hsAssert( ( srcBMap->GetCurrWidth() & 3 ) == 0, "Bitmap width must be multiple of 4" );
     hsAssert( ( srcBMap->GetCurrHeight() & 3 ) == 0, "Bitmap height must be multiple of 4" );
-    numBlocks = ( srcBMap->GetCurrWidth() * srcBMap->GetCurrHeight() ) >> 4;
+    if( srcBMap->fDirectXInfo.fBlockSize != hsDXTKernels::BlockSize( hsDXTKernels::kDXT5 ) )
+    {
+        // The block kernels step by the standard block size, so anything else would run off the level
+        hsAssert( false, "Unexpected DXT5 block size" );
+        return;
+    }
 
-    blockSize = srcBMap->fDirectXInfo.fBlockSize >> 1; // In 16-bit words
-    srcData = (uint16_t *)srcBMap->GetCurrLevelPtr();
+    const uint8_t *srcData = (const uint8_t *)srcBMap->GetCurrLevelPtr();
+    uint32_t *destData = destBMap->GetAddr32( 0, 0 );
     // Note our trick here to make sure nothing breaks if GetAddr32's 
     // formula changes
-    bMapStride = (uint32_t)( destBMap->GetAddr32( 0, 1 ) - destBMap->GetAddr32( 0, 0 ) );
-    x = y = 0;
-
+    uint32_t bMapStride = (uint32_t)( destBMap->GetAddr32( 0, 1 ) - destBMap->GetAddr32( 0, 0 ) );
+    uint32_t widthBlocks = srcBMap->GetCurrWidth() >> 2;
 
-    /// Loop through the # of blocks (width*height / 16-pixel-blocks)
-    for( i = 0; i < numBlocks; i++ )
-    {
-        /// Per block--determine alpha compression type first
-        bytePtr = (uint8_t *)srcData;
-        alphas[ 0 ] = bytePtr[ 0 ];
-        alphas[ 1 ] = bytePtr[ 1 ];
-
-        /// Note that we use the preshifted alphas really as fixed point.
-        /// The result: more accuracy, and no need to shift the alphas afterwards
-        if( alphas[ 0 ] > alphas[ 1 ] )
+    IForEachBlockRowBand( srcBMap->GetCurrHeight() >> 2, widthBlocks, kMinParallelDecodeBlocks,
+        [=]( uint32_t rowBegin, uint32_t rowEnd )
         {
-            /// 8-alpha block: interpolate 6 others
-/*          //// Here's the old code, for reference ////
-            alphas[ 2 ] = ( 6 * alphas[ 0 ] +     alphas[ 1 ] ) / 7;
-            alphas[ 3 ] = ( 5 * alphas[ 0 ] + 2 * alphas[ 1 ] ) / 7;
-            alphas[ 4 ] = ( 4 * alphas[ 0 ] + 3 * alphas[ 1 ] ) / 7;
-            alphas[ 5 ] = ( 3 * alphas[ 0 ] + 4 * alphas[ 1 ] ) / 7;
-            alphas[ 6 ] = ( 2 * alphas[ 0 ] + 5 * alphas[ 1 ] ) / 7;
-            alphas[ 7 ] = (     alphas[ 0 ] + 6 * alphas[ 1 ] ) / 7;
-*/
-            alphas[ 0 ] <<= 24;
-            alphas[ 1 ] <<= 24;
-
-            /// Note that, unlike below, we can't combine a0 and a1 into
-            /// one value, because that would give us a negative value,
-            /// and we're using unsigned values here. (i.e. we need all the bits)
-            aTemp = alphas[ 0 ];
-            a0 = ( aTemp / 7 ) & 0xff000000;
-            a1 = ( alphas[ 1 ] / 7 ) & 0xff000000;          
-            for( j = 2; j < 8; j++ )
-            {
-                aTemp += a1 - a0;
-                alphas[ j ] = aTemp;
-            }
-        }
-        else
-        {
-            /// 6-alpha block: interpolate 4 others, then assume last 2 are 0 and 255
-/*          //// Here's the old code, for reference ////
-            alphas[ 2 ] = ( 4 * alphas[ 0 ] +     alphas[ 1 ] ) / 5;
-            alphas[ 3 ] = ( 3 * alphas[ 0 ] + 2 * alphas[ 1 ] ) / 5;
-            alphas[ 4 ] = ( 2 * alphas[ 0 ] + 3 * alphas[ 1 ] ) / 5;
-            alphas[ 5 ] = (     alphas[ 0 ] + 4 * alphas[ 1 ] ) / 5;
-*/
-            alphas[ 0 ] <<= 24;
-            alphas[ 1 ] <<= 24;
-
-            aTemp = alphas[ 0 ];
-            a0 = ( alphas[ 1 ] - aTemp ) / 5;
-            for( j = 2; j < 6; j++ )
-            {
-                aTemp += a0;
-                alphas[ j ] = aTemp & 0xff000000;
-            }
-
-            alphas[ 6 ] = 0;
-            alphas[ 7 ] = 255 << 24;
-        }
-
-        /// Now do the 16 pixels in 2 blocks, decompressing 3-bit lookups
-        aBitSrc1 = ( (uint32_t)bytePtr[ 4 ] << 16 ) + 
-                    ( (uint32_t)bytePtr[ 3 ] << 8 ) + 
-                    ( (uint32_t)bytePtr[ 2 ] );
-        aBitSrc2 = ( (uint32_t)bytePtr[ 7 ] << 16 ) + 
-                    ( (uint32_t)bytePtr[ 6 ] << 8 ) + 
-                    ( (uint32_t)bytePtr[ 5 ] );
-
-        /// Now decompress color data
-        srcData += 4;       // Alpha was 4 16-bit words worth
-        //hsAssert( srcData[ 0 ] > srcData[ 1 ], "Invalid block compression for DX5 method" );  /// If not, then it's one-bit
-                                                /// alpha, but this is DX5!
-        colors[ 0 ] = IRGB16To32Bit( srcData[ 0 ] );
-        colors[ 1 ] = IRGB16To32Bit( srcData[ 1 ] );
-        colors[ 2 ] = IMixTwoThirdsRGB32( colors[ 0 ], colors[ 1 ] );
-        colors[ 3 ] = IMixTwoThirdsRGB32( colors[ 1 ], colors[ 0 ] );
-        
-        cBitSrc1 = hsToLE16( srcData[ 2 ] );
-        cBitSrc2 = hsToLE16( srcData[ 3 ] );
-        
-        for( j = 0; j < 8; j++ )
-        {
-            destBlock[ j ] = alphas[ aBitSrc1 & 0x07 ] | colors[ cBitSrc1 & 0x03 ];
-            aBitSrc1 >>= 3;
-            cBitSrc1 >>= 2;
-            destBlock[ j + 8 ] = alphas[ aBitSrc2 & 0x07 ] | colors[ cBitSrc2 & 0x03 ];
-            aBitSrc2 >>= 3;
-            cBitSrc2 >>= 2;
-
-            destBlock[ j ] = hsToLE32( destBlock[ j ] );
-            destBlock[ j + 8 ] = hsToLE32( destBlock[ j + 8 ] );
-        }
-        
-        /// Now copy the block to the destination bitmap
-        /// (Trust me, this is actually *faster* than memcpy for some reason
-        destData = destBMap->GetAddr32( x, y );
-        destData[ 0 ] = destBlock[ 0 ];
-        destData[ 1 ] = destBlock[ 1 ];
-        destData[ 2 ] = destBlock[ 2 ];
-        destData[ 3 ] = destBlock[ 3 ];
-        destData += bMapStride;
-        destData[ 0 ] = destBlock[ 4 ];
-        destData[ 1 ] = destBlock[ 5 ];
-        destData[ 2 ] = destBlock[ 6 ];
-        destData[ 3 ] = destBlock[ 7 ];
-        destData += bMapStride;
-        destData[ 0 ] = destBlock[ 8 ];
-        destData[ 1 ] = destBlock[ 9 ];
-        destData[ 2 ] = destBlock[ 10 ];
-        destData[ 3 ] = destBlock[ 11 ];
-        destData += bMapStride;
-        destData[ 0 ] = destBlock[ 12 ];
-        destData[ 1 ] = destBlock[ 13 ];
-        destData[ 2 ] = destBlock[ 14 ];
-        destData[ 3 ] = destBlock[ 15 ];
-
-        /// Increment and loop!
-        srcData += blockSize - 4;       /// JUUUST in case our block size is diff
-        x += 4;
-        if( x == srcBMap->GetCurrWidth() )
-        {
-            x = 0;
-            y += 4;
-        }
-    }
+            hsDXTKernels::DecodeRows( hsDXTKernels::kDXT5, srcData, destData, bMapStride, widthBlocks, rowBegin, rowEnd );
+        } );
 }
 
 //// IUncompressMipmapDXT5ToAInten ////////////////////////////////////////////
@@ -1399,96 +1276,28 @@ void    hsDXTSoftwareCodec::IUncompressMipmapDXT1To16Weird( plMipmap *destBMap,
 void    hsDXTSoftwareCodec::IUncompressMipmapDXT1To32( plMipmap *destBMap, 
                                                    plMipmap *srcBMap )
 {
-    uint16_t      *srcData, tempW1, tempW2;
-    uint32_t      *destData, destBlock[ 16 ];
-    uint32_t      blockSize;
-    uint32_t      bitSource, bitSource2, x, y, bMapStride;
-    uint32_t      colors[ 4 ];
-    int32_t       numBlocks, i, j;
-
-
     /// Setup some nifty stuff
     hsAssert( ( srcBMap->GetCurrWidth() & 3 ) == 0, "Bitmap width must be multiple of 4" );
     hsAssert( ( srcBMap->GetCurrHeight() & 3 ) == 0, "Bitmap height must be multiple of 4" );
-    numBlocks = ( srcBMap->GetCurrWidth() * srcBMap->GetCurrHeight() ) >> 4;
+    if( srcBMap->fDirectXInfo.fBlockSize != hsDXTKernels::BlockSize( hsDXTKernels::kDXT1 ) )
+    {
+        // The block kernels step by the standard block size, so anything else would run off the level
+        hsAssert( false, "Unexpected DXT1 block size" );
+        return;
+    }
 
-    blockSize = srcBMap->fDirectXInfo.fBlockSize >> 1; // In 16-bit words
-    srcData = (uint16_t *)srcBMap->GetCurrLevelPtr();
+    const uint8_t *srcData = (const uint8_t *)srcBMap->GetCurrLevelPtr();
+    uint32_t *destData = destBMap->GetAddr32( 0, 0 );
     // Note our trick here to make sure nothing breaks if GetAddr32's 
     // formula changes
-    bMapStride = (uint32_t)( destBMap->GetAddr32( 0, 1 ) - destBMap->GetAddr32( 0, 0 ) );
-    x = y = 0;
-
-
-    /// Loop through the # of blocks (width*height / 16-pixel-blocks)
-    for( i = 0; i < numBlocks; i++ )
-    {
-        /// Decompress color data block
-        colors[ 0 ] = IRGB16To32Bit( srcData[ 0 ] ) | 0xff000000;
-        colors[ 1 ] = IRGB16To32Bit( srcData[ 1 ] ) | 0xff000000;
-
-        tempW1 = hsToLE16( srcData[ 0 ] );
-        tempW2 = hsToLE16( srcData[ 1 ] );
-
-        if( tempW1 > tempW2 )
-        {
-            /// Four-color block--mix the other two
-            colors[ 2 ] = IMixTwoThirdsRGB32( colors[ 0 ], colors[ 1 ] ) | 0xff000000;
-            colors[ 3 ] = IMixTwoThirdsRGB32( colors[ 1 ], colors[ 0 ] ) | 0xff000000;
-        }
-        else
-        {
-            /// Three-color block and transparent
-            colors[ 2 ] = IMixEqualRGB32( colors[ 0 ], colors[ 1 ] ) | 0xff000000;
-            colors[ 3 ] = 0;
-        }
-
-        bitSource = hsToLE16( srcData[ 2 ] );
-        bitSource2 = hsToLE16( srcData[ 3 ] );
-
-        for( j = 0; j < 8; j++ )
-        {
-            destBlock[ j ] = colors[ bitSource & 0x03 ];
-            bitSource >>= 2;
-            destBlock[ j + 8 ] = colors[ bitSource2 & 0x03 ];
-            bitSource2 >>= 2;
-
-            destBlock[ j ] = hsToLE32( destBlock[ j ] );
-            destBlock[ j + 8 ] = hsToLE32( destBlock[ j + 8 ] );
-        }
-        
-        /// Now copy the block to the destination bitmap
-        /// (Trust me, this is actually *faster* than memcpy for some reason
-        destData = destBMap->GetAddr32( x, y );
-        destData[ 0 ] = destBlock[ 0 ];
-        destData[ 1 ] = destBlock[ 1 ];
-        destData[ 2 ] = destBlock[ 2 ];
-        destData[ 3 ] = destBlock[ 3 ];
-        destData += bMapStride;
-        destData[ 0 ] = destBlock[ 4 ];
-        destData[ 1 ] = destBlock[ 5 ];
-        destData[ 2 ] = destBlock[ 6 ];
-        destData[ 3 ] = destBlock[ 7 ];
-        destData += bMapStride;
-        destData[ 0 ] = destBlock[ 8 ];
-        destData[ 1 ] = destBlock[ 9 ];
-        destData[ 2 ] = destBlock[ 10 ];
-        destData[ 3 ] = destBlock[ 11 ];
-        destData += bMapStride;
-        destData[ 0 ] = destBlock[ 12 ];
-        destData[ 1 ] = destBlock[ 13 ];
-        destData[ 2 ] = destBlock[ 14 ];
-        destData[ 3 ] = destBlock[ 15 ];
+    uint32_t bMapStride = (uint32_t)( destBMap->GetAddr32( 0, 1 ) - destBMap->GetAddr32( 0, 0 ) );
+    uint32_t widthBlocks = srcBMap->GetCurrWidth() >> 2;
 
-        /// Increment and loop!
-        srcData += blockSize;
-        x += 4;
-        if( x == srcBMap->GetCurrWidth() )
+    IForEachBlockRowBand( srcBMap->GetCurrHeight() >> 2, widthBlocks, kMinParallelDecodeBlocks,
+        [=]( uint32_t rowBegin, uint32_t rowEnd )
         {
-            x = 0;
-            y += 4;
-        }
-    }
+            hsDXTKernels::DecodeRows( hsDXTKernels::kDXT1, srcData, destData, bMapStride, widthBlocks, rowBegin, rowEnd );
+        } );
 }
 
 //// IUncompressMipmapDXT1ToInten /////////////////////////////////////////////
@@ -1927,292 +1736,63 @@ uint8_t   hsDXTSoftwareCodec::IMixEqualInten( uint8_t color1, uint8_t color2 )
 
 void hsDXTSoftwareCodec::CompressMipmapLevel( plMipmap *uncompressed, plMipmap *compressed )
 {
-    uint32_t *compressedImage = (uint32_t *)compressed->GetCurrLevelPtr();
-    int32_t x, y;
-    int32_t xMax = uncompressed->GetCurrWidth() >> 2;
-    int32_t yMax = uncompressed->GetCurrHeight() >> 2;
-    for (x = 0; x < xMax; ++x)
+    hsDXTKernels::Format format;
+    if( compressed->fDirectXInfo.fCompressionType == plMipmap::DirectXInfo::kDXT5 )
+        format = hsDXTKernels::kDXT5;
+    else if( compressed->fDirectXInfo.fCompressionType == plMipmap::DirectXInfo::kDXT1 )
+        format = hsDXTKernels::kDXT1;
+    else
     {
-        for (y = 0; y < yMax; ++y)
-        {
-            uint8_t maxAlpha = 0;
-            uint8_t minAlpha = 255;
-            uint8_t oldMaxAlpha = 0;
-            uint8_t oldMinAlpha = 255;
-            uint8_t alpha[8];
-            int32_t maxDistance = 0;
-            hsRGBAColor32 color[4];
-            bool hasTransparency = false;
-
-            int32_t xx, yy;
-            for (xx = 0; xx < 4; ++xx)
-            {
-                for (yy = 0; yy < 4; ++yy)
-                {
-                    hsRGBAColor32* pixel = (hsRGBAColor32*)uncompressed->GetAddr32(4 * x + xx, 4 * y + yy);
-                    uint8_t pixelAlpha = pixel->a;
-                    if (pixelAlpha != 255)
-                    {
-                        hasTransparency = true;
-                    }
-
-                    if (compressed->fDirectXInfo.fCompressionType == plMipmap::DirectXInfo::kDXT5)
-                    {
-                        if (pixelAlpha > maxAlpha)
-                        {
-                            maxAlpha = pixelAlpha;
-                        }
-                        
-                        if ((pixelAlpha > oldMaxAlpha) && (pixelAlpha < 255))
-                        {
-                            oldMaxAlpha = pixelAlpha;
-                        }
-
-                        if (pixelAlpha < minAlpha)
-                        {
-                            minAlpha = pixelAlpha;
-                        }
+        hsAssert( false, "Unrecognized compression scheme." );
+        return;
+    }
+    if( compressed->fDirectXInfo.fBlockSize != hsDXTKernels::BlockSize( format ) )
+    {
+        // The block kernels step by the standard block size, so anything else would run off the level
+        hsAssert( false, "Unexpected DXT block size" );
+        return;
+    }
 
-                        if ((pixelAlpha < oldMinAlpha) && (pixelAlpha > 0))
-                        {
-                            oldMinAlpha = minAlpha;
-                        }
-                    }
-                    
-                    int32_t xx2, yy2;
-                    for (xx2 = 0; xx2 < 4; ++xx2)
-                    {
-                        for (yy2 = 0; yy2 < 4; ++yy2)
-                        {
-                            hsRGBAColor32* pixel1 = (hsRGBAColor32*)uncompressed->GetAddr32(4 * x + xx, 4 * y + yy);
-                            hsRGBAColor32* pixel2 = (hsRGBAColor32*)uncompressed->GetAddr32(4 * x + xx2, 4 * y + yy2);
-                            
-                            int32_t distance = ColorDistanceARGBSquared(*pixel1, *pixel2);
-                            if (distance >= maxDistance)
-                            {
-                                maxDistance = distance;
-                                color[0] = *pixel1;
-                                color[1] = *pixel2;
-                            }
-                        } // for yy2
-                    } // for xx2
-                } // for yy
-            } // for xx
-            
-            if (oldMinAlpha == 255)
-            {
-                hsAssert(oldMaxAlpha == 0, "Weirdness in oldMaxAlpha hsDXTSoftwareCodec::CompressBitmap.");
-                oldMinAlpha = 0;
-                oldMaxAlpha = 255;
-            }
+    const uint32_t *srcData = uncompressed->GetAddr32( 0, 0 );
+    uint32_t srcStride = (uint32_t)( uncompressed->GetAddr32( 0, 1 ) - uncompressed->GetAddr32( 0, 0 ) );
+    uint8_t *destData = (uint8_t *)compressed->GetCurrLevelPtr();
+    uint32_t widthBlocks = uncompressed->GetCurrWidth() >> 2;
 
-            if (compressed->fDirectXInfo.fCompressionType == plMipmap::DirectXInfo::kDXT5)
-            {
-                if ((maxAlpha == 255) && (minAlpha == 0))
-                {
-                    hsAssert(oldMinAlpha <= oldMaxAlpha, "Min > Max in hsDXTSoftwareCodec::CompressBitmap 1.");
-                    alpha[0] = oldMinAlpha;
-                    alpha[1] = oldMaxAlpha;
-                    alpha[2] = (4 * alpha[0] + alpha[1]) / 5;      // Bit code 010
-                    alpha[3] = (3 * alpha[0] + 2 * alpha[1]) / 5;  // Bit code 011    
-                    alpha[4] = (2 * alpha[0] + 3 * alpha[1]) / 5;  // Bit code 100    
-                    alpha[5] = (alpha[0] + 4 * alpha[1]) / 5;      // Bit code 101
-                    alpha[6] = 0;                                // Bit code 110
-                    alpha[7] = 255;                              // Bit code 111
-                }
-                else if (maxAlpha == minAlpha)
-                {
-                    alpha[0] = minAlpha;
-                    alpha[1] = maxAlpha;
-                    alpha[2] = (4 * alpha[0] + alpha[1]) / 5;      // Bit code 010
-                    alpha[3] = (3 * alpha[0] + 2 * alpha[1]) / 5;  // Bit code 011    
-                    alpha[4] = (2 * alpha[0] + 3 * alpha[1]) / 5;  // Bit code 100    
-                    alpha[5] = (alpha[0] + 4 * alpha[1]) / 5;      // Bit code 101
-                    alpha[6] = 0;                                // Bit code 110
-                    alpha[7] = 255;                              // Bit code 111
-                }
-                else
-                {
-                    hsAssert(minAlpha < maxAlpha, "Min => Max in hsDXTSoftwareCodec::CompressBitmap 3.");
-                    alpha[0] = maxAlpha;
-                    alpha[1] = minAlpha;
-                    alpha[2] = (6 * alpha[0] + alpha[1]) / 7;      // bit code 010
-                    alpha[3] = (5 * alpha[0] + 2 * alpha[1]) / 7;  // Bit code 011    
-                    alpha[4] = (4 * alpha[0] + 3 * alpha[1]) / 7;  // Bit code 100    
-                    alpha[5] = (3 * alpha[0] + 4 * alpha[1]) / 7;  // Bit code 101
-                    alpha[6] = (2 * alpha[0] + 5 * alpha[1]) / 7;  // Bit code 110    
-                    alpha[7] = (alpha[0] + 6 * alpha[1]) / 7;      // Bit code 111
-                }
-            }
-            
-            uint32_t encoding;
-            uint16_t shortColor[2];
-            shortColor[0] = Color32To16(color[0]);
-            shortColor[1] = Color32To16(color[1]);
-            if ((shortColor[0] == shortColor[1]) ||
-                ((compressed->fDirectXInfo.fCompressionType == plMipmap::DirectXInfo::kDXT1) &&
-                hasTransparency))
-            {
-                encoding = kThreeColorEncoding;
-
-                if (shortColor[0] > shortColor[1])
-                {
-                    uint16_t temp = shortColor[1];
-                    shortColor[1] = shortColor[0];
-                    shortColor[0] = temp;
-                    
-                    hsRGBAColor32 temp32 = color[1];
-                    color[1] = color[0];
-                    color[0] = temp32;
-                }
+    IForEachBlockRowBand( uncompressed->GetCurrHeight() >> 2, widthBlocks, kMinParallelEncodeBlocks,
+        [=]( uint32_t rowBegin, uint32_t rowEnd )
+        {
+            hsDXTKernels::EncodeRows( format, srcData, srcStride, destData, widthBlocks, rowBegin, rowEnd );
+        } );
+}
 
-                color[2] = BlendColors32(1, color[0], 1, color[1]);
+//// IForEachBlockRowBand /////////////////////////////////////////////////////
+//  Splits a level's block rows into one band per thread and runs fn on each.
+//  Levels smaller than minParallelBlocks just run on the calling thread, as
+//  starting the threads would cost more than it saves.
 
-                hsRGBAColor32 black;
-                black.Set(0, 0, 0, 0);
+void hsDXTSoftwareCodec::IForEachBlockRowBand( uint32_t numBlockRows, uint32_t blocksPerRow, uint32_t minParallelBlocks,
+                                               const std::function<void(uint32_t, uint32_t)>& fn )
+{
+    uint32_t numThreads = fNumThreads;
+    if( numThreads == 0 )
+        numThreads = std::max( std::thread::hardware_concurrency(), 1U );
+    numThreads = std::min( numThreads, numBlockRows );
 
-                color[3] = black;
-            }
-            else
-            {
-                encoding = kFourColorEncoding;
+    if( numThreads <= 1 || numBlockRows * blocksPerRow < minParallelBlocks )
+    {
+        fn( 0, numBlockRows );
+        return;
+    }
 
-                if (shortColor[0] < shortColor[1])
-                {
-                    uint16_t temp = shortColor[1];
-                    shortColor[1] = shortColor[0];
-                    shortColor[0] = temp;
-                    
-                    hsRGBAColor32 temp32 = color[1];
-                    color[1] = color[0];
-                    color[0] = temp32;
-                }
+    std::vector<std::thread> threads;
+    threads.reserve( numThreads - 1 );
+    for( uint32_t i = 1; i < numThreads; i++ )
+        threads.emplace_back( fn, numBlockRows * i / numThreads, numBlockRows * ( i + 1 ) / numThreads );
 
-                color[2] = BlendColors32(2, color[0], 1, color[1]);
-                color[3] = BlendColors32(1, color[0], 2, color[1]);
-            }
-            
-            // Process each pixel in block
-            uint32_t blockSize = compressed->fDirectXInfo.fBlockSize;
-            uint32_t *block = &compressedImage[(x + xMax * y) * (blockSize >> 2)];
-            uint8_t *byteBlock = (uint8_t *)block;
-            uint8_t *alphaBlock = nullptr;
-            uint16_t *colorBlock = nullptr;
-            if (compressed->fDirectXInfo.fCompressionType == plMipmap::DirectXInfo::kDXT5)
-            {
-                alphaBlock = byteBlock;
-                colorBlock = (uint16_t *)(byteBlock + 8);
-                alphaBlock[0] = 0;
-                alphaBlock[1] = 0;
-                alphaBlock[2] = 0;
-                alphaBlock[3] = 0;
-                alphaBlock[4] = 0;
-                alphaBlock[5] = 0;
-                alphaBlock[6] = 0;
-                alphaBlock[7] = 0;
-            }
-            else if (compressed->fDirectXInfo.fCompressionType == plMipmap::DirectXInfo::kDXT1)
-            {
-                alphaBlock = nullptr;
-                colorBlock = (uint16_t *)(byteBlock);
-            }
-            else
-            {
-                hsAssert(false, "Unrecognized compression scheme.");
-            }
-            
-            colorBlock[0] = 0;
-            colorBlock[1] = 0;
-            colorBlock[2] = 0;
-            colorBlock[3] = 0;
-            for (xx = 0; xx < 4; ++xx)
-            {
-                for (yy = 0; yy < 4; ++yy)
-                {
-                    hsRGBAColor32* pixel = (hsRGBAColor32*)uncompressed->GetAddr32(4 * x + xx, 4 * y + yy);
-                    uint8_t pixelAlpha = pixel->a;
-                    if (alphaBlock)
-                    {
-                        uint32_t alphaIndex = 0;
-                        uint32_t alphaDistance = abs(pixelAlpha - alpha[0]);
-                        
-                        int32_t i;
-                        for (i = 1; i < 8; i++)
-                        {
-                            uint32_t distance = abs(pixelAlpha - alpha[i]);
-                            if (distance < alphaDistance)
-                            {
-                                alphaIndex = i;
-                                alphaDistance = distance;
-                            }
-                        }
-                        
-                        if (yy < 2)
-                        {
-                            uint32_t alphaShift = 3 * (4 * yy + xx);
-                            uint32_t threeAlphaBytes = alphaIndex << alphaShift;
-                            alphaBlock[2] |= (threeAlphaBytes & 0xff);
-                            alphaBlock[3] |= ((threeAlphaBytes >> 8) & 0xff);
-                            alphaBlock[4] |= ((threeAlphaBytes >> 16) & 0xff);
-                        }
-                        else
-                        {
-                            uint32_t alphaShift = 3 * (4 * (yy - 2) + xx);
-                            uint32_t threeAlphaBytes = alphaIndex << alphaShift;
-                            alphaBlock[5] |= (threeAlphaBytes & 0xff);
-                            alphaBlock[6] |= ((threeAlphaBytes >> 8) & 0xff);
-                            alphaBlock[7] |= ((threeAlphaBytes >> 16) & 0xff);
-                        }
-                    }
-                    
-                    uint32_t colorIndex = 0;
-                    uint32_t colorDistance = ColorDistanceARGBSquared(*pixel, color[0]);
-                    
-                    if ((encoding == kThreeColorEncoding) &&
-                        (pixelAlpha == 0))
-                    {
-                        colorIndex = 3;
-                    }
-                    else
-                    {
-                        int32_t i;
-                        int32_t colorMax = (encoding == kThreeColorEncoding) ? 3 : 4;
-                        for (i = 1; i < colorMax; i++)
-                        {
-                            uint32_t distance = ColorDistanceARGBSquared(*pixel, color[i]);
-                            if (distance < colorDistance)
-                            {
-                                colorIndex = i;
-                                colorDistance = distance;
-                            }
-                        }
-                    }
+    fn( 0, numBlockRows / numThreads );
 
-                    if (yy < 2)
-                    {
-                        uint32_t colorShift = 2 * (4 * yy + xx);
-                        uint16_t colorWord = (uint16_t)(colorIndex << colorShift);
-                        colorBlock[2] |= colorWord;
-                    }
-                    else
-                    {
-                        uint32_t colorShift = 2 * (4 * (yy - 2) + xx);
-                        uint16_t colorWord = (uint16_t)(colorIndex << colorShift);
-                        colorBlock[3] |= colorWord;
-                    }
-                } // for yy
-            } // for xx
-            
-            if (alphaBlock)
-            {
-                alphaBlock[0] = alpha[0];
-                alphaBlock[1] = alpha[1];
-            }
-            
-            colorBlock[0] = shortColor[0];
-            colorBlock[1] = shortColor[1];
-        } // for y
-    } // for x
+    for( std::thread& thread : threads )
+        thread.join();
 }
 
 uint16_t hsDXTSoftwareCodec::BlendColors16(uint16_t weight1, uint16_t color1, uint16_t weight2, uint16_t color2)
@@ -2236,43 +1816,6 @@ uint16_t hsDXTSoftwareCodec::BlendColors16(uint16_t weight1, uint16_t color1, ui
 }
 
 
-hsRGBAColor32 hsDXTSoftwareCodec::BlendColors32(uint32_t weight1, hsRGBAColor32 color1, 
-                                         uint32_t weight2, hsRGBAColor32 color2)
-{
-    hsRGBAColor32 result;
-
-    result.r = static_cast<uint8_t>((color1.r * weight1 + color2.r * weight2)/(weight1 + weight2));
-    result.g = static_cast<uint8_t>((color1.g * weight1 + color2.g * weight2)/(weight1 + weight2));
-    result.b = static_cast<uint8_t>((color1.b * weight1 + color2.b * weight2)/(weight1 + weight2));
-
-    return result;
-}
-
-
-int32_t hsDXTSoftwareCodec::ColorDistanceARGBSquared(hsRGBAColor32 color1, hsRGBAColor32 color2)
-{
-    int32_t r1, g1, b1;
-    int32_t r2, g2, b2;
-
-    r1 = color1.r;
-    r2 = color2.r;
-    g1 = color1.g;
-    g2 = color2.g;
-    b1 = color1.b;
-    b2 = color2.b;
-
-    return (r1 - r2) * (r1 - r2) + (g1 - g2) * (g1 - g2) + (b1 - b2) * (b1 - b2);
-}
-
-uint16_t hsDXTSoftwareCodec::Color32To16(hsRGBAColor32 color)
-{
-    uint8_t r = (uint8_t)(color.r & 0xf8);
-    uint8_t g = (uint8_t)(color.g & 0xfc);
-    uint8_t b = (uint8_t)(color.b & 0xf8);
-
-    return (r << 8) | (g << 3) | (b >> 3);
-}
-
 bool hsDXTSoftwareCodec::Register()
 {
     return hsCodecManager::Instance().Register(&(Instance()), plMipmap::kDirectXCompression, 100);
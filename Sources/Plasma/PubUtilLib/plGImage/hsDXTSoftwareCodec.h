@@ -45,6 +45,8 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "HeadSpin.h"
 #include "hsCodec.h"
 
+#include <functional>
+
 class plMipmap;
 typedef struct hsColor32 hsRGBAColor32;
 
@@ -66,6 +68,11 @@ public:
     // Colorize a compressed mipmap
     bool    ColorizeCompMipmap(plMipmap *bMap, const uint8_t *colorMask) override;
 
+    // Number of threads used to compress and decompress large levels.
+    // 0 (the default) uses one per core; 1 keeps everything on the caller.
+    void        SetNumThreads(uint32_t numThreads) { fNumThreads = numThreads; }
+    uint32_t    GetNumThreads() const { return fNumThreads; }
+
 private:
     enum {
         kFourColorEncoding,
@@ -75,9 +82,17 @@ private:
     void    CompressMipmapLevel( plMipmap *uncompressed, plMipmap *compressed );
 
     uint16_t BlendColors16(uint16_t weight1, uint16_t color1, uint16_t weight2, uint16_t color2);
-    hsRGBAColor32 BlendColors32(uint32_t weight1, hsRGBAColor32 color1, uint32_t weight2, hsRGBAColor32 color2);
-    int32_t ColorDistanceARGBSquared(hsRGBAColor32 color1, hsRGBAColor32 color2);
-    uint16_t Color32To16(hsRGBAColor32 color);
+
+    // Levels with fewer blocks than these stay on one thread
+    enum
+    {
+        kMinParallelEncodeBlocks = 32 * 32,
+        kMinParallelDecodeBlocks = 128 * 128
+    };
+
+    // Runs fn over bands of block rows, in parallel for large levels
+    void    IForEachBlockRowBand(uint32_t numBlockRows, uint32_t blocksPerRow, uint32_t minParallelBlocks,
+                                 const std::function<void(uint32_t, uint32_t)>& fn);
 
     // Calculates the DXT format based on a mipmap
     uint8_t   ICalcCompressedFormat( plMipmap *bMap );
@@ -149,6 +164,8 @@ private:
 
     static bool Register();
     static bool fRegistered;
+
+    uint32_t    fNumThreads;
 };
 
 #endif // __HSDXTSOFTWARECODEC_H
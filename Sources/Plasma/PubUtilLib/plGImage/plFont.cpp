@@ -63,10 +63,13 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "HeadSpin.h"
+#include <functional>
 #include <string>
+#include <string_view>
 
 #include "plFont.h"
 
+#include "plFontKernels.h"
 #include "plMipmap.h"
 #include "hsResMgr.h"
 
@@ -128,6 +131,7 @@ void    plFont::IClear( bool onConstruct )
     fFirstChar = 0;
     fMaxCharHeight = 0;
     fCharacters.clear();
+    fWrapLayouts.clear();
 
     fRenderInfo.fFlags = 0;
     fRenderInfo.fX = fRenderInfo.fY = fRenderInfo.fNumCols = 0;
@@ -393,11 +397,12 @@ void    plFont::IRenderString( plMipmap *mip, uint16_t x, uint16_t y, const wcha
     if( fRenderInfo.fFlags & kRenderWrap )
     {
         // Hell, gotta uint16_t wrap the text
-        // To avoid backtracking, we step forward in the string one uint16_t at a time until we hit a break,
-        // then render what we have and continue
-        int32_t lastWord = 0, i;
+        // The line breaks come from IGetWrapLayout(), so all we have to do here
+        // is render each line and advance down
+        const plWrapLayout &layout = IGetWrapLayout( string, fRenderInfo.fMaxWidth, fRenderInfo.fFirstLineIndent );
+        const wchar_t *base = string;
+        size_t line = 0;
         bool isFirstLine = true;
-        x = 0;
         int16_t firstMaxAscent = 0;
         uint32_t lineHt, lineDelta;
         if( fRenderInfo.fFlags & kRenderScaleAA )
@@ -410,123 +415,27 @@ void    plFont::IRenderString( plMipmap *mip, uint16_t x, uint16_t y, const wcha
 
         lineDelta = lineHt * fRenderInfo.fDestStride;
 
-        while( *string != 0 && fRenderInfo.fMaxHeight >= fFontDescent )
+        while( line < layout.fLines.size() && fRenderInfo.fMaxHeight >= fFontDescent )
         {
+            const plWrappedLine &wrapped = layout.fLines[ line ];
             uint8_t *destStartPtr = fRenderInfo.fDestPtr;
             uint32_t destStartX = fRenderInfo.fX;
-            int16_t destMaxWidth = fRenderInfo.fMaxWidth, thisIndent = 0;
+            int16_t destMaxWidth = fRenderInfo.fMaxWidth;
 
+            string = base + wrapped.fStart;
             if( isFirstLine )
             {
                 // First line, apply indent if applicable
                 fRenderInfo.fX += fRenderInfo.fFirstLineIndent;
                 fRenderInfo.fMaxWidth -= fRenderInfo.fFirstLineIndent;
                 fRenderInfo.fDestPtr += fRenderInfo.fFirstLineIndent * fRenderInfo.fDestBPP;
-                thisIndent = fRenderInfo.fFirstLineIndent;
                 isFirstLine = false;
             }
 
-            std::string ellipsisTracker = ""; // keeps track of ellipsis, since there are three uint16_t break chars that can't be split
-            bool possibleEllipsis = false;
-            int preEllipsisLastWord = 0; // where the uint16_t break was before we started tracking an ellipsis
-
-            // Iterate through the string, looking for the next line break
-            for( lastWord = 0, i = 0; string[ i ] != 0; i++ )
-            {
-                // If we're a carriage return, we go ahead and break anyway
-                if( string[ i ] == L'\n' )
-                {
-                    lastWord = i;
-                    break;
-                }
-                
-                // handle invalid chars discretely
-                plCharacter* charToDraw = nullptr;
-                if (fCharacters.size() <= ((uint16_t)string[i] - fFirstChar))
-                    charToDraw = &(fCharacters[(uint16_t)L' ' - fFirstChar]);
-                else
-                    charToDraw = &(fCharacters[(uint16_t)string[i] - fFirstChar]);
-
-                int16_t leftKern = (int16_t)charToDraw->fLeftKern;
-                if( fRenderInfo.fFlags & kRenderScaleAA )
-                    x += leftKern / 2;
-                else
-                    x += leftKern;
-
-                // Update our position and see if we're over
-                // Note that our wrapping is slightly off, in that it doesn't take into account
-                // the left kerning of characters. Hopefully that won't matter much...
-                uint16_t charWidth = (uint16_t)(fWidth + (int16_t)charToDraw->fRightKern);
-                if( fRenderInfo.fFlags & kRenderScaleAA )
-                    charWidth >>= 1;
-
-                uint16_t nonAdjustedX = (uint16_t)(x + fWidth); // just in case the actual bitmap is too big to fit on page and we think the character can (because of right kern)
-                x += charWidth;
-
-                if(( x >= fRenderInfo.fMaxWidth ) || (nonAdjustedX >= fRenderInfo.fMaxWidth))
-                {
-                    // we're over, but lastWord may not be correct (especially if we're in the middle of an ellipsis)
-                    if (possibleEllipsis)
-                    {
-                        // ellipsisTracker will not be empty since possibleEllipsis is true (so there will be at least one period)
-                        if (ellipsisTracker == ".") // only one period so far
-                        {
-                            if ((string[i] == '.') && (string[i+1] == '.')) // we have an ellipsis, so reset the lastWord back before we found it
-                                lastWord = preEllipsisLastWord;
-                            // otherwise, we don't have an ellipsis, so lastWord is correct (but the grammer might not be ;-)
-                        }
-                        else if (ellipsisTracker == "..") // only two periods so far
-                        {
-                            if (string[i] == '.') // we have an ellipsis, so reset the lastWord back before we found it
-                                lastWord = preEllipsisLastWord;
-                            // otherwise, we don't have an ellipsis, so lastWord is correct (but the grammer might not be ;-)
-                        }
-                        // if neither of the above are true, then the full ellipsis was encountered and the lastWord is correct
-                        ellipsisTracker = "";
-                        possibleEllipsis = false;
-                    }
-                    // Over, so break
-                    break;
-                }
-
-                // Are we a word breaker?
-                if( IIsWordBreaker( (char)(string[ i ]) ) )
-                {
-                    if (string[i] == '.') // we might have an ellipsis here
-                    {
-                        if (ellipsisTracker == "...") // we already have a full ellipsis, so break between them
-                        {
-                            preEllipsisLastWord = i;
-                            ellipsisTracker = "";
-                        }
-                        else if (ellipsisTracker == "") // no ellipsis yet, so save the last word
-                            preEllipsisLastWord = lastWord;
-                        ellipsisTracker += '.';
-                        possibleEllipsis = true;
-                    }
-                    else
-                    {
-                        ellipsisTracker = ""; // no chance of an ellipsis, so kill it
-                        possibleEllipsis = false;
-                    }
-                    // Yes, and we didn't go over, so store as the last successfully fit uint16_t and move on
-                    lastWord = i;
-                }           
-            }
-
-            if( string[ i ] == 0 )
-                lastWord = i;       // Final catch for end-of-string
-            else if( lastWord == 0 && string[ i ] != L'\n' && thisIndent == 0 )
-                lastWord = i;       // Catch for a single uint16_t that didn't fit (just go up as many chars as we can)
-                                    // (but NOT if we have a first line indent, mind you :)
-
-            // Got to the end of a line (somewhere), so render up to lastWord, then advance from that point
-            // to the first non-word-breaker and continue onward
+            // Render the line (including any drawable word break at its end)
+            int32_t lastWord = wrapped.fCount;
             if( lastWord > 0 )
             {
-                bool drawableWordBreak = IIsDrawableWordBreak((char)(string[lastWord]));
-                if (drawableWordBreak)
-                    lastWord++; // make sure we draw it
                 if( ( fRenderInfo.fFlags & kRenderJustXMask ) == kRenderJustXRight )
                 {
                     uint16_t baseX = fRenderInfo.fX, baseMaxW = fRenderInfo.fMaxWidth;
@@ -592,8 +501,6 @@ void    plFont::IRenderString( plMipmap *mip, uint16_t x, uint16_t y, const wcha
                     fRenderInfo.fLastX = fRenderInfo.fX;
                     fRenderInfo.fLastY = fRenderInfo.fY;
                 }
-                if (drawableWordBreak)
-                    lastWord--; // reset it
             }
 
 
@@ -604,16 +511,13 @@ void    plFont::IRenderString( plMipmap *mip, uint16_t x, uint16_t y, const wcha
             if( firstMaxAscent == 0 )
                 firstMaxAscent = fRenderInfo.fMaxAscent;
 
-            x = 0;
             fRenderInfo.fX = (int16_t)destStartX;
             fRenderInfo.fDestPtr = destStartPtr;
             fRenderInfo.fMaxWidth = destMaxWidth;
             fRenderInfo.fMaxAscent = 0;
 
-            // Look for the next non-word-breaker. Note that if we have any carriage returns hidden in here, 
-            // we'll want to be advancing down even further
-            // Advance down
-            if( string[ i ] != 0 )
+            // Advance down past this line and any carriage returns after it
+            for( uint32_t j = 0; j < wrapped.fAdvance; j++ )
             {
                 fRenderInfo.fY += (int16_t)lineHt;
                 fRenderInfo.fMaxHeight -= (int16_t)lineHt;
@@ -621,26 +525,11 @@ void    plFont::IRenderString( plMipmap *mip, uint16_t x, uint16_t y, const wcha
                 fRenderInfo.fLastX = fRenderInfo.fX;
                 fRenderInfo.fLastY = fRenderInfo.fY;
             }
-            for( i = lastWord; string[ i ] != 0 && IIsWordBreaker( (char)(string[ i ]) ) && string[ i ] != L'\n'; i++ )
-            {
-            }
-            // Process any trailing carriage returns as a separate loop b/c we don't want to throw away white space
-            // after returns
-            for( ; string[ i ] == L'\n'; i++ )
-            {
-                // Don't process if i==lastWord, since we already did that one
-                if( i > lastWord && string[ i ] == L'\n' )
-                {
-                    // Advance down
-                    fRenderInfo.fY += (int16_t)lineHt;
-                    fRenderInfo.fMaxHeight -= (int16_t)lineHt;
-                    fRenderInfo.fDestPtr += lineDelta;
-                    fRenderInfo.fLastY = fRenderInfo.fY;
-                }
-            }
 
             // Keep going from here!
-            string += i;
+            string = base + wrapped.fNext;
+            if( !layout.fRepeatLast || line + 1 < layout.fLines.size() )
+                line++;
         }
 
         fRenderInfo.fMaxAscent = firstMaxAscent;    
@@ -684,6 +573,200 @@ void    plFont::IRenderString( plMipmap *mip, uint16_t x, uint16_t y, const wcha
     }
 }
 
+//// IGetWrapLayout ///////////////////////////////////////////////////////////
+//  Returns the cached line breaks for the given text, building them if we
+//  haven't seen this text/width/indent before
+
+const plFont::plWrapLayout &plFont::IGetWrapLayout( const wchar_t *string, int16_t maxWidth, int16_t indent )
+{
+    std::wstring_view text( string );
+    bool scaleAA = ( fRenderInfo.fFlags & kRenderScaleAA ) != 0;
+
+    size_t hash = std::hash<std::wstring_view>()( text );
+    hash ^= ( (size_t)(uint16_t)maxWidth << 1 ) ^ ( (size_t)(uint16_t)indent << 17 ) ^ ( scaleAA ? 1 : 0 );
+
+    auto iter = fWrapLayouts.find( hash );
+    if( iter != fWrapLayouts.end() )
+    {
+        const plWrapLayout &layout = iter->second;
+        if( layout.fMaxWidth == maxWidth && layout.fIndent == indent && layout.fScaleAA == scaleAA && layout.fText == text )
+            return layout;
+    }
+    else if( fWrapLayouts.size() >= kMaxWrapLayouts )
+        fWrapLayouts.clear();
+
+    plWrapLayout &layout = fWrapLayouts[ hash ];
+    layout.fText = text;
+    layout.fMaxWidth = maxWidth;
+    layout.fIndent = indent;
+    layout.fScaleAA = scaleAA;
+    IBuildWrapLayout( layout );
+    return layout;
+}
+
+//// IBuildWrapLayout /////////////////////////////////////////////////////////
+//  Breaks layout.fText into lines.
+//  To avoid backtracking, we step forward in the string one uint16_t at a time until we hit a break,
+//  then store what we have and continue
+
+void    plFont::IBuildWrapLayout( plWrapLayout &layout ) const
+{
+    const wchar_t *string = layout.fText.c_str();
+    bool isFirstLine = true;
+    uint32_t start = 0;
+
+    layout.fLines.clear();
+    layout.fRepeatLast = false;
+
+    while( *string != 0 )
+    {
+        int32_t lastWord = 0, i;
+        int16_t maxWidth = layout.fMaxWidth, thisIndent = 0;
+        uint16_t x = 0;
+
+        if( isFirstLine )
+        {
+            // First line, apply indent if applicable
+            maxWidth -= layout.fIndent;
+            thisIndent = layout.fIndent;
+            isFirstLine = false;
+        }
+
+        std::string ellipsisTracker = ""; // keeps track of ellipsis, since there are three uint16_t break chars that can't be split
+        bool possibleEllipsis = false;
+        int preEllipsisLastWord = 0; // where the uint16_t break was before we started tracking an ellipsis
+
+        // Iterate through the string, looking for the next line break
+        for( lastWord = 0, i = 0; string[ i ] != 0; i++ )
+        {
+            // If we're a carriage return, we go ahead and break anyway
+            if( string[ i ] == L'\n' )
+            {
+                lastWord = i;
+                break;
+            }
+            
+            // handle invalid chars discretely
+            const plCharacter* charToDraw = nullptr;
+            if (fCharacters.size() <= ((uint16_t)string[i] - fFirstChar))
+                charToDraw = &(fCharacters[(uint16_t)L' ' - fFirstChar]);
+            else
+                charToDraw = &(fCharacters[(uint16_t)string[i] - fFirstChar]);
+
+            int16_t leftKern = (int16_t)charToDraw->fLeftKern;
+            if( layout.fScaleAA )
+                x += leftKern / 2;
+            else
+                x += leftKern;
+
+            // Update our position and see if we're over
+            // Note that our wrapping is slightly off, in that it doesn't take into account
+            // the left kerning of characters. Hopefully that won't matter much...
+            uint16_t charWidth = (uint16_t)(fWidth + (int16_t)charToDraw->fRightKern);
+            if( layout.fScaleAA )
+                charWidth >>= 1;
+
+            uint16_t nonAdjustedX = (uint16_t)(x + fWidth); // just in case the actual bitmap is too big to fit on page and we think the character can (because of right kern)
+            x += charWidth;
+
+            if(( x >= maxWidth ) || (nonAdjustedX >= maxWidth))
+            {
+                // we're over, but lastWord may not be correct (especially if we're in the middle of an ellipsis)
+                if (possibleEllipsis)
+                {
+                    // ellipsisTracker will not be empty since possibleEllipsis is true (so there will be at least one period)
+                    if (ellipsisTracker == ".") // only one period so far
+                    {
+                        if ((string[i] == '.') && (string[i+1] == '.')) // we have an ellipsis, so reset the lastWord back before we found it
+                            lastWord = preEllipsisLastWord;
+                        // otherwise, we don't have an ellipsis, so lastWord is correct (but the grammer might not be ;-)
+                    }
+                    else if (ellipsisTracker == "..") // only two periods so far
+                    {
+                        if (string[i] == '.') // we have an ellipsis, so reset the lastWord back before we found it
+                            lastWord = preEllipsisLastWord;
+                        // otherwise, we don't have an ellipsis, so lastWord is correct (but the grammer might not be ;-)
+                    }
+                    // if neither of the above are true, then the full ellipsis was encountered and the lastWord is correct
+                    ellipsisTracker = "";
+                    possibleEllipsis = false;
+                }
+                // Over, so break
+                break;
+            }
+
+            // Are we a word breaker?
+            if( IIsWordBreaker( (char)(string[ i ]) ) )
+            {
+                if (string[i] == '.') // we might have an ellipsis here
+                {
+                    if (ellipsisTracker == "...") // we already have a full ellipsis, so break between them
+                    {
+                        preEllipsisLastWord = i;
+                        ellipsisTracker = "";
+                    }
+                    else if (ellipsisTracker == "") // no ellipsis yet, so save the last word
+                        preEllipsisLastWord = lastWord;
+                    ellipsisTracker += '.';
+                    possibleEllipsis = true;
+                }
+                else
+                {
+                    ellipsisTracker = ""; // no chance of an ellipsis, so kill it
+                    possibleEllipsis = false;
+                }
+                // Yes, and we didn't go over, so store as the last successfully fit uint16_t and move on
+                lastWord = i;
+            }           
+        }
+
+        if( string[ i ] == 0 )
+            lastWord = i;       // Final catch for end-of-string
+        else if( lastWord == 0 && string[ i ] != L'\n' && thisIndent == 0 )
+            lastWord = i;       // Catch for a single uint16_t that didn't fit (just go up as many chars as we can)
+                                // (but NOT if we have a first line indent, mind you :)
+
+        // Got to the end of a line (somewhere), so draw up to lastWord (and the break itself
+        // if it's drawable), then advance from that point to the first non-word-breaker
+        plWrappedLine wrapped;
+        wrapped.fStart = start;
+        wrapped.fCount = 0;
+        wrapped.fAdvance = 0;
+        if( lastWord > 0 )
+            wrapped.fCount = lastWord + ( IIsDrawableWordBreak( (char)(string[ lastWord ]) ) ? 1 : 0 );
+
+        // Look for the next non-word-breaker. Note that if we have any carriage returns hidden in here, 
+        // we'll want to be advancing down even further
+        if( string[ i ] != 0 )
+            wrapped.fAdvance++;
+        for( i = lastWord; string[ i ] != 0 && IIsWordBreaker( (char)(string[ i ]) ) && string[ i ] != L'\n'; i++ )
+        {
+        }
+        // Process any trailing carriage returns as a separate loop b/c we don't want to throw away white space
+        // after returns
+        for( ; string[ i ] == L'\n'; i++ )
+        {
+            // Don't process if i==lastWord, since we already did that one
+            if( i > lastWord )
+                wrapped.fAdvance++;
+        }
+
+        wrapped.fNext = start + i;
+        layout.fLines.push_back( wrapped );
+
+        // Nothing fit and the next line would be just the same (no indent), so the
+        // renderer just keeps stepping down until it runs out of room
+        if( i == 0 && thisIndent == 0 )
+        {
+            layout.fRepeatLast = true;
+            break;
+        }
+
+        start += i;
+        string += i;
+    }
+}
+
 void    plFont::IRenderLoop( const wchar_t *string, int32_t maxCount )
 {
     // Render the string straight across, one char at a time
@@ -845,9 +928,7 @@ void    plFont::IRenderChar8To32( const plFont::plCharacter &c )
 {
     uint8_t   *src = fBMapData + c.fBitmapOff;
     uint32_t  *destPtr, *destBasePtr = (uint32_t *)(fRenderInfo.fDestPtr - c.fBaseline * int32_t(fRenderInfo.fDestStride));
-    int16_t   x, y, thisHeight, xstart, thisWidth;
-    uint32_t  srcAlpha, oneMinusAlpha, r, g, b, dR, dG, dB, destAlpha;
-    uint8_t   srcR, srcG, srcB;
+    int16_t   y, thisHeight, xstart, thisWidth;
 
 
     // Unfortunately for some fonts, their right kern value actually is
@@ -865,9 +946,8 @@ void    plFont::IRenderChar8To32( const plFont::plCharacter &c )
     if( xstart < 0 )
         xstart = 0;
 
-    srcR = (uint8_t)(( fRenderInfo.fColor >> 16 ) & 0x000000ff);
-    srcG = (uint8_t)(( fRenderInfo.fColor >> 8  ) & 0x000000ff);
-    srcB = (uint8_t)(( fRenderInfo.fColor       ) & 0x000000ff);
+    if( xstart >= thisWidth )
+        return;
 
     y = fRenderInfo.fClipRect.fY - fRenderInfo.fY + (int16_t)c.fBaseline;
     if( y < 0 )
@@ -885,32 +965,7 @@ void    plFont::IRenderChar8To32( const plFont::plCharacter &c )
     for( ; y < thisHeight; y++ )
     {
         destPtr = destBasePtr;
-        for( x = xstart; x < thisWidth; x++ )
-        {
-            if( src[ x ] == 255 )
-                destPtr[ x ] = fRenderInfo.fColor;
-            else if( src[ x ] == 0 )
-                ;   // Empty
-            else
-            {
-                srcAlpha = ( src[ x ] * ( fRenderInfo.fColor >> 24 ) ) / 255;
-                oneMinusAlpha = 255 - srcAlpha;
-
-                destAlpha = destPtr[ x ] & 0xff000000;
-
-                dR = ( destPtr[ x ] >> 16 ) & 0x000000ff;
-                dG = ( destPtr[ x ] >> 8  ) & 0x000000ff;
-                dB = ( destPtr[ x ]       ) & 0x000000ff;
-                r = ( srcR * srcAlpha ) >> 8;
-                g = ( srcG * srcAlpha ) >> 8;
-                b = ( srcB * srcAlpha ) >> 8;
-                dR = ( dR * oneMinusAlpha ) >> 8;
-                dG = ( dG * oneMinusAlpha ) >> 8;
-                dB = ( dB * oneMinusAlpha ) >> 8;
-
-                destPtr[ x ] = ( ( r + dR ) << 16 ) | ( ( g + dG ) << 8 ) | ( b + dB ) | destAlpha;
-            }
-        }
+        plFontKernels::blend_row.call( destPtr + xstart, src + xstart, thisWidth - xstart, fRenderInfo.fColor );
         destBasePtr = (uint32_t *)( (uint8_t *)destBasePtr + fRenderInfo.fDestStride );
         src += fWidth;
     }
@@ -920,8 +975,7 @@ void    plFont::IRenderChar8To32FullAlpha( const plFont::plCharacter &c )
 {
     uint8_t   *src = fBMapData + c.fBitmapOff;
     uint32_t  *destPtr, *destBasePtr = (uint32_t *)(fRenderInfo.fDestPtr - c.fBaseline * int32_t(fRenderInfo.fDestStride));
-    int16_t   x, y, thisHeight, xstart, thisWidth;
-    uint32_t  destColorOnly;
+    int16_t   y, thisHeight, xstart, thisWidth;
 
 
     // Unfortunately for some fonts, their right kern value actually is
@@ -939,7 +993,8 @@ void    plFont::IRenderChar8To32FullAlpha( const plFont::plCharacter &c )
     if( xstart < 0 )
         xstart = 0;
 
-    destColorOnly = fRenderInfo.fColor & 0x00ffffff;
+    if( xstart >= thisWidth )
+        return;
 
     y = fRenderInfo.fClipRect.fY - fRenderInfo.fY + (int16_t)c.fBaseline;
     if( y < 0 )
@@ -957,11 +1012,7 @@ void    plFont::IRenderChar8To32FullAlpha( const plFont::plCharacter &c )
     for( ; y < thisHeight; y++ )
     {
         destPtr = destBasePtr;
-        for( x = xstart; x < thisWidth; x++ )
-        {
-            if( src[ x ] != 0 )
-                destPtr[ x ] = ( src[ x ] << 24 ) | destColorOnly;
-        }
+        plFontKernels::alpha_row.call( destPtr + xstart, src + xstart, thisWidth - xstart, fRenderInfo.fColor );
         destBasePtr = (uint32_t *)( (uint8_t *)destBasePtr + fRenderInfo.fDestStride );
         src += fWidth;
     }
@@ -1031,8 +1082,7 @@ void    plFont::IRenderChar8To32AlphaPremultiplied( const plFont::plCharacter &c
 {
     uint8_t   *src = fBMapData + c.fBitmapOff;
     uint32_t  *destPtr, *destBasePtr = (uint32_t *)(fRenderInfo.fDestPtr - c.fBaseline * int32_t(fRenderInfo.fDestStride));
-    int16_t   x, y, thisHeight, xstart, thisWidth;
-    uint8_t   srcA, srcR, srcG, srcB;
+    int16_t   y, thisHeight, xstart, thisWidth;
 
 
     // Unfortunately for some fonts, their right kern value actually is
@@ -1050,10 +1100,8 @@ void    plFont::IRenderChar8To32AlphaPremultiplied( const plFont::plCharacter &c
     if( xstart < 0 )
         xstart = 0;
 
-    srcA = (uint8_t)(( fRenderInfo.fColor >> 24 ) & 0x000000ff);
-    srcR = (uint8_t)(( fRenderInfo.fColor >> 16 ) & 0x000000ff);
-    srcG = (uint8_t)(( fRenderInfo.fColor >> 8  ) & 0x000000ff);
-    srcB = (uint8_t)(( fRenderInfo.fColor       ) & 0x000000ff);
+    if( xstart >= thisWidth )
+        return;
 
     y = fRenderInfo.fClipRect.fY - fRenderInfo.fY + (int16_t)c.fBaseline;
     if( y < 0 )
@@ -1071,16 +1119,7 @@ void    plFont::IRenderChar8To32AlphaPremultiplied( const plFont::plCharacter &c
     for( ; y < thisHeight; y++ )
     {
         destPtr = destBasePtr;
-        for( x = xstart; x < thisWidth; x++ )
-        {
-            uint32_t a = src[ x ];
-            if (a != 0)
-            {
-                if (srcA != 0xff)
-                    a = (srcA*a + 127)/255;
-                destPtr[ x ] = ( a << 24 ) | (((srcR*a + 127)/255) << 16) | (((srcG*a + 127)/255) << 8) | ((srcB*a + 127)/255);
-            }
-        }
+        plFontKernels::premultiplied_row.call( destPtr + xstart, src + xstart, thisWidth - xstart, fRenderInfo.fColor );
         destBasePtr = (uint32_t *)( (uint8_t *)destBasePtr + fRenderInfo.fDestStride );
         src += fWidth;
     }
@@ -1115,16 +1154,32 @@ void    plFont::IRenderChar8To32AlphaPremShadow( const plFont::plCharacter &c )
     srcG = (uint8_t)(( fRenderInfo.fColor >> 8  ) & 0x000000ff);
     srcB = (uint8_t)(( fRenderInfo.fColor       ) & 0x000000ff);
 
-    static const uint32_t kernel[5][5] = {
-        {1,  2,  2,  2, 1},
-        {1, 13, 13, 13, 1},
-        {1, 10, 10, 10, 1},
-        {1,  7,  7,  7, 1},
-        {1,  1,  1,  1, 1}
-    };
+    // The shadow is this 5x5 kernel over the glyph coverage:
+    //      1  2  2  2  1
+    //      1 13 13 13  1
+    //      1 10 10 10  1
+    //      1  7  7  7  1
+    //      1  1  1  1  1
+    // Every row is 1s around a run of three equal weights, so we sum each
+    // glyph row once into a three wide (x-1..x+1) and a two tap (x-2, x+2)
+    // sum and then only need five rows of those per pixel. Same sums as
+    // running the full kernel, just a lot fewer reads.
+    static const uint32_t rowWeights[5] = { 2, 13, 10, 7, 1 };
 
     uint32_t clamp = 220 - ((2 * srcR + 4 * srcG + srcB) >> 4);
 
+    const int32_t sumsWidth = fWidth + 4, glyphHeight = c.fHeight;
+    fShadowSums.resize( sumsWidth * glyphHeight * 2 );
+    uint16_t *centerSums = fShadowSums.data(), *edgeSums = centerSums + sumsWidth * glyphHeight;
+    for( int32_t row = 0; row < glyphHeight; row++ )
+    {
+        for( int32_t col = -2; col < (int32_t)fWidth + 2; col++ )
+        {
+            centerSums[ row * sumsWidth + col + 2 ] = (uint16_t)(IGetCharPixel(c, col-1, row) + IGetCharPixel(c, col, row) + IGetCharPixel(c, col+1, row));
+            edgeSums[ row * sumsWidth + col + 2 ] = (uint16_t)(IGetCharPixel(c, col-2, row) + IGetCharPixel(c, col+2, row));
+        }
+    }
+
     y = fRenderInfo.fClipRect.fY - fRenderInfo.fY + (int16_t)c.fBaseline;
     if( y < -2 )
         y = -2;
@@ -1140,12 +1195,10 @@ void    plFont::IRenderChar8To32AlphaPremShadow( const plFont::plCharacter &c )
         for( x = xstart; x < thisWidth; x++ )
         {
             uint32_t sa = 0;
-            for (int32_t i = -2; i <= 2; i++) {
-                for (int32_t j = -2; j <= 2; j++) {
-                    uint32_t m = kernel[j+2][i+2];
-                    if (m != 0)
-                        sa += m * IGetCharPixel(c, x+i, y+j);
-                }
+            for (int32_t j = -2; j <= 2; j++) {
+                int32_t row = y + j;
+                if (row >= 0 && row < glyphHeight)
+                    sa += rowWeights[j+2] * centerSums[row * sumsWidth + x + 2] + edgeSums[row * sumsWidth + x + 2];
             }
             sa = (sa * clamp) >> 13;
             if (sa > clamp)
@@ -2120,6 +2173,8 @@ bool    plFont::LoadFromBDF( const plFileName &path, plBDFConvertCallback *callb
 
 bool    plFont::ReadRaw( hsStream *s )
 {
+    fWrapLayouts.clear();
+
     char face_buf[257];
     s->Read(256, face_buf);
     face_buf[256] = 0;
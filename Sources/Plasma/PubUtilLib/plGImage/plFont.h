@@ -66,6 +66,8 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "hsColorRGBA.h"
 #include "pcSmallRect.h"
 
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "pnKeyedObject/hsKeyedObject.h"
@@ -207,11 +209,51 @@ class plFont : public hsKeyedObject
 
         plRenderInfo    fRenderInfo;
 
+        // One line of wrapped text: where it starts in the string, how many
+        // chars of it get drawn (0 for none), where the next line starts and
+        // how many lines we move down before drawing it
+        class plWrappedLine
+        {
+            public:
+                uint32_t  fStart;
+                uint32_t  fCount;
+                uint32_t  fNext;
+                uint32_t  fAdvance;
+        };
+
+        // Where the wrapping code breaks lines only depends on the text, the
+        // wrap width, the first line indent and kRenderScaleAA, so we keep the
+        // last few layouts around. CalcStringExtents() and RenderString() on
+        // the same text then only break it into lines once.
+        class plWrapLayout
+        {
+            public:
+                std::wstring                fText;
+                int16_t                     fMaxWidth;
+                int16_t                     fIndent;
+                bool                        fScaleAA;
+                bool                        fRepeatLast;    // Last line never fits, so it repeats until we run out of room
+                std::vector<plWrappedLine>  fLines;
+        };
+
+        enum
+        {
+            kMaxWrapLayouts = 64
+        };
+
+        std::unordered_map<size_t, plWrapLayout> fWrapLayouts;
+
+        // Scratch for the shadow blitter
+        std::vector<uint16_t>   fShadowSums;
+
         void    IClear( bool onConstruct = false );
         void    ICalcFontAscent();
 
         uint8_t   *IGetFreeCharData( uint32_t &newOffset );
 
+        const plWrapLayout  &IGetWrapLayout( const wchar_t *string, int16_t maxWidth, int16_t indent );
+        void    IBuildWrapLayout( plWrapLayout &layout ) const;
+
         void    IRenderLoop( const wchar_t *string, int32_t maxCount );
         void    IRenderString( plMipmap *mip, uint16_t x, uint16_t y, const wchar_t *string, bool justCalc );
 
@@ -289,6 +331,9 @@ class plFont : public hsKeyedObject
 
         bool    LoadFromP2FFile( const plFileName &path );
 
+        // Drops any cached wrapped text layouts
+        void    ClearLayoutCache() { fWrapLayouts.clear(); }
+
         bool    ReadRaw( hsStream *stream );
         bool    WriteRaw( hsStream *stream );
 };
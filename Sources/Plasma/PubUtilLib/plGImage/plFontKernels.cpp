@@ -0,0 +1,124 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "plFontKernels.h"
+
+//// Blend ////////////////////////////////////////////////////////////////////
+
+void plFontKernels::blend_row_fpu(uint32_t* dst, const uint8_t* coverage, uint32_t count, uint32_t color)
+{
+    uint32_t srcR = (color >> 16) & 0x000000ff;
+    uint32_t srcG = (color >> 8 ) & 0x000000ff;
+    uint32_t srcB = (color      ) & 0x000000ff;
+
+    for (uint32_t x = 0; x < count; x++) {
+        if (coverage[x] == 255)
+            dst[x] = color;
+        else if (coverage[x] != 0) {
+            uint32_t srcAlpha = (coverage[x] * (color >> 24)) / 255;
+            uint32_t oneMinusAlpha = 255 - srcAlpha;
+            uint32_t destAlpha = dst[x] & 0xff000000;
+
+            uint32_t dR = (dst[x] >> 16) & 0x000000ff;
+            uint32_t dG = (dst[x] >> 8 ) & 0x000000ff;
+            uint32_t dB = (dst[x]      ) & 0x000000ff;
+            uint32_t r = (srcR * srcAlpha) >> 8;
+            uint32_t g = (srcG * srcAlpha) >> 8;
+            uint32_t b = (srcB * srcAlpha) >> 8;
+            dR = (dR * oneMinusAlpha) >> 8;
+            dG = (dG * oneMinusAlpha) >> 8;
+            dB = (dB * oneMinusAlpha) >> 8;
+
+            dst[x] = ((r + dR) << 16) | ((g + dG) << 8) | (b + dB) | destAlpha;
+        }
+    }
+}
+
+//// Coverage Into Alpha //////////////////////////////////////////////////////
+
+void plFontKernels::alpha_row_fpu(uint32_t* dst, const uint8_t* coverage, uint32_t count, uint32_t color)
+{
+    uint32_t destColorOnly = color & 0x00ffffff;
+    for (uint32_t x = 0; x < count; x++) {
+        if (coverage[x] != 0)
+            dst[x] = (coverage[x] << 24) | destColorOnly;
+    }
+}
+
+//// Premultiplied ////////////////////////////////////////////////////////////
+
+void plFontKernels::premultiplied_row_fpu(uint32_t* dst, const uint8_t* coverage, uint32_t count, uint32_t color)
+{
+    uint32_t srcA = (color >> 24) & 0x000000ff;
+    uint32_t srcR = (color >> 16) & 0x000000ff;
+    uint32_t srcG = (color >> 8 ) & 0x000000ff;
+    uint32_t srcB = (color      ) & 0x000000ff;
+
+    for (uint32_t x = 0; x < count; x++) {
+        uint32_t a = coverage[x];
+        if (a != 0) {
+            if (srcA != 0xff)
+                a = (srcA * a + 127) / 255;
+            dst[x] = (a << 24) | (((srcR * a + 127) / 255) << 16) | (((srcG * a + 127) / 255) << 8) | ((srcB * a + 127) / 255);
+        }
+    }
+}
+
+//// Dispatchers //////////////////////////////////////////////////////////////
+
+hsCpuFunctionDispatcher<plFontKernels::blend_row_ptr> plFontKernels::blend_row {
+    &plFontKernels::blend_row_fpu,
+    nullptr,            // SSE1
+    &plFontKernels::blend_row_sse2
+};
+
+hsCpuFunctionDispatcher<plFontKernels::alpha_row_ptr> plFontKernels::alpha_row {
+    &plFontKernels::alpha_row_fpu,
+    nullptr,            // SSE1
+    &plFontKernels::alpha_row_sse2
+};
+
+hsCpuFunctionDispatcher<plFontKernels::premultiplied_row_ptr> plFontKernels::premultiplied_row {
+    &plFontKernels::premultiplied_row_fpu,
+    nullptr,            // SSE1
+    &plFontKernels::premultiplied_row_sse2
+};
@@ -0,0 +1,87 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+//  plFontKernels - Row kernels for plFont's 8-bit glyph blitters            //
+//                                                                           //
+//  Each kernel draws one row of glyph coverage values into ARGB32 pixels,   //
+//  exactly like the matching plFont::IRenderChar8To32* loop did. The SSE2   //
+//  versions do four pixels at a time, skip runs of empty coverage and use   //
+//  an exact divide-by-255, so their output is bit-identical to the plain    //
+//  versions. Glyph rows are short, so there is no AVX2 version.             //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef _plFontKernels_h
+#define _plFontKernels_h
+
+#include "HeadSpin.h"
+#include "hsCpuID.h"
+
+class plFontKernels
+{
+public:
+    // Blends color over the destination by coverage * color alpha, keeping
+    // the destination alpha (IRenderChar8To32)
+    typedef void(*blend_row_ptr)(uint32_t* dst, const uint8_t* coverage, uint32_t count, uint32_t color);
+    static hsCpuFunctionDispatcher<blend_row_ptr> blend_row;
+
+    // Writes the color with the coverage as its alpha (IRenderChar8To32FullAlpha)
+    typedef void(*alpha_row_ptr)(uint32_t* dst, const uint8_t* coverage, uint32_t count, uint32_t color);
+    static hsCpuFunctionDispatcher<alpha_row_ptr> alpha_row;
+
+    // Writes the color premultiplied by coverage * color alpha
+    // (IRenderChar8To32AlphaPremultiplied)
+    typedef void(*premultiplied_row_ptr)(uint32_t* dst, const uint8_t* coverage, uint32_t count, uint32_t color);
+    static hsCpuFunctionDispatcher<premultiplied_row_ptr> premultiplied_row;
+
+    static void blend_row_fpu(uint32_t* dst, const uint8_t* coverage, uint32_t count, uint32_t color);
+    static void blend_row_sse2(uint32_t* dst, const uint8_t* coverage, uint32_t count, uint32_t color);
+
+    static void alpha_row_fpu(uint32_t* dst, const uint8_t* coverage, uint32_t count, uint32_t color);
+    static void alpha_row_sse2(uint32_t* dst, const uint8_t* coverage, uint32_t count, uint32_t color);
+
+    static void premultiplied_row_fpu(uint32_t* dst, const uint8_t* coverage, uint32_t count, uint32_t color);
+    static void premultiplied_row_sse2(uint32_t* dst, const uint8_t* coverage, uint32_t count, uint32_t color);
+};
+
+#endif // _plFontKernels_h
@@ -0,0 +1,180 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "plFontKernels.h"
+
+#include <cstring>
+
+#ifdef HAVE_SSE2
+#   include <emmintrin.h>
+
+// x / 255 for 0 <= x < 65535, in each 16-bit lane
+static inline __m128i IDiv255_16(__m128i x)
+{
+    __m128i t = _mm_add_epi16(_mm_add_epi16(x, _mm_set1_epi16(1)), _mm_srli_epi16(x, 8));
+    return _mm_srli_epi16(t, 8);
+}
+
+// Four coverage bytes at once, 0 if they are all empty
+static inline uint32_t ILoadCoverage(const uint8_t* coverage)
+{
+    uint32_t cov;
+    memcpy(&cov, coverage, sizeof(cov));
+    return cov;
+}
+
+// Spreads four 16-bit values (one per pixel) across the channels of two
+// pixels each
+static inline void ISpread(__m128i v, __m128i& lo, __m128i& hi)
+{
+    v = _mm_unpacklo_epi16(v, v);
+    lo = _mm_unpacklo_epi32(v, v);
+    hi = _mm_unpackhi_epi32(v, v);
+}
+
+// result where mask is set, otherwise keep
+static inline __m128i ISelect(__m128i mask, __m128i result, __m128i keep)
+{
+    return _mm_or_si128(_mm_and_si128(mask, result), _mm_andnot_si128(mask, keep));
+}
+#endif
+
+void plFontKernels::blend_row_sse2(uint32_t* dst, const uint8_t* coverage, uint32_t count, uint32_t color)
+{
+#ifdef HAVE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i c255 = _mm_set1_epi16(255);
+    const __m128i colorA = _mm_set1_epi16((short)(color >> 24));
+    const __m128i colorV = _mm_set1_epi32((int)color);
+    const __m128i alphaMask = _mm_set1_epi32((int)0xff000000);
+    const __m128i src16 = _mm_unpacklo_epi8(_mm_set1_epi32((int)(color & 0x00ffffff)), zero);
+
+    uint32_t x = 0;
+    for (; x + 4 <= count; x += 4) {
+        uint32_t cov4 = ILoadCoverage(coverage + x);
+        if (cov4 == 0)
+            continue;
+
+        __m128i cov = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)cov4), zero);
+        __m128i srcAlpha = IDiv255_16(_mm_mullo_epi16(cov, colorA));
+        __m128i aLo, aHi;
+        ISpread(srcAlpha, aLo, aHi);
+
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + x));
+        __m128i lo = _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(src16, aLo), 8),
+                                   _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), _mm_sub_epi16(c255, aLo)), 8));
+        __m128i hi = _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(src16, aHi), 8),
+                                   _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), _mm_sub_epi16(c255, aHi)), 8));
+        __m128i blended = ISelect(alphaMask, d, _mm_packus_epi16(lo, hi));
+
+        __m128i cov32 = _mm_unpacklo_epi16(cov, zero);
+        __m128i result = ISelect(_mm_cmpeq_epi32(cov32, _mm_set1_epi32(255)), colorV, blended);
+        result = ISelect(_mm_cmpeq_epi32(cov32, zero), d, result);
+        _mm_storeu_si128((__m128i*)(dst + x), result);
+    }
+
+    blend_row_fpu(dst + x, coverage + x, count - x, color);
+#else
+    blend_row_fpu(dst, coverage, count, color);
+#endif
+}
+
+void plFontKernels::alpha_row_sse2(uint32_t* dst, const uint8_t* coverage, uint32_t count, uint32_t color)
+{
+#ifdef HAVE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i colorOnly = _mm_set1_epi32((int)(color & 0x00ffffff));
+
+    uint32_t x = 0;
+    for (; x + 4 <= count; x += 4) {
+        uint32_t cov4 = ILoadCoverage(coverage + x);
+        if (cov4 == 0)
+            continue;
+
+        __m128i cov32 = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128((int)cov4), zero), zero);
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + x));
+        __m128i result = _mm_or_si128(_mm_slli_epi32(cov32, 24), colorOnly);
+        _mm_storeu_si128((__m128i*)(dst + x), ISelect(_mm_cmpeq_epi32(cov32, zero), d, result));
+    }
+
+    alpha_row_fpu(dst + x, coverage + x, count - x, color);
+#else
+    alpha_row_fpu(dst, coverage, count, color);
+#endif
+}
+
+void plFontKernels::premultiplied_row_sse2(uint32_t* dst, const uint8_t* coverage, uint32_t count, uint32_t color)
+{
+#ifdef HAVE_SSE2
+    // (s * a + 127) / 255 with a 16-bit exact divide; s * a + 127 stays below
+    // 65535. Scaling by an opaque color alpha gives the coverage back, so that
+    // case needs no branch, and putting 255 in the alpha lane of the color
+    // turns the same multiply into the alpha itself.
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi16(127);
+    const __m128i colorA = _mm_set1_epi16((short)(color >> 24));
+    const __m128i src16 = _mm_unpacklo_epi8(_mm_set1_epi32((int)(color | 0xff000000)), zero);
+
+    uint32_t x = 0;
+    for (; x + 4 <= count; x += 4) {
+        uint32_t cov4 = ILoadCoverage(coverage + x);
+        if (cov4 == 0)
+            continue;
+
+        __m128i cov = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)cov4), zero);
+        __m128i a = IDiv255_16(_mm_add_epi16(_mm_mullo_epi16(cov, colorA), round));
+        __m128i aLo, aHi;
+        ISpread(a, aLo, aHi);
+
+        __m128i lo = IDiv255_16(_mm_add_epi16(_mm_mullo_epi16(src16, aLo), round));
+        __m128i hi = IDiv255_16(_mm_add_epi16(_mm_mullo_epi16(src16, aHi), round));
+
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + x));
+        __m128i cov32 = _mm_unpacklo_epi16(cov, zero);
+        _mm_storeu_si128((__m128i*)(dst + x), ISelect(_mm_cmpeq_epi32(cov32, zero), d, _mm_packus_epi16(lo, hi)));
+    }
+
+    premultiplied_row_fpu(dst + x, coverage + x, count - x, color);
+#else
+    premultiplied_row_fpu(dst, coverage, count, color);
+#endif
+}
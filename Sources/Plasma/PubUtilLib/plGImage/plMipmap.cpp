@@ -53,6 +53,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 #include "HeadSpin.h"
 #include "plMipmap.h"
+#include "plMipmapKernels.h"
 #include "hsStream.h"
 #include "hsExceptions.h"
 
@@ -64,6 +65,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plPNG.h"
 #include <cmath>
 #include <algorithm>
+#include <vector>
 
 plProfile_CreateMemCounter("Mipmaps", "Memory", MemMipmaps);
 
@@ -880,6 +882,10 @@ class plFilterMask
         int     End() const { return fExt; }
 
         float    Mask( int i, int j ) const { return fMask[ i ][ j ]; }
+
+        // Fills in a plMipmapKernels::FilterInfo, using weights as the storage
+        // for the mask.
+        void    GetFilterInfo( plMipmapKernels::FilterInfo& info, std::vector<float>& weights ) const;
 };
 
 plFilterMask::plFilterMask( float sig )
@@ -912,6 +918,20 @@ plFilterMask::~plFilterMask()
     delete [] ( fMask - fExt );
 }
 
+void plFilterMask::GetFilterInfo( plMipmapKernels::FilterInfo& info, std::vector<float>& weights ) const
+{
+    weights.clear();
+    weights.reserve( ( ( fExt << 1 ) + 1 ) * ( ( fExt << 1 ) + 1 ) );
+    for( int i = -fExt; i <= fExt; i++ )
+    {
+        for( int j = -fExt; j <= fExt; j++ )
+            weights.push_back( fMask[ i ][ j ] );
+    }
+
+    info.fMask = weights.data();
+    info.fMaskExt = fExt;
+}
+
 
 ///////////////////////////////////////////////////////////////////////////////
 //// Some More Functions //////////////////////////////////////////////////////
@@ -1085,8 +1105,6 @@ void    plMipmap::ICreateLevelNoDetail( uint8_t iDst, const plFilterMask& mask )
     hsAssert(fPixelSize == 32, "Only 32 bit implemented");
     ASSERT_UNCOMPRESSED();
 
-    int i, j, ii, jj;
-
     if( 32 == fPixelSize )
     {
         SetCurrLevel(iDst);
@@ -1094,40 +1112,17 @@ void    plMipmap::ICreateLevelNoDetail( uint8_t iDst, const plFilterMask& mask )
         uint8_t *src = (uint8_t *)GetLevelPtr( iDst-1 );
         uint8_t *dst = (uint8_t *)GetLevelPtr(iDst);
 
-        uint32_t srcRowBytes = fCurrLevelRowBytes << 1;
-        uint32_t srcHeight = fCurrLevelHeight << 1;
-        uint32_t srcWidth = fCurrLevelWidth << 1;
-
-        for( i = 0; i < fCurrLevelHeight; i++ )
-        {
-            for( j = 0; j < fCurrLevelWidth; j++ )
-            {
-                uint8_t *center = src + (i << 1) * srcRowBytes + (j << 3);
-
-                uint32_t chan;
-                for( chan = 0; chan < 4; chan++ )
-                {
-                    float w = 0;
-                    float a = 0;
-
-                    for( ii = mask.Begin(); ii <= mask.End(); ii++ )
-                    {
-                        for( jj = mask.Begin(); jj <= mask.End(); jj++ )
-                        {
-                            if( (ii + (i << 1) >= 0)&&(ii + (i << 1) < srcHeight)
-                              &&(jj + (j << 1) >= 0)&&(jj + (j << 1) < srcWidth) )
-                            {
-                                w += mask.Mask(ii, jj);
-                                a += (float(center[ii*srcRowBytes + (jj<<2) + chan]) + 0.5f) * mask.Mask(ii, jj);
-                            }
-                        }
-                    }
-                    a /= w;
+        std::vector<float> weights;
+        plMipmapKernels::FilterInfo info;
+        mask.GetFilterInfo(info, weights);
+        info.fSrcRowBytes = fCurrLevelRowBytes << 1;
+        info.fSrcHeight = fCurrLevelHeight << 1;
+        info.fSrcWidth = fCurrLevelWidth << 1;
+        info.fDstWidth = fCurrLevelWidth;
+        info.fStep = 2;
 
-                    dst[i * fCurrLevelRowBytes + (j << 2) + chan] = (uint8_t)a;
-                }
-            }
-        }
+        for( uint32_t i = 0; i < fCurrLevelHeight; i++ )
+            plMipmapKernels::filter_row.call(dst + i * fCurrLevelRowBytes, src, info, i << 1);
     }
 }
 
@@ -1213,27 +1208,15 @@ void    plMipmap::IBlendLevelDetailAlpha( uint8_t iDst, const plFilterMask& mask
     hsAssert(fPixelSize == 32, "Only 32 bit implemented");
     ASSERT_UNCOMPRESSED();
 
-    int     i, j;
-    uint32_t  offset;
-
-
     SetCurrLevel(iDst);
 
     uint8_t *dst = (uint8_t *)GetLevelPtr(iDst);
 
     float detailAlpha = IGetDetailLevelAlpha( iDst, detailDropoffStart, detailDropoffStop, detailMin, detailMax );
 
-    for( i = 0; i < fCurrLevelHeight; i++ )
-    {
-        for( j = 0; j < fCurrLevelWidth; j++ )
-        {
-            uint32_t chan = 3;    // Alpha channel only
-            offset = i * fCurrLevelRowBytes + (j << 2) + chan;
-
-            float a = (float)dst[ offset ] * detailAlpha;
-            dst[ offset ] = (uint8_t)a;
-        }
-    }
+    // Alpha channel only
+    for( uint32_t i = 0; i < fCurrLevelHeight; i++ )
+        plMipmapKernels::scale_row.call(dst + i * fCurrLevelRowBytes, fCurrLevelWidth, detailAlpha, 0.f, 1 << 3);
 }
 
 //// IBlendLevelDetailAdd /////////////////////////////////////////////////////
@@ -1247,32 +1230,15 @@ void    plMipmap::IBlendLevelDetailAdd( uint8_t iDst, const plFilterMask& mask,
     hsAssert(fPixelSize == 32, "Only 32 bit implemented");
     ASSERT_UNCOMPRESSED();
 
-    int     i, j;
-    uint32_t  offset;
-
-
     SetCurrLevel(iDst);
 
     uint8_t *dst = (uint8_t *)GetLevelPtr(iDst);
 
     float detailAlpha = IGetDetailLevelAlpha( iDst, detailDropoffStart, detailDropoffStop, detailMin, detailMax );
 
-    for( i = 0; i < fCurrLevelHeight; i++ )
-    {
-        for( j = 0; j < fCurrLevelWidth; j++ )
-        {
-            uint32_t chan;
-
-            /// Blend all but the alpha channel, since we're doing additive blending
-            for( chan = 0; chan < 3; chan++ )
-            {
-                offset = i * fCurrLevelRowBytes + (j << 2) + chan;
-
-                float a = (float)dst[ offset ] * detailAlpha;
-                dst[ offset ] = (uint8_t)a;
-            }
-        }
-    }
+    /// Blend all but the alpha channel, since we're doing additive blending
+    for( uint32_t i = 0; i < fCurrLevelHeight; i++ )
+        plMipmapKernels::scale_row.call(dst + i * fCurrLevelRowBytes, fCurrLevelWidth, detailAlpha, 0.f, 0x7);
 }
 
 //// IBlendLevelDetailMult ////////////////////////////////////////////////////
@@ -1286,10 +1252,6 @@ void    plMipmap::IBlendLevelDetailMult( uint8_t iDst, const plFilterMask& mask,
     hsAssert(fPixelSize == 32, "Only 32 bit implemented");
     ASSERT_UNCOMPRESSED();
 
-    int     i, j;
-    uint32_t  offset;
-
-
     SetCurrLevel(iDst);
 
     uint8_t *dst = (uint8_t *)GetLevelPtr(iDst);
@@ -1297,25 +1259,9 @@ void    plMipmap::IBlendLevelDetailMult( uint8_t iDst, const plFilterMask& mask,
     float    detailAlpha = IGetDetailLevelAlpha( iDst, detailDropoffStart, detailDropoffStop, detailMin, detailMax );
     float    invDetailAlpha = ( 1.f - detailAlpha ) * 255.f;
 
-    for( i = 0; i < fCurrLevelHeight; i++ )
-    {
-        for( j = 0; j < fCurrLevelWidth; j++ )
-        {
-            uint32_t chan;
-
-            for( chan = 0; chan < 4; chan++ )
-            {
-                offset = i * fCurrLevelRowBytes + (j << 2) + chan;
-
-                float a = (float)dst[ offset ];
-
-                // Mult should fade to white, not black like with additive blending
-                a = invDetailAlpha + a * detailAlpha;
-
-                dst[ offset ] = (uint8_t)a;
-            }
-        }
-    }
+    // Mult should fade to white, not black like with additive blending
+    for( uint32_t i = 0; i < fCurrLevelHeight; i++ )
+        plMipmapKernels::scale_row.call(dst + i * fCurrLevelRowBytes, fCurrLevelWidth, detailAlpha, invDetailAlpha, 0xf);
 }
 
 //// EnsureKonstantBorder /////////////////////////////////////////////////////
@@ -1442,8 +1388,6 @@ void plMipmap::Filter(float sig)
     hsAssert(fPixelSize == 32, "Only 32 bit implemented");
     ASSERT_UNCOMPRESSED();
 
-    int i, j, ii, jj;
-
     if( 32 == fPixelSize )
     {
         uint8_t *dst = (uint8_t *)(fImage);
@@ -1456,40 +1400,17 @@ void plMipmap::Filter(float sig)
 
         plFilterMask mask(sig);
 
-        uint32_t srcRowBytes = fRowBytes;
-        uint32_t srcHeight = fHeight;
-        uint32_t srcWidth = fWidth;
+        std::vector<float> weights;
+        plMipmapKernels::FilterInfo info;
+        mask.GetFilterInfo(info, weights);
+        info.fSrcRowBytes = fRowBytes;
+        info.fSrcHeight = fHeight;
+        info.fSrcWidth = fWidth;
+        info.fDstWidth = fWidth;
+        info.fStep = 1;
 
-        for( i = 0; i < fHeight; i++ )
-        {
-            for( j = 0; j < fWidth; j++ )
-            {
-                uint8_t *center = src + i * srcRowBytes + (j << 2);
-
-                uint32_t chan;
-                for( chan = 0; chan < 4; chan++ )
-                {
-                    float w = 0;
-                    float a = 0;
-
-                    for( ii = mask.Begin(); ii <= mask.End(); ii++ )
-                    {
-                        for( jj = mask.Begin(); jj <= mask.End(); jj++ )
-                        {
-                            if( (ii + i >= 0)&&(ii + i < srcHeight)
-                              &&(jj + j >= 0)&&(jj + j < srcWidth) )
-                            {
-                                w += mask.Mask(ii, jj);
-                                a += (float(center[ii*srcRowBytes + (jj<<2) + chan]) + 0.5f) * mask.Mask(ii, jj);
-                            }
-                        }
-                    }
-                    a /= w;
-
-                    dst[i * fRowBytes + (j << 2) + chan] = (uint8_t)(a);
-                }
-            }
-        }
+        for( uint32_t i = 0; i < fHeight; i++ )
+            plMipmapKernels::filter_row.call(dst + i * fRowBytes, src, info, i);
 
         HSMemory::Delete(src);
     }
@@ -1643,8 +1564,8 @@ void    plMipmap::Composite( plMipmap *source, uint16_t x, uint16_t y, plMipmap:
     uint8_t   level, numLevels, srcNumLevels, srcLevelOffset, levelsToSkip;
     uint16_t  pX, pY;
     uint32_t  *srcLevelPtr, *dstLevelPtr, *srcPtr, *dstPtr;
-    uint32_t  srcRowBytes, dstRowBytes, srcRowBytesToCopy, r, g, b, dR, dG, dB, srcWidth, srcHeight;
-    uint32_t  srcAlpha, oneMinusAlpha, destAlpha;
+    uint32_t  srcRowBytes, dstRowBytes, srcRowBytesToCopy, srcWidth, srcHeight;
+    uint32_t  srcAlpha;
     uint16_t  srcClipX, srcClipY;
 
 
@@ -1770,14 +1691,7 @@ void    plMipmap::Composite( plMipmap *source, uint16_t x, uint16_t y, plMipmap:
                 if( options->fFlags & kDestPremultiplied )
                 {
                     // multiply color values by alpha
-                    for( pX = 0; pX < srcWidth; pX++ )
-                    {
-                        srcAlpha = ((dstPtr[ pX ] >> 24) & 0x000000ff);
-                        dstPtr[ pX ] = ( srcAlpha << 24 )
-                            | (((((dstPtr[ pX ] >> 16) & 0xff)*srcAlpha + 127)/255) << 16)
-                            | (((((dstPtr[ pX ] >>  8) & 0xff)*srcAlpha + 127)/255) <<  8)
-                            | (((((dstPtr[ pX ]      ) & 0xff)*srcAlpha + 127)/255)      );
-                    }
+                    plMipmapKernels::premultiply_row.call( dstPtr, srcWidth );
                 }
                 dstPtr += dstRowBytes >> 2;
                 srcPtr += srcRowBytes >> 2;
@@ -1837,6 +1751,8 @@ void    plMipmap::Composite( plMipmap *source, uint16_t x, uint16_t y, plMipmap:
     }
     else
     {
+        const float tint[ 3 ] = { options->fRedTint, options->fGreenTint, options->fBlueTint };
+
         for( level = 0; level < numLevels; level++, y >>= 1, x >>= 1 )
         {
             srcPtr = srcLevelPtr;
@@ -1847,49 +1763,14 @@ void    plMipmap::Composite( plMipmap *source, uint16_t x, uint16_t y, plMipmap:
 
             for( pY = (uint16_t)srcHeight; pY > 0; pY-- )         
             {
-                // Reverse the loop so we can count downwards--slightly faster
-                pX = (uint16_t)srcWidth;
-                do
-                {
-                    pX--;
-
-                    // Wacko trick here. Alphas are 0-255, which means scaling by alpha would
-                    // be a v' = v * alpha / 255 operation sequence. However, since we hate
-                    // dividing by 255 all the time, we actually scale the alpha just ever so
-                    // slightly so it's 0-256, which makes the divide a simple shift. Note
-                    // that this will result in some tiny bit of aliasing, but it shouldn't be
-                    // enough to notice
-                    
-                    if (!(srcPtr[pX] >> 24)) // Zero alpha. Skip this pixel
-                        continue;
-
-                    srcAlpha = options->fOpacity * ( ( srcPtr[ pX ] >> 16 ) & 0x0000ff00 ) / 255 / 256;
-                    oneMinusAlpha = 256 - srcAlpha;
-                    destAlpha = dstPtr[ pX ] & 0xff000000;
-
-                    r = (uint32_t)((( srcPtr[ pX ] >> 16 ) & 0x000000ff) * options->fRedTint);
-                    g = (uint32_t)((( srcPtr[ pX ] >> 8  ) & 0x000000ff) * options->fGreenTint);
-                    b = (uint32_t)((( srcPtr[ pX ]       ) & 0x000000ff) * options->fBlueTint);
-                    dR = ( dstPtr[ pX ] >> 16 ) & 0x000000ff;
-                    dG = ( dstPtr[ pX ] >> 8  ) & 0x000000ff;
-                    dB = ( dstPtr[ pX ]       ) & 0x000000ff;
-                    r = ( r * srcAlpha ) >> 8;
-                    g = ( g * srcAlpha ) >> 8;
-                    b = ( b * srcAlpha ) >> 8;
-                    dR = ( dR * oneMinusAlpha ) >> 8;
-                    dG = ( dG * oneMinusAlpha ) >> 8;
-                    dB = ( dB * oneMinusAlpha ) >> 8;
-
-                    // Dest alpha for now is just our original dest alpha
-                    dstPtr[ pX ] = ( ( r + dR ) << 16 ) | ( ( g + dG ) << 8 ) | ( b + dB ) | destAlpha;
-
-                    if( !( options->fFlags & kBlendWriteAlpha ) )
-                        continue;
-
-                    // Unless our blend option is set of course
-                    dstPtr[ pX ] = ( dstPtr[ pX ] & 0x00ffffff ) | ( srcAlpha << 24 );
-
-                } while( pX > 0 );
+                // Wacko trick here. Alphas are 0-255, which means scaling by alpha would
+                // be a v' = v * alpha / 255 operation sequence. However, since we hate
+                // dividing by 255 all the time, we actually scale the alpha just ever so
+                // slightly so it's 0-256, which makes the divide a simple shift. Note
+                // that this will result in some tiny bit of aliasing, but it shouldn't be
+                // enough to notice
+                plMipmapKernels::blend_row.call( dstPtr, srcPtr, srcWidth, options->fOpacity, tint,
+                                                 ( options->fFlags & kBlendWriteAlpha ) != 0 );
 
                 dstPtr += dstRowBytes >> 2;
                 srcPtr += srcRowBytes >> 2;
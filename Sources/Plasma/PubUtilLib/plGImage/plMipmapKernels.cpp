@@ -0,0 +1,186 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "plMipmapKernels.h"
+
+//// Composite Blend //////////////////////////////////////////////////////////
+//  See plMipmap::Composite() for the reasoning behind the 0-256 alpha.
+
+void plMipmapKernels::blend_row_fpu(uint32_t* dst, const uint32_t* src, uint32_t count,
+                                    uint32_t opacity, const float* rgbTint, bool writeAlpha)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t s = src[i];
+        if (!(s >> 24)) // Zero alpha. Skip this pixel
+            continue;
+
+        uint32_t srcAlpha = opacity * ((s >> 16) & 0x0000ff00) / 255 / 256;
+        uint32_t oneMinusAlpha = 256 - srcAlpha;
+        uint32_t destAlpha = dst[i] & 0xff000000;
+
+        uint32_t r = (uint32_t)(((s >> 16) & 0x000000ff) * rgbTint[0]);
+        uint32_t g = (uint32_t)(((s >> 8 ) & 0x000000ff) * rgbTint[1]);
+        uint32_t b = (uint32_t)(((s      ) & 0x000000ff) * rgbTint[2]);
+        uint32_t dR = (dst[i] >> 16) & 0x000000ff;
+        uint32_t dG = (dst[i] >> 8 ) & 0x000000ff;
+        uint32_t dB = (dst[i]      ) & 0x000000ff;
+        r = (r * srcAlpha) >> 8;
+        g = (g * srcAlpha) >> 8;
+        b = (b * srcAlpha) >> 8;
+        dR = (dR * oneMinusAlpha) >> 8;
+        dG = (dG * oneMinusAlpha) >> 8;
+        dB = (dB * oneMinusAlpha) >> 8;
+
+        dst[i] = ((r + dR) << 16) | ((g + dG) << 8) | (b + dB) | destAlpha;
+        if (writeAlpha)
+            dst[i] = (dst[i] & 0x00ffffff) | (srcAlpha << 24);
+    }
+}
+
+//// Premultiply //////////////////////////////////////////////////////////////
+
+void plMipmapKernels::premultiply_row_fpu(uint32_t* pixels, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t srcAlpha = (pixels[i] >> 24) & 0x000000ff;
+        pixels[i] = (srcAlpha << 24)
+            | (((((pixels[i] >> 16) & 0xff) * srcAlpha + 127) / 255) << 16)
+            | (((((pixels[i] >>  8) & 0xff) * srcAlpha + 127) / 255) <<  8)
+            | (((((pixels[i]      ) & 0xff) * srcAlpha + 127) / 255)      );
+    }
+}
+
+//// Scale ////////////////////////////////////////////////////////////////////
+
+void plMipmapKernels::scale_row_fpu(uint8_t* pixels, uint32_t count, float scale, float bias,
+                                    uint32_t chanMask)
+{
+    for (uint32_t i = 0; i < count; i++, pixels += 4) {
+        for (uint32_t chan = 0; chan < 4; chan++) {
+            if (chanMask & (1 << chan))
+                pixels[chan] = (uint8_t)(bias + (float)pixels[chan] * scale);
+        }
+    }
+}
+
+//// Filter ///////////////////////////////////////////////////////////////////
+
+void plMipmapKernels::filter_row_fpu(uint8_t* dst, const uint8_t* src, const FilterInfo& info,
+                                     uint32_t srcY)
+{
+    const int ext = info.fMaskExt;
+    const int maskStride = (ext << 1) + 1;
+
+    for (uint32_t x = 0; x < info.fDstWidth; x++) {
+        const int srcX = x * info.fStep;
+        const uint8_t* center = src + srcY * info.fSrcRowBytes + (srcX << 2);
+
+        for (uint32_t chan = 0; chan < 4; chan++) {
+            float w = 0;
+            float a = 0;
+
+            for (int ii = -ext; ii <= ext; ii++) {
+                const float* maskRow = info.fMask + (ii + ext) * maskStride + ext;
+                for (int jj = -ext; jj <= ext; jj++) {
+                    if ((ii + (int)srcY >= 0) && (ii + (int)srcY < (int)info.fSrcHeight)
+                        && (jj + srcX >= 0) && (jj + srcX < (int)info.fSrcWidth)) {
+                        w += maskRow[jj];
+                        a += (float(center[ii * (int)info.fSrcRowBytes + (jj << 2) + (int)chan]) + 0.5f) * maskRow[jj];
+                    }
+                }
+            }
+            a /= w;
+
+            dst[(x << 2) + chan] = (uint8_t)a;
+        }
+    }
+}
+
+//// Dispatchers //////////////////////////////////////////////////////////////
+
+hsCpuFunctionDispatcher<plMipmapKernels::blend_row_ptr> plMipmapKernels::blend_row {
+    &plMipmapKernels::blend_row_fpu,
+    nullptr,            // SSE1
+    &plMipmapKernels::blend_row_sse2,
+    nullptr,            // SSE3
+    nullptr,            // SSSE3
+    nullptr,            // SSE4.1
+    nullptr,            // SSE4.2
+    nullptr,            // AVX
+    &plMipmapKernels::blend_row_avx2
+};
+
+hsCpuFunctionDispatcher<plMipmapKernels::premultiply_row_ptr> plMipmapKernels::premultiply_row {
+    &plMipmapKernels::premultiply_row_fpu,
+    nullptr,            // SSE1
+    &plMipmapKernels::premultiply_row_sse2,
+    nullptr,            // SSE3
+    nullptr,            // SSSE3
+    nullptr,            // SSE4.1
+    nullptr,            // SSE4.2
+    nullptr,            // AVX
+    &plMipmapKernels::premultiply_row_avx2
+};
+
+hsCpuFunctionDispatcher<plMipmapKernels::scale_row_ptr> plMipmapKernels::scale_row {
+    &plMipmapKernels::scale_row_fpu,
+    nullptr,            // SSE1
+    &plMipmapKernels::scale_row_sse2,
+    nullptr,            // SSE3
+    nullptr,            // SSSE3
+    nullptr,            // SSE4.1
+    nullptr,            // SSE4.2
+    nullptr,            // AVX
+    &plMipmapKernels::scale_row_avx2
+};
+
+hsCpuFunctionDispatcher<plMipmapKernels::filter_row_ptr> plMipmapKernels::filter_row {
+    &plMipmapKernels::filter_row_fpu,
+    nullptr,            // SSE1
+    &plMipmapKernels::filter_row_sse2,
+    nullptr,            // SSE3
+    nullptr,            // SSSE3
+    nullptr,            // SSE4.1
+    nullptr,            // SSE4.2
+    nullptr,            // AVX
+    &plMipmapKernels::filter_row_avx2
+};
@@ -0,0 +1,131 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+//  plMipmapKernels - Row kernels for plMipmap compositing and filtering     //
+//                                                                           //
+//  Each kernel has a plain C++ version plus SIMD versions that get picked   //
+//  once at startup through hsCpuFunctionDispatcher. The SIMD versions give  //
+//  bit-identical results to the plain ones: the float kernels do the same   //
+//  per-channel operations in the same order (only across channels at       //
+//  once), and the integer kernels use an exact divide-by-255 for inputs     //
+//  below 65535. Call through the dispatchers (e.g. blend_row.call(...)),    //
+//  the _fpu versions are public so that tools can compare against them.     //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef _plMipmapKernels_h
+#define _plMipmapKernels_h
+
+#include "HeadSpin.h"
+#include "hsCpuID.h"
+
+class plMipmapKernels
+{
+public:
+    // Describes the source image and mask for filter_row. The mask is stored
+    // row-major, (2 * fMaskExt + 1) floats on a side, centered on the pixel.
+    struct FilterInfo
+    {
+        const float*    fMask;
+        int             fMaskExt;
+        uint32_t        fSrcRowBytes;
+        uint32_t        fSrcWidth;
+        uint32_t        fSrcHeight;
+        uint32_t        fDstWidth;
+        uint32_t        fStep;          // 1 to filter in place, 2 to build the next mip level
+    };
+
+    // Default Composite() blend of one row of ARGB32 pixels. Zero-alpha source
+    // pixels are skipped. Tints outside [0,1] always take the plain path.
+    typedef void(*blend_row_ptr)(uint32_t* dst, const uint32_t* src, uint32_t count,
+                                 uint32_t opacity, const float* rgbTint, bool writeAlpha);
+    static hsCpuFunctionDispatcher<blend_row_ptr> blend_row;
+
+    // Premultiplies the color channels of a row of ARGB32 pixels by their alpha.
+    typedef void(*premultiply_row_ptr)(uint32_t* pixels, uint32_t count);
+    static hsCpuFunctionDispatcher<premultiply_row_ptr> premultiply_row;
+
+    // byte = (uint8_t)(bias + byte * scale) for each channel whose bit is set
+    // in chanMask (bit 0 is the first byte of each pixel). Used to fade in
+    // detail maps.
+    typedef void(*scale_row_ptr)(uint8_t* pixels, uint32_t count, float scale, float bias,
+                                 uint32_t chanMask);
+    static hsCpuFunctionDispatcher<scale_row_ptr> scale_row;
+
+    // Writes one row of filtered pixels, centering the mask on source row srcY
+    // and source column (x * fStep) for each destination pixel x.
+    typedef void(*filter_row_ptr)(uint8_t* dst, const uint8_t* src, const FilterInfo& info,
+                                  uint32_t srcY);
+    static hsCpuFunctionDispatcher<filter_row_ptr> filter_row;
+
+    static void blend_row_fpu(uint32_t* dst, const uint32_t* src, uint32_t count,
+                              uint32_t opacity, const float* rgbTint, bool writeAlpha);
+    static void blend_row_sse2(uint32_t* dst, const uint32_t* src, uint32_t count,
+                               uint32_t opacity, const float* rgbTint, bool writeAlpha);
+    static void blend_row_avx2(uint32_t* dst, const uint32_t* src, uint32_t count,
+                               uint32_t opacity, const float* rgbTint, bool writeAlpha);
+
+    static void premultiply_row_fpu(uint32_t* pixels, uint32_t count);
+    static void premultiply_row_sse2(uint32_t* pixels, uint32_t count);
+    static void premultiply_row_avx2(uint32_t* pixels, uint32_t count);
+
+    static void scale_row_fpu(uint8_t* pixels, uint32_t count, float scale, float bias, uint32_t chanMask);
+    static void scale_row_sse2(uint8_t* pixels, uint32_t count, float scale, float bias, uint32_t chanMask);
+    static void scale_row_avx2(uint8_t* pixels, uint32_t count, float scale, float bias, uint32_t chanMask);
+
+    static void filter_row_fpu(uint8_t* dst, const uint8_t* src, const FilterInfo& info, uint32_t srcY);
+    static void filter_row_sse2(uint8_t* dst, const uint8_t* src, const FilterInfo& info, uint32_t srcY);
+    static void filter_row_avx2(uint8_t* dst, const uint8_t* src, const FilterInfo& info, uint32_t srcY);
+
+    // True if the SIMD blend can reproduce the plain blend for these tints
+    static bool CanVectorizeTint(const float* rgbTint)
+    {
+        for (int i = 0; i < 3; i++) {
+            if (!(rgbTint[i] >= 0.f && rgbTint[i] <= 1.f))
+                return false;
+        }
+        return true;
+    }
+};
+
+#endif // _plMipmapKernels_h
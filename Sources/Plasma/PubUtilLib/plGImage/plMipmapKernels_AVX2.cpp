@@ -0,0 +1,303 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "plMipmapKernels.h"
+
+#include <cstring>
+
+#ifdef HAVE_AVX2
+#   include <immintrin.h>
+
+// x / 255 for 0 <= x < 65535, in each 16-bit lane
+static inline __m256i IDiv255_16(__m256i x)
+{
+    __m256i t = _mm256_add_epi16(_mm256_add_epi16(x, _mm256_set1_epi16(1)), _mm256_srli_epi16(x, 8));
+    return _mm256_srli_epi16(t, 8);
+}
+
+// x / 255 for 0 <= x < 65535, in each 32-bit lane
+static inline __m256i IDiv255_32(__m256i x)
+{
+    __m256i t = _mm256_add_epi32(_mm256_add_epi32(x, _mm256_set1_epi32(1)), _mm256_srli_epi32(x, 8));
+    return _mm256_srli_epi32(t, 8);
+}
+
+// (uint32_t)(c * tint) for each channel value c in [0,255]
+static inline __m256i ITint(__m256i c, __m256 tint)
+{
+    return _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(c), tint));
+}
+
+static inline __m128i ILoadPixel(const uint8_t* p)
+{
+    uint32_t pixel;
+    memcpy(&pixel, p, sizeof(pixel));
+    return _mm_cvtsi32_si128(static_cast<int>(pixel));
+}
+#endif // HAVE_AVX2
+
+//// Composite Blend //////////////////////////////////////////////////////////
+//  Same approach as the SSE2 version, eight pixels at a time.
+
+void plMipmapKernels::blend_row_avx2(uint32_t* dst, const uint32_t* src, uint32_t count,
+                                     uint32_t opacity, const float* rgbTint, bool writeAlpha)
+{
+#ifdef HAVE_AVX2
+    if (!CanVectorizeTint(rgbTint)) {
+        blend_row_fpu(dst, src, count, opacity, rgbTint, writeAlpha);
+        return;
+    }
+
+    const bool tinted = rgbTint[0] != 1.f || rgbTint[1] != 1.f || rgbTint[2] != 1.f;
+    const __m256 tintR = _mm256_set1_ps(rgbTint[0]);
+    const __m256 tintG = _mm256_set1_ps(rgbTint[1]);
+    const __m256 tintB = _mm256_set1_ps(rgbTint[2]);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i chanMask = _mm256_set1_epi32(0xff);
+    const __m256i alphaMask = _mm256_set1_epi32(static_cast<int>(0xff000000));
+    const __m256i vOpacity = _mm256_set1_epi32(opacity);
+    const __m256i v256 = _mm256_set1_epi32(256);
+
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+
+        __m256i sa = _mm256_srli_epi32(s, 24);
+        __m256i skip = _mm256_cmpeq_epi32(sa, zero);
+        if (_mm256_movemask_epi8(skip) == -1)
+            continue;
+
+        __m256i srcAlpha = IDiv255_32(_mm256_mullo_epi16(sa, vOpacity));
+        __m256i oneMinusAlpha = _mm256_sub_epi32(v256, srcAlpha);
+
+        __m256i r = _mm256_and_si256(_mm256_srli_epi32(s, 16), chanMask);
+        __m256i g = _mm256_and_si256(_mm256_srli_epi32(s, 8), chanMask);
+        __m256i b = _mm256_and_si256(s, chanMask);
+        if (tinted) {
+            r = ITint(r, tintR);
+            g = ITint(g, tintG);
+            b = ITint(b, tintB);
+        }
+        __m256i dR = _mm256_and_si256(_mm256_srli_epi32(d, 16), chanMask);
+        __m256i dG = _mm256_and_si256(_mm256_srli_epi32(d, 8), chanMask);
+        __m256i dB = _mm256_and_si256(d, chanMask);
+
+        r = _mm256_add_epi32(_mm256_srli_epi32(_mm256_mullo_epi16(r, srcAlpha), 8),
+                             _mm256_srli_epi32(_mm256_mullo_epi16(dR, oneMinusAlpha), 8));
+        g = _mm256_add_epi32(_mm256_srli_epi32(_mm256_mullo_epi16(g, srcAlpha), 8),
+                             _mm256_srli_epi32(_mm256_mullo_epi16(dG, oneMinusAlpha), 8));
+        b = _mm256_add_epi32(_mm256_srli_epi32(_mm256_mullo_epi16(b, srcAlpha), 8),
+                             _mm256_srli_epi32(_mm256_mullo_epi16(dB, oneMinusAlpha), 8));
+
+        __m256i alpha = writeAlpha ? _mm256_slli_epi32(srcAlpha, 24) : _mm256_and_si256(d, alphaMask);
+        __m256i result = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi32(r, 16), _mm256_slli_epi32(g, 8)),
+                                         _mm256_or_si256(b, alpha));
+
+        result = _mm256_blendv_epi8(result, d, skip);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), result);
+    }
+
+    blend_row_fpu(dst + i, src + i, count - i, opacity, rgbTint, writeAlpha);
+#else
+    blend_row_fpu(dst, src, count, opacity, rgbTint, writeAlpha);
+#endif
+}
+
+//// Premultiply //////////////////////////////////////////////////////////////
+
+void plMipmapKernels::premultiply_row_avx2(uint32_t* pixels, uint32_t count)
+{
+#ifdef HAVE_AVX2
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i round = _mm256_set1_epi16(127);
+    const __m256i alphaMask = _mm256_set1_epi32(static_cast<int>(0xff000000));
+
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pixels + i));
+
+        // Unpack and pack both work within each 128-bit lane, so the pixel
+        // order comes back out the same way it went in.
+        __m256i lo = _mm256_unpacklo_epi8(p, zero);
+        __m256i hi = _mm256_unpackhi_epi8(p, zero);
+        __m256i aLo = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(lo, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        __m256i aHi = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(hi, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+
+        lo = IDiv255_16(_mm256_add_epi16(_mm256_mullo_epi16(lo, aLo), round));
+        hi = IDiv255_16(_mm256_add_epi16(_mm256_mullo_epi16(hi, aHi), round));
+
+        __m256i result = _mm256_packus_epi16(lo, hi);
+        result = _mm256_blendv_epi8(result, p, alphaMask);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(pixels + i), result);
+    }
+
+    premultiply_row_fpu(pixels + i, count - i);
+#else
+    premultiply_row_fpu(pixels, count);
+#endif
+}
+
+//// Scale ////////////////////////////////////////////////////////////////////
+
+void plMipmapKernels::scale_row_avx2(uint8_t* pixels, uint32_t count, float scale, float bias,
+                                     uint32_t chanMask)
+{
+#ifdef HAVE_AVX2
+    uint32_t laneMask = 0;
+    for (uint32_t chan = 0; chan < 4; chan++) {
+        if (chanMask & (1 << chan))
+            laneMask |= 0xff << (chan << 3);
+    }
+
+    const __m256i keep = _mm256_set1_epi32(static_cast<int>(laneMask));
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    const __m256 vScale = _mm256_set1_ps(scale);
+    const __m256 vBias = _mm256_set1_ps(bias);
+
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        uint8_t* row = pixels + (i << 2);
+        __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row));
+
+        __m256i c[4];
+        for (int k = 0; k < 4; k++) {
+            __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(row + (k << 3)));
+            __m256 f = _mm256_add_ps(vBias, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes)), vScale));
+            c[k] = _mm256_cvttps_epi32(f);
+        }
+
+        // The packs interleave 4-byte groups across the 128-bit lanes; put
+        // them back in order afterwards.
+        __m256i result = _mm256_packus_epi16(_mm256_packs_epi32(c[0], c[1]), _mm256_packs_epi32(c[2], c[3]));
+        result = _mm256_permutevar8x32_epi32(result, order);
+        result = _mm256_blendv_epi8(p, result, keep);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(row), result);
+    }
+
+    scale_row_fpu(pixels + (i << 2), count - i, scale, bias, chanMask);
+#else
+    scale_row_fpu(pixels, count, scale, bias, chanMask);
+#endif
+}
+
+//// Filter ///////////////////////////////////////////////////////////////////
+//  Two neighboring pixels per register where the whole mask fits inside the
+//  source, one pixel per register along the edges. The taps are summed in the
+//  same order as the plain version, so the float results match exactly.
+
+void plMipmapKernels::filter_row_avx2(uint8_t* dst, const uint8_t* src, const FilterInfo& info,
+                                      uint32_t srcY)
+{
+#ifdef HAVE_AVX2
+    const int ext = info.fMaskExt;
+    const int maskStride = (ext << 1) + 1;
+    const int rowBytes = (int)info.fSrcRowBytes;
+    const int step = (int)info.fStep;
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m256 half8 = _mm256_set1_ps(0.5f);
+
+    const bool rowInside = (int)srcY - ext >= 0 && (int)srcY + ext < (int)info.fSrcHeight;
+
+    float fullWeight = 0;
+    for (int k = 0; k < maskStride * maskStride; k++)
+        fullWeight += info.fMask[k];
+
+    uint32_t x = 0;
+    while (x < info.fDstWidth) {
+        const int srcX = x * step;
+        const uint8_t* center = src + srcY * info.fSrcRowBytes + (srcX << 2);
+
+        if (rowInside && x + 1 < info.fDstWidth && srcX - ext >= 0 && srcX + step + ext < (int)info.fSrcWidth) {
+            __m256 a = _mm256_setzero_ps();
+            for (int ii = -ext; ii <= ext; ii++) {
+                const float* maskRow = info.fMask + (ii + ext) * maskStride + ext;
+                const uint8_t* srcRow = center + ii * rowBytes;
+                for (int jj = -ext; jj <= ext; jj++) {
+                    const uint8_t* tap = srcRow + (jj << 2);
+                    __m128i c = _mm_unpacklo_epi32(ILoadPixel(tap), ILoadPixel(tap + (step << 2)));
+                    __m256 f = _mm256_add_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(c)), half8);
+                    a = _mm256_add_ps(a, _mm256_mul_ps(f, _mm256_set1_ps(maskRow[jj])));
+                }
+            }
+
+            __m256i v = _mm256_cvttps_epi32(_mm256_div_ps(a, _mm256_set1_ps(fullWeight)));
+            __m128i v16 = _mm_packs_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + (x << 2)), _mm_packus_epi16(v16, v16));
+            x += 2;
+            continue;
+        }
+
+        const bool inside = rowInside && srcX - ext >= 0 && srcX + ext < (int)info.fSrcWidth;
+        float w = inside ? fullWeight : 0.f;
+        __m128 a = _mm_setzero_ps();
+
+        for (int ii = -ext; ii <= ext; ii++) {
+            if (!inside && (ii + (int)srcY < 0 || ii + (int)srcY >= (int)info.fSrcHeight))
+                continue;
+
+            const float* maskRow = info.fMask + (ii + ext) * maskStride + ext;
+            const uint8_t* srcRow = center + ii * rowBytes;
+            for (int jj = -ext; jj <= ext; jj++) {
+                if (!inside) {
+                    if (jj + srcX < 0 || jj + srcX >= (int)info.fSrcWidth)
+                        continue;
+                    w += maskRow[jj];
+                }
+
+                __m128i c = _mm_cvtepu8_epi32(ILoadPixel(srcRow + (jj << 2)));
+                __m128 f = _mm_add_ps(_mm_cvtepi32_ps(c), half);
+                a = _mm_add_ps(a, _mm_mul_ps(f, _mm_set1_ps(maskRow[jj])));
+            }
+        }
+
+        __m128i v = _mm_cvttps_epi32(_mm_div_ps(a, _mm_set1_ps(w)));
+        v = _mm_packs_epi32(v, v);
+        v = _mm_packus_epi16(v, v);
+        uint32_t pixel = static_cast<uint32_t>(_mm_cvtsi128_si32(v));
+        memcpy(dst + (x << 2), &pixel, sizeof(pixel));
+        x++;
+    }
+#else
+    filter_row_fpu(dst, src, info, srcY);
+#endif
+}
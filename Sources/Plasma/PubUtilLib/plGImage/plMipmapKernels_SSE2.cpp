@@ -0,0 +1,289 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "plMipmapKernels.h"
+
+#include <cstring>
+
+#ifdef HAVE_SSE2
+#   include <emmintrin.h>
+
+// x / 255 for 0 <= x < 65535, in each 16-bit lane
+static inline __m128i IDiv255_16(__m128i x)
+{
+    __m128i t = _mm_add_epi16(_mm_add_epi16(x, _mm_set1_epi16(1)), _mm_srli_epi16(x, 8));
+    return _mm_srli_epi16(t, 8);
+}
+
+// x / 255 for 0 <= x < 65535, in each 32-bit lane
+static inline __m128i IDiv255_32(__m128i x)
+{
+    __m128i t = _mm_add_epi32(_mm_add_epi32(x, _mm_set1_epi32(1)), _mm_srli_epi32(x, 8));
+    return _mm_srli_epi32(t, 8);
+}
+
+// (uint32_t)(c * tint) for each channel value c in [0,255]
+static inline __m128i ITint(__m128i c, __m128 tint)
+{
+    return _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(c), tint));
+}
+
+static inline __m128i ILoadPixel(const uint8_t* p)
+{
+    uint32_t pixel;
+    memcpy(&pixel, p, sizeof(pixel));
+    return _mm_cvtsi32_si128(static_cast<int>(pixel));
+}
+
+static inline void IStorePixel(uint8_t* p, __m128 value)
+{
+    __m128i v = _mm_cvttps_epi32(value);
+    v = _mm_packs_epi32(v, v);
+    v = _mm_packus_epi16(v, v);
+    uint32_t pixel = static_cast<uint32_t>(_mm_cvtsi128_si32(v));
+    memcpy(p, &pixel, sizeof(pixel));
+}
+#endif // HAVE_SSE2
+
+//// Composite Blend //////////////////////////////////////////////////////////
+//  Works on four pixels at a time, one channel per register. Every product
+//  fits in 16 bits, so _mm_mullo_epi16 is exact on the zero-extended lanes.
+//  srcAlpha is computed as opacity * a / 255, which is what the plain
+//  version's opacity * (a << 8) / 255 / 256 works out to.
+
+void plMipmapKernels::blend_row_sse2(uint32_t* dst, const uint32_t* src, uint32_t count,
+                                     uint32_t opacity, const float* rgbTint, bool writeAlpha)
+{
+#ifdef HAVE_SSE2
+    if (!CanVectorizeTint(rgbTint)) {
+        blend_row_fpu(dst, src, count, opacity, rgbTint, writeAlpha);
+        return;
+    }
+
+    const bool tinted = rgbTint[0] != 1.f || rgbTint[1] != 1.f || rgbTint[2] != 1.f;
+    const __m128 tintR = _mm_set1_ps(rgbTint[0]);
+    const __m128 tintG = _mm_set1_ps(rgbTint[1]);
+    const __m128 tintB = _mm_set1_ps(rgbTint[2]);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i chanMask = _mm_set1_epi32(0xff);
+    const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(0xff000000));
+    const __m128i vOpacity = _mm_set1_epi32(opacity);
+    const __m128i v256 = _mm_set1_epi32(256);
+
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+
+        __m128i sa = _mm_srli_epi32(s, 24);
+        __m128i skip = _mm_cmpeq_epi32(sa, zero);
+        if (_mm_movemask_epi8(skip) == 0xffff)
+            continue;
+
+        __m128i srcAlpha = IDiv255_32(_mm_mullo_epi16(sa, vOpacity));
+        __m128i oneMinusAlpha = _mm_sub_epi32(v256, srcAlpha);
+
+        __m128i r = _mm_and_si128(_mm_srli_epi32(s, 16), chanMask);
+        __m128i g = _mm_and_si128(_mm_srli_epi32(s, 8), chanMask);
+        __m128i b = _mm_and_si128(s, chanMask);
+        if (tinted) {
+            r = ITint(r, tintR);
+            g = ITint(g, tintG);
+            b = ITint(b, tintB);
+        }
+        __m128i dR = _mm_and_si128(_mm_srli_epi32(d, 16), chanMask);
+        __m128i dG = _mm_and_si128(_mm_srli_epi32(d, 8), chanMask);
+        __m128i dB = _mm_and_si128(d, chanMask);
+
+        r = _mm_add_epi32(_mm_srli_epi32(_mm_mullo_epi16(r, srcAlpha), 8),
+                          _mm_srli_epi32(_mm_mullo_epi16(dR, oneMinusAlpha), 8));
+        g = _mm_add_epi32(_mm_srli_epi32(_mm_mullo_epi16(g, srcAlpha), 8),
+                          _mm_srli_epi32(_mm_mullo_epi16(dG, oneMinusAlpha), 8));
+        b = _mm_add_epi32(_mm_srli_epi32(_mm_mullo_epi16(b, srcAlpha), 8),
+                          _mm_srli_epi32(_mm_mullo_epi16(dB, oneMinusAlpha), 8));
+
+        __m128i alpha = writeAlpha ? _mm_slli_epi32(srcAlpha, 24) : _mm_and_si128(d, alphaMask);
+        __m128i result = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(r, 16), _mm_slli_epi32(g, 8)),
+                                      _mm_or_si128(b, alpha));
+
+        result = _mm_or_si128(_mm_and_si128(skip, d), _mm_andnot_si128(skip, result));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), result);
+    }
+
+    blend_row_fpu(dst + i, src + i, count - i, opacity, rgbTint, writeAlpha);
+#else
+    blend_row_fpu(dst, src, count, opacity, rgbTint, writeAlpha);
+#endif
+}
+
+//// Premultiply //////////////////////////////////////////////////////////////
+
+void plMipmapKernels::premultiply_row_sse2(uint32_t* pixels, uint32_t count)
+{
+#ifdef HAVE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi16(127);
+    const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(0xff000000));
+
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + i));
+
+        __m128i lo = _mm_unpacklo_epi8(p, zero);
+        __m128i hi = _mm_unpackhi_epi8(p, zero);
+        __m128i aLo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        __m128i aHi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+
+        lo = IDiv255_16(_mm_add_epi16(_mm_mullo_epi16(lo, aLo), round));
+        hi = IDiv255_16(_mm_add_epi16(_mm_mullo_epi16(hi, aHi), round));
+
+        __m128i result = _mm_packus_epi16(lo, hi);
+        result = _mm_or_si128(_mm_andnot_si128(alphaMask, result), _mm_and_si128(alphaMask, p));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + i), result);
+    }
+
+    premultiply_row_fpu(pixels + i, count - i);
+#else
+    premultiply_row_fpu(pixels, count);
+#endif
+}
+
+//// Scale ////////////////////////////////////////////////////////////////////
+
+void plMipmapKernels::scale_row_sse2(uint8_t* pixels, uint32_t count, float scale, float bias,
+                                     uint32_t chanMask)
+{
+#ifdef HAVE_SSE2
+    uint32_t laneMask = 0;
+    for (uint32_t chan = 0; chan < 4; chan++) {
+        if (chanMask & (1 << chan))
+            laneMask |= 0xff << (chan << 3);
+    }
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i keep = _mm_set1_epi32(static_cast<int>(laneMask));
+    const __m128 vScale = _mm_set1_ps(scale);
+    const __m128 vBias = _mm_set1_ps(bias);
+
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + (i << 2)));
+
+        __m128i lo = _mm_unpacklo_epi8(p, zero);
+        __m128i hi = _mm_unpackhi_epi8(p, zero);
+        __m128i c[4] = {
+            _mm_unpacklo_epi16(lo, zero),
+            _mm_unpackhi_epi16(lo, zero),
+            _mm_unpacklo_epi16(hi, zero),
+            _mm_unpackhi_epi16(hi, zero)
+        };
+        for (int k = 0; k < 4; k++) {
+            __m128 f = _mm_add_ps(vBias, _mm_mul_ps(_mm_cvtepi32_ps(c[k]), vScale));
+            c[k] = _mm_cvttps_epi32(f);
+        }
+
+        __m128i result = _mm_packus_epi16(_mm_packs_epi32(c[0], c[1]), _mm_packs_epi32(c[2], c[3]));
+        result = _mm_or_si128(_mm_and_si128(keep, result), _mm_andnot_si128(keep, p));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + (i << 2)), result);
+    }
+
+    scale_row_fpu(pixels + (i << 2), count - i, scale, bias, chanMask);
+#else
+    scale_row_fpu(pixels, count, scale, bias, chanMask);
+#endif
+}
+
+//// Filter ///////////////////////////////////////////////////////////////////
+//  One pixel per register, all four channels at once. The taps are summed in
+//  the same order as the plain version, so the float results match exactly.
+
+void plMipmapKernels::filter_row_sse2(uint8_t* dst, const uint8_t* src, const FilterInfo& info,
+                                      uint32_t srcY)
+{
+#ifdef HAVE_SSE2
+    const int ext = info.fMaskExt;
+    const int maskStride = (ext << 1) + 1;
+    const int rowBytes = (int)info.fSrcRowBytes;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 half = _mm_set1_ps(0.5f);
+
+    const bool rowInside = (int)srcY - ext >= 0 && (int)srcY + ext < (int)info.fSrcHeight;
+
+    // Weight total for a fully covered mask, summed in tap order
+    float fullWeight = 0;
+    for (int k = 0; k < maskStride * maskStride; k++)
+        fullWeight += info.fMask[k];
+
+    for (uint32_t x = 0; x < info.fDstWidth; x++) {
+        const int srcX = x * info.fStep;
+        const uint8_t* center = src + srcY * info.fSrcRowBytes + (srcX << 2);
+        const bool inside = rowInside && srcX - ext >= 0 && srcX + ext < (int)info.fSrcWidth;
+
+        float w = inside ? fullWeight : 0.f;
+        __m128 a = _mm_setzero_ps();
+
+        for (int ii = -ext; ii <= ext; ii++) {
+            if (!inside && (ii + (int)srcY < 0 || ii + (int)srcY >= (int)info.fSrcHeight))
+                continue;
+
+            const float* maskRow = info.fMask + (ii + ext) * maskStride + ext;
+            const uint8_t* srcRow = center + ii * rowBytes;
+            for (int jj = -ext; jj <= ext; jj++) {
+                if (!inside) {
+                    if (jj + srcX < 0 || jj + srcX >= (int)info.fSrcWidth)
+                        continue;
+                    w += maskRow[jj];
+                }
+
+                __m128i c = ILoadPixel(srcRow + (jj << 2));
+                c = _mm_unpacklo_epi16(_mm_unpacklo_epi8(c, zero), zero);
+                __m128 f = _mm_add_ps(_mm_cvtepi32_ps(c), half);
+                a = _mm_add_ps(a, _mm_mul_ps(f, _mm_set1_ps(maskRow[jj])));
+            }
+        }
+
+        IStorePixel(dst + (x << 2), _mm_div_ps(a, _mm_set1_ps(w)));
+    }
+#else
+    filter_row_fpu(dst, src, info, srcY);
+#endif
+}
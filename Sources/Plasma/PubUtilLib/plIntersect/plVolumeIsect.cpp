@@ -48,6 +48,8 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "hsResMgr.h"
 #include "plIntersect/plClosest.h"
 
+#include <limits>
+
 static const float kDefLength = 5.f;
 
 plSphereIsect::plSphereIsect()
@@ -578,6 +580,14 @@ plVolumeCullResult plParallelIsect::Test(const hsBounds3Ext& bnd) const
     return retVal;
 }
 
+bool plParallelIsect::GetSlabs(std::vector<plVolumeSlab>& slabs) const
+{
+    slabs.clear();
+    for (const ParPlane& plane : fPlanes)
+        slabs.push_back({ plane.fNorm, plane.fMin, plane.fMax });
+    return true;
+}
+
 float plParallelIsect::Test(const hsPoint3& pos) const
 {
     float maxDist = 0;
@@ -721,6 +731,15 @@ plVolumeCullResult plConvexIsect::Test(const hsBounds3Ext& bnd) const
     return retVal;
 }
 
+bool plConvexIsect::GetSlabs(std::vector<plVolumeSlab>& slabs) const
+{
+    // Open on the inside, so only the far side of each plane can cull
+    slabs.clear();
+    for (const SinglePlane& plane : fPlanes)
+        slabs.push_back({ plane.fWorldNorm, -std::numeric_limits<float>::infinity(), plane.fWorldDist });
+    return true;
+}
+
 float plConvexIsect::Test(const hsPoint3& pos) const
 {
     float maxDist = 0;
@@ -59,6 +59,14 @@ enum plVolumeCullResult
     kVolumeSplit        = 0x2
 };
 
+// The volume between two parallel planes, fMin <= fNorm.p <= fMax
+struct plVolumeSlab
+{
+    hsVector3   fNorm;
+    float       fMin;
+    float       fMax;
+};
+
 
 class plVolumeIsect : public plCreatable
 {
@@ -70,6 +78,13 @@ public:
     virtual plVolumeCullResult  Test(const hsBounds3Ext& bnd) const = 0;    
     virtual float            Test(const hsPoint3& pos) const = 0;
 
+    // Volumes made only of planes can hand them over as slabs, so boxes can
+    // be tested against them in bulk. Test(bnd) on an axis aligned box must
+    // give the same answer as testing it against the slabs, computing the
+    // box's depths the way hsBounds3::TestPlane does. Returns false if the
+    // volume can't be described that way.
+    virtual bool GetSlabs(std::vector<plVolumeSlab>& slabs) const { return false; }
+
     void Read(hsStream* s, hsResMgr* mgr) override = 0;
     void Write(hsStream* s, hsResMgr* mgr) override = 0;
 };
@@ -204,6 +219,7 @@ public:
 
     plVolumeCullResult  Test(const hsBounds3Ext& bnd) const override;
     float            Test(const hsPoint3& pos) const override;
+    bool                GetSlabs(std::vector<plVolumeSlab>& slabs) const override;
 
     void Read(hsStream* s, hsResMgr* mgr) override;
     void Write(hsStream* s, hsResMgr* mgr) override;
@@ -238,6 +254,7 @@ public:
 
     plVolumeCullResult  Test(const hsBounds3Ext& bnd) const override;
     float            Test(const hsPoint3& pos) const override;
+    bool                GetSlabs(std::vector<plVolumeSlab>& slabs) const override;
 
     void Read(hsStream* s, hsResMgr* mgr) override;
     void Write(hsStream* s, hsResMgr* mgr) override;
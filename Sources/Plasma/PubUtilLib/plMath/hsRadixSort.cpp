@@ -44,6 +44,8 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "hsMemory.h"
 #include "hsRadixSort.h"
 
+#include <utility>
+
 hsRadixSort::hsRadixSort() : fList()
 {
     HSMemory::Clear(fHeads, 256*sizeof(Elem*));
@@ -179,3 +181,59 @@ hsRadixSort::Elem* hsRadixSort::Sort(Elem* inList, uint32_t flags)
 
     return fList;
 }
+
+void hsRadixSort::SortUnsigned(uint32_t* keys, uint32_t* indices,
+                               uint32_t* keyScratch, uint32_t* indexScratch, uint32_t count)
+{
+    if( count < 2 )
+        return;
+
+    // One pass over the keys builds the histograms for all four bytes
+    uint32_t counts[4][256];
+    memset(counts, 0, sizeof(counts));
+    for( uint32_t i = 0; i < count; i++ )
+    {
+        uint32_t key = keys[i];
+        counts[0][key & 0xff]++;
+        counts[1][(key >> 8) & 0xff]++;
+        counts[2][(key >> 16) & 0xff]++;
+        counts[3][key >> 24]++;
+    }
+
+    uint32_t* srcKeys = keys;
+    uint32_t* srcIndices = indices;
+    uint32_t* dstKeys = keyScratch;
+    uint32_t* dstIndices = indexScratch;
+    for( int pass = 0; pass < 4; pass++ )
+    {
+        const int shift = pass * 8;
+        const uint32_t* histo = counts[pass];
+        if( histo[(srcKeys[0] >> shift) & 0xff] == count )
+            continue;
+
+        uint32_t offsets[256];
+        uint32_t sum = 0;
+        for( int i = 0; i < 256; i++ )
+        {
+            offsets[i] = sum;
+            sum += histo[i];
+        }
+
+        for( uint32_t i = 0; i < count; i++ )
+        {
+            uint32_t key = srcKeys[i];
+            uint32_t dst = offsets[(key >> shift) & 0xff]++;
+            dstKeys[dst] = key;
+            dstIndices[dst] = srcIndices[i];
+        }
+
+        std::swap(srcKeys, dstKeys);
+        std::swap(srcIndices, dstIndices);
+    }
+
+    if( srcKeys != keys )
+    {
+        memcpy(keys, srcKeys, count * sizeof(uint32_t));
+        memcpy(indices, srcIndices, count * sizeof(uint32_t));
+    }
+}
@@ -43,6 +43,9 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #ifndef hsRadixSort_inc
 #define hsRadixSort_inc
 
+#include <cstdint>
+#include <cstring>
+
 class hsRadixSortElem 
 {
 public:
@@ -86,6 +89,21 @@ public:
 
     Elem*   Sort(Elem* inList, uint32_t flags = 0);
 
+    // Array version, for when the keys can be packed contiguously. Sorts
+    // count unsigned keys ascending, least significant byte first, moving
+    // indices along with them. Equal keys keep their input order. The
+    // scratch arrays must hold count entries each. Passes over a byte that's
+    // the same in every key are skipped.
+    static void SortUnsigned(uint32_t* keys, uint32_t* indices,
+                             uint32_t* keyScratch, uint32_t* indexScratch, uint32_t count);
+
+    // Unsigned key that sorts in the same order as the float does
+    static uint32_t FloatKey(float f)
+    {
+        uint32_t bits;
+        memcpy(&bits, &f, sizeof(bits));
+        return (bits & 0x80000000) ? ~bits : (bits | 0x80000000);
+    }
 };
 
 #endif // hsRadixSort_inc
@@ -81,6 +81,7 @@ class plNetVoiceListMsg;
 class plStateDataRecord;
 class plCCRPetitionMsg;
 class plNetMsgPagingRoom;
+struct plNetClientReplayStats;
 
 
 struct plNetClientCommMsgHandler : plNetClientComm::MsgHandler {
@@ -351,6 +352,7 @@ public:
 
     bool RecordMsgs(const char* recType, const char* recName);
     bool PlaybackMsgs(const char* recName);
+    bool BenchmarkPlayback(const char* recName, double rate, plNetClientReplayStats& stats);
 
     void MakeCCRInvisible(plKey avKey, int level);
     bool CCRVaultConnected() const { return GetFlagsBit(kCCRVaultConnected); }
@@ -43,11 +43,16 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plNetClientMgr.h"
 
 #include "plgDispatch.h"
+#include "hsTimer.h"
+
+#include <thread>
 
 #include "pnMessage/plTimeMsg.h"
 #include "pnNetCommon/pnNetCommon.h"
 
+#include "plMessage/plAgeLoadedMsg.h"
 #include "plNetClientRecorder/plNetClientRecorder.h"
+#include "plNetMessage/plNetMessage.h"
 
 //
 // make a recording of current play
@@ -133,3 +138,74 @@ void plNetClientMgr::IPlaybackMsgs()
 }
 
 
+
+//
+// play a recording back synchronously, at a multiple of the recorded speed
+// or as fast as possible (rate 0), and measure what handling it costs
+//
+bool plNetClientMgr::BenchmarkPlayback(const char* recName, double rate, plNetClientReplayStats& stats)
+{
+    plNetClientStreamRecorder player;
+    player.SetPlaybackRate(rate);
+    if (!player.BeginPlayback(recName))
+        return false;
+
+    // SDL state is only delivered while we're in an age
+    bool wasPlaying = GetFlagsBit(kPlayingGame);
+    SetFlagsBit(kPlayingGame);
+
+    uint64_t startTicks = hsTimer::GetTicks();
+    while (!player.IsQueueEmpty())
+    {
+        uint64_t startAllocs = stats.fAllocCountProc ? stats.fAllocCountProc() : 0;
+        uint64_t readTicks = hsTimer::GetTicks();
+
+        plNetMessage* msg = player.GetNextMessage();
+        if (!msg)
+        {
+            if (player.IsBetweenAges())
+            {
+                // Nothing is going to load the next age for us, so pretend it did
+                plAgeLoadedMsg ageLoadedMsg;
+                player.RecordAgeLoadedMsg(&ageLoadedMsg);
+            }
+            else
+            {
+                // Waiting for the next message's time to come up
+                std::this_thread::yield();
+            }
+            continue;
+        }
+
+        uint64_t handleTicks = hsTimer::GetTicks();
+
+        uint16_t classIdx = msg->ClassIndex();
+        if (plNetMsgGameMessage* gameMsg = plNetMsgGameMessage::ConvertNoRef(msg))
+        {
+            if (gameMsg->StreamInfo()->GetStreamType() > 0)
+                classIdx = gameMsg->StreamInfo()->GetStreamType();
+        }
+
+        fMsgHandler.ReceiveMsg(msg);
+        ICheckPendingStateLoad(hsTimer::GetSysSeconds());
+
+        uint64_t dispatchTicks = hsTimer::GetTicks();
+        plgDispatch::Dispatch()->MsgQueueProcess();
+        uint64_t endTicks = hsTimer::GetTicks();
+
+        plNetClientReplayStats::ClassStats& classStats = stats.fClasses[classIdx];
+        classStats.fCount++;
+        classStats.fReadTicks += handleTicks - readTicks;
+        classStats.fHandleTicks += dispatchTicks - handleTicks;
+        classStats.fDispatchTicks += endTicks - dispatchTicks;
+        if (stats.fAllocCountProc)
+            classStats.fAllocs += stats.fAllocCountProc() - startAllocs;
+        stats.fNumMsgs++;
+
+        hsRefCnt_SafeUnRef(msg);
+    }
+    stats.fTotalTicks += hsTimer::GetTicks() - startTicks;
+
+    SetFlagsBit(kPlayingGame, wasPlaying);
+    return true;
+}
@@ -44,6 +44,8 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 #include "HeadSpin.h"
 
+#include <map>
+
 class hsStream;
 class plNetMessage;
 class plStatusLog;
@@ -85,6 +87,35 @@ public:
     virtual double GetNextMessageTimeDelta() { hsAssert(false,"plNetClientRecording: Playback not supported"); return 0; }
 };
 
+//
+// What playing back a recording cost, broken down by message class.  Game
+// messages are counted under the class of the plasma message they contain.
+//
+struct plNetClientReplayStats
+{
+    struct ClassStats
+    {
+        uint32_t fCount;
+        uint64_t fReadTicks;        // Reading the message out of the recording
+        uint64_t fHandleTicks;      // Net message handler and SDL state delivery
+        uint64_t fDispatchTicks;    // Dispatching the plasma messages that produced
+        uint64_t fAllocs;
+
+        ClassStats() : fCount(), fReadTicks(), fHandleTicks(), fDispatchTicks(), fAllocs() { }
+    };
+
+    // Returns the number of heap allocations made so far.  Optional, since
+    // only the application can hook the allocator.
+    typedef uint64_t(*AllocCountProc)();
+
+    std::map<uint16_t, ClassStats> fClasses;
+    uint32_t fNumMsgs;
+    uint64_t fTotalTicks;
+    AllocCountProc fAllocCountProc;
+
+    plNetClientReplayStats() : fNumMsgs(), fTotalTicks(), fAllocCountProc() { }
+};
+
 class plNetClientLoggingRecorder : public plNetClientRecorder
 {
 protected:
@@ -106,6 +137,9 @@ public:
     void RecordLinkMsg(plLinkToAgeMsg* linkMsg, double secs) override;
     void RecordAgeLoadedMsg(plAgeLoadedMsg* ageLoadedMsg) override = 0;
 
+    // Playback holds off between ages until the next age has loaded
+    bool IsBetweenAges() const { return fBetweenAges; }
+
 };
 
 //
@@ -118,6 +152,8 @@ protected:
 
     hsResMgr* fResMgr;
 
+    double fPlaybackRate;
+
     plNetMessage* IGetNextMessage();
     virtual bool IIsValidMsg(plNetMessage* msg);
 
@@ -136,6 +172,9 @@ public:
 
     // Playback functions
     void SetResMgr(hsResMgr* resmgr) { fResMgr = resmgr; }
+    // Multiple of the recorded speed to play back at, or 0 for as fast as possible
+    void SetPlaybackRate(double rate) { fPlaybackRate = rate; }
+    double GetPlaybackRate() const { return fPlaybackRate; }
     hsResMgr* GetResMgr();
     bool IsQueueEmpty() override;
     plNetMessage* GetNextMessage() override;
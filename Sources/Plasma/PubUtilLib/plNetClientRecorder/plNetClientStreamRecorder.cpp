@@ -60,7 +60,8 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 plNetClientStreamRecorder::plNetClientStreamRecorder(TimeWrapper* timeWrapper) :
     plNetClientLoggingRecorder(timeWrapper),
     fRecordStream(),
-    fResMgr()
+    fResMgr(),
+    fPlaybackRate(1.0)
 {
     if (fLog)
         delete fLog;
@@ -87,7 +88,10 @@ hsResMgr* plNetClientStreamRecorder::GetResMgr()
 
 double plNetClientStreamRecorder::GetNextMessageTimeDelta()
 {
-    return fNextPlaybackTime - (GetTime() - fPlaybackTimeOffset);
+    if (fPlaybackRate <= 0.0)
+        return 0.0;
+
+    return fNextPlaybackTime - (GetTime() - fPlaybackTimeOffset) * fPlaybackRate;
 }
 
 enum NetClientRecFlags
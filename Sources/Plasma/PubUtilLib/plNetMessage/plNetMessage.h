@@ -166,7 +166,8 @@ public:
         kCompressionNone,       // not compressed
         kCompressionFailed,     // failed to compress
         kCompressionZlib,       // zlib compressed
-        kCompressionDont        // don't compress
+        kCompressionDont,       // don't compress
+        kCompressionLZ4,        // LZ4 compressed, only sent when the shard allows it
     };
 
     CLASSNAME_REGISTER( plNetMessage );
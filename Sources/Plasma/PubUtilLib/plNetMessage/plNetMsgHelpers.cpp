@@ -46,8 +46,10 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "hsStream.h"
 
 #include "pnKeyedObject/plKey.h"
+#include "pnNetBase/pnNbSrvs.h"
 #include "pnNetCommon/plNetApp.h"
 
+#include "plCompression/plLZ4Compress.h"
 #include "plCompression/plZlibCompress.h"
 
 #include <algorithm>
@@ -144,9 +146,13 @@ int plNetMsgCreatableHelper::Peek(hsStream * s, uint32_t peekOptions)
 // NOT A MSG
 // PL STREAM MSG - HELPER class
 /////////////////////////////////////////////////////////
+int      plNetMsgStreamHelper::fCompressionLevel = plZlibCompress::kDefaultLevel;
+uint32_t plNetMsgStreamHelper::fDefaultCompressionThreshold = kDefaultCompressionThreshold;
+uint32_t plNetMsgStreamHelper::fFastCompressionThreshold = kDefaultFastCompressionThreshold;
+
 plNetMsgStreamHelper::plNetMsgStreamHelper() :  fStreamBuf(), fStreamType(-1), fStreamLen(),
         fCompressionType(plNetMessage::kCompressionNone), fUncompressedSize(),
-        fCompressionThreshold( kDefaultCompressionThreshold )
+        fCompressionThreshold( fDefaultCompressionThreshold )
 {
 }
 
@@ -157,7 +163,7 @@ void plNetMsgStreamHelper::Clear()
     fStreamType = 0xff;
     fStreamLen = 0;
     fCompressionType = plNetMessage::kCompressionNone;
-    fCompressionThreshold = kDefaultCompressionThreshold;
+    fCompressionThreshold = fDefaultCompressionThreshold;
 }
 
 int plNetMsgStreamHelper::Poke(hsStream* stream, uint32_t peekOptions)
@@ -267,14 +273,27 @@ bool plNetMsgStreamHelper::Compress(int offset)
     if ( !IsCompressable() )
         return true;
 
-    plZlibCompress compressor;
+    // Every client in the age has to understand LZ4 to receive it, since the
+    // game server passes streams along untouched
+    uint8_t compressionType = plNetMessage::kCompressionZlib;
+    if ( GetGameSrvFastCompression() && plLZ4Compress::IsAvailable()
+        && GetStreamLen() >= fFastCompressionThreshold )
+        compressionType = plNetMessage::kCompressionLZ4;
+
     uint8_t* buf = (uint8_t*)GetStreamBuf();    // skip creatable index
     uint32_t bufLen = GetStreamLen();
     uint32_t uncompressedSize = bufLen;
     SetUncompressedSize( uncompressedSize );
-    if ( compressor.Compress( &buf, &bufLen, offset) )
+
+    bool ok;
+    if ( compressionType == plNetMessage::kCompressionLZ4 )
+        ok = plLZ4Compress().Compress( &buf, &bufLen, offset );
+    else
+        ok = plZlibCompress(fCompressionLevel).Compress( &buf, &bufLen, offset );
+
+    if ( ok )
     {
-        SetCompressionType( plNetMessage::kCompressionZlib );
+        SetCompressionType( compressionType );
         SetStreamLen(bufLen);
         SetStreamBuf(buf);
 #if 0
@@ -298,10 +317,16 @@ bool plNetMsgStreamHelper::Uncompress(int offset)
         return true;
 
     uint32_t origLen = GetStreamLen();
-    plZlibCompress compressor;
     uint8_t* buf = (uint8_t*)GetStreamBuf();
     uint32_t bufLen = origLen;
-    if ( compressor.Uncompress( &buf, &bufLen, GetUncompressedSize(), offset ) )
+
+    bool ok;
+    if ( fCompressionType == plNetMessage::kCompressionLZ4 )
+        ok = plLZ4Compress().Uncompress( &buf, &bufLen, GetUncompressedSize(), offset );
+    else
+        ok = plZlibCompress().Uncompress( &buf, &bufLen, GetUncompressedSize(), offset );
+
+    if ( ok )
     {
         SetCompressionType( plNetMessage::kCompressionNone );
         SetStreamLen(bufLen);
@@ -323,7 +348,8 @@ bool plNetMsgStreamHelper::Uncompress(int offset)
 
 bool plNetMsgStreamHelper::IsCompressed() const
 {
-    return ( fCompressionType==plNetMessage::kCompressionZlib );
+    return ( fCompressionType==plNetMessage::kCompressionZlib
+        || fCompressionType==plNetMessage::kCompressionLZ4 );
 }
 
 bool plNetMsgStreamHelper::IsCompressable() const
@@ -132,10 +132,15 @@ protected:
     uint8_t   fCompressionType;   // see plNetMessage::CompressionType
     uint32_t  fCompressionThreshold;  // NOT WRITTEN
 
+    static int      fCompressionLevel;
+    static uint32_t fDefaultCompressionThreshold;
+    static uint32_t fFastCompressionThreshold;
+
     void IAllocStream(uint32_t len);
 
 public:
     enum { kDefaultCompressionThreshold = 255 }; // bytes
+    enum { kDefaultFastCompressionThreshold = 1024 }; // bytes
 
     plNetMsgStreamHelper();
     virtual ~plNetMsgStreamHelper() { delete [] fStreamBuf; }
@@ -179,6 +184,16 @@ public:
     bool    IsCompressable() const;
     uint32_t  GetCompressionThreshold() const { return fCompressionThreshold; }
     void    SetCompressionThreshold( uint32_t v ) { fCompressionThreshold=v; }
+
+    // Settings shared by every stream.  Streams at least the fast threshold
+    // long are LZ4 compressed when the shard allows it, everything else
+    // bigger than the default threshold goes through zlib at the given level.
+    static int      GetCompressionLevel() { return fCompressionLevel; }
+    static void     SetCompressionLevel(int level) { fCompressionLevel = level; }
+    static uint32_t GetDefaultCompressionThreshold() { return fDefaultCompressionThreshold; }
+    static void     SetDefaultCompressionThreshold(uint32_t v) { fDefaultCompressionThreshold = v; }
+    static uint32_t GetFastCompressionThreshold() { return fFastCompressionThreshold; }
+    static void     SetFastCompressionThreshold(uint32_t v) { fFastCompressionThreshold = v; }
 };
 
 //
@@ -40,6 +40,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 *==LICENSE==*/
 #include "plPXPhysical.h"
+#include "plPXSimulation.h"
 #include "plPXSubWorld.h"
 #include "plSimulationMgr.h"
 
@@ -105,7 +106,7 @@ PhysRecipe::~PhysRecipe()
 
 plPXPhysical::plPXPhysical()
     : fActor(), fGroup(plSimDefs::kGroupMax), fReportsOn(), fLOSDBs(plSimDefs::kLOSDBNone),
-      fLastSyncTime(), fSDLMod(), fSndGroup()
+      fLocationQueued(), fLastSyncTime(), fSDLMod(), fSndGroup()
 {
 }
 
@@ -236,6 +237,9 @@ void plPXPhysical::SetSceneNode(plKey newNode)
     if (newNode) {
         plNodeRefMsg* refMsg = new plNodeRefMsg(newNode, plNodeRefMsg::kOnRequest, -1, plNodeRefMsg::kPhysical);
         hsgResMgr::ResMgr()->SendRef(GetKey(), refMsg, plRefFlags::kActiveRef);
+
+        // Locations aren't sent for physicals without a room, so we may have missed some.
+        QueueNewLocation();
     }
     if (oldNode)
         oldNode->Release(GetKey());
@@ -365,9 +369,9 @@ void plPXPhysical::Read(hsStream* stream, hsResMgr* mgr)
         fRecipe.bDimensions.Read(stream);
         fRecipe.bOffset.Read(stream);
     } else if (fBounds == plSimDefs::kHullBounds) {
-        fRecipe.convexMesh = ICookHull(stream);
+        fRecipe.cookJob = IReadHull(stream);
     } else {
-        fRecipe.triMesh = ICookTriMesh(stream);
+        fRecipe.cookJob = IReadTriMesh(stream);
     }
 
     // If we do not have a world specified, we go ahead and init into the main world...
@@ -477,6 +481,14 @@ void plPXPhysical::ResetSyncState()
 
 // ==========================================================================
 
+void plPXPhysical::QueueNewLocation()
+{
+    if (!fLocationQueued && fActor) {
+        fLocationQueued = true;
+        plSimulationMgr::GetInstance()->QueueNewLocation(this);
+    }
+}
+
 void plPXPhysical::SendNewLocation(bool synchTransform, bool isSynchUpdate)
 {
     // Called after the simulation has run....sends new positions to the various scene objects
@@ -487,7 +499,9 @@ void plPXPhysical::SendNewLocation(bool synchTransform, bool isSynchUpdate)
         if (!GetProperty(plSimulationInterface::kPassive)) {
             hsMatrix44 curl2w = fCachedLocal2World;
             // we're going to cache the transform before sending so we can recognize if it comes back
-            IGetTransformGlobal(fCachedLocal2World);
+            // (synch updates want where the body really is, rendering may want it between steps)
+            bool interpolate = !isSynchUpdate && plSimulationMgr::GetInstance()->GetPhysX()->IsInterpolating();
+            IGetTransformGlobal(fCachedLocal2World, interpolate);
 
             if (!curl2w.Compare(fCachedLocal2World, .0001f)) {
                 plProfile_Inc(LocationsSent);
@@ -57,7 +57,17 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plModifier/plLogicModifier.h"
 #include "plStatusLog/plStatusLog.h"
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
 plProfile_CreateTimer("LineOfSight", "Simulation", LineOfSight);
+plProfile_CreateCounter("LOS Queries", "Simulation", LOSQueries);
+
+uint32_t plLOSDispatch::fNumThreads = 1;
+
+// Fewer requests than this aren't worth starting threads for
+static const size_t kMinParallelQueries = 8;
 
 plLOSDispatch::plLOSDispatch()
     : fDebugDisplay()
@@ -77,75 +87,14 @@ bool plLOSDispatch::MsgReceive(plMessage* msg)
 {
     plLOSRequestMsg* requestMsg = plLOSRequestMsg::ConvertNoRef(msg);
     if (requestMsg) {
-        plProfile_BeginTiming(LineOfSight);
-
-        plKey worldKey = requestMsg->fWorldKey;
-        if (!worldKey) {
-            plArmatureMod* av = plAvatarMgr::GetInstance()->GetLocalAvatar();
-            if (av && av->GetController())
-                worldKey = av->GetController()->GetSubworld();
-        }
-
-        auto hitMsg = std::make_unique<plLOSHitMsg>(GetKey(), requestMsg->GetSender(), requestMsg->fRequestID);
-        hitMsg->fNoHit = !IRaycast(requestMsg->fFrom, requestMsg->fTo, worldKey, requestMsg->fRequestType,
-                                   requestMsg->GetTestType() == plLOSRequestMsg::kTestClosest,
-                                   hitMsg->fObj, hitMsg->fHitPoint, hitMsg->fNormal, hitMsg->fDistance);
-        if (!hitMsg->fNoHit) {
-            // If we have a cull db, adjust the length of the raycast to be from the
-            // original point to the object we hit.  If we find anything from the cull
-            // db in there, the cast fails.
-            if (requestMsg->GetCullDB() != plSimDefs::kLOSDBNone) {
-                plKey cullObj;
-                hsPoint3 cullPoint;
-                hsVector3 cullNormal;
-                float cullDistance;
-                bool cullHit = IRaycast(requestMsg->fFrom,
-                                        hitMsg->fHitPoint,
-                                        worldKey,
-                                        requestMsg->fCullDB,
-                                        requestMsg->GetTestType() == plLOSRequestMsg::kTestClosest,
-                                        cullObj,
-                                        cullPoint,
-                                        cullNormal,
-                                        cullDistance);
-                if (cullHit) {
-                    fRequests.emplace_back(requestMsg->GetRequestName(), requestMsg->GetRequestID(),
-                                           LOSResult::kCull, hitMsg->fObj, cullObj);
-                    if (requestMsg->GetReportType() == plLOSRequestMsg::kReportMiss ||
-                        requestMsg->GetReportType() == plLOSRequestMsg::kReportHitOrMiss) {
-                        hitMsg = std::make_unique<plLOSHitMsg>(GetKey(), requestMsg->GetSender(), requestMsg->fRequestID);
-                        hitMsg->fNoHit = true;
-                    } else {
-                        hitMsg.reset();
-                    }
-                } else {
-                    fRequests.emplace_back(requestMsg->GetRequestName(), requestMsg->GetRequestID(),
-                                           LOSResult::kHit, hitMsg->fObj);
-                }
-            } else {
-                fRequests.emplace_back(requestMsg->GetRequestName(), requestMsg->GetRequestID(),
-                                       LOSResult::kHit, hitMsg->fObj);
-            }
-
-            if (hitMsg && (requestMsg->GetReportType() == plLOSRequestMsg::kReportHit ||
-                           requestMsg->GetReportType() == plLOSRequestMsg::kReportHitOrMiss))
-                hitMsg.release()->Send();
-
-        } else {
-            fRequests.emplace_back(requestMsg->GetRequestName(), requestMsg->GetRequestID(), LOSResult::kMiss);
-            if (requestMsg->GetReportType() == plLOSRequestMsg::kReportMiss ||
-                requestMsg->GetReportType() == plLOSRequestMsg::kReportHitOrMiss) {
-                plLOSHitMsg* missMsg = new plLOSHitMsg(GetKey(), requestMsg->GetSender(), requestMsg->fRequestID);
-                missMsg->fNoHit = true;
-                missMsg->Send();
-            }
-        }
-
-        plProfile_EndTiming(LineOfSight);
+        requestMsg->Ref();
+        fQueries.emplace_back(hsRef<plLOSRequestMsg>(requestMsg, hsStealRef));
         return true;
     }
 
     if (plRenderMsg::ConvertNoRef(msg)) {
+        ProcessRequests();
+
         if (!fDebugDisplay) {
             fDebugDisplay = plStatusLogMgr::GetInstance().CreateStatusLog(32, "Line of Sight",
                                                                           plStatusLog::kDontWriteFile |
@@ -192,6 +141,114 @@ bool plLOSDispatch::MsgReceive(plMessage* msg)
     return hsKeyedObject::MsgReceive(msg);
 }
 
+void plLOSDispatch::ProcessRequests()
+{
+    if (fQueries.empty())
+        return;
+
+    plProfile_BeginTiming(LineOfSight);
+    plProfile_IncCount(LOSQueries, fQueries.size());
+
+    // Anything that needs the avatar or a ref count is done here, on our thread.
+    plArmatureMod* av = plAvatarMgr::GetInstance()->GetLocalAvatar();
+    plKey avatarWorld;
+    if (av && av->GetController())
+        avatarWorld = av->GetController()->GetSubworld();
+    for (LOSQuery& query : fQueries)
+        query.fWorld = query.fRequest->fWorldKey ? query.fRequest->fWorldKey : avatarWorld;
+
+    uint32_t numThreads = fNumThreads;
+    if (numThreads == 0)
+        numThreads = std::max(std::thread::hardware_concurrency(), 1U);
+    numThreads = (uint32_t)std::min<size_t>(numThreads, fQueries.size());
+
+    if (numThreads > 1 && fQueries.size() >= kMinParallelQueries) {
+        // The scene is only read from while the batch runs, so the queries can go in any
+        // order. Results are reported in the order the requests came in.
+        std::atomic<size_t> next(0);
+        auto runQueries = [this, &next]()
+        {
+            for (size_t i = next++; i < fQueries.size(); i = next++)
+                IRunQuery(fQueries[i]);
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(numThreads - 1);
+        for (uint32_t i = 1; i < numThreads; ++i)
+            threads.emplace_back(runQueries);
+        runQueries();
+        for (std::thread& thread : threads)
+            thread.join();
+    } else {
+        for (LOSQuery& query : fQueries)
+            IRunQuery(query);
+    }
+
+    for (LOSQuery& query : fQueries)
+        IReportQuery(query);
+    fQueries.clear();
+
+    plProfile_EndTiming(LineOfSight);
+}
+
+void plLOSDispatch::IRunQuery(LOSQuery& query)
+{
+    plLOSRequestMsg* requestMsg = query.fRequest.Get();
+    bool closest = requestMsg->GetTestType() == plLOSRequestMsg::kTestClosest;
+
+    query.fHit = IRaycast(requestMsg->fFrom, requestMsg->fTo, query.fWorld, requestMsg->fRequestType,
+                          closest, query.fHitObj, query.fHitPoint, query.fHitNormal, query.fDistance);
+
+    // If we have a cull db, adjust the length of the raycast to be from the
+    // original point to the object we hit.  If we find anything from the cull
+    // db in there, the cast fails.
+    if (query.fHit && requestMsg->GetCullDB() != plSimDefs::kLOSDBNone) {
+        hsPoint3 cullPoint;
+        hsVector3 cullNormal;
+        float cullDistance;
+        query.fCullHit = IRaycast(requestMsg->fFrom, query.fHitPoint, query.fWorld, requestMsg->fCullDB,
+                                  closest, query.fCullObj, cullPoint, cullNormal, cullDistance);
+    }
+}
+
+void plLOSDispatch::IReportQuery(LOSQuery& query)
+{
+    plLOSRequestMsg* requestMsg = query.fRequest.Get();
+    plLOSRequestMsg::ReportType reportType = requestMsg->GetReportType();
+    bool reportHit = reportType == plLOSRequestMsg::kReportHit ||
+                     reportType == plLOSRequestMsg::kReportHitOrMiss;
+    bool reportMiss = reportType == plLOSRequestMsg::kReportMiss ||
+                      reportType == plLOSRequestMsg::kReportHitOrMiss;
+    plKey hitObj = query.fHitObj ? *query.fHitObj : nullptr;
+    plKey cullObj = query.fCullObj ? *query.fCullObj : nullptr;
+
+    if (!query.fHit) {
+        fRequests.emplace_back(requestMsg->GetRequestName(), requestMsg->GetRequestID(), LOSResult::kMiss);
+    } else if (query.fCullHit) {
+        fRequests.emplace_back(requestMsg->GetRequestName(), requestMsg->GetRequestID(),
+                               LOSResult::kCull, hitObj, cullObj);
+    } else {
+        fRequests.emplace_back(requestMsg->GetRequestName(), requestMsg->GetRequestID(),
+                               LOSResult::kHit, hitObj);
+    }
+
+    if (query.fHit && !query.fCullHit) {
+        if (reportHit) {
+            plLOSHitMsg* hitMsg = new plLOSHitMsg(GetKey(), requestMsg->GetSender(), requestMsg->fRequestID);
+            hitMsg->fNoHit = false;
+            hitMsg->fObj = hitObj;
+            hitMsg->fHitPoint = query.fHitPoint;
+            hitMsg->fNormal = query.fHitNormal;
+            hitMsg->fDistance = query.fDistance;
+            hitMsg->Send();
+        }
+    } else if (reportMiss) {
+        plLOSHitMsg* missMsg = new plLOSHitMsg(GetKey(), requestMsg->GetSender(), requestMsg->fRequestID);
+        missMsg->fNoHit = true;
+        missMsg->Send();
+    }
+}
+
 bool plLOSDispatch::ITestHit(const plSceneObject* so) const
 {
     for (size_t i = 0; i < so->GetNumModifiers(); ++i) {
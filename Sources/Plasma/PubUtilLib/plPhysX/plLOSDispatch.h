@@ -42,23 +42,26 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #ifndef plLOSDispatch_H
 #define plLOSDispatch_H
 
+#include "hsGeometry3.h"
+#include "hsRefCnt.h"
 #include "pnKeyedObject/hsKeyedObject.h"
 #include "plPhysical/plSimDefs.h"
 #include <vector>
 
 class plLOSRequestMsg;
 struct hsMatrix44;
-struct hsPoint3;
 class plSceneObject;
 class plStatusLog;
-struct hsVector3;
 
 /** \class plLOSDispatch
     Line-of-sight requests are sent to this guy, who then hands them
     to the appropriate solvers, which can vary depending on such
     criteria as which subworld the player is currently in.
     Eventually we will have more variants of requests, such as 
-    "search all subworlds," etc.  */
+    "search all subworlds," etc.
+    Requests are collected as they come in and answered together by
+    ProcessRequests(), which the simulation manager calls after each
+    step (and we call again at render time for any stragglers).  */
 class plLOSDispatch : public hsKeyedObject
 {
     friend class plPXRaycastQueryFilter;
@@ -83,8 +86,34 @@ class plLOSDispatch : public hsKeyedObject
         { }
     };
 
+    // A request waiting for the next batch, and what the batch found for it.
+    // The hit keys point at the actors' own keys, so that the threads running
+    // the queries never touch a key's ref count.
+    struct LOSQuery
+    {
+        hsRef<plLOSRequestMsg> fRequest;
+        plKey fWorld;
+
+        bool fHit;
+        const plKey* fHitObj;
+        hsPoint3 fHitPoint;
+        hsVector3 fHitNormal;
+        float fDistance;
+
+        bool fCullHit;
+        const plKey* fCullObj;
+
+        LOSQuery(hsRef<plLOSRequestMsg> request)
+            : fRequest(std::move(request)), fHit(), fHitObj(), fDistance(),
+              fCullHit(), fCullObj()
+        { }
+    };
+
     plStatusLog* fDebugDisplay;
     std::vector<LOSRequest> fRequests;
+    std::vector<LOSQuery> fQueries;
+
+    static uint32_t fNumThreads;
 
 public:
     plLOSDispatch();
@@ -95,10 +124,23 @@ public:
 
     bool MsgReceive(plMessage* msg) override;
 
+    /** Runs every request received since the last call and sends out the plLOSHitMsgs. */
+    void ProcessRequests();
+
+    /**
+     * Sets how many threads a batch of requests is split across.
+     * 0 means one per core, and 1 (the default) runs them all on the calling thread.
+     */
+    static void SetQueryThreads(uint32_t numThreads) { fNumThreads = numThreads; }
+    static uint32_t GetQueryThreads() { return fNumThreads; }
+
 protected:
+    void IRunQuery(LOSQuery& query);
+    void IReportQuery(LOSQuery& query);
+
     bool ITestHit(const plSceneObject* obj) const;
     bool IRaycast(hsPoint3 origin, hsPoint3 destination, const plKey& world, plSimDefs::plLOSDB db,
-                  bool closest, plKey& hitObj, hsPoint3& hitPos, hsVector3& hitNormal, float& distance);
+                  bool closest, const plKey*& hitObj, hsPoint3& hitPos, hsVector3& hitNormal, float& distance);
 };
 
 #endif
@@ -57,7 +57,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 // ==========================================================================
 
 bool plLOSDispatch::IRaycast(hsPoint3 origin, hsPoint3 destination, const plKey& world,
-                             plSimDefs::plLOSDB db, bool closest, plKey& hitObj, hsPoint3& hitPos,
+                             plSimDefs::plLOSDB db, bool closest, const plKey*& hitObj, hsPoint3& hitPos,
                              hsVector3& hitNormal, float& distance)
 {
     plPXSimulation* sim = plSimulationMgr::GetInstance()->GetPhysX();
@@ -154,7 +154,7 @@ bool plLOSDispatch::IRaycast(hsPoint3 origin, hsPoint3 destination, const plKey&
         {
             auto data = static_cast<plPXActorData*>(hit.actor->userData);
             if (hit.distance < fDist) {
-                fHitObj = data->GetKey();
+                fHitObj = &data->GetKey();
                 fPos = plPXConvert::Point(hit.position);
                 fNormal = plPXConvert::Vector(hit.normal);
                 fDist = hit.distance;
@@ -210,6 +210,15 @@ bool plPXPhysical::InitActor()
         actorType = plPXActorType::kDynamicActor;
     physx::PxTransform globalPose = plPXConvert::Transform(fRecipe.l2sP, fRecipe.l2sQ);
 
+    // The mesh read in with us is cooked (or came from the cache) but isn't in PhysX yet.
+    if (fRecipe.cookJob) {
+        if (fRecipe.cookJob->GetType() == plPXCookJob::Type::kConvexHull)
+            fRecipe.convexMesh = sim->InsertConvexHull(fRecipe.cookJob);
+        else
+            fRecipe.triMesh = sim->InsertTriangleMesh(fRecipe.cookJob);
+        fRecipe.cookJob.reset();
+    }
+
     // Reminder: fRecipe.bounds represents what the artist wanted. This may
     // be adjusted by our smarter code such that you do not have the shape
     // described by fRecipe.bounds after a read-in. Use fBounds.
@@ -274,6 +283,9 @@ bool plPXPhysical::InitActor()
 
     InitRefs();
 
+    // Nothing has sent our starting location yet.
+    QueueNewLocation();
+
     // only dynamic physicals without noSync need SDLs
     if (IsDynamic() && !GetProperty(plSimulationInterface::kNoSynchronize))
         InitSDL();
@@ -300,6 +312,11 @@ void plPXPhysical::DestroyActor()
         fActor = nullptr;
     }
 
+    if (fLocationQueued) {
+        plSimulationMgr::GetInstance()->DequeueNewLocation(this);
+        fLocationQueued = false;
+    }
+
     if (fRecipe.triMesh) {
         fRecipe.triMesh->release();
         fRecipe.triMesh = nullptr;
@@ -398,6 +415,9 @@ void plPXPhysical::ISetTransformGlobal(const hsMatrix44& l2w)
         else
             fActor->setGlobalPose(pose);
     }
+
+    // Statics and sleeping bodies moved this way aren't reported active.
+    QueueNewLocation();
 }
 
 // the physical may have several parents between it and the subworld object,
@@ -405,9 +425,12 @@ void plPXPhysical::ISetTransformGlobal(const hsMatrix44& l2w)
 // to avoid any confusion about this difference, we avoid referring to the 
 // subworld as "parent" and use, for example, "l2s" (local-to-sub) instead
 // of the canonical plasma "l2p" (local-to-parent)
-void plPXPhysical::IGetTransformGlobal(hsMatrix44& l2w) const
+void plPXPhysical::IGetTransformGlobal(hsMatrix44& l2w, bool interpolate) const
 {
-    l2w = plPXConvert::Transform(fActor->getGlobalPose());
+    if (interpolate)
+        l2w = plPXConvert::Transform(plSimulationMgr::GetInstance()->GetPhysX()->InterpolatePose(fActor));
+    else
+        l2w = plPXConvert::Transform(fActor->getGlobalPose());
 
     if (fWorldKey) {
         plSceneObject* so = plSceneObject::ConvertNoRef(fWorldKey->ObjectIsLoaded());
@@ -446,6 +469,8 @@ void plPXPhysical::ISetPoseSim(const hsPoint3* pos, const hsQuat* rot, bool wake
             fActor->setGlobalPose(pose, wakeup);
         }
     }
+
+    QueueNewLocation();
 }
 
 bool plPXPhysical::GetLinearVelocitySim(hsVector3& vel) const
@@ -493,7 +518,7 @@ void plPXPhysical::SetAngularVelocitySim(const hsVector3& vel, bool wakeup)
 
 // ==========================================================================
 
-physx::PxConvexMesh* plPXPhysical::ICookHull(hsStream* s)
+std::shared_ptr<plPXCookJob> plPXPhysical::IReadHull(hsStream* s)
 {
     std::vector<uint32_t> tris;
     std::vector<hsPoint3> verts;
@@ -504,7 +529,7 @@ physx::PxConvexMesh* plPXPhysical::ICookHull(hsStream* s)
             plPXCooking::ReadConvexHull26(s, tris, verts);
         } catch (const plPXCookingException& ex) {
             SimLog("Failed to uncook convex hull '{}': {}", GetKeyName(), ex.what());
-            return nullptr;
+            return {};
         }
         break;
 
@@ -514,7 +539,7 @@ physx::PxConvexMesh* plPXPhysical::ICookHull(hsStream* s)
             plPXCooking::ReadTriMesh26(s, tris, verts);
         } catch (const plPXCookingException& ex) {
             SimLog("Failed to uncook triangle mesh (for hull bounds) '{}': {}", GetKeyName(), ex.what());
-            return nullptr;
+            return {};
         }
 
         // Forces PhysX to compute a hull
@@ -524,10 +549,11 @@ physx::PxConvexMesh* plPXPhysical::ICookHull(hsStream* s)
     DEFAULT_FATAL(fRecipe.bounds);
     }
 
-    return plSimulationMgr::GetInstance()->GetPhysX()->InsertConvexHull(tris, verts);
+    return plSimulationMgr::GetInstance()->GetPhysX()->CookMesh(plPXCookJob::Type::kConvexHull,
+                                                                std::move(tris), std::move(verts));
 }
 
-physx::PxTriangleMesh* plPXPhysical::ICookTriMesh(hsStream* s)
+std::shared_ptr<plPXCookJob> plPXPhysical::IReadTriMesh(hsStream* s)
 {
     std::vector<uint32_t> tris;
     std::vector<hsPoint3> verts;
@@ -539,14 +565,31 @@ physx::PxTriangleMesh* plPXPhysical::ICookTriMesh(hsStream* s)
              plPXCooking::ReadTriMesh26(s, tris, verts);
         } catch (const plPXCookingException& ex) {
             SimLog("Failed to uncook triangle mesh '{}': {}", GetKeyName(), ex.what());
-            return nullptr;
+            return {};
         }
         break;
 
     DEFAULT_FATAL(fRecipe.bounds);
     }
 
-    return plSimulationMgr::GetInstance()->GetPhysX()->InsertTriangleMesh(tris, verts);
+    return plSimulationMgr::GetInstance()->GetPhysX()->CookMesh(plPXCookJob::Type::kTriangleMesh,
+                                                                std::move(tris), std::move(verts));
+}
+
+physx::PxConvexMesh* plPXPhysical::ICookHull(hsStream* s)
+{
+    std::shared_ptr<plPXCookJob> job = IReadHull(s);
+    if (!job)
+        return nullptr;
+    return plSimulationMgr::GetInstance()->GetPhysX()->InsertConvexHull(job);
+}
+
+physx::PxTriangleMesh* plPXPhysical::ICookTriMesh(hsStream* s)
+{
+    std::shared_ptr<plPXCookJob> job = IReadTriMesh(s);
+    if (!job)
+        return nullptr;
+    return plSimulationMgr::GetInstance()->GetPhysX()->InsertTriangleMesh(job);
 }
 
 // ==========================================================================
@@ -59,6 +59,7 @@ class plGenRefMsg;
 class hsGMaterial;
 class plLOSHit;
 class plMessage;
+class plPXCookJob;
 class plPhysicalProxy;
 struct hsPlane3;
 struct hsPoint3;
@@ -108,6 +109,9 @@ public:
 
     std::unique_ptr<hsVectorStream> meshStream;
 
+    // The mesh, when it's read in but not inserted into the simulation yet
+    std::shared_ptr<plPXCookJob> cookJob;
+
     PhysRecipe();
     ~PhysRecipe();
 };
@@ -184,6 +188,11 @@ public:
     physx::PxConvexMesh* ICookHull(hsStream* s);
     physx::PxTriangleMesh* ICookTriMesh(hsStream* s);
 
+protected:
+    std::shared_ptr<plPXCookJob> IReadHull(hsStream* s);
+    std::shared_ptr<plPXCookJob> IReadTriMesh(hsStream* s);
+
+public:
     void Read(hsStream* s, hsResMgr* mgr) override;
     void Write(hsStream* s, hsResMgr* mgr) override;
 
@@ -248,6 +257,9 @@ public:
 
     void SendNewLocation(bool synchTransform = false, bool isSynchUpdate = false) override;
 
+    /** Makes sure our new location goes out with the next update, even if PhysX didn't move us. */
+    void QueueNewLocation();
+
     void GetSyncState(hsPoint3& pos, hsQuat& rot, hsVector3& linV, hsVector3& angV) override;
     void SetSyncState(hsPoint3* pos, hsQuat* rot, hsVector3* linV, hsVector3* angV) override;
     void ResetSyncState() override;
@@ -290,8 +302,9 @@ protected:
     double GetLastSyncTime() { return fLastSyncTime; }
 
     /** Get the simulation transform of the physical, in world
-    coordinates (factoring in the subworld if necessary */
-    void IGetTransformGlobal(hsMatrix44 &l2w) const;
+    coordinates (factoring in the subworld if necessary). If interpolate is set,
+    it's blended between the last two steps for rendering. */
+    void IGetTransformGlobal(hsMatrix44 &l2w, bool interpolate = false) const;
     void ISetTransformGlobal(const hsMatrix44& l2w);
 
     // Enable/disable collisions and dynamic movement
@@ -316,6 +329,10 @@ protected:
     // which would reactivate our body. inelegant but effective
     hsMatrix44 fCachedLocal2World;
 
+    // Set while we're on the simulation manager's list of physicals to send
+    // new locations for, so we only go on it once.
+    bool fLocationQueued;
+
     // Syncronization
     double          fLastSyncTime;
     plSDLModifier*  fSDLMod;
@@ -48,6 +48,8 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plPXSubWorld.h"
 #include "plSimulationMgr.h"
 
+#include "hsStream.h"
+#include "hsTimer.h"
 #include "plProfile.h"
 
 #include "pnNetCommon/plNetApp.h"
@@ -55,6 +57,9 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 #include "plStatusLog/plStatusLog.h"
 
+#include <algorithm>
+#include <cstdio>
+
 // ==========================================================================
 
 /** if the step is greater than .15 seconds, clamp to that */
@@ -69,6 +74,12 @@ constexpr float kToleranceScaleLength = 6.f;
 /** Typical magnitude of actor velocities in the simulation */
 constexpr float kToleranceScaleSpeed = 32.f;
 
+/** Cooked meshes are cached in UserData/PhysXCache/<hash>.hull (or .mesh) */
+constexpr uint32_t kCookCacheMagic = 0x43435850; // 'PXCC'
+
+/** Bump this whenever the cooking params set up in Init() change */
+constexpr uint32_t kCookCacheVersion = 1;
+
 // ==========================================================================
 
 plProfile_CreateTimer(  "Apply Controller Animations", "Simulation", ApplyController);
@@ -86,6 +97,29 @@ plProfile_CreateTimer(  "Correct Controller Movement", "Simulation", CorrectCont
 
 // ==========================================================================
 
+/** FNV-1a, over everything that goes into cooking the mesh */
+static uint64_t IHashMeshData(uint64_t hash, const void* data, size_t size)
+{
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+plPXCookJob::plPXCookJob(Type type, std::vector<uint32_t> tris, std::vector<hsPoint3> verts)
+    : fType(type), fTris(std::move(tris)), fVerts(std::move(verts)),
+      fCookTime(), fCacheHit()
+{
+    uint32_t counts[] = { (uint32_t)fType, (uint32_t)fTris.size(), (uint32_t)fVerts.size() };
+    fHash = IHashMeshData(0xCBF29CE484222325ULL, counts, sizeof(counts));
+    fHash = IHashMeshData(fHash, fTris.data(), fTris.size() * sizeof(uint32_t));
+    fHash = IHashMeshData(fHash, fVerts.data(), fVerts.size() * sizeof(hsPoint3));
+}
+
+// ==========================================================================
+
 plPXActorData::plPXActorData(plPXPhysical* phys)
     : fKey(phys->GetObjectKey()), fPhysical(phys), fController()
 {
@@ -328,14 +362,96 @@ static physx::PxFilterFlags ISimulationFilterShader(physx::PxFilterObjectAttribu
 
 // ==========================================================================
 
+/**
+ * Runs the simulation's tasks. Without any threads, each task runs as it's submitted,
+ * so simulate() does the whole step. Otherwise, simulate() hands the step off to the
+ * threads and returns, and fetchResults() waits for them to finish it.
+ */
+class plPXStepDispatcher : public physx::PxCpuDispatcher
+{
+    std::vector<std::thread> fThreads;
+    std::deque<physx::PxBaseTask*> fTasks;
+    std::mutex fMutex;
+    std::condition_variable fQueued;
+    bool fStop;
+
+    void IWork()
+    {
+        for (;;) {
+            physx::PxBaseTask* task;
+            {
+                std::unique_lock<std::mutex> lock(fMutex);
+                fQueued.wait(lock, [this]() { return fStop || !fTasks.empty(); });
+                if (fTasks.empty())
+                    break;
+                task = fTasks.front();
+                fTasks.pop_front();
+            }
+
+            task->run();
+            task->release();
+        }
+    }
+
+public:
+    plPXStepDispatcher() : fStop() { }
+    ~plPXStepDispatcher() { SetNumThreads(0); }
+
+    /** Don't change the threads while anything is stepping. */
+    void SetNumThreads(size_t numThreads)
+    {
+        if (fThreads.size() == numThreads)
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(fMutex);
+            fStop = true;
+        }
+        fQueued.notify_all();
+        for (std::thread& thread : fThreads)
+            thread.join();
+        fThreads.clear();
+        fStop = false;
+
+        for (size_t i = 0; i < numThreads; ++i)
+            fThreads.emplace_back(&plPXStepDispatcher::IWork, this);
+    }
+
+    size_t GetNumThreads() const { return fThreads.size(); }
+
+    void submitTask(physx::PxBaseTask& task) override
+    {
+        if (fThreads.empty()) {
+            task.run();
+            task.release();
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(fMutex);
+            fTasks.push_back(&task);
+        }
+        fQueued.notify_one();
+    }
+
+    uint32_t getWorkerCount() const override { return (uint32_t)fThreads.size(); }
+};
+
+// ==========================================================================
+
 plPXSimulation::plPXSimulation()
     : fPxFoundation(), fDebugger(), fTransport(), fPxPhysics(), fPxCooking(),
-      fPxCpuDispatcher(), fAccumulator()
+      fPxCpuDispatcher(), fAccumulator(), fSteppingSubSteps(),
+      fCookCacheHits(), fCookCacheMisses(), fCookSeconds()
 {
 }
 
 plPXSimulation::~plPXSimulation()
 {
+    for (physx::PxScene* scene : fSteppingWorlds)
+        scene->fetchResults(true);
+    fSteppingWorlds.clear();
+
     // This should only run for the empty main world.
     for (const auto& world : fWorlds)
         world.second->release();
@@ -343,8 +459,7 @@ plPXSimulation::~plPXSimulation()
 
     if (fPxCooking)
         fPxCooking->release();
-    if (fPxCpuDispatcher)
-        fPxCpuDispatcher->release();
+    delete fPxCpuDispatcher;
     if (fPxPhysics)
         fPxPhysics->release();
     PxCloseExtensions();
@@ -403,12 +518,9 @@ bool plPXSimulation::Init()
 
     // Worker threads actually slow down our simulation - probably because Uru scenes are mostly
     // composed of static geometry, so the thread synchronization adds more overhead than the
-    // threads help.
-    fPxCpuDispatcher = physx::PxDefaultCpuDispatcherCreate(0);
-    if (!fPxCpuDispatcher) {
-        plStatusLog::AddLineS("Simulation.log", plStatusLog::kRed, "PhysX CPU Dispatcher failed to initialize!");
-        return false;
-    }
+    // threads help. The dispatcher only gets threads to run the step alongside the rest of
+    // the frame; \sa SetStepThreads().
+    fPxCpuDispatcher = new plPXStepDispatcher();
 
     physx::PxCookingParams params(scale);
     // disable mesh cleaning - perform mesh validation on development configurations
@@ -494,36 +606,198 @@ bool plPXSimulation::IsDebuggerConnected() const
 
 // ==========================================================================
 
-physx::PxConvexMesh* plPXSimulation::InsertConvexHull(const std::vector<uint32_t>& tris,
-                                                      const std::vector<hsPoint3>& verts)
+uint32_t plPXSimulation::fNumStepThreads = 1;
+
+plFileName plPXSimulation::IGetCookCachePath(const plPXCookJob& job) const
+{
+    const char* ext = job.fType == plPXCookJob::Type::kConvexHull ? "hull" : "mesh";
+    return plFileName::Join(plFileSystem::GetUserDataPath(), "PhysXCache",
+                            ST::format("{016x}.{}", job.fHash, ext));
+}
+
+bool plPXSimulation::IReadCookCache(plPXCookJob& job) const
+{
+    hsUNIXStream file;
+    if (!file.Open(IGetCookCachePath(job), "rb"))
+        return false;
+    if (file.GetEOF() < sizeof(uint32_t) * 6)
+        return false;
+
+    if (file.ReadLE32() != kCookCacheMagic || file.ReadLE32() != kCookCacheVersion)
+        return false;
+    if (file.ReadLE32() != PX_PHYSICS_VERSION)
+        return false;
+    if (file.ReadLE32() != (uint32_t)job.fHash || file.ReadLE32() != (uint32_t)(job.fHash >> 32))
+        return false;
+
+    uint32_t size = file.ReadLE32();
+    if (size == 0 || size != file.GetSizeLeft()) // truncated?
+        return false;
+
+    job.fCooked.resize(size);
+    if (file.Read(size, job.fCooked.data()) != size) {
+        job.fCooked.clear();
+        return false;
+    }
+    return true;
+}
+
+void plPXSimulation::IWriteCookCache(const plPXCookJob& job) const
+{
+    // Write it off to the side and rename it into place, so that a crash (or another client
+    // reading the same age) never sees half a mesh. The size check in IReadCookCache still
+    // catches anything that slips through.
+    plFileName cachePath = IGetCookCachePath(job);
+    plFileName tempPath = ST::format("{}.tmp", cachePath);
+    plFileSystem::CreateDir(cachePath.StripFileName(), true);
+
+    hsUNIXStream file;
+    if (!file.Open(tempPath, "wb"))
+        return;
+    file.WriteLE32(kCookCacheMagic);
+    file.WriteLE32(kCookCacheVersion);
+    file.WriteLE32(PX_PHYSICS_VERSION);
+    file.WriteLE32((uint32_t)job.fHash);
+    file.WriteLE32((uint32_t)(job.fHash >> 32));
+    file.WriteLE32((uint32_t)job.fCooked.size());
+    uint32_t written = file.Write((uint32_t)job.fCooked.size(), job.fCooked.data());
+    file.Close();
+
+    if (written != job.fCooked.size()) {
+        plFileSystem::Unlink(tempPath);
+        return;
+    }
+
+    // plFileSystem::Move is a copy and unlink outside Windows, which isn't atomic.
+#if HS_BUILD_FOR_WIN32
+    bool moved = plFileSystem::Move(tempPath, cachePath);
+#else
+    bool moved = rename(tempPath.AsString().c_str(), cachePath.AsString().c_str()) == 0;
+#endif
+    if (!moved)
+        plFileSystem::Unlink(tempPath);
+}
+
+void plPXSimulation::ICook(plPXCookJob& job) const
 {
-    physx::PxConvexMeshDesc desc;
-    desc.indices.count = tris.size();
-    desc.indices.stride = sizeof(uint32_t);
-    desc.indices.data = tris.empty() ? nullptr : &tris[0];
-    desc.points.count = verts.size();
-    desc.points.stride = sizeof(hsPoint3);
-    desc.points.data = &verts[0];
-    desc.flags = physx::PxConvexFlag::eDISABLE_MESH_VALIDATION |
-                 physx::PxConvexFlag::eFAST_INERTIA_COMPUTATION;
-    if (tris.empty())
-        desc.flags |= physx::PxConvexFlag::eCOMPUTE_CONVEX;
+    double start = hsTimer::GetSeconds<double>();
+    physx::PxDefaultMemoryOutputStream output;
+    bool cooked = false;
+
+    switch (job.fType) {
+    case plPXCookJob::Type::kConvexHull:
+    {
+        physx::PxConvexMeshDesc desc;
+        desc.indices.count = job.fTris.size();
+        desc.indices.stride = sizeof(uint32_t);
+        desc.indices.data = job.fTris.empty() ? nullptr : job.fTris.data();
+        desc.points.count = job.fVerts.size();
+        desc.points.stride = sizeof(hsPoint3);
+        desc.points.data = job.fVerts.data();
+        desc.flags = physx::PxConvexFlag::eDISABLE_MESH_VALIDATION |
+                     physx::PxConvexFlag::eFAST_INERTIA_COMPUTATION;
+        if (job.fTris.empty())
+            desc.flags |= physx::PxConvexFlag::eCOMPUTE_CONVEX;
+        cooked = fPxCooking->cookConvexMesh(desc, output);
+    }
+    break;
+
+    case plPXCookJob::Type::kTriangleMesh:
+    {
+        physx::PxTriangleMeshDesc desc;
+        desc.points.count = job.fVerts.size();
+        desc.points.stride = sizeof(hsPoint3);
+        desc.points.data = job.fVerts.data();
+        desc.triangles.count = job.fTris.size() / 3;
+        desc.triangles.stride = sizeof(uint32_t) * 3;
+        desc.triangles.data = job.fTris.data();
+        cooked = fPxCooking->cookTriangleMesh(desc, output);
+    }
+    break;
+    }
+
+    job.fCooked.clear();
+    if (cooked)
+        job.fCooked.assign(output.getData(), output.getData() + output.getSize());
+    job.fCookTime = hsTimer::GetSeconds<double>() - start;
+}
 
-    return fPxCooking->createConvexMesh(desc, fPxPhysics->getPhysicsInsertionCallback());
+std::shared_ptr<plPXCookJob> plPXSimulation::CookMesh(plPXCookJob::Type type,
+                                                      std::vector<uint32_t> tris,
+                                                      std::vector<hsPoint3> verts)
+{
+    auto job = std::make_shared<plPXCookJob>(type, std::move(tris), std::move(verts));
+    if (IReadCookCache(*job))
+        job->fCacheHit = true;
+    else
+        ICook(*job);
+    return job;
 }
 
-physx::PxTriangleMesh* plPXSimulation::InsertTriangleMesh(const std::vector<uint32_t>& tris,
-                                                          const std::vector<hsPoint3>& verts)
+template<class MeshT>
+MeshT* plPXSimulation::IInsertMesh(plPXCookJob& job, MeshT* (physx::PxPhysics::*create)(physx::PxInputStream&))
 {
-    physx::PxTriangleMeshDesc desc;
-    desc.points.count = verts.size();
-    desc.points.stride = sizeof(hsPoint3);
-    desc.points.data = &verts[0];
-    desc.triangles.count = tris.size() / 3;
-    desc.triangles.stride = sizeof(uint32_t) * 3;
-    desc.triangles.data = &tris[0];
+    MeshT* mesh = nullptr;
+    if (!job.fCooked.empty()) {
+        physx::PxDefaultMemoryInputData input(job.fCooked.data(), (physx::PxU32)job.fCooked.size());
+        mesh = (fPxPhysics->*create)(input);
+    }
 
-    return fPxCooking->createTriangleMesh(desc, fPxPhysics->getPhysicsInsertionCallback());
+    // A cache entry PhysX doesn't like is cooked over again and replaced.
+    if (!mesh && job.fCacheHit) {
+        job.fCacheHit = false;
+        ICook(job);
+        if (!job.fCooked.empty()) {
+            physx::PxDefaultMemoryInputData input(job.fCooked.data(), (physx::PxU32)job.fCooked.size());
+            mesh = (fPxPhysics->*create)(input);
+        }
+    }
+
+    if (job.fCacheHit) {
+        fCookCacheHits++;
+    } else {
+        fCookCacheMisses++;
+        fCookSeconds += job.fCookTime;
+        if (mesh)
+            IWriteCookCache(job);
+    }
+    return mesh;
+}
+
+physx::PxConvexMesh* plPXSimulation::InsertConvexHull(const std::shared_ptr<plPXCookJob>& job)
+{
+    hsAssert(job->GetType() == plPXCookJob::Type::kConvexHull, "Inserting a triangle mesh as a hull?");
+    return IInsertMesh(*job, &physx::PxPhysics::createConvexMesh);
+}
+
+physx::PxTriangleMesh* plPXSimulation::InsertTriangleMesh(const std::shared_ptr<plPXCookJob>& job)
+{
+    hsAssert(job->GetType() == plPXCookJob::Type::kTriangleMesh, "Inserting a hull as a triangle mesh?");
+    return IInsertMesh(*job, &physx::PxPhysics::createTriangleMesh);
+}
+
+physx::PxConvexMesh* plPXSimulation::InsertConvexHull(std::vector<uint32_t> tris,
+                                                      std::vector<hsPoint3> verts)
+{
+    return InsertConvexHull(CookMesh(plPXCookJob::Type::kConvexHull, std::move(tris), std::move(verts)));
+}
+
+physx::PxTriangleMesh* plPXSimulation::InsertTriangleMesh(std::vector<uint32_t> tris,
+                                                          std::vector<hsPoint3> verts)
+{
+    return InsertTriangleMesh(CookMesh(plPXCookJob::Type::kTriangleMesh, std::move(tris), std::move(verts)));
+}
+
+void plPXSimulation::ReportCookStats()
+{
+    if (fCookCacheHits == 0 && fCookCacheMisses == 0)
+        return;
+
+    plSimulationMgr::Log("Collision meshes: {} from the cooking cache, {} cooked in {.1f} ms",
+                         fCookCacheHits, fCookCacheMisses, fCookSeconds * 1000.0);
+    fCookCacheHits = 0;
+    fCookCacheMisses = 0;
+    fCookSeconds = 0.0;
 }
 
 physx::PxRigidActor* plPXSimulation::CreateRigidActor(const physx::PxGeometry& geometry,
@@ -588,7 +862,8 @@ physx::PxScene* plPXSimulation::InitSubworld(const plKey& world)
     desc.frictionType = physx::PxFrictionType::eTWO_DIRECTIONAL;
     desc.solverType = physx::PxSolverType::eTGS;
     desc.flags = physx::PxSceneFlag::eENABLE_PCM |
-                 physx::PxSceneFlag::eENABLE_AVERAGE_POINT;
+                 physx::PxSceneFlag::eENABLE_AVERAGE_POINT |
+                 physx::PxSceneFlag::eENABLE_ACTIVE_ACTORS;
     desc.cpuDispatcher = fPxCpuDispatcher;
     desc.userData = world ? world->ObjectIsLoaded() : nullptr;
 
@@ -620,6 +895,14 @@ void plPXSimulation::ReleaseSubworld(const hsKeyedObject* world)
             plStatusLog::AddLineSF("Simulation.log", plStatusLog::kGreen,
                                    "Releasing world '{}'",
                                    world ? world->GetKey()->GetUoid().StringIze() : "(main world)");
+
+            // A world can't go away in the middle of a step.
+            auto stepping = std::find(fSteppingWorlds.begin(), fSteppingWorlds.end(), it->second);
+            if (stepping != fSteppingWorlds.end()) {
+                (*stepping)->fetchResults(true);
+                fSteppingWorlds.erase(stepping);
+            }
+
             it->second->release();
             fWorlds.erase(it);
         }
@@ -682,13 +965,17 @@ void plPXSimulation::RemoveFromWorld(physx::PxRigidActor* actor)
     scene->removeActor(*actor);
     ReleaseSubworld((hsKeyedObject*)scene->userData);
 
+    auto it = std::find(fActiveActors.begin(), fActiveActors.end(), actor);
+    if (it != fActiveActors.end())
+        fActiveActors.erase(it);
+
     // Implicitly releases all actor shapes
     actor->release();
 }
 
 // ==========================================================================
 
-bool plPXSimulation::Advance(float delta)
+bool plPXSimulation::IBeginStep(float delta)
 {
     fAccumulator += delta;
     if (fAccumulator < kDefaultStepSize) {
@@ -716,13 +1003,35 @@ bool plPXSimulation::Advance(float delta)
     plPXPhysicalControllerCore::Apply(delta);
     plProfile_EndTiming(ApplyController);
 
+    uint32_t numThreads = fNumStepThreads;
+    if (numThreads == 0)
+        numThreads = std::max(std::thread::hardware_concurrency(), 1U);
+    fPxCpuDispatcher->SetNumThreads(numThreads - 1);
+
+    // Every world steps at once; with step threads, simulate() returns right away.
     plProfile_BeginTiming(Step);
     for (auto& it : fWorlds) {
         it.second->simulate(delta);
-        it.second->fetchResults(true);
+        fSteppingWorlds.push_back(it.second);
+    }
+    fSteppingSubSteps = numSubSteps;
+    plProfile_EndTiming(Step);
+
+    return true;
+}
+
+bool plPXSimulation::IFinishStep()
+{
+    if (fSteppingSubSteps == 0)
+        return false;
+
+    fActiveActors.clear();
+    plProfile_BeginTiming(Step);
+    for (physx::PxScene* scene : fSteppingWorlds) {
+        scene->fetchResults(true);
 
         physx::PxSimulationStatistics stats;
-        it.second->getSimulationStatistics(stats);
+        scene->getSimulationStatistics(stats);
         plProfile_IncCount(ActiveBodies, stats.nbActiveDynamicBodies + stats.nbActiveDynamicBodies);
         plProfile_IncCount(ActiveDynamics, stats.nbActiveDynamicBodies);
         plProfile_IncCount(ActiveKinematics, stats.nbActiveKinematicBodies);
@@ -730,13 +1039,72 @@ bool plPXSimulation::Advance(float delta)
         plProfile_IncCount(Dynamics, stats.nbDynamicBodies);
         plProfile_IncCount(Kinematics, stats.nbKinematicBodies);
         plProfile_IncCount(Statics, stats.nbStaticBodies);
+
+        physx::PxU32 numActive;
+        physx::PxActor** active = scene->getActiveActors(numActive);
+        for (physx::PxU32 i = 0; i < numActive; ++i) {
+            if (auto rigid = active[i]->is<physx::PxRigidActor>())
+                fActiveActors.push_back(rigid);
+        }
     }
+    fSteppingWorlds.clear();
     plProfile_EndTiming(Step);
 
     // Propagate the simulated controller movement to the SceneObjects for rendering purposes.
     plProfile_BeginTiming(CorrectController);
-    plPXPhysicalControllerCore::Update(numSubSteps, fAccumulator / kDefaultStepSize);
+    plPXPhysicalControllerCore::Update(fSteppingSubSteps, fAccumulator / kDefaultStepSize);
     plProfile_EndTiming(CorrectController);
 
+    fSteppingSubSteps = 0;
     return true;
 }
+
+bool plPXSimulation::FinishStep()
+{
+    return IFinishStep();
+}
+
+bool plPXSimulation::Advance(float delta)
+{
+    // Without interpolation, there's nothing to send for frames that don't step.
+    if (!IsInterpolating())
+        fActiveActors.clear();
+
+    // Whatever the last call left stepping normally came in with FinishStep() already.
+    // If the caller doesn't split its frame, pick it up now so steps never overlap.
+    bool stepped = IFinishStep();
+
+    if (IBeginStep(delta) && fPxCpuDispatcher->GetNumThreads() == 0)
+        stepped = IFinishStep() || stepped;
+    return stepped;
+}
+
+bool plPXSimulation::IsInterpolating() const
+{
+    return fPxCpuDispatcher->GetNumThreads() != 0;
+}
+
+float plPXSimulation::GetStepAlpha() const
+{
+    return fAccumulator / kDefaultStepSize;
+}
+
+physx::PxTransform plPXSimulation::InterpolatePose(const physx::PxRigidActor* actor) const
+{
+    physx::PxTransform pose = actor->getGlobalPose();
+
+    auto body = actor->is<physx::PxRigidDynamic>();
+    if (!body || body->getRigidBodyFlags().isSet(physx::PxRigidBodyFlag::eKINEMATIC))
+        return pose;
+
+    // The last substep moved the body by exactly its velocity times the step size, so
+    // walk that back for the part of the step that hasn't happened yet.
+    float back = (1.f - GetStepAlpha()) * kDefaultStepSize;
+    pose.p -= body->getLinearVelocity() * back;
+
+    physx::PxVec3 angVel = body->getAngularVelocity();
+    float speed = angVel.magnitude();
+    if (speed > 0.f)
+        pose.q = (physx::PxQuat(-speed * back, angVel / speed) * pose.q).getNormalized();
+    return pose;
+}
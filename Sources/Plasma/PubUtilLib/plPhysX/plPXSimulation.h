@@ -42,19 +42,25 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #ifndef plPXSimulation_H
 #define plPXSimulation_H
 
+#include "hsGeometry3.h"
 #include "plFileSystem.h"
 #include "pnKeyedObject/plKey.h"
 
+#include <condition_variable>
+#include <deque>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <string_theory/string>
+#include <thread>
 #include <vector>
 
 class hsKeyedObject;
-struct hsPoint3;
 class plPXFilterData;
 class plPXPhysical;
 class plPXPhysicalControllerCore;
+class plPXStepDispatcher;
 class hsQuat;
 
 namespace physx
@@ -65,9 +71,9 @@ namespace physx
     class PxController;
     class PxControllerDesc;
     class PxControllerManager;
-    class PxDefaultCpuDispatcher;
     class PxFoundation;
     class PxGeometry;
+    class PxInputStream;
     class PxMaterial;
     class PxPvd;
     class PxPvdTransport;
@@ -95,6 +101,37 @@ enum class plPXDebuggerStatus
     kDisconnected,
 };
 
+/**
+ * A convex hull or triangle mesh on its way into the simulation.
+ * Meshes that are in the cooking cache are read from it, and anything else is cooked
+ * when the job is created.
+ */
+class plPXCookJob
+{
+    friend class plPXSimulation;
+
+public:
+    enum class Type
+    {
+        kConvexHull,
+        kTriangleMesh,
+    };
+
+protected:
+    Type fType;
+    uint64_t fHash;
+    std::vector<uint32_t> fTris;
+    std::vector<hsPoint3> fVerts;
+    std::vector<uint8_t> fCooked;
+    double fCookTime;
+    bool fCacheHit;
+
+public:
+    plPXCookJob(Type type, std::vector<uint32_t> tris, std::vector<hsPoint3> verts);
+
+    Type GetType() const { return fType; }
+};
+
 class plPXActorData
 {
     plKey fKey;
@@ -111,7 +148,7 @@ public:
 
     /** Gets the key of the owner object. */
     [[nodiscard]]
-    plKey GetKey() const { return fKey; }
+    const plKey& GetKey() const { return fKey; }
 
     [[nodiscard]]
     plPXPhysical* GetPhysical() const { return fPhysical; }
@@ -133,13 +170,40 @@ protected:
     physx::PxPvdTransport* fTransport;
     physx::PxPhysics* fPxPhysics;
     physx::PxCooking* fPxCooking;
-    physx::PxDefaultCpuDispatcher* fPxCpuDispatcher;
+    plPXStepDispatcher* fPxCpuDispatcher;
     std::map<plKey, physx::PxScene*> fWorlds;
     float fAccumulator;
 
+    // Worlds told to simulate whose results haven't been fetched yet, and how many
+    // substeps they're taking (0 if nothing is stepping)
+    std::vector<physx::PxScene*> fSteppingWorlds;
+    int fSteppingSubSteps;
+
+    static uint32_t fNumStepThreads;
+
+    // Actors PhysX moved in the last finished step, across all the worlds
+    std::vector<physx::PxRigidActor*> fActiveActors;
+
+    // What the cooking cache has saved us since the last ReportCookStats
+    uint32_t fCookCacheHits;
+    uint32_t fCookCacheMisses;
+    double fCookSeconds;
+
 protected:
     bool IConnectDebugger(physx::PxPvdTransport* transport);
 
+    plFileName IGetCookCachePath(const plPXCookJob& job) const;
+    bool IReadCookCache(plPXCookJob& job) const;
+    void IWriteCookCache(const plPXCookJob& job) const;
+
+    void ICook(plPXCookJob& job) const;
+
+    template<class MeshT>
+    MeshT* IInsertMesh(plPXCookJob& job, MeshT* (physx::PxPhysics::*create)(physx::PxInputStream&));
+
+    bool IBeginStep(float delta);
+    bool IFinishStep();
+
 public:
     plPXSimulation();
     plPXSimulation(const plPXSimulation&) = delete;
@@ -187,15 +251,35 @@ protected:
     physx::PxMaterial* InitMaterial(float uStatic, float uDynamic, float restitution);
 
 public:
+    /**
+     * Gets a mesh ready for the simulation, from the cooking cache if it's there.
+     * \sa InsertConvexHull() and \sa InsertTriangleMesh() turn the result into a PhysX mesh.
+     */
+    [[nodiscard]]
+    std::shared_ptr<plPXCookJob> CookMesh(plPXCookJob::Type type,
+                                          std::vector<uint32_t> tris,
+                                          std::vector<hsPoint3> verts);
+
+    /** Inserts a cooked convex mesh into the simulation. */
+    [[nodiscard]]
+    physx::PxConvexMesh* InsertConvexHull(const std::shared_ptr<plPXCookJob>& job);
+
+    /** Inserts a cooked triangle mesh into the simulation. */
+    [[nodiscard]]
+    physx::PxTriangleMesh* InsertTriangleMesh(const std::shared_ptr<plPXCookJob>& job);
+
     /** Cooks and inserts a convex mesh into the simulation. */
     [[nodiscard]]
-    physx::PxConvexMesh* InsertConvexHull(const std::vector<uint32_t>& tris,
-                                          const std::vector<hsPoint3>& verts);
+    physx::PxConvexMesh* InsertConvexHull(std::vector<uint32_t> tris,
+                                          std::vector<hsPoint3> verts);
 
     /** Cooks and inserts a triangle mesh into the simulation. */
     [[nodiscard]]
-    physx::PxTriangleMesh* InsertTriangleMesh(const std::vector<uint32_t>& tris,
-                                              const std::vector<hsPoint3>& verts);
+    physx::PxTriangleMesh* InsertTriangleMesh(std::vector<uint32_t> tris,
+                                              std::vector<hsPoint3> verts);
+
+    /** Writes the cooking cache hits and cook time since the last report to the sim log. */
+    void ReportCookStats();
 
     [[nodiscard]]
     physx::PxRigidActor* CreateRigidActor(const physx::PxGeometry& geometry,
@@ -224,8 +308,57 @@ public:
      */
     void RemoveFromWorld(physx::PxRigidActor* actor);
 
-    /** Advances the simulation. */
+    /**
+     * Sets how many threads run the simulation step.
+     * 0 means one per core, and 1 (the default) runs the whole step inside Advance().
+     * With more, the step is left running while the frame goes on, and its results come
+     * in with the next FinishStep() or Advance(). It takes the same fixed substeps either way.
+     */
+    static void SetStepThreads(uint32_t numThreads) { fNumStepThreads = numThreads; }
+    static uint32_t GetStepThreads() { return fNumStepThreads; }
+
+    /**
+     * Collects the results of a step the last Advance() left running on the step threads.
+     * Call it before the frame's transform pass, so the avatar corrections it sends are
+     * applied before the next step reads the avatars' transforms.
+     * Returns whether any results came in.
+     */
+    bool FinishStep();
+
+    /**
+     * Advances the simulation.
+     * Returns whether any results came in, which, with step threads, are from the step
+     * started by the previous call if FinishStep() didn't already collect them.
+     */
     bool Advance(float delta);
+
+    /**
+     * Whether poses sent out for rendering are blended between steps.
+     * Only the step threads need it; stepping in Advance() sends the real poses, as always.
+     */
+    bool IsInterpolating() const;
+
+    /**
+     * How far the accumulated frame time is into the next fixed step, from 0 to 1.
+     * While interpolating, poses sent out for rendering are blended this far from the
+     * previous step to the last.
+     */
+    float GetStepAlpha() const;
+
+    /**
+     * Gets the actor's pose blended GetStepAlpha() of the way from the previous step,
+     * the same way the controllers blend their avatars.
+     * Kinematic and static actors aren't simulated, so they just get their current pose.
+     */
+    physx::PxTransform InterpolatePose(const physx::PxRigidActor* actor) const;
+
+    /**
+     * Gets the actors whose poses changed in the last finished step.
+     * While interpolating, they stay here until the next step finishes, so their blended
+     * poses can be sent out again on frames that don't step. Otherwise, Advance() clears them.
+     * Anything that was sleeping, static, or moved directly (rather than by simulating) isn't here.
+     */
+    const std::vector<physx::PxRigidActor*>& GetActiveActors() const { return fActiveActors; }
 };
 
 #endif
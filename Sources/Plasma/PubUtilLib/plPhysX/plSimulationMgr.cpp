@@ -53,6 +53,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plPXPhysicalControllerCore.h"
 #include "plPXSimulation.h"
 #include "plPXSubWorld.h"
+#include "plPhysXAPI.h"
 
 #include "pnMessage/plRefMsg.h"
 #include "pnNetCommon/plSDLTypes.h"
@@ -87,9 +88,10 @@ void plSimulationMgr::Init()
 {
     hsAssert(!gTheInstance, "Initializing the sim when it's already been done");
     gTheInstance = new plSimulationMgr;
-    if (gTheInstance->fSimulation->Init())
+    if (gTheInstance->fSimulation->Init()) {
         gTheInstance->RegisterAs(kSimulationMgr_KEY);
-    else
+        plgDispatch::Dispatch()->RegisterForExactType(plAgeLoadedMsg::Index(), gTheInstance->GetKey());
+    } else
         gTheInstance = nullptr;
 }
 
@@ -97,8 +99,10 @@ void plSimulationMgr::Init()
 void plSimulationMgr::Shutdown()
 {
     hsAssert(gTheInstance, "Simulation manager missing during shutdown.");
-    if (gTheInstance)
+    if (gTheInstance) {
+        plgDispatch::Dispatch()->UnRegisterForExactType(plAgeLoadedMsg::Index(), gTheInstance->GetKey());
         gTheInstance->UnRegisterAs(kSimulationMgr_KEY);     // this will destroy the instance
+    }
 }
 
 plSimulationMgr* plSimulationMgr::GetInstance()
@@ -140,7 +144,13 @@ bool plSimulationMgr::MsgReceive(plMessage* msg)
             switch (refMsg->GetContext()) {
             case plRefMsg::kOnCreate:
             case plRefMsg::kOnRequest:
-                fPhysicals.push_back(plPXPhysical::ConvertNoRef(refMsg->GetRef()));
+                {
+                    plPXPhysical* physical = plPXPhysical::ConvertNoRef(refMsg->GetRef());
+                    fPhysicals.push_back(physical);
+                    if (physical && physical->GetWorldKey() &&
+                        std::find(fSubworldPhysicals.begin(), fSubworldPhysicals.end(), physical) == fSubworldPhysicals.end())
+                        fSubworldPhysicals.push_back(physical);
+                }
                 break;
 
             case plRefMsg::kOnDestroy:
@@ -149,6 +159,9 @@ bool plSimulationMgr::MsgReceive(plMessage* msg)
                     auto it = std::find(fPhysicals.begin(), fPhysicals.end(), refMsg->GetRef());
                     if (it != fPhysicals.end())
                         fPhysicals.erase(it);
+                    it = std::find(fSubworldPhysicals.begin(), fSubworldPhysicals.end(), refMsg->GetRef());
+                    if (it != fSubworldPhysicals.end())
+                        fSubworldPhysicals.erase(it);
                 }
                 break;
             }
@@ -158,6 +171,13 @@ bool plSimulationMgr::MsgReceive(plMessage* msg)
         }
     }
 
+    // Everything in the age has been read in, so tell the log what cooking its meshes cost.
+    if (plAgeLoadedMsg* loadedMsg = plAgeLoadedMsg::ConvertNoRef(msg)) {
+        if (loadedMsg->fLoaded)
+            fSimulation->ReportCookStats();
+        return true;
+    }
+
     return hsKeyedObject::MsgReceive(msg);
 }
 
@@ -209,23 +229,31 @@ void plSimulationMgr::ResetKickables()
     }
 }
 
-void plSimulationMgr::Advance(float delSecs)
+void plSimulationMgr::FinishStep()
 {
-    if (fSuspended)
-        return;
-
-    // Only pump the sounds if the simulation actually advanced. Otherwise we get fascinating
-    // (read: bad) sounds stopping/starting when the fps is greater than the simulation frequency.
-    if (fSimulation->Advance(delSecs))
+    if (!fSuspended && fSimulation->FinishStep())
         fSoundMgr->Update();
+}
 
-    plProfile_BeginTiming(ProcessSyncs);
-    IProcessSynchs();
-    plProfile_EndTiming(ProcessSyncs);
+void plSimulationMgr::Advance(float delSecs)
+{
+    if (!fSuspended) {
+        // Only pump the sounds if the simulation actually advanced. Otherwise we get fascinating
+        // (read: bad) sounds stopping/starting when the fps is greater than the simulation frequency.
+        if (fSimulation->Advance(delSecs))
+            fSoundMgr->Update();
+
+        plProfile_BeginTiming(ProcessSyncs);
+        IProcessSynchs();
+        plProfile_EndTiming(ProcessSyncs);
+
+        plProfile_BeginTiming(UpdateContexts);
+        ISendUpdates();
+        plProfile_EndTiming(UpdateContexts);
+    }
 
-    plProfile_BeginTiming(UpdateContexts);
-    ISendUpdates();
-    plProfile_EndTiming(UpdateContexts);
+    // Line of sight requests made so far this frame see the world as of the last finished step.
+    fLOSDispatch->ProcessRequests();
 }
 
 void plSimulationMgr::ISendUpdates()
@@ -239,10 +267,42 @@ void plSimulationMgr::ISendUpdates()
     }
     fCollideMsgs.clear();
 
-    for (auto physical : fPhysicals) {
+    for (physx::PxRigidActor* actor : fSimulation->GetActiveActors()) {
+        auto data = static_cast<plPXActorData*>(actor->userData);
+        if (data && data->GetPhysical())
+            data->GetPhysical()->QueueNewLocation();
+    }
+
+    for (auto it = fSubworldPhysicals.begin(); it != fSubworldPhysicals.end();) {
+        if ((*it)->GetWorldKey()) {
+            (*it)->QueueNewLocation();
+            ++it;
+        } else {
+            it = fSubworldPhysicals.erase(it);
+        }
+    }
+
+    // Anything queued while we're sending goes out next time.
+    fUpdatingPhysicals.swap(fQueuedPhysicals);
+    for (auto physical : fUpdatingPhysicals) {
+        if (!physical)
+            continue;
+        physical->fLocationQueued = false;
         if (physical->GetSceneNode())
             physical->SendNewLocation();
     }
+    fUpdatingPhysicals.clear();
+}
+
+void plSimulationMgr::QueueNewLocation(plPXPhysical* physical)
+{
+    fQueuedPhysicals.push_back(physical);
+}
+
+void plSimulationMgr::DequeueNewLocation(plPXPhysical* physical)
+{
+    std::replace(fQueuedPhysicals.begin(), fQueuedPhysicals.end(), physical, (plPXPhysical*)nullptr);
+    std::replace(fUpdatingPhysicals.begin(), fUpdatingPhysicals.end(), physical, (plPXPhysical*)nullptr);
 }
 
 
@@ -81,6 +81,9 @@ public:
 
     bool MsgReceive(plMessage* msg) override;
 
+    // Collect a step left running on the step threads by the last Advance, if any
+    void FinishStep();
+
     // Advance the simulation by the given number of seconds
     void Advance(float delSecs);
 
@@ -106,6 +109,10 @@ public:
 
     void ResetKickables();
 
+    /** Sends the physical's new location with the next update. \sa plPXPhysical::QueueNewLocation() */
+    void QueueNewLocation(plPXPhysical* physical);
+    void DequeueNewLocation(plPXPhysical* physical);
+
 protected:
     void ISendUpdates();
 
@@ -122,6 +129,13 @@ protected:
 
     std::vector<plPXPhysical*> fPhysicals;
 
+    // Only physicals that may have moved get their new locations sent: these, the
+    // ones PhysX reports as active, and the ones in a subworld, since those move
+    // whenever their subworld does.
+    std::vector<plPXPhysical*> fQueuedPhysicals;
+    std::vector<plPXPhysical*> fUpdatingPhysicals;
+    std::vector<plPXPhysical*> fSubworldPhysicals;
+
     plLOSDispatch* fLOSDispatch;
 
     // Is the entire physics world suspended? If so, the clock can still advance
@@ -318,6 +318,14 @@ public:
         return fView.HarvestVisible(space, visList);
     }
 
+    void PrepareHarvest(plSpaceTree* space) override {
+        fView.PrepareHarvest(space);
+    }
+
+    bool HarvestPrepared(const plSpaceTree* space, std::vector<int16_t>& visList) const override {
+        return fView.HarvestPrepared(space, visList);
+    }
+
 
     /**
      * Add the input polys into the list of polys from which to generate the
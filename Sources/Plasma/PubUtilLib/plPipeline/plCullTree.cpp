@@ -968,6 +968,20 @@ void plCullTree::ISetupScratch(uint16_t nNodes)
     ScratchPolys().SetCount(0);
 }
 
+// Every harvest leaves these empty when it's done, so all the cull trees
+// on a thread can share them.
+static thread_local hsTArray<int16_t>   scratchClear;
+static thread_local hsTArray<int16_t>   scratchSplit;
+static thread_local hsTArray<int16_t>   scratchCulled;
+static thread_local hsBitVector         scratchBitVec;
+static thread_local hsBitVector         scratchTotVec;
+
+hsTArray<int16_t>& plCullTree::ScratchClear() const { return scratchClear; }
+hsTArray<int16_t>& plCullTree::ScratchSplit() const { return scratchSplit; }
+hsTArray<int16_t>& plCullTree::ScratchCulled() const { return scratchCulled; }
+hsBitVector& plCullTree::ScratchBitVec() const { return scratchBitVec; }
+hsBitVector& plCullTree::ScratchTotVec() const { return scratchTotVec; }
+
 void plCullTree::Reset()
 {
     // Using NodeList as scratch will only work if we use indices,
@@ -75,11 +75,6 @@ protected:
     mutable float                        fVisYon;
 
     mutable hsTArray<plCullPoly>    fScratchPolys;
-    mutable hsTArray<int16_t>       fScratchClear;
-    mutable hsTArray<int16_t>       fScratchSplit;
-    mutable hsTArray<int16_t>       fScratchCulled;
-    mutable hsBitVector             fScratchBitVec;
-    mutable hsBitVector             fScratchTotVec;
 
     void        IVisPolyShape(const plCullPoly& poly, bool dark) const;
     void        IVisPolyEdge(const hsPoint3& p0, const hsPoint3& p1, bool dark) const;
@@ -102,12 +97,14 @@ protected:
     int16_t               IMakePolyNode(const plCullPoly& poly, int i0, int i1) const;
 
     // Some scratch areas for the nodes use when building the tree etc.
+    // The ones used for harvesting are per thread, so several space trees
+    // can be harvested against the same cull tree at once.
     hsTArray<plCullPoly>&           ScratchPolys() const { return fScratchPolys; }
-    hsTArray<int16_t>&              ScratchClear() const { return fScratchClear; }
-    hsTArray<int16_t>&              ScratchSplit() const { return fScratchSplit; }
-    hsTArray<int16_t>&              ScratchCulled() const { return fScratchCulled; }
-    hsBitVector&                    ScratchBitVec() const { return fScratchBitVec; }
-    hsBitVector&                    ScratchTotVec() const { return fScratchTotVec; }
+    hsTArray<int16_t>&              ScratchClear() const;
+    hsTArray<int16_t>&              ScratchSplit() const;
+    hsTArray<int16_t>&              ScratchCulled() const;
+    hsBitVector&                    ScratchBitVec() const;
+    hsBitVector&                    ScratchTotVec() const;
 
     void                            ISetupScratch(uint16_t nNodes);
 
@@ -251,16 +251,34 @@ bool plPipelineViewSettings::HarvestVisible(plSpaceTree* space, std::vector<int1
     if (!space)
         return false;
 
+    PrepareHarvest(space);
+
+    plProfile_BeginTiming(Harvest);
+    HarvestPrepared(space, visList);
+    plProfile_EndTiming(Harvest);
+
+    return !visList.empty();
+}
+
+void plPipelineViewSettings::PrepareHarvest(plSpaceTree* space)
+{
+    if (!space)
+        return;
+
     space->SetViewPos(GetViewPositionWorld());
 
     space->Refresh();
 
     if (fCullTreeDirty)
         RefreshCullTree();
+}
+
+bool plPipelineViewSettings::HarvestPrepared(const plSpaceTree* space, std::vector<int16_t>& visList) const
+{
+    if (!space)
+        return false;
 
-    plProfile_BeginTiming(Harvest);
     fCullTree.Harvest(space, visList);
-    plProfile_EndTiming(Harvest);
 
     return !visList.empty();
 }
@@ -205,6 +205,15 @@ public:
      */
     bool    HarvestVisible(plSpaceTree* space, std::vector<int16_t>& visList);
 
+    /**
+     * HarvestVisible in two halves. PrepareHarvest updates the space tree
+     * and the cull tree, and must run on the render thread. HarvestPrepared
+     * only reads them, so harvests of different, prepared trees may run on
+     * other threads at the same time.
+     */
+    void    PrepareHarvest(plSpaceTree* space);
+    bool    HarvestPrepared(const plSpaceTree* space, std::vector<int16_t>& visList) const;
+
 
     /**
      * Given a drawable, returns a list of visible span indices. Disabled spans
@@ -48,8 +48,14 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plPipeline.h"
 #include "plProfile.h"
 #include "plTweak.h"
+#include "plViewTransform.h"
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
 
 #include "plCullPoly.h"
 #include "plOccluder.h"
@@ -63,6 +69,11 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 static std::vector<hsRadixSortElem> scratchList;
 
 bool plPageTreeMgr::fDisableVisMgr = false;
+bool plPageTreeMgr::fSoftOcclusion = false;
+uint32_t plPageTreeMgr::fHarvestThreads = 1;
+
+// Fewer nodes than this aren't worth waking the threads for
+static const size_t kMinParallelHarvestNodes = 4;
 
 plProfile_CreateTimer("Object Sort", "Draw", DrawObjSort);
 plProfile_CreateCounter("Objects Sorted", "Draw", DrawObjSorted);
@@ -71,6 +82,12 @@ plProfile_CreateCounter("Occluders Used", "Draw", DrawOccUsed);
 plProfile_CreateTimer("Occluder Build", "Draw", DrawOccBuild);
 plProfile_CreateCounter("Occluder Polys Processed", "Draw", DrawOccPolyProc);
 plProfile_CreateTimer("Occluder Poly Sort", "Draw", DrawOccPolySort);
+plProfile_CreateTimer("Collect For Render", "Draw", DrawCollect);
+plProfile_CreateCounter("Collect For Render Nodes", "Draw", DrawCollectNodes);
+plProfile_CreateTimer("Soft Occluder Raster", "Draw", DrawSoftOccRaster);
+plProfile_CreateCounter("Soft Occluder Tris", "Draw", DrawSoftOccTris);
+plProfile_CreateTimer("Soft Occlusion Test", "Draw", DrawSoftOccTest);
+plProfile_CreateCounter("Soft Occluded Spans", "Draw", DrawSoftOccCulled);
 
 plPageTreeMgr::plPageTreeMgr()
 :   fSpaceTree()
@@ -132,6 +149,131 @@ bool plPageTreeMgr::Harvest(plVolumeIsect* isect, std::vector<plDrawVisList>& le
     return !levList.empty();
 }
 
+// Threads kept around for harvesting scene nodes, so a frame doesn't pay for
+// starting them. The render thread works through the nodes along with them.
+class plHarvestWorkers
+{
+    std::vector<std::thread>    fThreads;
+    std::mutex                  fMutex;
+    std::condition_variable     fStart;
+    std::condition_variable     fDone;
+    std::function<void(size_t)> fJob;
+    size_t                      fNumItems;
+    std::atomic<size_t>         fNextItem;
+    size_t                      fBusy;
+    uint32_t                    fGeneration;
+    bool                        fStop;
+
+    void IRunItems()
+    {
+        for (size_t i = fNextItem++; i < fNumItems; i = fNextItem++)
+            fJob(i);
+    }
+
+    void IWork(uint32_t generation)
+    {
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(fMutex);
+                fStart.wait(lock, [this, generation]() { return fStop || fGeneration != generation; });
+                if (fStop)
+                    break;
+                generation = fGeneration;
+            }
+
+            IRunItems();
+
+            std::lock_guard<std::mutex> lock(fMutex);
+            if (--fBusy == 0)
+                fDone.notify_one();
+        }
+    }
+
+public:
+    plHarvestWorkers() : fNumItems(), fNextItem(), fBusy(), fGeneration(), fStop() { }
+    ~plHarvestWorkers() { SetNumThreads(0); }
+
+    void SetNumThreads(size_t numThreads)
+    {
+        if (fThreads.size() == numThreads)
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(fMutex);
+            fStop = true;
+        }
+        fStart.notify_all();
+        for (std::thread& thread : fThreads)
+            thread.join();
+        fThreads.clear();
+        fStop = false;
+
+        for (size_t i = 0; i < numThreads; i++)
+            fThreads.emplace_back(&plHarvestWorkers::IWork, this, fGeneration);
+    }
+
+    // Calls job once for each item, spread over the threads and this one,
+    // and returns when they're all done
+    void Run(size_t numItems, std::function<void(size_t)> job)
+    {
+        if (fThreads.empty())
+        {
+            for (size_t i = 0; i < numItems; i++)
+                job(i);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(fMutex);
+            fJob = std::move(job);
+            fNumItems = numItems;
+            fNextItem = 0;
+            fBusy = fThreads.size();
+            fGeneration++;
+        }
+        fStart.notify_all();
+
+        IRunItems();
+
+        std::unique_lock<std::mutex> lock(fMutex);
+        fDone.wait(lock, [this]() { return fBusy == 0; });
+        fJob = nullptr;
+    }
+};
+
+static plHarvestWorkers s_harvestWorkers;
+
+void plPageTreeMgr::ICollectParallel(plPipeline* pipe, const std::vector<int16_t>& nodeList, std::vector<plDrawVisList>& levList, plVisMgr* visMgr, uint32_t numThreads)
+{
+    // Getting a node's space tree builds or dirties it on demand, and
+    // preparing it refreshes it and maybe the cull tree, so all that
+    // happens here. After this the workers only read the trees.
+    static std::vector<const plSpaceTree*> nodeTrees;
+    nodeTrees.clear();
+    for (int16_t idx : nodeList)
+    {
+        plSpaceTree* space = fNodes[idx]->GetSpaceTree();
+        pipe->PrepareHarvest(space);
+        nodeTrees.emplace_back(space);
+    }
+
+    static std::vector<std::vector<int16_t>> nodeVisLists;
+    nodeVisLists.resize(nodeList.size());
+
+    s_harvestWorkers.SetNumThreads(numThreads - 1);
+    s_harvestWorkers.Run(nodeList.size(), [pipe](size_t i)
+    {
+        nodeVisLists[i].clear();
+        pipe->HarvestPrepared(nodeTrees[i], nodeVisLists[i]);
+    });
+
+    // PreRender updates pipeline and drawable state as it goes, so it
+    // stays on this thread, in node order like the serial path
+    for (size_t i = 0; i < nodeList.size(); i++)
+        fNodes[nodeList[i]]->PreRenderVisible(pipe, nodeVisLists[i], levList, visMgr);
+}
+
 #include "plProfile.h"
 plProfile_CreateTimer("DrawableTime", "Draw", DrawableTime);
 plProfile_Extern(RenderScene);
@@ -164,12 +306,31 @@ int plPageTreeMgr::Render(plPipeline* pipe)
     IGetOcclusion(pipe, list);
     pipe->HarvestVisible(GetSpaceTree(), list);
 
+    plProfile_BeginTiming(DrawCollect);
+    plProfile_IncCount(DrawCollectNodes, list.size());
     static std::vector<plDrawVisList> levList;
     levList.clear();
-    for (int16_t idx : list)
+
+    uint32_t numThreads = fHarvestThreads;
+    if (numThreads == 0)
+        numThreads = std::max(std::thread::hardware_concurrency(), 1U);
+    numThreads = (uint32_t)std::min<size_t>(numThreads, list.size());
+
+    if (numThreads > 1 && list.size() >= kMinParallelHarvestNodes)
     {
-        fNodes[idx]->CollectForRender(pipe, levList, visMgr);
+        ICollectParallel(pipe, list, levList, visMgr, numThreads);
     }
+    else
+    {
+        for (int16_t idx : list)
+        {
+            fNodes[idx]->CollectForRender(pipe, levList, visMgr);
+        }
+    }
+    plProfile_EndTiming(DrawCollect);
+
+    if (IBuildSoftOcclusion(pipe))
+        ISoftOcclude(levList);
     
     int numDrawn = IRenderVisList(pipe, levList);
 
@@ -640,6 +801,19 @@ bool plPageTreeMgr::IGetCullPolys(plPipeline* pipe)
     {
         plOccluder* occ = (plOccluder*)listTrav->fBody;
         IAddCullPolyList(occ->GetWorldPolyList());
+
+        // The soft buffer only takes solid occluders, since a hole
+        // poly can't be subtracted back out of it
+        if (fSoftOcclusion)
+        {
+            const std::vector<plCullPoly>& polys = occ->GetWorldPolyList();
+            auto isHole = [](const plCullPoly& poly) { return poly.IsHole(); };
+            if (std::none_of(polys.begin(), polys.end(), isHole))
+            {
+                for (const plCullPoly& poly : polys)
+                    fSoftCullPolys.push_back(&poly);
+            }
+        }
         
         listTrav = listTrav->fNext;
     }
@@ -654,6 +828,7 @@ bool plPageTreeMgr::IGetOcclusion(plPipeline* pipe, std::vector<int16_t>& list)
     plProfile_BeginTiming(DrawOccBuild);
 
     fCullPolys.clear();
+    fSoftCullPolys.clear();
     fOccluders.clear();
     for (plSceneNode* node : fNodes)
         node->SubmitOccluders(this);
@@ -678,8 +853,63 @@ bool plPageTreeMgr::IGetOcclusion(plPipeline* pipe, std::vector<int16_t>& list)
     return !fSortedCullPolys.empty();
 }
 
+bool plPageTreeMgr::IBuildSoftOcclusion(plPipeline* pipe)
+{
+    if (!fSoftOcclusion || fSoftCullPolys.empty())
+        return false;
+
+    plProfile_BeginTiming(DrawSoftOccRaster);
+
+    hsPoint3 viewPos = pipe->GetViewPositionWorld();
+
+    fSoftOccluder.Begin(pipe->GetViewTransform().GetWorldToNDC());
+    for (const plCullPoly* poly : fSoftCullPolys)
+    {
+        bool backFace = poly->fNorm.InnerProduct(viewPos) + poly->fDist <= 0;
+        if (backFace && !poly->IsTwoSided())
+            continue;
+
+        fSoftOccluder.AddPolygon(poly->fVerts.data(), poly->fVerts.size());
+    }
+    fSoftOccluder.End();
+
+    plProfile_IncCount(DrawSoftOccTris, fSoftOccluder.GetNumTris());
+    plProfile_EndTiming(DrawSoftOccRaster);
+
+    return !fSoftOccluder.IsEmpty();
+}
+
+void plPageTreeMgr::ISoftOcclude(std::vector<plDrawVisList>& levList)
+{
+    plProfile_BeginTiming(DrawSoftOccTest);
+
+    uint32_t numCulled = 0;
+    for (plDrawVisList& drawVis : levList)
+    {
+        const plSpaceTree* space = drawVis.fDrawable->GetSpaceTree();
+        if (!space)
+            continue;
+
+        auto occluded = [this, space](int16_t span)
+        {
+            return fSoftOccluder.IsOccluded(space->GetNode(span).GetWorldBounds());
+        };
+        auto newEnd = std::remove_if(drawVis.fVisList.begin(), drawVis.fVisList.end(), occluded);
+        numCulled += uint32_t(drawVis.fVisList.end() - newEnd);
+        drawVis.fVisList.erase(newEnd, drawVis.fVisList.end());
+    }
+
+    // Drop any drawables left with nothing to draw
+    auto noSpans = [](const plDrawVisList& drawVis) { return drawVis.fVisList.empty(); };
+    levList.erase(std::remove_if(levList.begin(), levList.end(), noSpans), levList.end());
+
+    plProfile_IncCount(DrawSoftOccCulled, numCulled);
+    plProfile_EndTiming(DrawSoftOccTest);
+}
+
 void plPageTreeMgr::IResetOcclusion(plPipeline* pipe)
 {
     fCullPolys.clear();
     fSortedCullPolys.clear();
+    fSoftCullPolys.clear();
 }
@@ -46,6 +46,8 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include <cstdint>
 #include <vector>
 
+#include "plSoftOcclusion.h"
+
 class plSceneNode;
 class plSpaceTree;
 class plPipeline;
@@ -81,10 +83,15 @@ protected:
     plVisMgr*                   fVisMgr;
 
     static bool                 fDisableVisMgr;
+    static bool                 fSoftOcclusion;
+    static uint32_t             fHarvestThreads;
 
     std::vector<const plOccluder*> fOccluders;
     std::vector<const plCullPoly*> fCullPolys;
     std::vector<const plCullPoly*> fSortedCullPolys;
+    std::vector<const plCullPoly*> fSoftCullPolys; // From occluders without holes
+
+    plSoftOcclusion             fSoftOccluder;
 
     void                        ITrashSpaceTree();
     bool                        IBuildSpaceTree();
@@ -94,6 +101,9 @@ protected:
     bool                        IGetCullPolys(plPipeline* pipe);
     void                        IResetOcclusion(plPipeline* pipe);
     void                        IAddCullPolyList(const std::vector<plCullPoly>& polyList);
+    void                        ICollectParallel(plPipeline* pipe, const std::vector<int16_t>& nodeList, std::vector<plDrawVisList>& levList, plVisMgr* visMgr, uint32_t numThreads);
+    bool                        IBuildSoftOcclusion(plPipeline* pipe);
+    void                        ISoftOcclude(std::vector<plDrawVisList>& levList);
 
     bool                        ISortByLevel(plPipeline* pipe, std::vector<plDrawVisList>& drawList, std::vector<plDrawVisList>& sortedDrawList);
     size_t                      IPrepForRenderSortingSpans(plPipeline* pipe, std::vector<plDrawVisList>& drawVis, size_t& iDrawStart);
@@ -124,6 +134,17 @@ public:
 
     static void     EnableVisMgr(bool on) { fDisableVisMgr = !on; }
     static bool     VisMgrEnabled() { return !fDisableVisMgr; }
+
+    // Rasterizes the nearest occluders into a small CPU depth buffer and
+    // drops the spans hidden behind them before they're sorted and drawn.
+    // Off by default.
+    static void     EnableSoftOcclusion(bool on) { fSoftOcclusion = on; }
+    static bool     SoftOcclusionEnabled() { return fSoftOcclusion; }
+
+    // Threads Render splits harvesting the visible scene nodes across.
+    // 0 means one per core, 1 (the default) keeps it all on the calling thread.
+    static void     SetHarvestThreads(uint32_t numThreads) { fHarvestThreads = numThreads; }
+    static uint32_t GetHarvestThreads() { return fHarvestThreads; }
 };
 
 #endif // plPageTreeMgr_inc
@@ -150,6 +150,11 @@ void plSceneNode::CollectForRender(plPipeline* pipe, std::vector<plDrawVisList>&
     static std::vector<int16_t> visList;
     visList.clear();
     pipe->HarvestVisible(GetSpaceTree(), visList);
+    PreRenderVisible(pipe, visList, levList, visMgr);
+}
+
+void plSceneNode::PreRenderVisible(plPipeline* pipe, const std::vector<int16_t>& visList, std::vector<plDrawVisList>& levList, plVisMgr* visMgr)
+{
     static std::vector<int16_t> visSpans;
     visSpans.clear();
 
@@ -207,7 +212,7 @@ void plSceneNode::IDirtySpaceTree()
         if (drawable && drawable->GetSpaceTree()->IsDirty() )
         {
             drawable->GetSpaceTree()->Refresh();
-            fSpaceTree->MoveLeaf(i, drawable->GetSpaceTree()->GetWorldBounds());
+            fSpaceTree->RelocateLeaf(i, drawable->GetSpaceTree()->GetWorldBounds());
         }
     }
 }
@@ -227,7 +232,11 @@ void plSceneNode::ISetDrawable(plDrawable* d)
 
     if (std::find(fDrawPool.begin(), fDrawPool.end(), d) == fDrawPool.end()) {
         fDrawPool.push_back(d);
-        ITrashSpaceTree();
+
+        // Slot it into the tree we have, rather than building a new one next
+        // time anyone asks. Removals still rebuild, every later leaf shifts.
+        if (fSpaceTree && fSpaceTree->AddLeaf(d->GetSpaceTree()->GetWorldBounds()) < 0)
+            ITrashSpaceTree();
     }
 }
 
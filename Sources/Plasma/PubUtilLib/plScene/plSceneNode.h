@@ -128,6 +128,8 @@ public:
 
     virtual void Harvest(plVolumeIsect* isect, std::vector<plDrawVisList>& levList);
     virtual void CollectForRender(plPipeline* pipe, std::vector<plDrawVisList>& levList, plVisMgr* visMgr);
+    // The second half of CollectForRender, for drawables already harvested into visList
+    void PreRenderVisible(plPipeline* pipe, const std::vector<int16_t>& visList, std::vector<plDrawVisList>& levList, plVisMgr* visMgr);
 
     virtual void SubmitOccluders(plPageTreeMgr* pageMgr) const;
 
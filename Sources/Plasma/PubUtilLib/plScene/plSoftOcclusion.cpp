@@ -0,0 +1,329 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "plSoftOcclusion.h"
+
+#include "hsBounds.h"
+#include "hsGeometry3.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// Stretches the conservative edge and depth offsets a little, so float
+// rounding in the setup can't let a partly covered pixel through
+static const double kConservativeFudge = 1.001;
+
+plSoftOcclusion::plSoftOcclusion()
+:   fWidth(), fHeight(), fTilesX(), fTilesY(), fNumTris(), fEmpty(true)
+{
+    SetResolution(kDefaultWidth, kDefaultHeight);
+}
+
+void plSoftOcclusion::SetResolution(uint32_t width, uint32_t height)
+{
+    fWidth = std::max(width, 1U);
+    fHeight = std::max(height, 1U);
+    fTilesX = (fWidth + kTileSize - 1) / kTileSize;
+    fTilesY = (fHeight + kTileSize - 1) / kTileSize;
+
+    fDepth.assign(fWidth * fHeight, FLT_MAX);
+    fTileMax.assign(fTilesX * fTilesY, FLT_MAX);
+    fNumTris = 0;
+    fEmpty = true;
+}
+
+void plSoftOcclusion::Begin(const hsMatrix44& worldToNDC)
+{
+    fWorldToNDC = worldToNDC;
+    if (!fEmpty)
+        std::fill(fDepth.begin(), fDepth.end(), FLT_MAX);
+    fNumTris = 0;
+    fEmpty = true;
+}
+
+plSoftOcclusion::ClipVert plSoftOcclusion::IToClip(const hsPoint3& p) const
+{
+    const float (&m)[4][4] = fWorldToNDC.fMap;
+    ClipVert v;
+    v.fX = m[0][0] * p.fX + m[0][1] * p.fY + m[0][2] * p.fZ + m[0][3];
+    v.fY = m[1][0] * p.fX + m[1][1] * p.fY + m[1][2] * p.fZ + m[1][3];
+    v.fZ = m[2][0] * p.fX + m[2][1] * p.fY + m[2][2] * p.fZ + m[2][3];
+    v.fW = m[3][0] * p.fX + m[3][1] * p.fY + m[3][2] * p.fZ + m[3][3];
+    return v;
+}
+
+void plSoftOcclusion::AddPolygon(const hsPoint3* verts, size_t numVerts)
+{
+    if (numVerts < 3)
+        return;
+
+    std::vector<ClipVert>& in = fClipScratch[0];
+    std::vector<ClipVert>& out = fClipScratch[1];
+    in.clear();
+    out.clear();
+    for (size_t i = 0; i < numVerts; i++)
+        in.emplace_back(IToClip(verts[i]));
+
+    // Only the near plane needs clipping. The rasterizer clamps to the
+    // viewport, and occluders past the far plane can't hide anything drawn.
+    for (size_t i = 0; i < in.size(); i++)
+    {
+        const ClipVert& a = in[i];
+        const ClipVert& b = in[(i + 1) % in.size()];
+        bool aIn = a.fZ >= 0.f && a.fW > 0.f;
+        bool bIn = b.fZ >= 0.f && b.fW > 0.f;
+        if (aIn)
+            out.emplace_back(a);
+        if (aIn != bIn)
+        {
+            float t = a.fZ / (a.fZ - b.fZ);
+            ClipVert c;
+            c.fX = a.fX + (b.fX - a.fX) * t;
+            c.fY = a.fY + (b.fY - a.fY) * t;
+            c.fZ = 0.f;
+            c.fW = a.fW + (b.fW - a.fW) * t;
+            if (c.fW > 0.f)
+                out.emplace_back(c);
+        }
+    }
+
+    for (size_t i = 2; i < out.size(); i++)
+        IRasterTri(out[0], out[i - 1], out[i]);
+}
+
+void plSoftOcclusion::IRasterTri(const ClipVert& c0, const ClipVert& c1, const ClipVert& c2)
+{
+    // To pixels, y down. The setup is done in double, since clipped
+    // verts close to the eye can land far outside the viewport.
+    double x[3], y[3], z[3];
+    const ClipVert* clip[3] = { &c0, &c1, &c2 };
+    for (int i = 0; i < 3; i++)
+    {
+        double invW = 1.0 / clip[i]->fW;
+        x[i] = (clip[i]->fX * invW + 1.0) * 0.5 * fWidth;
+        y[i] = (1.0 - clip[i]->fY * invW) * 0.5 * fHeight;
+        z[i] = clip[i]->fZ * invW;
+    }
+
+    double area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (std::fabs(area) < 1.e-8)
+        return;
+    if (area < 0.)
+    {
+        std::swap(x[1], x[2]);
+        std::swap(y[1], y[2]);
+        std::swap(z[1], z[2]);
+        area = -area;
+    }
+
+    int x0 = std::max(0, int(std::floor(std::min({ x[0], x[1], x[2] }))));
+    int y0 = std::max(0, int(std::floor(std::min({ y[0], y[1], y[2] }))));
+    int x1 = std::min(int(fWidth), int(std::ceil(std::max({ x[0], x[1], x[2] }))));
+    int y1 = std::min(int(fHeight), int(std::ceil(std::max({ y[0], y[1], y[2] }))));
+    if (x0 >= x1 || y0 >= y1)
+        return;
+
+    // Edge j runs from vert j to vert j+1, and is >= 0 inside. Each is
+    // pulled in by half a pixel's worth, so only pixels the triangle
+    // covers completely pass.
+    double edgeA[3], edgeB[3], edgeC[3];
+    for (int j = 0; j < 3; j++)
+    {
+        int k = (j + 1) % 3;
+        edgeA[j] = y[j] - y[k];
+        edgeB[j] = x[k] - x[j];
+        edgeC[j] = -(edgeA[j] * x[j] + edgeB[j] * y[j])
+                 - 0.5 * (std::fabs(edgeA[j]) + std::fabs(edgeB[j])) * kConservativeFudge;
+    }
+
+    // Depth plane z = zA * x + zB * y + zC, pushed back to the farthest
+    // value it reaches inside each pixel
+    double zA = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+    double zB = ((x[1] - x[0]) * (z[2] - z[0]) - (x[2] - x[0]) * (z[1] - z[0])) / area;
+    double zC = z[0] - zA * x[0] - zB * y[0]
+              + 0.5 * (std::fabs(zA) + std::fabs(zB)) * kConservativeFudge;
+
+    RowSetup row;
+    row.fDepthStep = float(zA);
+    for (int j = 0; j < 3; j++)
+        row.fEdgeStep[j] = float(edgeA[j]);
+
+    double px = x0 + 0.5;
+    for (int iy = y0; iy < y1; iy++)
+    {
+        double py = iy + 0.5;
+        for (int j = 0; j < 3; j++)
+            row.fEdge[j] = float(edgeA[j] * px + edgeB[j] * py + edgeC[j]);
+        row.fDepth = float(zA * px + zB * py + zC);
+
+        raster_row.call(&fDepth[iy * fWidth + x0], x1 - x0, row);
+    }
+
+    fNumTris++;
+    fEmpty = false;
+}
+
+void plSoftOcclusion::End()
+{
+    if (fEmpty)
+    {
+        std::fill(fTileMax.begin(), fTileMax.end(), FLT_MAX);
+        return;
+    }
+
+    for (uint32_t ty = 0; ty < fTilesY; ty++)
+    {
+        for (uint32_t tx = 0; tx < fTilesX; tx++)
+        {
+            uint32_t xEnd = std::min<uint32_t>((tx + 1) * kTileSize, fWidth);
+            uint32_t yEnd = std::min<uint32_t>((ty + 1) * kTileSize, fHeight);
+            float maxDepth = 0.f;
+            for (uint32_t py = ty * kTileSize; py < yEnd; py++)
+            {
+                const float* depth = &fDepth[py * fWidth];
+                for (uint32_t px = tx * kTileSize; px < xEnd; px++)
+                    maxDepth = std::max(maxDepth, depth[px]);
+            }
+            fTileMax[ty * fTilesX + tx] = maxDepth;
+        }
+    }
+}
+
+bool plSoftOcclusion::IsOccluded(const hsBounds3Ext& worldBnd) const
+{
+    if (fEmpty || worldBnd.GetType() != kBoundsNormal)
+        return false;
+
+    hsPoint3 corners[8];
+    worldBnd.GetCorners(corners);
+
+    float minX = FLT_MAX, minY = FLT_MAX, minZ = FLT_MAX;
+    float maxX = -FLT_MAX, maxY = -FLT_MAX;
+    for (const hsPoint3& corner : corners)
+    {
+        ClipVert v = IToClip(corner);
+        if (v.fZ < 0.f || v.fW <= 0.f)
+            return false;
+
+        float invW = 1.f / v.fW;
+        float x = (v.fX * invW + 1.f) * 0.5f * fWidth;
+        float y = (1.f - v.fY * invW) * 0.5f * fHeight;
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        minZ = std::min(minZ, v.fZ * invW);
+    }
+
+    // Every pixel the box touches, widened a pixel for rounding
+    int x0 = std::max(0, int(std::floor(minX)) - 1);
+    int y0 = std::max(0, int(std::floor(minY)) - 1);
+    int x1 = std::min(int(fWidth), int(std::ceil(maxX)) + 1);
+    int y1 = std::min(int(fHeight), int(std::ceil(maxY)) + 1);
+    if (x0 >= x1 || y0 >= y1)
+        return false;
+
+    // Quick accept if every tile touched is entirely in front
+    bool tilesHide = true;
+    for (int ty = y0 / kTileSize; tilesHide && ty <= (y1 - 1) / kTileSize; ty++)
+    {
+        for (int tx = x0 / kTileSize; tx <= (x1 - 1) / kTileSize; tx++)
+        {
+            if (fTileMax[ty * fTilesX + tx] >= minZ)
+            {
+                tilesHide = false;
+                break;
+            }
+        }
+    }
+    if (tilesHide)
+        return true;
+
+    for (int py = y0; py < y1; py++)
+    {
+        if (test_row.call(&fDepth[py * fWidth + x0], x1 - x0, minZ))
+            return false;
+    }
+    return true;
+}
+
+//// Row Kernels //////////////////////////////////////////////////////////////
+
+void plSoftOcclusion::raster_row_fpu(float* depth, uint32_t count, const RowSetup& row)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        float fi = float(i);
+        if (row.fEdge[0] + fi * row.fEdgeStep[0] >= 0.f &&
+            row.fEdge[1] + fi * row.fEdgeStep[1] >= 0.f &&
+            row.fEdge[2] + fi * row.fEdgeStep[2] >= 0.f)
+        {
+            float z = row.fDepth + fi * row.fDepthStep;
+            depth[i] = z < depth[i] ? z : depth[i];
+        }
+    }
+}
+
+bool plSoftOcclusion::test_row_fpu(const float* depths, uint32_t count, float depth)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (depths[i] >= depth)
+            return true;
+    }
+    return false;
+}
+
+//// Dispatchers //////////////////////////////////////////////////////////////
+
+hsCpuFunctionDispatcher<plSoftOcclusion::raster_row_ptr> plSoftOcclusion::raster_row {
+    &plSoftOcclusion::raster_row_fpu,
+    nullptr,            // SSE1
+    &plSoftOcclusion::raster_row_sse2
+};
+
+hsCpuFunctionDispatcher<plSoftOcclusion::test_row_ptr> plSoftOcclusion::test_row {
+    &plSoftOcclusion::test_row_fpu,
+    nullptr,            // SSE1
+    &plSoftOcclusion::test_row_sse2
+};
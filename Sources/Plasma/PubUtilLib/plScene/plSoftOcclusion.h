@@ -0,0 +1,160 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+//  plSoftOcclusion - Low resolution software depth buffer for occlusion     //
+//                                                                           //
+//  Occluder polygons are rasterized on the CPU into a small depth buffer    //
+//  (256x128 by default, covering the whole viewport), and bounding boxes    //
+//  are then tested against it. Both sides are conservative: a pixel only    //
+//  counts as covered if the polygon covers all of it, at the farthest      //
+//  depth the polygon reaches inside the pixel, and a box tests against     //
+//  its nearest projected point over every pixel it touches. So a box is    //
+//  only reported hidden if it really is, however coarse the buffer.        //
+//                                                                           //
+//  The per-row work is in kernels picked through hsCpuFunctionDispatcher.   //
+//  The SSE2 versions do the same float operations as the plain ones, so     //
+//  both fill the buffer identically.                                        //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef plSoftOcclusion_inc
+#define plSoftOcclusion_inc
+
+#include "HeadSpin.h"
+#include "hsCpuID.h"
+#include "hsMatrix44.h"
+
+#include <vector>
+
+struct hsPoint3;
+class hsBounds3Ext;
+
+class plSoftOcclusion
+{
+public:
+    enum
+    {
+        kDefaultWidth   = 256,
+        kDefaultHeight  = 128,
+        kTileSize       = 8
+    };
+
+    // Coverage and depth for one row of a triangle. Values are for the first
+    // pixel's centre, with the edges already pulled in half a pixel; each
+    // pixel to the right adds the step.
+    struct RowSetup
+    {
+        float   fEdge[3];
+        float   fEdgeStep[3];
+        float   fDepth;
+        float   fDepthStep;
+    };
+
+    // depth[i] = min(depth[i], fDepth + i * fDepthStep) for each of the count
+    // pixels where all three fEdge[j] + i * fEdgeStep[j] are >= 0
+    typedef void(*raster_row_ptr)(float* depth, uint32_t count, const RowSetup& row);
+    static hsCpuFunctionDispatcher<raster_row_ptr> raster_row;
+
+    // True if any of the count depths is >= depth
+    typedef bool(*test_row_ptr)(const float* depths, uint32_t count, float depth);
+    static hsCpuFunctionDispatcher<test_row_ptr> test_row;
+
+    static void raster_row_fpu(float* depth, uint32_t count, const RowSetup& row);
+    static void raster_row_sse2(float* depth, uint32_t count, const RowSetup& row);
+
+    static bool test_row_fpu(const float* depths, uint32_t count, float depth);
+    static bool test_row_sse2(const float* depths, uint32_t count, float depth);
+
+protected:
+    struct ClipVert
+    {
+        float   fX, fY, fZ, fW;
+    };
+
+    uint32_t                fWidth;
+    uint32_t                fHeight;
+    uint32_t                fTilesX;
+    uint32_t                fTilesY;
+
+    hsMatrix44              fWorldToNDC;
+
+    std::vector<float>      fDepth;     // Nearest occluder depth (NDC z) per pixel
+    std::vector<float>      fTileMax;   // Farthest fDepth in each tile
+    std::vector<ClipVert>   fClipScratch[2];
+
+    uint32_t                fNumTris;
+    bool                    fEmpty;
+
+    ClipVert    IToClip(const hsPoint3& p) const;
+    void        IRasterTri(const ClipVert& v0, const ClipVert& v1, const ClipVert& v2);
+
+public:
+    plSoftOcclusion();
+
+    void        SetResolution(uint32_t width, uint32_t height);
+    uint32_t    GetWidth() const { return fWidth; }
+    uint32_t    GetHeight() const { return fHeight; }
+
+    // Clears the buffer for a new view. worldToNDC is the view transform's
+    // GetWorldToNDC().
+    void        Begin(const hsMatrix44& worldToNDC);
+
+    // Rasterizes a convex, planar polygon in world space. Either winding is
+    // accepted, so callers should skip polygons facing away themselves if
+    // they only block from one side.
+    void        AddPolygon(const hsPoint3* verts, size_t numVerts);
+
+    // Call once all the occluders are in and before testing
+    void        End();
+
+    bool        IsEmpty() const { return fEmpty; }
+    uint32_t    GetNumTris() const { return fNumTris; }
+
+    // True if the box is entirely behind occluders. Boxes crossing the near
+    // plane are never occluded.
+    bool        IsOccluded(const hsBounds3Ext& worldBnd) const;
+
+    const float* GetDepthBuffer() const { return fDepth.data(); }
+};
+
+#endif // plSoftOcclusion_inc
@@ -0,0 +1,116 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "plSoftOcclusion.h"
+
+#ifdef HAVE_SSE2
+#   include <emmintrin.h>
+#endif // HAVE_SSE2
+
+//// Raster Row ///////////////////////////////////////////////////////////////
+//  Four pixels at a time, with the same adds and multiplies as the plain
+//  version (_mm_min_ps(z, d) is z < d ? z : d), so the buffers match.
+
+void plSoftOcclusion::raster_row_sse2(float* depth, uint32_t count, const RowSetup& row)
+{
+#ifdef HAVE_SSE2
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 four = _mm_set1_ps(4.f);
+    const __m128 e0 = _mm_set1_ps(row.fEdge[0]), s0 = _mm_set1_ps(row.fEdgeStep[0]);
+    const __m128 e1 = _mm_set1_ps(row.fEdge[1]), s1 = _mm_set1_ps(row.fEdgeStep[1]);
+    const __m128 e2 = _mm_set1_ps(row.fEdge[2]), s2 = _mm_set1_ps(row.fEdgeStep[2]);
+    const __m128 z0 = _mm_set1_ps(row.fDepth), zs = _mm_set1_ps(row.fDepthStep);
+
+    __m128 fi = _mm_set_ps(3.f, 2.f, 1.f, 0.f);
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4, fi = _mm_add_ps(fi, four))
+    {
+        __m128 inside = _mm_cmpge_ps(_mm_add_ps(e0, _mm_mul_ps(fi, s0)), zero);
+        inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(e1, _mm_mul_ps(fi, s1)), zero));
+        inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(e2, _mm_mul_ps(fi, s2)), zero));
+        if (!_mm_movemask_ps(inside))
+            continue;
+
+        __m128 old = _mm_loadu_ps(depth + i);
+        __m128 z = _mm_min_ps(_mm_add_ps(z0, _mm_mul_ps(fi, zs)), old);
+        _mm_storeu_ps(depth + i, _mm_or_ps(_mm_and_ps(inside, z), _mm_andnot_ps(inside, old)));
+    }
+
+    for (; i < count; i++)
+    {
+        float fi = float(i);
+        if (row.fEdge[0] + fi * row.fEdgeStep[0] >= 0.f &&
+            row.fEdge[1] + fi * row.fEdgeStep[1] >= 0.f &&
+            row.fEdge[2] + fi * row.fEdgeStep[2] >= 0.f)
+        {
+            float z = row.fDepth + fi * row.fDepthStep;
+            depth[i] = z < depth[i] ? z : depth[i];
+        }
+    }
+#else
+    raster_row_fpu(depth, count, row);
+#endif
+}
+
+//// Test Row /////////////////////////////////////////////////////////////////
+
+bool plSoftOcclusion::test_row_sse2(const float* depths, uint32_t count, float depth)
+{
+#ifdef HAVE_SSE2
+    const __m128 ref = _mm_set1_ps(depth);
+
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(depths + i), ref)))
+            return true;
+    }
+    for (; i < count; i++)
+    {
+        if (depths[i] >= depth)
+            return true;
+    }
+    return false;
+#else
+    return test_row_fpu(depths, count, depth);
+#endif
+}
@@ -56,10 +56,14 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plDniCoordinateInfo.h"
 
 #include <algorithm>
+#include <map>
 #include <memory>
+#include <set>
 #include <sstream>
 #include <string_theory/string>
+#include <tuple>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "hsGeometry3.h"
 #include "hsSTLStream.h"
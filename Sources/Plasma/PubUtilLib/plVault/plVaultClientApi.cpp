@@ -90,20 +90,200 @@ struct RelVaultNodeLink : THashKeyVal<unsigned> {
 };
 
 
+typedef HASHTABLEDECL(
+    RelVaultNodeLink,
+    THashKeyVal<unsigned>,
+    link
+) RelVaultNodeLinkTable;
+
+// Secondary indices over the links of a RelVaultNodeLinkTable, so template
+// lookups that name a node type only look at nodes that can match. Links are
+// filed by node type, by node type and Int32_1 (the folder type of folders
+// and folder-like lists), and by node type and String64_1 (chronicle entry
+// and SDL names). Each bucket keeps its links in the order they were added
+// to the table, which is the order the table iterates in, so a lookup finds
+// the same node a full scan would.
+//
+// Whoever adds a link to the table or removes one calls Add() or Remove().
+// Field changes on a RelVaultNode re-file it through Update(); see
+// RelVaultNode::IFieldsChanged.
+struct VaultNodeIndex {
+    typedef std::vector<RelVaultNodeLink *> Bucket;
+
+    // What a link is currently filed under
+    struct Key {
+        uint64_t    order;
+        unsigned    nodeType;
+        int32_t     int32_1;
+        ST::string  string64_1;
+    };
+
+    std::unordered_map<RelVaultNodeLink *, Key>             keys;
+    std::unordered_map<unsigned, Bucket>                    byType;
+    std::map<std::tuple<unsigned, int32_t>, Bucket>         byInt32_1;
+    std::map<std::tuple<unsigned, ST::string>, Bucket>      byString64_1;
+    uint64_t                                                nextOrder;
+
+    VaultNodeIndex () : nextOrder() { }
+
+    void Add (RelVaultNodeLink * link);
+    void Remove (RelVaultNodeLink * link);
+    void Update (RelVaultNodeLink * link);
+    void Clear ();
+
+    // Returns the links that can match the template, in table order, or
+    // nullptr if the template doesn't name a node type and the whole table
+    // has to be searched
+    const Bucket * Find (hsWeakRef<NetVaultNode> templateNode) const;
+
+private:
+    void IFile (RelVaultNodeLink * link, const Key & key);
+    void IUnfile (RelVaultNodeLink * link, const Key & key);
+};
+
+//============================================================================
+// Buckets are sorted by the order their links were added to the table
+template <typename Buckets, typename K>
+static void FileInBucket (
+    Buckets &                                                           buckets,
+    const K &                                                           bucketKey,
+    RelVaultNodeLink *                                                  link,
+    const std::unordered_map<RelVaultNodeLink *, VaultNodeIndex::Key> & keys
+) {
+    VaultNodeIndex::Bucket & bucket = buckets[bucketKey];
+    uint64_t order = keys.at(link).order;
+
+    // Almost always the newest link, so check the end first
+    if (bucket.empty() || keys.at(bucket.back()).order < order) {
+        bucket.push_back(link);
+        return;
+    }
+    auto it = std::lower_bound(bucket.begin(), bucket.end(), order,
+        [&keys](RelVaultNodeLink * other, uint64_t value) {
+            return keys.at(other).order < value;
+        });
+    bucket.insert(it, link);
+}
+
+//============================================================================
+template <typename Buckets, typename K>
+static void UnfileFromBucket (
+    Buckets &                                                           buckets,
+    const K &                                                           bucketKey,
+    RelVaultNodeLink *                                                  link,
+    const std::unordered_map<RelVaultNodeLink *, VaultNodeIndex::Key> & keys
+) {
+    auto found = buckets.find(bucketKey);
+    if (found == buckets.end())
+        return;
+
+    VaultNodeIndex::Bucket & bucket = found->second;
+    auto it = std::lower_bound(bucket.begin(), bucket.end(), keys.at(link).order,
+        [&keys](RelVaultNodeLink * other, uint64_t value) {
+            return keys.at(other).order < value;
+        });
+    if (it != bucket.end() && *it == link)
+        bucket.erase(it);
+    if (bucket.empty())
+        buckets.erase(found);
+}
+
+//============================================================================
+void VaultNodeIndex::IFile (RelVaultNodeLink * link, const Key & key) {
+    FileInBucket(byType, key.nodeType, link, keys);
+    FileInBucket(byInt32_1, std::make_tuple(key.nodeType, key.int32_1), link, keys);
+    FileInBucket(byString64_1, std::make_tuple(key.nodeType, key.string64_1), link, keys);
+}
+
+//============================================================================
+void VaultNodeIndex::IUnfile (RelVaultNodeLink * link, const Key & key) {
+    UnfileFromBucket(byType, key.nodeType, link, keys);
+    UnfileFromBucket(byInt32_1, std::make_tuple(key.nodeType, key.int32_1), link, keys);
+    UnfileFromBucket(byString64_1, std::make_tuple(key.nodeType, key.string64_1), link, keys);
+}
+
+//============================================================================
+void VaultNodeIndex::Add (RelVaultNodeLink * link) {
+    // Unused fields are filed under whatever value they hold; that only adds
+    // candidates, which Matches() then turns away.
+    Key & key = keys[link];
+    key.order       = nextOrder++;
+    key.nodeType    = link->node->GetNodeType();
+    key.int32_1     = link->node->GetInt32_1();
+    key.string64_1  = link->node->GetString64_1();
+    IFile(link, key);
+}
+
+//============================================================================
+void VaultNodeIndex::Remove (RelVaultNodeLink * link) {
+    auto it = keys.find(link);
+    if (it == keys.end())
+        return;
+    IUnfile(link, it->second);
+    keys.erase(it);
+}
+
+//============================================================================
+void VaultNodeIndex::Update (RelVaultNodeLink * link) {
+    auto it = keys.find(link);
+    if (it == keys.end())
+        return;
+
+    Key & key = it->second;
+    if (key.nodeType == link->node->GetNodeType() &&
+        key.int32_1 == link->node->GetInt32_1() &&
+        key.string64_1 == link->node->GetString64_1())
+        return;
+
+    IUnfile(link, key);
+    key.nodeType    = link->node->GetNodeType();
+    key.int32_1     = link->node->GetInt32_1();
+    key.string64_1  = link->node->GetString64_1();
+    IFile(link, key);
+}
+
+//============================================================================
+void VaultNodeIndex::Clear () {
+    keys.clear();
+    byType.clear();
+    byInt32_1.clear();
+    byString64_1.clear();
+}
+
+//============================================================================
+const VaultNodeIndex::Bucket * VaultNodeIndex::Find (hsWeakRef<NetVaultNode> templateNode) const {
+    static const Bucket kNoLinks;
+
+    if (!templateNode->HasNodeType())
+        return nullptr;
+
+    unsigned nodeType = templateNode->GetNodeType();
+    auto typed = byType.find(nodeType);
+    const Bucket * best = (typed != byType.end()) ? &typed->second : &kNoLinks;
+
+    // Take whichever of the narrower buckets the template allows is smallest
+    if (templateNode->HasInt32_1()) {
+        auto it = byInt32_1.find(std::make_tuple(nodeType, templateNode->GetInt32_1()));
+        const Bucket * bucket = (it != byInt32_1.end()) ? &it->second : &kNoLinks;
+        if (bucket->size() < best->size())
+            best = bucket;
+    }
+    if (templateNode->HasString64_1()) {
+        auto it = byString64_1.find(std::make_tuple(nodeType, templateNode->GetString64_1()));
+        const Bucket * bucket = (it != byString64_1.end()) ? &it->second : &kNoLinks;
+        if (bucket->size() < best->size())
+            best = bucket;
+    }
+    return best;
+}
+
+
 struct IRelVaultNode {
     hsWeakRef<RelVaultNode> node;
     
-    HASHTABLEDECL(
-        RelVaultNodeLink,
-        THashKeyVal<unsigned>,
-        link
-    ) parents;
-
-    HASHTABLEDECL(
-        RelVaultNodeLink,
-        THashKeyVal<unsigned>,
-        link
-    ) children;
+    RelVaultNodeLinkTable parents;
+    RelVaultNodeLinkTable children;
+    VaultNodeIndex        childrenIndex;
 
     IRelVaultNode(hsWeakRef<RelVaultNode> node);
     ~IRelVaultNode ();
@@ -260,11 +440,8 @@ struct AddChildNodeFetchTrans {
 
 static bool s_running;
 
-static HASHTABLEDECL(
-    RelVaultNodeLink,
-    THashKeyVal<unsigned>,
-    link
-) s_nodes;
+static RelVaultNodeLinkTable s_nodes;
+static VaultNodeIndex        s_nodesIndex;
 
 static LISTDECL(
     IVaultCallback,
@@ -281,6 +458,17 @@ static std::unordered_map<ST::string, ST::string, ST::hash> s_ageDeviceInboxes;
 
 static bool s_processPlayerInbox = false;
 
+static bool s_nodeCacheEnabled = false;
+static std::set<unsigned> s_nodeCacheRoots;  // vaults to write back in VaultDestroy
+static plFileName s_nodeCacheDir;            // VaultCache in the user data folder if not set
+
+static const VaultDownloadNet s_authDownloadNet = {
+    NetCliAuthVaultFetchNodeRefs,
+    NetCliAuthVaultNodeFetch,
+    NetCliAuthVaultNodeFind,
+};
+static const VaultDownloadNet * s_downloadNet = &s_authDownloadNet;
+
 /*****************************************************************************
 *
 *   Local functions
@@ -301,6 +489,11 @@ static void VaultNodeFound (
     unsigned            nodeIdCount,
     const unsigned      nodeIds[]
 );
+static void ChangedVaultNodeFetched (
+    ENetError           result,
+    void *              param,
+    NetVaultNode *      node
+);
 
 //============================================================================
 static void VaultNodeAddedDownloadCallback(ENetError result, void * param) {
@@ -348,6 +541,7 @@ static void BuildNodeTree (
             parentLink = new RelVaultNodeLink(false, 0, refs[i].parentId);
             parentLink->node->SetNodeId_NoDirty(refs[i].parentId);
             s_nodes.Add(parentLink);
+            s_nodesIndex.Add(parentLink);
         }
         else {
             existingNodeIds->emplace_back(refs[i].parentId);
@@ -358,6 +552,7 @@ static void BuildNodeTree (
             childLink = new RelVaultNodeLink(refs[i].seen, refs[i].ownerId, refs[i].childId);
             childLink->node->SetNodeId_NoDirty(refs[i].childId);
             s_nodes.Add(childLink);
+            s_nodesIndex.Add(childLink);
         }
         else {
             existingNodeIds->emplace_back(refs[i].childId);
@@ -382,6 +577,7 @@ static void BuildNodeTree (
             // Add child to parent's children table
             childLink = new RelVaultNodeLink(refs[i].seen, refs[i].ownerId, childNode->GetNodeId(), childNode);
             parentNode->state->children.Add(childLink);
+            parentNode->state->childrenIndex.Add(childLink);
 
             if (notifyNow || childNode->GetNodeType() != 0) {
                 // We made a new link, so make the callbacks
@@ -431,7 +627,7 @@ static void FetchRefOwners (
                 access.SetPlayerId(refs[i].ownerId);
                 if (VaultGetNode(&templateNode))
                     continue;
-                NetCliAuthVaultNodeFind(
+                s_downloadNet->NodeFind(
                     &templateNode,
                     VaultNodeFound,
                     nullptr
@@ -441,14 +637,217 @@ static void FetchRefOwners (
     }
 }
 
+//============================================================================
+// On-disk node cache
+//
+// A downloaded vault is written to VaultCache/<vaultId>.cache in the user
+// data folder as the refs of its tree plus a blob of every node in it. On the
+// next download of that vault, a cached node whose refs are unchanged goes
+// straight into the tree, and the download doesn't wait on it. Afterwards,
+// each one is checked in the background with a find on its id and modify
+// time, and only the ones the server no longer has at that modify time are
+// fetched again, the same way as a node changed by someone else. Every other
+// node is fetched as usual. Modify times are in seconds, so a change made in
+// the same second the cached copy was taken is missed until the node changes
+// again.
+//============================================================================
+static const uint32_t kNodeCacheMagic   = 0x43564C50; // 'PLVC'
+static const uint32_t kNodeCacheVersion = 1;
+
+struct VaultNodeCache {
+    std::vector<NetVaultNodeRef>                        refs;
+    std::unordered_map<unsigned, hsRef<NetVaultNode>>   nodes;
+};
+
+//============================================================================
+static plFileName GetNodeCachePath (unsigned vaultId) {
+    plFileName cacheDir = s_nodeCacheDir.IsValid() ? s_nodeCacheDir
+                        : plFileName::Join(plFileSystem::GetUserDataPath(), "VaultCache");
+    return plFileName::Join(cacheDir, ST::format("{}.cache", vaultId));
+}
+
+//============================================================================
+static bool LoadNodeCache (unsigned vaultId, VaultNodeCache * cache) {
+    hsUNIXStream file;
+    if (!file.Open(GetNodeCachePath(vaultId), "rb"))
+        return false;
+    uint32_t fileSize = file.GetEOF();
+    if (fileSize < sizeof(uint32_t) * 4)
+        return false;
+    std::unique_ptr<uint8_t[]> data = std::make_unique<uint8_t[]>(fileSize);
+    uint32_t read = file.Read(fileSize, data.get());
+    file.Close();
+    if (read != fileSize)
+        return false;
+
+    hsReadOnlyStream stream(fileSize, data.get());
+    if (stream.ReadLE32() != kNodeCacheMagic || stream.ReadLE32() != kNodeCacheVersion)
+        return false;
+    if (stream.ReadLE32() != vaultId)
+        return false;
+    if (stream.ReadLE32() != stream.GetSizeLeft()) // truncated?
+        return false;
+
+    bool valid = true;
+    try {
+        uint32_t refCount = stream.ReadLE32();
+        valid = refCount <= stream.GetSizeLeft() / (sizeof(uint32_t) * 3 + 1);
+        cache->refs.resize(valid ? refCount : 0);
+        for (NetVaultNodeRef & ref : cache->refs) {
+            ref.parentId = stream.ReadLE32();
+            ref.childId  = stream.ReadLE32();
+            ref.ownerId  = stream.ReadLE32();
+            ref.seen     = stream.ReadBool();
+        }
+
+        std::vector<uint8_t> buffer;
+        uint32_t nodeCount = valid ? stream.ReadLE32() : 0;
+        for (uint32_t i = 0; valid && i < nodeCount; ++i) {
+            uint32_t size = stream.ReadLE32();
+            valid = size >= sizeof(uint64_t) && size <= stream.GetSizeLeft();
+            if (!valid)
+                break;
+            buffer.resize(size);
+            stream.Read(size, buffer.data());
+
+            hsRef<NetVaultNode> node(new NetVaultNode, hsStealRef);
+            node->Read(buffer.data(), buffer.size());
+            valid = node->GetNodeId() != 0 && node->GetNodeType() != 0;
+            cache->nodes[node->GetNodeId()] = std::move(node);
+        }
+    } catch (...) {
+        valid = false; // ran off the end of the data
+    }
+
+    if (!valid) {
+        LogMsg(kLogError, "Vault: Node cache for vault {} is corrupt, ignoring it", vaultId);
+        cache->refs.clear();
+        cache->nodes.clear();
+    }
+    return valid;
+}
+
+//============================================================================
+static void SaveNodeCache (unsigned vaultId) {
+    RelVaultNodeLink * root = s_nodes.Find(vaultId);
+    if (!root || root->node->GetNodeType() == 0)
+        return;
+
+    // Walk the tree the same way the server does when it sends us the refs
+    hsVectorStream payload;
+    uint32_t refCount = 0;
+    std::vector<hsWeakRef<RelVaultNode>> nodes;
+    std::vector<hsWeakRef<RelVaultNode>> pending { root->node };
+    std::unordered_set<unsigned> visited { vaultId };
+    hsVectorStream refs;
+    while (!pending.empty()) {
+        hsWeakRef<RelVaultNode> node = pending.back();
+        pending.pop_back();
+        if (node->GetNodeType() != 0)
+            nodes.emplace_back(node);
+
+        RelVaultNodeLink * link = node->state->children.Head();
+        for (; link; link = node->state->children.Next(link)) {
+            refs.WriteLE32(node->GetNodeId());
+            refs.WriteLE32(link->node->GetNodeId());
+            refs.WriteLE32(link->ownerId);
+            refs.WriteBool(link->seen);
+            ++refCount;
+            if (visited.insert(link->node->GetNodeId()).second)
+                pending.emplace_back(link->node);
+        }
+    }
+
+    payload.WriteLE32(refCount);
+    payload.Write(refs.GetEOF(), refs.GetData());
+    payload.WriteLE32((uint32_t)nodes.size());
+    std::vector<uint8_t> buffer;
+    for (hsWeakRef<RelVaultNode> node : nodes) {
+        buffer.clear();
+        node->Write(&buffer);
+        payload.WriteLE32((uint32_t)buffer.size());
+        payload.Write((uint32_t)buffer.size(), buffer.data());
+    }
+
+    plFileName cachePath = GetNodeCachePath(vaultId);
+    plFileSystem::CreateDir(cachePath.StripFileName(), true);
+    hsUNIXStream file;
+    if (!file.Open(cachePath, "wb")) {
+        LogMsg(kLogError, "Vault: Can't write the node cache to {}", cachePath);
+        return;
+    }
+    file.WriteLE32(kNodeCacheMagic);
+    file.WriteLE32(kNodeCacheVersion);
+    file.WriteLE32(vaultId);
+    file.WriteLE32(payload.GetEOF()); // everything after this, so a partial write is caught
+    file.Write(payload.GetEOF(), payload.GetData());
+    file.Close();
+}
+
+//============================================================================
+// Finds the cached nodes whose refs are the same as when the cache was
+// written. These are the ones we can use right away and check against the
+// server later, rather than fetching outright.
+static std::unordered_map<unsigned, hsRef<NetVaultNode>> FindCachedNodes (
+    const NetVaultNodeRef   refs[],
+    unsigned                refCount,
+    const VaultNodeCache &  cache
+) {
+    typedef std::tuple<unsigned, unsigned, unsigned> RefKey;
+    std::set<RefKey> cachedRefs;
+    std::unordered_map<unsigned, unsigned> cachedCounts;
+    for (const NetVaultNodeRef & ref : cache.refs) {
+        cachedRefs.emplace(ref.parentId, ref.childId, ref.ownerId);
+        ++cachedCounts[ref.parentId];
+        ++cachedCounts[ref.childId];
+    }
+
+    // Per node, how many of its refs there are and how many the cache knows
+    std::unordered_map<unsigned, std::pair<unsigned, unsigned>> counts;
+    for (unsigned i = 0; i < refCount; ++i) {
+        bool cached = cachedRefs.find(RefKey(refs[i].parentId, refs[i].childId, refs[i].ownerId)) != cachedRefs.end();
+        for (unsigned nodeId : { refs[i].parentId, refs[i].childId }) {
+            std::pair<unsigned, unsigned> & count = counts[nodeId];
+            ++count.first;
+            if (cached)
+                ++count.second;
+        }
+    }
+
+    std::unordered_map<unsigned, hsRef<NetVaultNode>> nodes;
+    for (const auto & [nodeId, count] : counts) {
+        if (count.second != count.first || cachedCounts[nodeId] != count.first)
+            continue;
+        auto cachedNode = cache.nodes.find(nodeId);
+        if (cachedNode != cache.nodes.end())
+            nodes.emplace(nodeId, cachedNode->second);
+    }
+    return nodes;
+}
+
+//============================================================================
+static void CachedNodeChecked (
+    ENetError           result,
+    void *              param,
+    unsigned            nodeIdCount,
+    const unsigned      nodeIds[]
+) {
+    unsigned nodeId = (unsigned)((uintptr_t)param);
+    if (IS_NET_SUCCESS(result) && std::find(nodeIds, nodeIds + nodeIdCount, nodeId) != nodeIds + nodeIdCount)
+        return;
+
+    // Changed since the cache was written, or the server couldn't tell us
+    s_downloadNet->NodeFetch(nodeId, ChangedVaultNodeFetched, nullptr);
+}
+
 //============================================================================
 static void FetchNodesFromRefs (
     NetVaultNodeRef *           refs,
     unsigned                    refCount,
     FNetCliAuthVaultNodeFetched fetchCallback,
     void *                      fetchParam,
-    unsigned *                  fetchCount
-    
+    unsigned *                  fetchCount,
+    const VaultNodeCache *      cache = nullptr
 ) {
     // On the side, start downloading PlayerInfo nodes of ref owners we don't already have locally
     FetchRefOwners(refs, refCount);
@@ -460,6 +859,10 @@ static void FetchNodesFromRefs (
     
     BuildNodeTree(refs, refCount, &newNodeIds, &existingNodeIds);
 
+    std::unordered_map<unsigned, hsRef<NetVaultNode>> cachedNodes;
+    if (cache)
+        cachedNodes = FindCachedNodes(refs, refCount, *cache);
+
     std::vector<unsigned> nodeIds;
     nodeIds.insert(nodeIds.end(), newNodeIds.begin(), newNodeIds.end());
     nodeIds.insert(nodeIds.end(), existingNodeIds.begin(), existingNodeIds.end());
@@ -467,6 +870,7 @@ static void FetchNodesFromRefs (
 
     // Fetch the nodes that do not yet have a nodetype
     unsigned prevId = 0;
+    std::vector<hsRef<NetVaultNode>> usedCachedNodes;
     for (unsigned nodeId : nodeIds) {
         RelVaultNodeLink * link = s_nodes.Find(nodeId);
         if (link->node->GetNodeType() != 0)
@@ -475,13 +879,38 @@ static void FetchNodesFromRefs (
         if (link->node->GetNodeId() == prevId)
             continue;
         prevId = link->node->GetNodeId();
-        NetCliAuthVaultNodeFetch(
+
+        // Cached copies go into the tree now, and aren't waited on
+        auto cachedNode = cachedNodes.find(nodeId);
+        if (cachedNode != cachedNodes.end()) {
+            VaultNodeFetched(kNetSuccess, nullptr, cachedNode->second.Get());
+            usedCachedNodes.emplace_back(cachedNode->second);
+            continue;
+        }
+
+        ++(*fetchCount);
+        s_downloadNet->NodeFetch(
             nodeId,
             fetchCallback,
             fetchParam
         );
-        ++(*fetchCount);
     }
+
+    // Now make sure the cached copies are still current. The fetches above
+    // go out first, so the download doesn't wait behind these.
+    for (const hsRef<NetVaultNode> & cachedNode : usedCachedNodes) {
+        NetVaultNode templateNode;
+        templateNode.SetNodeId(cachedNode->GetNodeId());
+        templateNode.SetModifyTime(cachedNode->GetModifyTime());
+        s_downloadNet->NodeFind(
+            &templateNode,
+            CachedNodeChecked,
+            (void *)(uintptr_t)cachedNode->GetNodeId()
+        );
+    }
+
+    if (cache)
+        LogMsg(kLogDebug, "Vault: {} nodes taken from the node cache, {} fetched", usedCachedNodes.size(), *fetchCount);
 }
 
 //============================================================================
@@ -504,7 +933,7 @@ static void VaultNodeFound (
             return;
 
         // Start fetching the node          
-        NetCliAuthVaultNodeFetch(nodeIds[i], VaultNodeFetched, nullptr);
+        s_downloadNet->NodeFetch(nodeIds[i], VaultNodeFetched, nullptr);
     }
 }
 
@@ -525,6 +954,7 @@ static void VaultNodeFetched (
         link = new RelVaultNodeLink(false, 0, node->GetNodeId());
         link->node->SetNodeId_NoDirty(node->GetNodeId());
         s_nodes.Add(link);
+        s_nodesIndex.Add(link);
     }
     link->node->CopyFrom(node);
     InitFetchedNode(link->node);
@@ -851,6 +1281,11 @@ void VaultDownloadTrans::VaultNodeFetched (
     if (!trans->nodesLeft) {
         VaultDump(trans->tag, trans->vaultId);
 
+        if (s_nodeCacheEnabled && IS_NET_SUCCESS(trans->result)) {
+            SaveNodeCache(trans->vaultId);
+            s_nodeCacheRoots.insert(trans->vaultId);
+        }
+
         if (trans->callback)
             trans->callback(
                 trans->result,
@@ -877,12 +1312,15 @@ void VaultDownloadTrans::VaultNodeRefsFetched (
     }
     else {
         if (refCount) {
+            VaultNodeCache cache;
+            bool haveCache = s_nodeCacheEnabled && LoadNodeCache(trans->vaultId, &cache);
             FetchNodesFromRefs(
                 refs,
                 refCount,
                 VaultDownloadTrans::VaultNodeFetched,
                 param,
-                &trans->nodeCount
+                &trans->nodeCount,
+                haveCache ? &cache : nullptr
             );
             trans->nodesLeft = trans->nodeCount;
         }
@@ -890,7 +1328,7 @@ void VaultDownloadTrans::VaultNodeRefsFetched (
             // root node has no child heirarchy? Make sure we still d/l the root node if necessary.
             RelVaultNodeLink* rootNodeLink = s_nodes.Find(trans->vaultId);
             if (!rootNodeLink || rootNodeLink->node->GetNodeType() == 0) {
-                NetCliAuthVaultNodeFetch(
+                s_downloadNet->NodeFetch(
                     trans->vaultId,
                     VaultDownloadTrans::VaultNodeFetched,
                     trans
@@ -902,6 +1340,9 @@ void VaultDownloadTrans::VaultNodeRefsFetched (
 
     // Make the callback now if there are no nodes to fetch, or if error
     if (!trans->nodesLeft) {
+        if (s_nodeCacheEnabled && IS_NET_SUCCESS(trans->result))
+            s_nodeCacheRoots.insert(trans->vaultId);
+
         if (trans->callback)
             trans->callback(
                 trans->result,
@@ -1061,6 +1502,7 @@ void IRelVaultNode::Unlink(hsWeakRef<RelVaultNode> other) {
     if (link = children.Find(other->GetNodeId()); link != nullptr) {
         // make them non-findable in our children table
         link->link.Unlink();
+        childrenIndex.Remove(link);
         // remove us from other's tables.
         link->node->state->Unlink(node);
         delete link;
@@ -1083,6 +1525,21 @@ RelVaultNode::~RelVaultNode () {
     delete state;
 }
 
+//============================================================================
+void RelVaultNode::IFieldsChanged (uint64_t fields) {
+    if (!(fields & (kNodeType | kInt32_1 | kString64_1)))
+        return;
+
+    // Re-file us in the global table and in each of our parents' children
+    RelVaultNodeLink * link = s_nodes.Find(GetNodeId());
+    if (link && link->node.Get() == this)
+        s_nodesIndex.Update(link);
+    for (RelVaultNodeLink * parent = state->parents.Head(); parent; parent = state->parents.Next(parent)) {
+        if (RelVaultNodeLink * child = parent->node->state->children.Find(GetNodeId()))
+            parent->node->state->childrenIndex.Update(child);
+    }
+}
+
 //============================================================================
 bool RelVaultNode::IsParentOf (unsigned childId, unsigned maxDepth) {
     if (GetNodeId() == childId)
@@ -1193,11 +1650,23 @@ hsRef<RelVaultNode> RelVaultNode::GetChildNode (
         return nullptr;
 
     RelVaultNodeLink * link;
-    link = state->children.Head();
-    for (; link; link = state->children.Next(link)) {
-        if (link->node->Matches(templateNode.Get()))
-            return link->node;
+    if (const VaultNodeIndex::Bucket * bucket = state->childrenIndex.Find(templateNode)) {
+        // Only these children can match
+        for (RelVaultNodeLink * candidate : *bucket) {
+            if (candidate->node->Matches(templateNode.Get()))
+                return candidate->node;
+        }
+    }
+    else {
+        link = state->children.Head();
+        for (; link; link = state->children.Next(link)) {
+            if (link->node->Matches(templateNode.Get()))
+                return link->node;
+        }
     }
+
+    if (maxDepth == 1)
+        return nullptr;
     
     link = state->children.Head();
     for (; link; link = state->children.Next(link)) {
@@ -1502,6 +1971,11 @@ void VaultDestroy () {
     NetCliAuthVaultSetRecvNodeDeletedHandler(nullptr);
 
     VaultClearDeviceInboxMap();
+
+    // Write back what changed during the session
+    for (unsigned vaultId : s_nodeCacheRoots)
+        SaveNodeCache(vaultId);
+    s_nodeCacheRoots.clear();
     
     RelVaultNodeLink * next, * link = s_nodes.Head();
     for (; link; link = next) {
@@ -1509,6 +1983,29 @@ void VaultDestroy () {
         link->node->state->UnlinkFromRelatives();
         delete link;
     }
+    s_nodesIndex.Clear();
+}
+
+//============================================================================
+void VaultSetNodeCacheEnabled (bool enabled) {
+    s_nodeCacheEnabled = enabled;
+    if (!enabled)
+        s_nodeCacheRoots.clear();
+}
+
+//============================================================================
+bool VaultIsNodeCacheEnabled () {
+    return s_nodeCacheEnabled;
+}
+
+//============================================================================
+void VaultSetNodeCacheDir (const plFileName & dir) {
+    s_nodeCacheDir = dir;
+}
+
+//============================================================================
+void VaultSetDownloadNet (const VaultDownloadNet * net) {
+    s_downloadNet = net ? net : &s_authDownloadNet;
 }
 
 //============================================================================
@@ -1528,6 +2025,14 @@ hsRef<RelVaultNode> VaultGetNode (
     hsWeakRef<NetVaultNode> templateNode
 ) {
     ASSERT(templateNode);
+    if (const VaultNodeIndex::Bucket * bucket = s_nodesIndex.Find(templateNode)) {
+        for (RelVaultNodeLink * link : *bucket) {
+            if (link->node->Matches(templateNode.Get()))
+                return link->node;
+        }
+        return nullptr;
+    }
+
     RelVaultNodeLink * link = s_nodes.Head();
     while (link) {
         if (link->node->Matches(templateNode.Get()))
@@ -1571,6 +2076,7 @@ void VaultAddChildNode (
             childLink = new RelVaultNodeLink(false, ownerId, childId);
             childLink->node->SetNodeId_NoDirty(childId);
             s_nodes.Add(childLink);
+            s_nodesIndex.Add(childLink);
         }
         else if (ownerId) {
             childLink->ownerId = ownerId;
@@ -2003,6 +2509,14 @@ void VaultLocalFindNodes (
     hsWeakRef<NetVaultNode> templateNode,
     std::vector<unsigned> * nodeIds
 ) {
+    if (const VaultNodeIndex::Bucket * bucket = s_nodesIndex.Find(templateNode)) {
+        for (RelVaultNodeLink * link : *bucket) {
+            if (link->node->Matches(templateNode.Get()))
+                nodeIds->emplace_back(link->node->GetNodeId());
+        }
+        return;
+    }
+
     for (RelVaultNodeLink * link = s_nodes.Head(); link != nullptr; link = s_nodes.Next(link)) {
         if (link->node->Matches(templateNode.Get()))
             nodeIds->emplace_back(link->node->GetNodeId());
@@ -4556,7 +5070,7 @@ void VaultDownload (
     VaultDownloadTrans * trans = new VaultDownloadTrans(tag, callback, cbParam,
         progressCallback, cbProgressParam, vaultId);
 
-    NetCliAuthVaultFetchNodeRefs(
+    s_downloadNet->FetchNodeRefs(
         vaultId,
         VaultDownloadTrans::VaultNodeRefsFetched,
         trans
@@ -4608,6 +5122,7 @@ void VaultCull (unsigned vaultId) {
     if (RelVaultNodeLink * link = s_nodes.Find(vaultId)) {
         LogMsg(kLogDebug, "Vault: Culling node {}", link->node->GetNodeId());
         link->node->state->UnlinkFromRelatives();
+        s_nodesIndex.Remove(link);
         delete link;
     }
 
@@ -4631,6 +5146,7 @@ void VaultCull (unsigned vaultId) {
         if (!foundRoot) {
             LogMsg(kLogDebug, "Vault: Culling node {}", link->node->GetNodeId());
             link->node->state->UnlinkFromRelatives();
+            s_nodesIndex.Remove(link);
             delete link;
         }
     }   
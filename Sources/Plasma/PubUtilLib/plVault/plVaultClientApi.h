@@ -59,6 +59,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 ***/
 
 struct RelVaultNode;
+class plFileName;
 class plUUID;
 
 struct VaultCallback {
@@ -176,6 +177,10 @@ struct RelVaultNode : NetVaultNode {
     
     // AgeInfoNode-specific (and it checks!)
     hsRef<RelVaultNode> GetParentAgeLink ();
+
+protected:
+    // Keeps the node's place in the local lookup indices current
+    void IFieldsChanged (uint64_t fields) override;
 };
 
 
@@ -189,6 +194,15 @@ void VaultInitialize ();
 void VaultDestroy ();
 void VaultUpdate ();
 
+// Keeps a copy of each downloaded vault on disk, so the next VaultDownload
+// of it only fetches the nodes that changed. Off by default.
+void VaultSetNodeCacheEnabled (bool enabled);
+bool VaultIsNodeCacheEnabled ();
+
+// Where the node cache lives. An empty name puts it back in VaultCache in
+// the user data folder.
+void VaultSetNodeCacheDir (const plFileName & dir);
+
 
 /*****************************************************************************
 *
@@ -477,6 +491,33 @@ void VaultCull (
     unsigned                    vaultId
 );
 
+// The auth server requests a vault download makes. Tests point these at a
+// stand-in server; passing nullptr goes back to plNetGameLib's NetCliAuth
+// calls. The callback types match the NetCliAuth ones.
+typedef void (*FVaultNodeRefsFetched)(
+    ENetError                   result,
+    void *                      param,
+    NetVaultNodeRef *           refs,
+    unsigned                    refCount
+);
+typedef void (*FVaultNodeFetched)(
+    ENetError                   result,
+    void *                      param,
+    NetVaultNode *              node
+);
+typedef void (*FVaultNodeFound)(
+    ENetError                   result,
+    void *                      param,
+    unsigned                    nodeIdCount,
+    const unsigned              nodeIds[]
+);
+struct VaultDownloadNet {
+    void (*FetchNodeRefs)(unsigned nodeId, FVaultNodeRefsFetched callback, void * param);
+    void (*NodeFetch)(unsigned nodeId, FVaultNodeFetched callback, void * param);
+    void (*NodeFind)(NetVaultNode * templateNode, FVaultNodeFound callback, void * param);
+};
+void VaultSetDownloadNet (const VaultDownloadNet * net);
+
 /*****************************************************************************
 *
 *   Vault global node handling
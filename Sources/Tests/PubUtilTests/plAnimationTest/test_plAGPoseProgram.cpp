@@ -0,0 +1,228 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011 Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "hsGeometry3.h"
+#include "hsMatrix44.h"
+#include "hsQuat.h"
+
+#include "plAnimation/plAGPoseProgram.h"
+#include "plAnimation/plMatrixChannel.h"
+#include "plAnimation/plScalarChannel.h"
+#include "plInterp/hsInterp.h"
+#include "plInterp/hsKeys.h"
+#include "plInterp/plAnimTimeConvert.h"
+#include "plInterp/plController.h"
+#include "plTransform/hsAffineParts.h"
+
+static const uint32_t kNumBones = 12;
+static const uint32_t kNumLayers = 3;
+static const uint32_t kNumKeys = 9;
+
+static plController* IMakeController(uint32_t seed, float length)
+{
+    plLeafController* pos = new plLeafController;
+    plLeafController* rot = new plLeafController;
+    plLeafController* scale = new plLeafController;
+    pos->AllocKeys(kNumKeys, hsKeyFrame::kPoint3KeyFrame);
+    rot->AllocKeys(kNumKeys, hsKeyFrame::kQuatKeyFrame);
+    scale->AllocKeys(kNumKeys, hsKeyFrame::kScaleKeyFrame);
+
+    hsVector3 axis(std::sin(float(seed)), std::cos(float(seed)), 0.5f);
+    axis.Normalize();
+
+    for (uint32_t i = 0; i < kNumKeys; i++) {
+        float t = float(i) / (kNumKeys - 1);
+        uint16_t frame = uint16_t(t * length * MAX_FRAMES_PER_SEC);
+
+        hsPoint3Key* pk = pos->GetPoint3Key(i);
+        pk->fFrame = frame;
+        pk->fValue.Set(0.1f * seed, 0.f, 0.3f * std::sin(t * 6.2832f + seed));
+
+        hsQuatKey* qk = rot->GetQuatKey(i);
+        qk->fFrame = frame;
+        qk->fValue.SetAngleAxis(std::sin(t * 6.2832f) + 0.1f * seed, axis);
+
+        hsScaleKey* sk = scale->GetScaleKey(i);
+        sk->fFrame = frame;
+        sk->fValue.fS.Set(1.f, 1.f, 1.f + 0.1f * t);
+        sk->fValue.fQ.Identity();
+    }
+
+    plCompoundController* ctl = new plCompoundController;
+    ctl->SetPosController(pos);
+    ctl->SetRotController(rot);
+    ctl->SetScaleController(scale);
+    return ctl;
+}
+
+// A skeleton with a few animations layered on top of each other, the way
+// plAGModifier::MergeChannel stacks them up
+class plTestSkeleton
+{
+    std::vector<plMatrixControllerChannel*> fAnims;
+    std::vector<plAGChannel*> fNodes;
+    plAnimTimeConvert fConvert[kNumLayers];
+    plScalarConstant fTime[kNumLayers];
+    plScalarConstant fBlend[kNumLayers];
+
+public:
+    std::vector<plMatrixChannel*> fTops;
+    plAGPoseProgram fProgram;
+
+    plTestSkeleton(uint32_t seed, float blendA, float blendB)
+    {
+        fBlend[1].Set(blendA);
+        fBlend[2].Set(blendB);
+
+        hsAffineParts parts;
+        parts.Reset();
+        for (uint32_t b = 0; b < kNumBones; b++) {
+            plMatrixChannel* top = nullptr;
+            for (uint32_t l = 0; l < kNumLayers; l++) {
+                fAnims.push_back(new plMatrixControllerChannel(IMakeController(seed + b + l, 1.f + l), &parts));
+                plAGChannel* cached = fAnims.back()->MakeCacheChannel(&fConvert[l]);
+                plAGChannel* scaled = cached->MakeTimeScale(&fTime[l]);
+                fNodes.push_back(cached);
+                fNodes.push_back(scaled);
+
+                if (top) {
+                    top = plMatrixChannel::ConvertNoRef(top->MakeBlend(scaled, &fBlend[l], 0));
+                    fNodes.push_back(top);
+                } else {
+                    top = plMatrixChannel::ConvertNoRef(scaled);
+                }
+            }
+            fTops.push_back(top);
+        }
+    }
+
+    ~plTestSkeleton()
+    {
+        for (plAGChannel* chan : fNodes)
+            delete chan;
+        for (plMatrixControllerChannel* chan : fAnims)
+            delete chan;
+    }
+
+    void SetTime(double time)
+    {
+        for (uint32_t l = 0; l < kNumLayers; l++)
+            fTime[l].Set(std::fmod(float(time) * (1.f + 0.1f * l), 1.f + l));
+    }
+
+    void Compile(double time)
+    {
+        fProgram.Reset();
+        for (plMatrixChannel* top : fTops)
+            ASSERT_GE(fProgram.AddChannel(top, time), 0);
+    }
+
+    std::vector<hsMatrix44> GetPose() const
+    {
+        std::vector<hsMatrix44> pose(kNumBones * 2);
+        for (uint32_t b = 0; b < kNumBones; b++) {
+            const hsAffineParts& ap = fProgram.GetParts(int(b));
+            ap.ComposeMatrix(&pose[b * 2]);
+            ap.ComposeInverseMatrix(&pose[b * 2 + 1]);
+        }
+        return pose;
+    }
+};
+
+static bool IPosesMatch(const std::vector<hsMatrix44>& a, const std::vector<hsMatrix44>& b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (std::memcmp(a[i].fMap, b[i].fMap, sizeof(a[i].fMap)) != 0)
+            return false;
+    }
+    return true;
+}
+
+TEST(plAGPoseProgram, EvalOpsParallelMatchesSerial)
+{
+    // Blends at 0, 1 and in between, so every bias case is compiled in.
+    std::vector<std::unique_ptr<plTestSkeleton>> skeletons;
+    skeletons.emplace_back(new plTestSkeleton(1, 0.5f, 0.25f));
+    skeletons.emplace_back(new plTestSkeleton(7, 1.f, 0.75f));
+    skeletons.emplace_back(new plTestSkeleton(13, 0.f, 0.5f));
+    skeletons.emplace_back(new plTestSkeleton(29, 0.3f, 1.f));
+    skeletons.emplace_back(new plTestSkeleton(41, 0.9f, 0.f));
+
+    std::vector<plAGPoseProgram*> programs;
+    for (auto& skeleton : skeletons) {
+        skeleton->SetTime(0.0);
+        skeleton->Compile(0.0);
+        ASSERT_TRUE(skeleton->fProgram.IsThreadSafe());
+        programs.push_back(&skeleton->fProgram);
+    }
+
+    for (uint32_t numThreads : { 0U, 2U, 3U, 8U }) {
+        for (uint32_t frame = 0; frame < 20; frame++) {
+            double time = frame * (1. / 30.);
+
+            std::vector<std::vector<hsMatrix44>> serial;
+            for (auto& skeleton : skeletons) {
+                skeleton->SetTime(time);
+                ASSERT_TRUE(skeleton->fProgram.EvalSlots(time));
+                skeleton->fProgram.EvalOps();
+                serial.push_back(skeleton->GetPose());
+            }
+
+            for (auto& skeleton : skeletons)
+                ASSERT_TRUE(skeleton->fProgram.EvalSlots(time));
+            plAGPoseProgram::EvalOpsParallel(programs, numThreads);
+
+            for (size_t i = 0; i < skeletons.size(); i++) {
+                EXPECT_TRUE(IPosesMatch(serial[i], skeletons[i]->GetPose()))
+                    << "skeleton " << i << ", frame " << frame << ", " << numThreads << " threads";
+            }
+        }
+    }
+}
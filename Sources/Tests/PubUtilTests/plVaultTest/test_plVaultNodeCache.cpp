@@ -0,0 +1,240 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011 Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <vector>
+
+#include "plFileSystem.h"
+
+#include "plVault/plVault.h"
+
+// Answers the vault download requests the way the auth server would, but
+// queues the replies until Pump() so they arrive after the request returns,
+// just as they do over the wire.
+class StandInAuthServer
+{
+public:
+    std::map<unsigned, hsRef<NetVaultNode>> fNodes;
+    std::vector<NetVaultNodeRef> fRefs;
+    std::vector<std::function<void()>> fReplies;
+    unsigned fFetches = 0;
+    unsigned fFinds = 0;
+
+    static StandInAuthServer* sInstance;
+
+    void AddNode(unsigned nodeId, unsigned nodeType, uint32_t modifyTime, const ST::string& text)
+    {
+        hsRef<NetVaultNode> node(new NetVaultNode, hsStealRef);
+        node->SetNodeId(nodeId);
+        node->SetNodeType(nodeType);
+        node->SetModifyTime(modifyTime);
+        node->SetText_1(text);
+        fNodes[nodeId] = std::move(node);
+    }
+
+    void AddRef(unsigned parentId, unsigned childId)
+    {
+        NetVaultNodeRef ref;
+        ref.parentId = parentId;
+        ref.childId = childId;
+        ref.ownerId = 0;
+        ref.seen = false;
+        fRefs.emplace_back(ref);
+    }
+
+    // Sends the replies to everything asked so far, but not to anything
+    // those replies ask in turn
+    void PumpOnce()
+    {
+        std::vector<std::function<void()>> replies;
+        replies.swap(fReplies);
+        for (const std::function<void()>& reply : replies)
+            reply();
+    }
+
+    void Pump()
+    {
+        while (!fReplies.empty())
+            PumpOnce();
+    }
+
+    static void FetchNodeRefs(unsigned nodeId, FVaultNodeRefsFetched callback, void* param)
+    {
+        sInstance->fReplies.emplace_back([callback, param]() {
+            std::vector<NetVaultNodeRef> refs = sInstance->fRefs;
+            callback(kNetSuccess, param, refs.data(), (unsigned)refs.size());
+        });
+    }
+
+    static void NodeFetch(unsigned nodeId, FVaultNodeFetched callback, void* param)
+    {
+        ++sInstance->fFetches;
+        sInstance->fReplies.emplace_back([nodeId, callback, param]() {
+            auto it = sInstance->fNodes.find(nodeId);
+            if (it == sInstance->fNodes.end()) {
+                callback(kNetErrVaultNodeNotFound, param, nullptr);
+                return;
+            }
+
+            // Send a copy through the wire format, not the server's node
+            std::vector<uint8_t> buffer;
+            it->second->Write(&buffer);
+            hsRef<NetVaultNode> node(new NetVaultNode, hsStealRef);
+            node->Read(buffer.data(), buffer.size());
+            callback(kNetSuccess, param, node.Get());
+        });
+    }
+
+    static void NodeFind(NetVaultNode* templateNode, FVaultNodeFound callback, void* param)
+    {
+        ++sInstance->fFinds;
+        hsRef<NetVaultNode> search(new NetVaultNode, hsStealRef);
+        search->CopyFrom(templateNode);
+        sInstance->fReplies.emplace_back([search, callback, param]() {
+            std::vector<unsigned> nodeIds;
+            for (const auto& [nodeId, node] : sInstance->fNodes) {
+                if (node->Matches(search.Get()))
+                    nodeIds.emplace_back(nodeId);
+            }
+            callback(kNetSuccess, param, (unsigned)nodeIds.size(), nodeIds.data());
+        });
+    }
+};
+
+StandInAuthServer* StandInAuthServer::sInstance = nullptr;
+
+static const VaultDownloadNet kStandInNet = {
+    StandInAuthServer::FetchNodeRefs,
+    StandInAuthServer::NodeFetch,
+    StandInAuthServer::NodeFind,
+};
+
+static void DownloadDone(ENetError result, void* param)
+{
+    *(ENetError*)param = result;
+}
+
+static ENetError Download(StandInAuthServer& server, unsigned vaultId)
+{
+    ENetError result = kNetPending;
+    VaultDownload("Test", vaultId, DownloadDone, &result, nullptr, nullptr);
+    server.Pump();
+    return result;
+}
+
+TEST(plVaultNodeCache, FetchesOnlyChangedNodes)
+{
+    const unsigned kRootId = 0x7E570000;
+
+    // Keep well away from the real cache in the user data folder
+    plFileName cacheDir = plFileName::Join(std::filesystem::temp_directory_path().u8string().c_str(),
+                                           "plVaultNodeCacheTest");
+    plFileName cachePath = plFileName::Join(cacheDir, ST::format("{}.cache", kRootId));
+    VaultSetNodeCacheDir(cacheDir);
+    plFileSystem::Unlink(cachePath);
+
+    StandInAuthServer server;
+    StandInAuthServer::sInstance = &server;
+    server.AddNode(kRootId, plVault::kNodeType_Folder, 100, {});
+    for (unsigned i = 1; i <= 4; ++i) {
+        server.AddNode(kRootId + i, plVault::kNodeType_TextNote, 100, ST::format("note {}", i));
+        server.AddRef(kRootId, kRootId + i);
+    }
+
+    VaultSetDownloadNet(&kStandInNet);
+    VaultSetNodeCacheEnabled(true);
+
+    // Nothing cached yet, so everything is fetched
+    VaultInitialize();
+    EXPECT_EQ(kNetSuccess, Download(server, kRootId));
+    EXPECT_EQ(5u, server.fFetches);
+    EXPECT_EQ(0u, server.fFinds);
+    VaultDestroy();
+    ASSERT_TRUE(plFileInfo(cachePath).Exists());
+
+    // Change one note and add another while the client is away
+    server.fNodes[kRootId + 2]->SetText_1("changed");
+    server.fNodes[kRootId + 2]->SetModifyTime(200);
+    server.AddNode(kRootId + 5, plVault::kNodeType_TextNote, 200, "note 5");
+    server.AddRef(kRootId, kRootId + 5);
+    server.fFetches = 0;
+
+    // The root's refs changed, so it is fetched outright, along with the new
+    // note. The four old notes go into the tree as soon as the refs arrive,
+    // and the download doesn't wait on them.
+    VaultInitialize();
+    ENetError result = kNetPending;
+    VaultDownload("Test", kRootId, DownloadDone, &result, nullptr, nullptr);
+    server.PumpOnce();
+    EXPECT_EQ(2u, server.fFetches);
+    EXPECT_EQ(4u, server.fFinds);
+    for (unsigned i = 1; i <= 4; ++i) {
+        hsRef<RelVaultNode> node = VaultGetNode(kRootId + i);
+        ASSERT_TRUE(node);
+        EXPECT_EQ((uint32_t)plVault::kNodeType_TextNote, node->GetNodeType());
+    }
+
+    // Then the modify time checks come back, and only the changed note is
+    // fetched again
+    server.Pump();
+    EXPECT_EQ(kNetSuccess, result);
+    EXPECT_EQ(4u, server.fFinds);
+    EXPECT_EQ(3u, server.fFetches);
+
+    for (unsigned i = 1; i <= 5; ++i) {
+        hsRef<RelVaultNode> node = VaultGetNode(kRootId + i);
+        ASSERT_TRUE(node);
+        EXPECT_EQ((uint32_t)plVault::kNodeType_TextNote, node->GetNodeType());
+        EXPECT_EQ(server.fNodes[kRootId + i]->GetText_1(), node->GetText_1());
+        EXPECT_EQ(server.fNodes[kRootId + i]->GetModifyTime(), node->GetModifyTime());
+    }
+    VaultDestroy();
+
+    VaultSetNodeCacheEnabled(false);
+    VaultSetNodeCacheDir({});
+    VaultSetDownloadNet(nullptr);
+    StandInAuthServer::sInstance = nullptr;
+    plFileSystem::Unlink(cachePath);
+}
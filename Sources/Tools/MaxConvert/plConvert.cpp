@@ -67,10 +67,10 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plLightMapGen.h"
 #include "plBitmapCreator.h"
 
-#include "pnMessage/plTimeMsg.h"
 #include "MaxComponent/plComponent.h"
 #include "MaxMain/plMaxNode.h"
 #include "plMessage/plNodeCleanupMsg.h"
+#include "pnSceneObject/plCoordinateInterface.h"
 #include "pnSceneObject/plSceneObject.h"
 #include "MaxComponent/plClusterComponent.h"
 
@@ -112,8 +112,6 @@ bool plConvert::Convert()
     fInterface->SetIncludeXRefsInHierarchy(TRUE);
 
     plMaxNode *pNode = (plMaxNode *)fInterface->GetRootNode();
-    AddMessageToQueue(new plTransformMsg(nullptr, nullptr, nullptr, nullptr));
-    AddMessageToQueue(new plDelayedTransformMsg(nullptr, nullptr, nullptr, nullptr));
 
     IFindDuplicateNames();
 
@@ -329,8 +327,8 @@ bool plConvert::Convert(hsTArray<plMaxNode*>& nodes)
     plLightMapGen::Instance().Close();
     hsVertexShader::Instance().Close();
 
-    plgDispatch::MsgSend(new plTransformMsg(nullptr, nullptr, nullptr, nullptr));
-    plgDispatch::MsgSend(new plDelayedTransformMsg(nullptr, nullptr, nullptr, nullptr));
+    plCoordinateInterface::UpdateTransforms(plCoordinateInterface::kTransformPhaseNormal);
+    plCoordinateInterface::UpdateTransforms(plCoordinateInterface::kTransformPhaseDelayed);
     DeInit();
 
     return IOK();   
@@ -378,6 +376,10 @@ void plConvert::DeInit()
     // Undo any autogenerated clusters.
     IAutoUnClusterRecur(fInterface->GetRootNode());
 
+    // Flush the transforms dirtied during the convert before anything else queued goes out
+    plCoordinateInterface::UpdateTransforms(plCoordinateInterface::kTransformPhaseNormal);
+    plCoordinateInterface::UpdateTransforms(plCoordinateInterface::kTransformPhaseDelayed);
+
     // clear out the message queue
     for (int i = 0; i < fMsgQueue.Count(); i++)
         plgDispatch::MsgSend(fMsgQueue[i]);
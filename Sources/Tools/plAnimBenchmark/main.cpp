@@ -0,0 +1,404 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string_theory/stdio>
+#include <vector>
+
+#include "HeadSpin.h"
+#include "hsGeometry3.h"
+#include "hsMatrix44.h"
+#include "hsQuat.h"
+#include "plCmdParser.h"
+
+#include "plAnimation/plAGPoseProgram.h"
+#include "plAnimation/plMatrixChannel.h"
+#include "plAnimation/plScalarChannel.h"
+#include "plInterp/hsInterp.h"
+#include "plInterp/hsKeys.h"
+#include "plInterp/plAnimTimeConvert.h"
+#include "plInterp/plController.h"
+#include "plTransform/hsAffineParts.h"
+
+enum CmdLineArgs
+{
+    kArgCount,
+    kArgThreads,
+};
+
+static const plCmdArgDef s_cmdLineArgs[] = {
+    { (kCmdTypeUint | kCmdArgFlagged), "Count", kArgCount },
+    { (kCmdTypeUint | kCmdArgFlagged), "Threads", kArgThreads },
+};
+
+using ClockT = std::chrono::steady_clock;
+
+// A busy age: a few dozen avatars, each with a full skeleton and a stack of
+// animations (idle, walk, turns, gestures...) fading in and out on top of
+// each other. Some layers sit at exactly 0 or 1 for a while, which is what
+// Compile optimizes around.
+static const uint32_t kNumAvatars = 48;
+static const uint32_t kNumBones = 64;
+static const uint32_t kNumLayers = 8;
+static const uint32_t kNumKeys = 31;
+static const uint32_t kNumFrames = 240;
+static const double kFrameSecs = 1. / 30.;
+
+static float IRandom(std::mt19937& rng, float lo, float hi)
+{
+    return std::uniform_real_distribution<float>(lo, hi)(rng);
+}
+
+// One bone's worth of keys for one animation, spread evenly over its length
+static plController* IMakeController(std::mt19937& rng, float length)
+{
+    plLeafController* pos = new plLeafController;
+    plLeafController* rot = new plLeafController;
+    plLeafController* scale = new plLeafController;
+    pos->AllocKeys(kNumKeys, hsKeyFrame::kPoint3KeyFrame);
+    rot->AllocKeys(kNumKeys, hsKeyFrame::kQuatKeyFrame);
+    scale->AllocKeys(kNumKeys, hsKeyFrame::kScaleKeyFrame);
+
+    hsVector3 axis(IRandom(rng, -1.f, 1.f), IRandom(rng, -1.f, 1.f), IRandom(rng, 0.1f, 1.f));
+    axis.Normalize();
+    hsPoint3 base(IRandom(rng, -1.f, 1.f), IRandom(rng, -1.f, 1.f), IRandom(rng, 0.f, 2.f));
+    float swing = IRandom(rng, 0.2f, 1.2f);
+
+    for (uint32_t i = 0; i < kNumKeys; i++) {
+        float t = float(i) / (kNumKeys - 1);
+        uint16_t frame = uint16_t(t * length * MAX_FRAMES_PER_SEC);
+
+        hsPoint3Key* pk = pos->GetPoint3Key(i);
+        pk->fFrame = frame;
+        pk->fValue = base + hsVector3(0.f, 0.f, 0.1f * std::sin(t * 6.2832f));
+
+        hsQuatKey* qk = rot->GetQuatKey(i);
+        qk->fFrame = frame;
+        qk->fValue.SetAngleAxis(swing * std::sin(t * 6.2832f), axis);
+
+        hsScaleKey* sk = scale->GetScaleKey(i);
+        sk->fFrame = frame;
+        sk->fValue.fS.Set(1.f, 1.f, 1.f + 0.05f * t);
+        sk->fValue.fQ.Identity();
+    }
+
+    plCompoundController* ctl = new plCompoundController;
+    ctl->SetPosController(pos);
+    ctl->SetRotController(rot);
+    ctl->SetScaleController(scale);
+    return ctl;
+}
+
+// The shared part of an animation, one controller channel per bone
+struct plBenchAnim
+{
+    std::vector<plMatrixControllerChannel*> fBones;
+    float fLength;
+
+    ~plBenchAnim()
+    {
+        for (plMatrixControllerChannel* chan : fBones)
+            delete chan;
+    }
+};
+
+// One avatar's instances of every animation, blended in layers the way
+// plAGAnimInstance and plAGModifier::MergeChannel stack them up
+struct plBenchAvatar
+{
+    plAnimTimeConvert fConvert[kNumLayers];
+    plScalarConstant fTime[kNumLayers];
+    plScalarConstant fBlend[kNumLayers];
+    float fPhase;
+    bool fNeedCompile;
+    bool fProgramDirty;
+
+    std::vector<plMatrixChannel*> fTops;
+    std::vector<plAGChannel*> fNodes;
+    plAGPoseProgram fProgram;
+
+    // graph, compiled and parallel results
+    std::vector<hsMatrix44> fL2P[3];
+    std::vector<hsMatrix44> fP2L[3];
+
+    plBenchAvatar(const std::vector<std::unique_ptr<plBenchAnim>>& anims, float phase)
+        : fPhase(phase), fNeedCompile(true), fProgramDirty(true)
+    {
+        for (uint32_t b = 0; b < kNumBones; b++) {
+            plMatrixChannel* top = nullptr;
+            for (uint32_t l = 0; l < kNumLayers; l++) {
+                plAGChannel* cached = anims[l]->fBones[b]->MakeCacheChannel(&fConvert[l]);
+                plAGChannel* scaled = cached->MakeTimeScale(&fTime[l]);
+                fNodes.push_back(cached);
+                fNodes.push_back(scaled);
+
+                if (top) {
+                    top = plMatrixChannel::ConvertNoRef(top->MakeBlend(scaled, &fBlend[l], 0));
+                    fNodes.push_back(top);
+                } else {
+                    top = plMatrixChannel::ConvertNoRef(scaled);
+                }
+            }
+            fTops.push_back(top);
+        }
+
+        for (int i = 0; i < 3; i++) {
+            fL2P[i].resize(kNumBones);
+            fP2L[i].resize(kNumBones);
+        }
+    }
+
+    ~plBenchAvatar()
+    {
+        for (plAGChannel* chan : fNodes)
+            delete chan;
+    }
+
+    // Advance the instance clocks and fades. A blend moving to or from 0 or 1
+    // needs a Compile, as plAGAnimInstance::SetBlend asks for, except that now
+    // and then we skip it so the program has to notice on its own.
+    void Update(const std::vector<std::unique_ptr<plBenchAnim>>& anims, uint32_t frame, double time)
+    {
+        for (uint32_t l = 0; l < kNumLayers; l++) {
+            float animTime = std::fmod(float(time) * (0.8f + 0.05f * l) + fPhase, anims[l]->fLength);
+            fTime[l].Set(animTime);
+
+            if (l == 0)
+                continue;
+
+            float blend = 0.5f + 0.8f * std::sin(float(time) * (0.6f + 0.2f * l) + fPhase * l);
+            blend = std::min(1.f, std::max(0.f, blend));
+
+            float oldBlend = fBlend[l].Value(0.0, true);
+            if (oldBlend != blend &&
+                (oldBlend == 0.f || blend == 0.f || oldBlend == 1.f || blend == 1.f) &&
+                (frame + l) % 7)
+                fNeedCompile = true;
+            fBlend[l].Set(blend);
+        }
+    }
+
+    void Compile(double time)
+    {
+        if (fNeedCompile) {
+            for (plMatrixChannel* top : fTops)
+                top->Optimize(time);
+            fNeedCompile = false;
+            fProgramDirty = true;
+        }
+    }
+
+    void EvalGraph(double time)
+    {
+        for (uint32_t b = 0; b < kNumBones; b++) {
+            const hsAffineParts& ap = fTops[b]->AffineValue(time);
+            ap.ComposeMatrix(&fL2P[0][b]);
+            ap.ComposeInverseMatrix(&fP2L[0][b]);
+        }
+    }
+
+    void IBuildProgram(double time, uint32_t& rebuilds)
+    {
+        fProgram.Reset();
+        for (plMatrixChannel* top : fTops)
+            fProgram.AddChannel(top, time);
+        fProgramDirty = false;
+        rebuilds++;
+    }
+
+    // The part of evaluating the program that stays on the main thread
+    void EvalSlots(double time, uint32_t& rebuilds)
+    {
+        if (fProgramDirty)
+            IBuildProgram(time, rebuilds);
+        if (!fProgram.EvalSlots(time)) {
+            IBuildProgram(time, rebuilds);
+            fProgram.EvalSlots(time);
+        }
+    }
+
+    void StoreProgram(int which)
+    {
+        for (uint32_t b = 0; b < kNumBones; b++) {
+            const hsAffineParts& ap = fProgram.GetParts(int(b));
+            ap.ComposeMatrix(&fL2P[which][b]);
+            ap.ComposeInverseMatrix(&fP2L[which][b]);
+        }
+    }
+
+    void EvalProgram(double time, uint32_t& rebuilds)
+    {
+        EvalSlots(time, rebuilds);
+        fProgram.EvalOps();
+        StoreProgram(1);
+    }
+
+    bool Match(int a, int b) const
+    {
+        for (uint32_t i = 0; i < kNumBones; i++) {
+            if (std::memcmp(fL2P[a][i].fMap, fL2P[b][i].fMap, sizeof(fL2P[a][i].fMap)) != 0)
+                return false;
+            if (std::memcmp(fP2L[a][i].fMap, fP2L[b][i].fMap, sizeof(fP2L[a][i].fMap)) != 0)
+                return false;
+        }
+        return true;
+    }
+};
+
+template <typename Op>
+static double ITime(int32_t count, Op op)
+{
+    auto elapsed = ClockT::duration::zero();
+    for (int32_t i = 0; i < count; ++i) {
+        auto begin = ClockT::now();
+        op();
+        elapsed += ClockT::now() - begin;
+    }
+    return std::chrono::duration<double, std::milli>(elapsed).count() / count;
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<ST::string> args;
+    for (int i = 0; i < argc; ++i)
+        args.emplace_back(argv[i]);
+
+    plCmdParser parser(s_cmdLineArgs, std::size(s_cmdLineArgs));
+    parser.Parse(args);
+
+    int32_t count = 5;
+    if (parser.IsSpecified(kArgCount))
+        count = parser.GetInt(kArgCount);
+    if (count <= 0) {
+        ST::printf(stderr, "Cannot iterate less than 1 time.\n");
+        return 1;
+    }
+
+    // 0 is one per core, same as plAGMasterMod::SetEvalThreads
+    uint32_t threads = 0;
+    if (parser.IsSpecified(kArgThreads))
+        threads = parser.GetUint(kArgThreads);
+
+    std::mt19937 rng(0x414e494d);
+    std::vector<std::unique_ptr<plBenchAnim>> anims;
+    for (uint32_t l = 0; l < kNumLayers; l++) {
+        anims.emplace_back(new plBenchAnim);
+        anims.back()->fLength = 1.f + 0.25f * l;
+
+        hsAffineParts parts;
+        parts.Reset();
+        for (uint32_t b = 0; b < kNumBones; b++)
+            anims.back()->fBones.push_back(new plMatrixControllerChannel(IMakeController(rng, anims.back()->fLength), &parts));
+    }
+
+    std::vector<std::unique_ptr<plBenchAvatar>> avatars;
+    for (uint32_t i = 0; i < kNumAvatars; i++)
+        avatars.emplace_back(new plBenchAvatar(anims, IRandom(rng, 0.f, 10.f)));
+
+    std::vector<plAGPoseProgram*> programs;
+    for (auto& avatar : avatars)
+        programs.push_back(&avatar->fProgram);
+
+    ST::printf("{} avatars, {} bones, {} layers, {} frames\n\n", kNumAvatars, kNumBones, kNumLayers, kNumFrames);
+
+    // All three paths evaluate the same graphs at the same time every frame,
+    // so they have to come up with the same bits. The parallel one also has
+    // to come out the same no matter how the avatars land on threads.
+    double graphMs = 0., programMs = 0., parallelMs = 0.;
+    uint32_t rebuilds = 0, parallelRebuilds = 0;
+    bool allMatch = true, parallelMatch = true;
+    for (uint32_t f = 0; f < kNumFrames; f++) {
+        double time = f * kFrameSecs;
+        for (auto& avatar : avatars) {
+            avatar->Update(anims, f, time);
+            avatar->Compile(time);
+        }
+
+        graphMs += ITime(count, [&]() {
+            for (auto& avatar : avatars)
+                avatar->EvalGraph(time);
+        });
+        programMs += ITime(count, [&]() {
+            for (auto& avatar : avatars)
+                avatar->EvalProgram(time, rebuilds);
+        });
+        parallelMs += ITime(count, [&]() {
+            for (auto& avatar : avatars)
+                avatar->EvalSlots(time, parallelRebuilds);
+            plAGPoseProgram::EvalOpsParallel(programs, threads);
+            for (auto& avatar : avatars)
+                avatar->StoreProgram(2);
+        });
+
+        for (auto& avatar : avatars) {
+            allMatch &= avatar->Match(0, 1);
+            parallelMatch &= avatar->Match(1, 2);
+        }
+    }
+
+    size_t numOps = 0;
+    for (auto& avatar : avatars)
+        numOps += avatar->fProgram.GetNumOps();
+
+    ST::printf("{>10} {>10} {>10} {>10}\n\n", "Eval", "Frame ms", "Ops/bone", "Rebuilds");
+    ST::printf("{>10} {>10.3f}\n", "graph", graphMs / kNumFrames);
+    ST::printf("{>10} {>10.3f} {>10.1f} {>10} {}\n", "compiled", programMs / kNumFrames,
+               double(numOps) / (kNumAvatars * kNumBones), rebuilds, allMatch ? "" : "MISMATCH");
+    ST::printf("{>10} {>10.3f} {>10.1f} {>10} {}\n\n", "parallel", parallelMs / kNumFrames,
+               double(numOps) / (kNumAvatars * kNumBones), parallelRebuilds, parallelMatch ? "" : "MISMATCH");
+
+    if (!allMatch) {
+        ST::printf(stderr, "The compiled poses did not match the channel graphs!\n");
+        return 1;
+    }
+    if (!parallelMatch) {
+        ST::printf(stderr, "The parallel poses did not match the serial ones!\n");
+        return 1;
+    }
+
+    ST::printf("Have a nice day!\n");
+    return 0;
+}
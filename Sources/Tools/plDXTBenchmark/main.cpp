@@ -0,0 +1,260 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <random>
+#include <string_theory/stdio>
+#include <thread>
+#include <vector>
+
+#include "HeadSpin.h"
+#include "hsCpuID.h"
+#include "plCmdParser.h"
+
+#include "plGImage/hsDXTKernels.h"
+
+enum CmdLineArgs
+{
+    kArgCount,
+    kArgThreads,
+};
+
+static const plCmdArgDef s_cmdLineArgs[] = {
+    { (kCmdTypeUint | kCmdArgFlagged), "Count", kArgCount },
+    { (kCmdTypeUint | kCmdArgFlagged), "Threads", kArgThreads },
+};
+
+using ClockT = std::chrono::steady_clock;
+
+static const uint32_t kSizes[] = { 256, 512, 1024, 2048 };
+
+// Smooth gradients and a few hard edges with a little noise on top, which
+// is closer to real texture content than pure noise. The alpha channel gets
+// a soft circle so that DXT5 sees a range of block types.
+static void IFillImage(std::vector<uint32_t>& pixels, uint32_t size, std::mt19937& rng)
+{
+    std::uniform_int_distribution<int> noise(-6, 6);
+    for (uint32_t y = 0; y < size; y++) {
+        for (uint32_t x = 0; x < size; x++) {
+            float u = float(x) / size, v = float(y) / size;
+            int r = int(255.f * u) + noise(rng);
+            int g = int(255.f * (0.5f + 0.5f * sinf(u * 12.f + v * 7.f))) + noise(rng);
+            int b = ((x / 32 + y / 32) & 1) ? 220 : 40;
+            float d = hypotf(u - 0.5f, v - 0.5f);
+            int a = d < 0.3f ? 255 : d > 0.45f ? 0 : int(255.f * (0.45f - d) / 0.15f);
+
+            r = std::clamp(r, 0, 255);
+            g = std::clamp(g, 0, 255);
+            pixels[y * size + x] = (uint32_t(a) << 24) | (uint32_t(r) << 16) | (uint32_t(g) << 8) | uint32_t(b);
+        }
+    }
+}
+
+// Same banding as hsDXTSoftwareCodec uses for large levels
+static void IRunBands(uint32_t numThreads, uint32_t numRows, const std::function<void(uint32_t, uint32_t)>& fn)
+{
+    if (numThreads <= 1) {
+        fn(0, numRows);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < numThreads; i++)
+        threads.emplace_back(fn, numRows * i / numThreads, numRows * (i + 1) / numThreads);
+    fn(0, numRows / numThreads);
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+template <typename Op>
+static double ITime(int32_t count, Op op)
+{
+    auto elapsed = ClockT::duration::zero();
+    for (int32_t i = 0; i < count; ++i) {
+        auto begin = ClockT::now();
+        op();
+        elapsed += ClockT::now() - begin;
+    }
+    return std::chrono::duration<double, std::milli>(elapsed).count() / count;
+}
+
+// PSNR of the color channels (and alpha, if asked) against the source
+static double IPSNR(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b, bool withAlpha)
+{
+    double sum = 0.;
+    size_t samples = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        for (uint32_t shift = 0; shift < (withAlpha ? 32u : 24u); shift += 8) {
+            int d = int((a[i] >> shift) & 0xff) - int((b[i] >> shift) & 0xff);
+            sum += d * d;
+            samples++;
+        }
+    }
+    if (sum == 0.)
+        return 99.;
+    return 10. * log10(255. * 255. / (sum / samples));
+}
+
+// Swaps the block kernels for their plain versions, which reproduce the
+// codec as it was before the SIMD kernels.
+class plScalarKernels
+{
+    hsDXTKernels::decode_block_ptr fDecode;
+    hsDXTKernels::find_endpoints_ptr fEndpoints;
+    hsDXTKernels::select_indices_ptr fIndices;
+
+public:
+    plScalarKernels()
+        : fDecode(hsDXTKernels::decode_block.call),
+          fEndpoints(hsDXTKernels::find_endpoints.call),
+          fIndices(hsDXTKernels::select_indices.call)
+    {
+        hsDXTKernels::decode_block.call = &hsDXTKernels::decode_block_fpu;
+        hsDXTKernels::find_endpoints.call = &hsDXTKernels::find_endpoints_fpu;
+        hsDXTKernels::select_indices.call = &hsDXTKernels::select_indices_fpu;
+    }
+
+    ~plScalarKernels()
+    {
+        hsDXTKernels::decode_block.call = fDecode;
+        hsDXTKernels::find_endpoints.call = fEndpoints;
+        hsDXTKernels::select_indices.call = fIndices;
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    std::vector<ST::string> args;
+    for (int i = 0; i < argc; ++i)
+        args.emplace_back(argv[i]);
+
+    plCmdParser parser(s_cmdLineArgs, std::size(s_cmdLineArgs));
+    parser.Parse(args);
+
+    int32_t count = 5;
+    if (parser.IsSpecified(kArgCount))
+        count = parser.GetInt(kArgCount);
+    if (count <= 0) {
+        ST::printf(stderr, "Cannot iterate less than 1 time.\n");
+        return 1;
+    }
+
+    uint32_t numThreads = std::max(std::thread::hardware_concurrency(), 1U);
+    if (parser.IsSpecified(kArgThreads))
+        numThreads = std::max(parser.GetInt(kArgThreads), 1);
+
+    const hsCpuId& cpu = hsCpuId::Instance();
+    ST::printf("CPU: SSE2 {}, AVX2 {}; {} threads\n", cpu.has_sse2 ? "yes" : "no",
+               cpu.has_avx2 ? "yes" : "no", numThreads);
+    ST::printf("{<6} {<7} {<9} {>12} {>12} {>12} {>8}\n\n", "Format", "Size", "Op", "Scalar ms",
+               "SIMD ms", "SIMD+MT ms", "PSNR");
+
+    std::mt19937 rng(0x445854);
+    bool allMatch = true;
+
+    for (uint32_t size : kSizes) {
+        std::vector<uint32_t> translucent(size * size), opaque(size * size);
+        IFillImage(translucent, size, rng);
+
+        // DXT1 turns anything with low alpha into transparent black, so
+        // give it an opaque copy to keep the PSNR meaningful.
+        std::transform(translucent.begin(), translucent.end(), opaque.begin(),
+                       [](uint32_t pixel) { return pixel | 0xff000000; });
+        const uint32_t widthBlocks = size >> 2, numRows = size >> 2;
+
+        for (hsDXTKernels::Format format : { hsDXTKernels::kDXT1, hsDXTKernels::kDXT5 }) {
+            const char* name = format == hsDXTKernels::kDXT1 ? "DXT1" : "DXT5";
+            const std::vector<uint32_t>& source = format == hsDXTKernels::kDXT1 ? opaque : translucent;
+            const size_t compressedSize = widthBlocks * numRows * hsDXTKernels::BlockSize(format);
+            std::vector<uint8_t> scalarOut(compressedSize), simdOut(compressedSize), mtOut(compressedSize);
+            std::vector<uint32_t> scalarImg(size * size), simdImg(size * size), mtImg(size * size);
+
+            auto encode = [&](std::vector<uint8_t>& out, uint32_t threads) {
+                return [&, threads]() {
+                    IRunBands(threads, numRows, [&](uint32_t begin, uint32_t end) {
+                        hsDXTKernels::EncodeRows(format, source.data(), size, out.data(), widthBlocks, begin, end);
+                    });
+                };
+            };
+            auto decode = [&](std::vector<uint32_t>& img, uint32_t threads) {
+                return [&, threads]() {
+                    IRunBands(threads, numRows, [&](uint32_t begin, uint32_t end) {
+                        hsDXTKernels::DecodeRows(format, scalarOut.data(), img.data(), size, widthBlocks, begin, end);
+                    });
+                };
+            };
+
+            double encScalar, decScalar;
+            {
+                plScalarKernels scalar;
+                encScalar = ITime(count, encode(scalarOut, 1));
+                decScalar = ITime(count, decode(scalarImg, 1));
+            }
+            double encSimd = ITime(count, encode(simdOut, 1));
+            double encMT = ITime(count, encode(mtOut, numThreads));
+            double decSimd = ITime(count, decode(simdImg, 1));
+            double decMT = ITime(count, decode(mtImg, numThreads));
+
+            bool encMatch = scalarOut == simdOut && scalarOut == mtOut;
+            bool decMatch = scalarImg == simdImg && scalarImg == mtImg;
+            allMatch &= encMatch && decMatch;
+
+            double psnr = IPSNR(source, scalarImg, format == hsDXTKernels::kDXT5);
+            ST::printf("{<6} {<7} {<9} {>12.3f} {>12.3f} {>12.3f} {>8.2f} {}\n", name, size, "encode",
+                       encScalar, encSimd, encMT, psnr, encMatch ? "" : "MISMATCH");
+            ST::printf("{<6} {<7} {<9} {>12.3f} {>12.3f} {>12.3f} {>8} {}\n", name, size, "decode",
+                       decScalar, decSimd, decMT, "", decMatch ? "" : "MISMATCH");
+        }
+        ST::printf("\n");
+    }
+
+    if (!allMatch) {
+        ST::printf(stderr, "The SIMD or threaded output did not match the scalar output!\n");
+        return 1;
+    }
+
+    ST::printf("Have a nice day!\n");
+    return 0;
+}
@@ -0,0 +1,252 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string_theory/stdio>
+#include <thread>
+#include <vector>
+
+#include "HeadSpin.h"
+#include "hsGeometry3.h"
+#include "plCmdParser.h"
+
+#include "plDrawable/plDrawableSpans.h"
+#include "plDrawable/plGBufferGroup.h"
+#include "plMath/hsRadixSort.h"
+
+enum CmdLineArgs
+{
+    kArgCount,
+    kArgThreads,
+};
+
+static const plCmdArgDef s_cmdLineArgs[] = {
+    { (kCmdTypeUint | kCmdArgFlagged), "Count", kArgCount },
+    { (kCmdTypeUint | kCmdArgFlagged), "Threads", kArgThreads },
+};
+
+using ClockT = std::chrono::steady_clock;
+
+// The biggest still fits in the 20 index buffers SortVisibleSpans allows
+static const uint32_t kTriCounts[] = { 4000, 16000, 64000, 128000 };
+
+// Same chunking as plDrawableSpans::SortVisibleSpans
+static const uint32_t kTriCutoff = 4000;
+
+static const hsPoint3 kViewPos(10.f, -5.f, 2.f);
+
+// A drawable filled in by hand with an alpha heavy view: lots of small and
+// medium spans (foliage cards, particles, glass) scattered around the
+// camera, with a few big ones. The indices are only ever sorted, never
+// drawn, so each span just numbers its own tris' corners from zero.
+class plBenchDrawable : public plDrawableSpans
+{
+public:
+    plBenchDrawable(uint32_t numTris, std::mt19937& rng)
+    {
+        std::uniform_real_distribution<float> pos(-200.f, 200.f);
+        std::uniform_real_distribution<float> jitter(-2.f, 2.f);
+        std::uniform_int_distribution<uint32_t> spanSize(6, 600);
+
+        plGBufferGroup* group = new plGBufferGroup(0, false, false);
+        fGroups.push_back(group);
+
+        uint32_t totTris = 0;
+        while (totTris < numTris) {
+            uint32_t size = std::min<uint32_t>((rng() % 16) ? spanSize(rng) : 3000, numTris - totTris);
+            float cx = pos(rng), cy = pos(rng), cz = pos(rng) * 0.1f;
+
+            plIcicle& span = fIcicles.emplace_back();
+            uint16_t* data;
+            group->ReserveIndexStorage(size * 3, &span.fIBufferIdx, &span.fIStartIdx, &data);
+            span.fGroupIdx = 0;
+            span.fILength = size * 3;
+            span.fProps |= plSpan::kPropFacesSortable;
+            span.fWorldToLocal.Reset();
+            span.fSortData = new plGBufferTriangle[size];
+
+            for (uint32_t i = 0; i < size; i++) {
+                plGBufferTriangle& tri = span.fSortData[i];
+                tri.fSpanIndex = uint16_t(fIcicles.size() - 1);
+                tri.fIndex1 = data[3 * i] = uint16_t(3 * i);
+                tri.fIndex2 = data[3 * i + 1] = uint16_t(3 * i + 1);
+                tri.fIndex3 = data[3 * i + 2] = uint16_t(3 * i + 2);
+                tri.fCenter.Set(cx + jitter(rng), cy + jitter(rng), cz + jitter(rng));
+            }
+            totTris += size;
+        }
+
+        for (plIcicle& span : fIcicles) {
+            fVisList.push_back(int16_t(fSpans.size()));
+            fSpans.push_back(&span);
+        }
+    }
+
+    const std::vector<int16_t>& GetVisList() const { return fVisList; }
+
+    static float Distance(const plGBufferTriangle& tri)
+    {
+        hsVector3 del(&kViewPos, &tri.fCenter);
+        return -del.MagnitudeSquared();
+    }
+
+    // The old way: a linked list of elements per chunk, sorted by walking
+    // pointers. Leaves the distances in the order each span's tris went out.
+    void ListSort(std::vector<std::vector<float>>& out)
+    {
+        out.assign(fIcicles.size(), {});
+        std::vector<hsRadixSort::Elem> elems;
+        for (size_t first = 0; first < fIcicles.size(); ) {
+            elems.clear();
+            size_t last = first;
+            for (; last < fIcicles.size() && elems.size() < kTriCutoff; last++) {
+                const plIcicle& span = fIcicles[last];
+                for (uint32_t j = 0; j < span.fILength / 3; j++) {
+                    hsRadixSort::Elem& elem = elems.emplace_back();
+                    elem.fKey.fFloat = Distance(span.fSortData[j]);
+                    elem.fBody = &span.fSortData[j];
+                }
+            }
+            for (size_t i = 0; i + 1 < elems.size(); i++)
+                elems[i].fNext = &elems[i + 1];
+            elems.back().fNext = nullptr;
+
+            hsRadixSort rad;
+            for (hsRadixSort::Elem* sorted = rad.Sort(elems.data(), 0); sorted; sorted = sorted->fNext) {
+                const plGBufferTriangle* tri = (const plGBufferTriangle*)sorted->fBody;
+                out[tri->fSpanIndex].push_back(Distance(*tri));
+            }
+            first = last;
+        }
+    }
+
+    // What SortVisibleSpans left in the index buffers, as distances
+    void ReadSorted(std::vector<std::vector<float>>& out)
+    {
+        out.assign(fIcicles.size(), {});
+        for (size_t i = 0; i < fIcicles.size(); i++) {
+            const plIcicle& span = fIcicles[i];
+            const uint16_t* data = fGroups[0]->GetIndexBufferData(span.fIBufferIdx) + span.fIStartIdx;
+            for (uint32_t j = 0; j < span.fILength / 3; j++)
+                out[i].push_back(Distance(span.fSortData[data[3 * j] / 3]));
+        }
+    }
+
+protected:
+    std::vector<int16_t>    fVisList;
+};
+
+template <typename Op>
+static double ITime(int32_t count, Op op)
+{
+    auto elapsed = ClockT::duration::zero();
+    for (int32_t i = 0; i < count; ++i) {
+        auto begin = ClockT::now();
+        op();
+        elapsed += ClockT::now() - begin;
+    }
+    return std::chrono::duration<double, std::milli>(elapsed).count() / count;
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<ST::string> args;
+    for (int i = 0; i < argc; ++i)
+        args.emplace_back(argv[i]);
+
+    plCmdParser parser(s_cmdLineArgs, std::size(s_cmdLineArgs));
+    parser.Parse(args);
+
+    int32_t count = 20;
+    if (parser.IsSpecified(kArgCount))
+        count = parser.GetInt(kArgCount);
+    if (count <= 0) {
+        ST::printf(stderr, "Cannot iterate less than 1 time.\n");
+        return 1;
+    }
+
+    uint32_t numThreads = std::max(std::thread::hardware_concurrency(), 1U);
+    if (parser.IsSpecified(kArgThreads))
+        numThreads = std::max(parser.GetInt(kArgThreads), 1);
+
+    ST::printf("{} threads\n", numThreads);
+    ST::printf("{>8} {>8} {>12} {>12} {>12}\n\n", "Tris", "Spans", "List ms", "Array ms", "Array+MT ms");
+
+    std::mt19937 rng(0x464143);
+    bool allMatch = true;
+
+    for (uint32_t numTris : kTriCounts) {
+        plBenchDrawable drawable(numTris, rng);
+        const std::vector<int16_t>& visList = drawable.GetVisList();
+
+        std::vector<std::vector<float>> listOut, arrayOut, mtOut;
+        double listMs = ITime(count, [&]() { drawable.ListSort(listOut); });
+
+        // The real thing, on the calling thread and then split up
+        plDrawableSpans::SetFaceSortThreads(1);
+        double arrayMs = ITime(count, [&]() { drawable.SortVisibleSpans(visList, kViewPos); });
+        drawable.ReadSorted(arrayOut);
+
+        plDrawableSpans::SetFaceSortThreads(numThreads);
+        double mtMs = ITime(count, [&]() { drawable.SortVisibleSpans(visList, kViewPos); });
+        drawable.ReadSorted(mtOut);
+
+        // Tris at the same distance may come out in a different order, so
+        // compare the distances rather than which tri went where
+        bool match = listOut == arrayOut && listOut == mtOut;
+        allMatch &= match;
+
+        ST::printf("{>8} {>8} {>12.3f} {>12.3f} {>12.3f} {}\n", numTris, visList.size(),
+                   listMs, arrayMs, mtMs, match ? "" : "MISMATCH");
+    }
+    plDrawableSpans::SetFaceSortThreads(0);
+
+    if (!allMatch) {
+        ST::printf(stderr, "The array sort did not match the list sort!\n");
+        return 1;
+    }
+
+    ST::printf("Have a nice day!\n");
+    return 0;
+}
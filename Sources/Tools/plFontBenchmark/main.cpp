@@ -0,0 +1,281 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <string_theory/stdio>
+#include <vector>
+
+#include "HeadSpin.h"
+#include "hsCpuID.h"
+#include "hsStream.h"
+#include "plCmdParser.h"
+#include "plFileSystem.h"
+
+#include "plGImage/plFont.h"
+#include "plGImage/plFontKernels.h"
+#include "plGImage/plMipmap.h"
+
+enum CmdLineArgs
+{
+    kArgCount,
+    kArgFont,
+};
+
+static const plCmdArgDef s_cmdLineArgs[] = {
+    { (kCmdTypeUint | kCmdArgFlagged), "Count", kArgCount },
+    { (kCmdTypeString | kCmdArgFlagged), "Font", kArgFont },
+};
+
+using ClockT = std::chrono::steady_clock;
+
+// Journal pages are 512x512 with a margin; see pfJournalBook
+static const uint32_t kPageSize = 512;
+static const int16_t kPageMargin = 40;
+
+static const wchar_t kPageText[] =
+    L"I have been here for some time now, and still the cavern surprises me. "
+    L"The water is warmer than it should be this deep, and the light... the light "
+    L"comes from nowhere I can find. Gehn would say that is simply how it was written, "
+    L"but I am no longer sure that anything here was written at all.\n\n"
+    L"Day seventeen. The bridge to the northern island is finished; the rope held, "
+    L"though the planks are swollen. I crossed twice, once with the lantern and once "
+    L"without, and counted forty-one steps each way. The far side has the same markings "
+    L"as the tower: three circles, a line, a circle again. A number, perhaps, or a name.\n\n"
+    L"Day nineteen. Rain, if it can be called that - more of a mist that falls upward "
+    L"from the pools. Spent the day copying the markings and trying the sequence on the "
+    L"door. Nothing. Either I have the order wrong or the door is simply a wall that "
+    L"looks like a door; I would not put it past whoever built this place.\n\n"
+    L"Day twenty. It was the order. Right to left, not left to right, as it always "
+    L"seems to be here. The room beyond is dry, round and nearly empty: a desk, a chair, "
+    L"and a book on the desk with its pages cut out. Only the first page is left, and "
+    L"it says, in a careful hand, \"Do not stay.\" I think I will stay a little longer.";
+
+// A synthetic 8-bit font with roughly the proportions of the journal fonts,
+// for when no real .p2f is given. Built through ReadRaw() so we only rely on
+// the public interface.
+static bool IMakeFont(plFont& font)
+{
+    const uint16_t firstChar = 32, numChars = 96;
+    const uint32_t width = 16, charHeight = 18, baseline = 14;
+
+    hsRAMStream stream;
+    char face[256] = "Benchmark";
+    stream.Write(sizeof(face), face);
+    stream.WriteByte((uint8_t)12);
+    stream.WriteLE32((uint32_t)0);
+    stream.WriteLE32(width);
+    stream.WriteLE32(charHeight * numChars);
+    stream.WriteLE32(charHeight);
+    stream.WriteByte((uint8_t)8);
+
+    // Soft-edged blobs, different for each character; space stays empty
+    std::vector<uint8_t> bitmap(width * charHeight * numChars);
+    for (uint16_t ch = 1; ch < numChars; ch++) {
+        uint8_t* glyph = bitmap.data() + ch * width * charHeight;
+        uint32_t glyphWidth = 5 + ch % 7, seed = ch * 2654435761U;
+        for (uint32_t y = 3; y < charHeight - 1; y++) {
+            for (uint32_t x = 1; x < glyphWidth + 1; x++) {
+                seed = seed * 1664525U + 1013904223U;
+                uint32_t edge = (x == 1 || x == glyphWidth || y == 3 || y == charHeight - 2);
+                uint32_t on = (seed >> 28) > 5;
+                glyph[y * width + x] = on ? (edge ? (uint8_t)(seed >> 16) : 255) : 0;
+            }
+        }
+    }
+    stream.Write((uint32_t)bitmap.size(), bitmap.data());
+
+    stream.WriteLE16(firstChar);
+    stream.WriteLE32((uint32_t)numChars);
+    for (uint16_t ch = 0; ch < numChars; ch++) {
+        stream.WriteLE32((uint32_t)(ch * width * charHeight));
+        stream.WriteLE32(charHeight);
+        stream.WriteLE32(baseline);
+        stream.WriteLEFloat(0.f);
+        stream.WriteLEFloat(-(float)(width - (ch == 0 ? 5 : 7 + ch % 7)));
+    }
+
+    stream.Rewind();
+    return font.ReadRaw(&stream);
+}
+
+// Forces the plain blitters, which is what the font renderer did before
+// plFontKernels
+class plScalarKernels
+{
+    plFontKernels::blend_row_ptr fBlend;
+    plFontKernels::alpha_row_ptr fAlpha;
+    plFontKernels::premultiplied_row_ptr fPremultiplied;
+
+public:
+    plScalarKernels()
+        : fBlend(plFontKernels::blend_row.call),
+          fAlpha(plFontKernels::alpha_row.call),
+          fPremultiplied(plFontKernels::premultiplied_row.call)
+    {
+        plFontKernels::blend_row.call = &plFontKernels::blend_row_fpu;
+        plFontKernels::alpha_row.call = &plFontKernels::alpha_row_fpu;
+        plFontKernels::premultiplied_row.call = &plFontKernels::premultiplied_row_fpu;
+    }
+
+    ~plScalarKernels()
+    {
+        plFontKernels::blend_row.call = fBlend;
+        plFontKernels::alpha_row.call = fAlpha;
+        plFontKernels::premultiplied_row.call = fPremultiplied;
+    }
+};
+
+struct RenderMode
+{
+    const char* fName;
+    uint32_t    fFlags;
+    uint32_t    fColor;
+};
+
+// Measures the page and then draws it, the way plDynamicTextMap's
+// CalcWrappingInfo() and DrawWrappedString() do for a journal page. Returns
+// the average time in microseconds and leaves the last page in mip.
+static double ITimePage(plFont& font, plMipmap& mip, int32_t count, bool cached)
+{
+    const int16_t wrapSize = kPageSize - 2 * kPageMargin;
+
+    auto elapsed = ClockT::duration::zero();
+    for (int32_t i = 0; i < count; ++i) {
+        memset(mip.GetImage(), 0, mip.GetHeight() * mip.GetRowBytes());
+        if (!cached)
+            font.ClearLayoutCache();
+
+        auto begin = ClockT::now();
+        uint16_t width, height, ascent, lastX, lastY;
+        uint32_t firstClipped;
+        font.SetRenderWrapping(0, 0, wrapSize, wrapSize);
+        font.CalcStringExtents(kPageText, width, height, ascent, firstClipped, lastX, lastY);
+        font.SetRenderWrapping(kPageMargin, kPageMargin, wrapSize, wrapSize);
+        font.RenderString(&mip, kPageMargin, kPageMargin, kPageText);
+        elapsed += ClockT::now() - begin;
+    }
+    return std::chrono::duration<double, std::micro>(elapsed).count() / count;
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<ST::string> args;
+    for (int i = 0; i < argc; ++i)
+        args.emplace_back(argv[i]);
+
+    plCmdParser parser(s_cmdLineArgs, std::size(s_cmdLineArgs));
+    parser.Parse(args);
+
+    int32_t count = 200;
+    if (parser.IsSpecified(kArgCount))
+        count = parser.GetInt(kArgCount);
+    if (count <= 0) {
+        ST::printf(stderr, "Cannot iterate less than 1 time.\n");
+        return 1;
+    }
+
+    plFont font;
+    if (parser.IsSpecified(kArgFont)) {
+        plFileName path = parser.GetString(kArgFont);
+        if (!font.LoadFromP2FFile(path)) {
+            ST::printf(stderr, "Could not load font {}\n", path.AsString());
+            return 1;
+        }
+    } else
+        IMakeFont(font);
+
+    if (font.GetBitmapBPP() != 8) {
+        ST::printf(stderr, "Only 8-bit fonts use the glyph blitters.\n");
+        return 1;
+    }
+
+    static const RenderMode kModes[] = {
+        { "Blend",          0,                                                                  0xff2a1a0e },
+        { "Blend 50%",      0,                                                                  0x802a1a0e },
+        { "Into alpha",     plFont::kRenderIntoAlpha,                                           0xff2a1a0e },
+        { "Premultiplied",  plFont::kRenderIntoAlpha | plFont::kRenderAlphaPremultiplied,       0xff2a1a0e },
+        { "Shadowed",       plFont::kRenderIntoAlpha | plFont::kRenderAlphaPremultiplied |
+                            plFont::kRenderShadow,                                              0xffe0d0b0 },
+    };
+    const uint32_t kModeFlags = plFont::kRenderIntoAlpha | plFont::kRenderAlphaPremultiplied | plFont::kRenderShadow;
+
+    const hsCpuId& cpu = hsCpuId::Instance();
+    ST::printf("CPU: SSE2 {}; font {} {}pt, {} chars\n", cpu.has_sse2 ? "yes" : "no",
+               font.GetFace(), (int)font.GetSize(), font.GetNumChars());
+    ST::printf("{<16} {>14} {>14} {>8}\n\n", "Mode", "Uncached", "Cached", "Speedup");
+
+    plMipmap scalarPage(kPageSize, kPageSize, plMipmap::kARGB32Config, 1);
+    plMipmap fastPage(kPageSize, kPageSize, plMipmap::kARGB32Config, 1);
+    bool allMatch = true;
+
+    font.SetRenderYJustify(plFont::kRenderJustYTop);
+    font.SetRenderXJustify(plFont::kRenderJustXForceLeft);
+    for (const RenderMode& mode : kModes) {
+        for (uint32_t flag = 1; flag <= kModeFlags; flag <<= 1) {
+            if (kModeFlags & flag)
+                font.SetRenderFlag(flag, (mode.fFlags & flag) != 0);
+        }
+        font.SetRenderColor(mode.fColor);
+
+        double scalarUs;
+        {
+            plScalarKernels scalar;
+            scalarUs = ITimePage(font, scalarPage, count, false);
+        }
+        double fastUs = ITimePage(font, fastPage, count, true);
+
+        bool match = memcmp(scalarPage.GetImage(), fastPage.GetImage(), kPageSize * scalarPage.GetRowBytes()) == 0;
+        allMatch &= match;
+        ST::printf("{<16} {>11.1f} us {>11.1f} us {>7.2f}x  {}\n", mode.fName, scalarUs, fastUs,
+                   fastUs > 0. ? scalarUs / fastUs : 0., match ? "exact" : "MISMATCH");
+    }
+
+    if (!allMatch) {
+        ST::printf(stderr, "The cached/SIMD page did not match the uncached/scalar one!\n");
+        return 1;
+    }
+
+    ST::printf("\nHave a nice day!\n");
+    return 0;
+}
@@ -42,25 +42,82 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 #include <chrono>
 #include <string_theory/stdio>
+#include <vector>
 
 #include "plCmdParser.h"
 #include "plFileSystem.h"
 
+#include "pfLocalizationMgr/pfLocalizationDataMgr.h"
 #include "pfLocalizationMgr/pfLocalizationMgr.h"
 
 enum CmdLineArgs
 {
     kArgCount,
+    kArgLookups,
     kArgDirectory,
 };
 
 static const plCmdArgDef s_cmdLineArgs[] = {
     { (kCmdTypeUint | kCmdArgFlagged), "Count", kArgCount },
+    { (kCmdTypeUint | kCmdArgFlagged), "Lookups", kArgLookups },
     { (kCmdTypeString | kCmdArgOptional), "Directory", kArgDirectory },
 };
 
 using ClockT = std::chrono::steady_clock;
 
+static ClockT::duration TimeLoads(const plFileName& locDir, int32_t count, bool useCache)
+{
+    pfLocalizationDataMgr::SetUseCache(useCache);
+
+    auto elapsed = ClockT::duration::zero();
+    for (int32_t i = 0; i < count; ++i) {
+        ST::printf("\r... Running iteration {} of {}", i + 1, count);
+        auto begin = ClockT::now();
+        pfLocalizationMgr::Initialize(locDir);
+        auto end = ClockT::now();
+        elapsed += end - begin;
+
+        // Who cares how long this takes...
+        pfLocalizationMgr::Shutdown();
+    }
+    ST::printf("\n");
+    return elapsed;
+}
+
+static void PrintLoadResults(const char* label, ClockT::duration elapsed, int32_t count)
+{
+    auto total_us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed);
+    auto avg_us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed / count);
+    auto total_sec = std::chrono::duration_cast<std::chrono::duration<double>>(elapsed);
+    auto avg_sec = std::chrono::duration_cast<std::chrono::duration<double>>(elapsed / count);
+
+    ST::printf("{}:\n", label);
+    ST::printf("  Total: {.4f} seconds ({} us)\n", total_sec.count(), total_us.count());
+    ST::printf("  Average: {.4f} seconds ({} us)\n", avg_sec.count(), avg_us.count());
+}
+
+// Every element path along with every translation's XML, so the XML and
+// cached loads can be compared
+static std::vector<ST::string> DumpDatabase(std::vector<ST::string>& paths)
+{
+    pfLocalizationDataMgr& mgr = pfLocalizationDataMgr::Instance();
+    std::vector<ST::string> dump;
+    paths.clear();
+    for (const ST::string& age : mgr.GetAgeList()) {
+        for (const ST::string& set : mgr.GetSetList(age)) {
+            for (const ST::string& element : mgr.GetElementList(age, set)) {
+                ST::string path = ST::format("{}.{}.{}", age, set, element);
+                paths.push_back(path);
+                for (const ST::string& language : mgr.GetLanguages(age, set, element)) {
+                    dump.push_back(ST::format("{}:{}={}", path, language,
+                                              mgr.GetElementXMLData(path, language)));
+                }
+            }
+        }
+    }
+    return dump;
+}
+
 int main(int argc, char* argv[])
 {
     std::vector<ST::string> args;
@@ -89,30 +146,46 @@ int main(int argc, char* argv[])
         return 1;
     }
 
+    int32_t lookups = 1000000;
+    if (parser.IsSpecified(kArgLookups))
+        lookups = parser.GetInt(kArgLookups);
+
     ST::printf("Parsing the localization database from '{}'...\n", locDir);
+    auto xmlElapsed = TimeLoads(locDir, count, false);
 
-    auto elapsed = ClockT::duration::zero();
-    for (int32_t i = 0; i < count; ++i) {
-        ST::printf("\r... Running iteration {} of {}", i + 1, count);
-        auto begin = ClockT::now();
-        pfLocalizationMgr::Initialize(locDir);
-        auto end = ClockT::now();
-        elapsed += end - begin;
+    // Load the XML once more to write out the cache, then time loading from it
+    pfLocalizationDataMgr::SetUseCache(true);
+    pfLocalizationMgr::Initialize(locDir);
+    std::vector<ST::string> paths;
+    std::vector<ST::string> xmlDump = DumpDatabase(paths);
+    pfLocalizationMgr::Shutdown();
 
-        // Who cares how long this takes...
-        pfLocalizationMgr::Shutdown();
-    }
+    ST::printf("Loading the localization database from the cache...\n");
+    auto cacheElapsed = TimeLoads(locDir, count, true);
 
-    ST::printf("\n... Done!\n\n");
+    pfLocalizationMgr::Initialize(locDir);
+    std::vector<ST::string> cacheDump = DumpDatabase(paths);
 
-    auto total_us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed);
-    auto avg_us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed / count);
-    auto total_sec = std::chrono::duration_cast<std::chrono::duration<double>>(elapsed);
-    auto avg_sec = std::chrono::duration_cast<std::chrono::duration<double>>(elapsed / count);
+    ST::printf("... Done!\n\n");
 
     ST::printf("Results:\n");
-    ST::printf("Total: {.4f} seconds ({} us)\n", total_sec.count(), total_us.count());
-    ST::printf("Average: {.4f} seconds ({} us)\n", avg_sec.count(), avg_us.count());
+    PrintLoadResults("XML", xmlElapsed, count);
+    PrintLoadResults("Cache", cacheElapsed, count);
+    ST::printf("Cached data: {} ({} elements, {} translations)\n",
+               (xmlDump == cacheDump) ? "exact" : "MISMATCH", paths.size(), cacheDump.size());
+
+    if (!paths.empty() && lookups > 0) {
+        size_t totalSize = 0;
+        auto begin = ClockT::now();
+        for (int32_t i = 0; i < lookups; ++i)
+            totalSize += pfLocalizationMgr::Instance().GetString(paths[i % paths.size()]).size();
+        auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(ClockT::now() - begin);
+
+        ST::printf("Lookups: {} in {.4f} seconds ({.0f} lookups/sec, {} chars)\n",
+                   lookups, elapsed.count(), lookups / elapsed.count(), totalSize);
+    }
+    pfLocalizationMgr::Shutdown();
+
     ST::printf("Have a nice day!\n");
     return 0;
 }
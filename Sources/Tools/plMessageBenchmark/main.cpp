@@ -0,0 +1,211 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string_theory/stdio>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "HeadSpin.h"
+#include "plCmdParser.h"
+
+#include "pnMessage/plMessagePool.h"
+#include "pnMessage/plNotifyMsg.h"
+#include "pnMessage/plRefMsg.h"
+#include "pnMessage/plTimeMsg.h"
+
+enum CmdLineArgs
+{
+    kArgCount,
+};
+
+static const plCmdArgDef s_cmdLineArgs[] = {
+    { (kCmdTypeUint | kCmdArgFlagged), "Count", kArgCount },
+};
+
+using ClockT = std::chrono::steady_clock;
+
+// Roughly what a busy age sends in a frame: mostly evals and transforms,
+// with refs and notifies mixed in
+static const uint32_t kMsgsPerFrame = 4000;
+static const uint32_t kNumFrames = 120;
+
+static plMessage* IMakeMsg(uint32_t i)
+{
+    double secs = i * 0.001;
+    float delSecs = 0.016f;
+    switch (i % 8) {
+    case 0:
+        return new plTimeMsg(nullptr, nullptr, &secs, &delSecs);
+    case 1:
+    case 2:
+    case 3:
+        return new plEvalMsg(nullptr, nullptr, &secs, &delSecs);
+    case 4:
+    case 5:
+        return new plTransformMsg(nullptr, nullptr, &secs, &delSecs);
+    case 6:
+        return new plGenRefMsg(nullptr, plRefMsg::kOnCreate, int32_t(i), 0);
+    default:
+        return new plNotifyMsg(nullptr, nullptr);
+    }
+}
+
+static void IMakeFrame(std::vector<plMessage*>& msgs)
+{
+    msgs.clear();
+    for (uint32_t i = 0; i < kMsgsPerFrame; i++)
+        msgs.push_back(IMakeMsg(i));
+}
+
+static void IFreeFrame(std::vector<plMessage*>& msgs)
+{
+    for (plMessage* msg : msgs)
+        hsRefCnt_SafeUnRef(msg);
+}
+
+// Everything made and freed on one thread, the way the dispatcher's own
+// messages go. Also counts how many messages landed where one from the
+// frame before had been.
+static double IRunLocal(int32_t count, double& reused)
+{
+    std::vector<plMessage*> msgs;
+    std::unordered_set<void*> lastFrame;
+    size_t numReused = 0;
+
+    auto elapsed = ClockT::duration::zero();
+    for (int32_t c = 0; c < count; c++) {
+        for (uint32_t f = 0; f < kNumFrames; f++) {
+            auto begin = ClockT::now();
+            IMakeFrame(msgs);
+            elapsed += ClockT::now() - begin;
+
+            for (plMessage* msg : msgs)
+                numReused += lastFrame.count(msg);
+            lastFrame.clear();
+            lastFrame.insert(msgs.begin(), msgs.end());
+
+            begin = ClockT::now();
+            IFreeFrame(msgs);
+            elapsed += ClockT::now() - begin;
+        }
+        lastFrame.clear();
+    }
+
+    reused = 100. * numReused / (double(count) * kNumFrames * kMsgsPerFrame);
+    return std::chrono::duration<double, std::milli>(elapsed).count() / (count * kNumFrames);
+}
+
+// Messages made on another thread, like the net or audio threads queueing
+// them up, and freed on the main thread after they've been delivered
+static double IRunProducer(int32_t count)
+{
+    std::mutex lock;
+    std::condition_variable ready;
+    std::deque<std::vector<plMessage*>> frames;
+    uint32_t numFrames = uint32_t(count) * kNumFrames;
+
+    auto begin = ClockT::now();
+    std::thread producer([&]() {
+        std::vector<plMessage*> msgs;
+        for (uint32_t f = 0; f < numFrames; f++) {
+            IMakeFrame(msgs);
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                frames.emplace_back(std::move(msgs));
+            }
+            ready.notify_one();
+        }
+    });
+
+    for (uint32_t f = 0; f < numFrames; f++) {
+        std::vector<plMessage*> msgs;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            ready.wait(guard, [&]() { return !frames.empty(); });
+            msgs = std::move(frames.front());
+            frames.pop_front();
+        }
+        IFreeFrame(msgs);
+    }
+    producer.join();
+
+    return std::chrono::duration<double, std::milli>(ClockT::now() - begin).count() / numFrames;
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<ST::string> args;
+    for (int i = 0; i < argc; ++i)
+        args.emplace_back(argv[i]);
+
+    plCmdParser parser(s_cmdLineArgs, std::size(s_cmdLineArgs));
+    parser.Parse(args);
+
+    int32_t count = 5;
+    if (parser.IsSpecified(kArgCount))
+        count = parser.GetInt(kArgCount);
+    if (count <= 0) {
+        ST::printf(stderr, "Cannot iterate less than 1 time.\n");
+        return 1;
+    }
+
+    ST::printf("{} messages a frame, {} frames\n\n", kMsgsPerFrame, kNumFrames);
+    ST::printf("{>10} {>12} {>10} {>14}\n\n", "Pooling", "Local ms", "Reused %", "Producer ms");
+
+    for (bool pooling : { false, true }) {
+        plMessagePool::SetPooling(pooling);
+
+        double reused = 0.;
+        double localMs = IRunLocal(count, reused);
+        double producerMs = IRunProducer(count);
+
+        ST::printf("{>10} {>12.4f} {>10.1f} {>14.4f}\n", pooling ? "on" : "off", localMs, reused, producerMs);
+    }
+
+    plMessagePool::SetPooling(true);
+    return 0;
+}
@@ -0,0 +1,223 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <random>
+#include <string_theory/stdio>
+#include <vector>
+
+#include "HeadSpin.h"
+#include "hsCpuID.h"
+#include "plCmdParser.h"
+
+#include "plGImage/plMipmapKernels.h"
+
+enum CmdLineArgs
+{
+    kArgCount,
+};
+
+static const plCmdArgDef s_cmdLineArgs[] = {
+    { (kCmdTypeUint | kCmdArgFlagged), "Count", kArgCount },
+};
+
+using ClockT = std::chrono::steady_clock;
+
+static const uint32_t kSizes[] = { 64, 256, 512, 1024, 2048 };
+
+// Same shape as the default mip filter in plMipmap (sigma 1)
+static void IMakeMask(std::vector<float>& mask, int ext, float sig)
+{
+    float ooSigSq = 1.f / (sig * sig);
+    mask.clear();
+    for (int i = -ext; i <= ext; i++) {
+        for (int j = -ext; j <= ext; j++)
+            mask.push_back(expf(-(i * i + j * j) * ooSigSq));
+    }
+}
+
+struct Image
+{
+    uint32_t fSize;
+    std::vector<uint32_t> fPixels;
+
+    Image(uint32_t size) : fSize(size), fPixels(size * size) { }
+    uint8_t* Bytes() { return reinterpret_cast<uint8_t*>(fPixels.data()); }
+    const uint8_t* Bytes() const { return reinterpret_cast<const uint8_t*>(fPixels.data()); }
+};
+
+// Noise with a mix of transparent, translucent and opaque pixels, so the
+// blend sees every case.
+static void IFillImage(Image& img, std::mt19937& rng)
+{
+    for (uint32_t& pixel : img.fPixels) {
+        pixel = rng();
+        switch (pixel & 3) {
+        case 0: pixel &= 0x00ffffff; break;
+        case 1: pixel |= 0xff000000; break;
+        }
+    }
+}
+
+// Runs op count times over a fresh copy of the input; returns the average
+// time in microseconds and leaves the last result in out.
+template <typename Op>
+static double ITime(int32_t count, const Image& in, Image& out, Op op)
+{
+    auto elapsed = ClockT::duration::zero();
+    for (int32_t i = 0; i < count; ++i) {
+        out.fPixels = in.fPixels;
+        auto begin = ClockT::now();
+        op(out);
+        elapsed += ClockT::now() - begin;
+    }
+    return std::chrono::duration<double, std::micro>(elapsed).count() / count;
+}
+
+template <typename Op>
+static bool IRun(const char* name, int32_t count, const Image& in, Op scalarOp, Op simdOp)
+{
+    Image scalarOut(in.fSize), simdOut(in.fSize);
+    double scalarUs = ITime(count, in, scalarOut, scalarOp);
+    double simdUs = ITime(count, in, simdOut, simdOp);
+    bool match = scalarOut.fPixels == simdOut.fPixels;
+
+    ST::printf("{<20} {>5}x{<5} {>10.1f} us {>10.1f} us {>6.2f}x  {}\n",
+               name, in.fSize, in.fSize, scalarUs, simdUs,
+               simdUs > 0. ? scalarUs / simdUs : 0., match ? "exact" : "MISMATCH");
+    return match;
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<ST::string> args;
+    for (int i = 0; i < argc; ++i)
+        args.emplace_back(argv[i]);
+
+    plCmdParser parser(s_cmdLineArgs, std::size(s_cmdLineArgs));
+    parser.Parse(args);
+
+    int32_t count = 20;
+    if (parser.IsSpecified(kArgCount))
+        count = parser.GetInt(kArgCount);
+    if (count <= 0) {
+        ST::printf(stderr, "Cannot iterate less than 1 time.\n");
+        return 1;
+    }
+
+    const hsCpuId& cpu = hsCpuId::Instance();
+    ST::printf("CPU: SSE2 {}, AVX2 {}\n", cpu.has_sse2 ? "yes" : "no", cpu.has_avx2 ? "yes" : "no");
+    ST::printf("{<20} {>11} {>13} {>13} {>7}\n\n", "Kernel", "Size", "Scalar", "Dispatched", "Speedup");
+
+    std::mt19937 rng(0x504c4d4d);
+    std::vector<float> mask;
+    IMakeMask(mask, 2, 1.f);
+
+    const float noTint[3] = { 1.f, 1.f, 1.f };
+    const float tint[3] = { 0.9f, 0.5f, 0.25f };
+
+    using K = plMipmapKernels;
+    using ImageOp = std::function<void(Image&)>;
+
+    bool allMatch = true;
+    for (uint32_t size : kSizes) {
+        Image src(size), dst(size);
+        IFillImage(src, rng);
+        IFillImage(dst, rng);
+
+        auto blend = [&](K::blend_row_ptr row, const float* rgb) -> ImageOp {
+            return [&, row, rgb](Image& img) {
+                for (uint32_t y = 0; y < size; y++)
+                    row(&img.fPixels[y * size], &src.fPixels[y * size], size, 200, rgb, false);
+            };
+        };
+        allMatch &= IRun("Composite", count, dst, blend(&K::blend_row_fpu, noTint), blend(K::blend_row.call, noTint));
+        allMatch &= IRun("Composite (tinted)", count, dst, blend(&K::blend_row_fpu, tint), blend(K::blend_row.call, tint));
+
+        auto premultiply = [&](K::premultiply_row_ptr row) -> ImageOp {
+            return [&, row](Image& img) {
+                for (uint32_t y = 0; y < size; y++)
+                    row(&img.fPixels[y * size], size);
+            };
+        };
+        allMatch &= IRun("Premultiply", count, src, premultiply(&K::premultiply_row_fpu), premultiply(K::premultiply_row.call));
+
+        auto detail = [&](K::scale_row_ptr row) -> ImageOp {
+            return [&, row](Image& img) {
+                for (uint32_t y = 0; y < size; y++)
+                    row(img.Bytes() + y * size * 4, size, 0.6f, (1.f - 0.6f) * 255.f, 0xf);
+            };
+        };
+        allMatch &= IRun("Detail fade", count, src, detail(&K::scale_row_fpu), detail(K::scale_row.call));
+
+        // Builds the next mip level down into the top-left quarter of the output
+        auto mip = [&](K::filter_row_ptr row) -> ImageOp {
+            return [&, row](Image& img) {
+                K::FilterInfo info { mask.data(), 2, size * 4, size, size, size >> 1, 2 };
+                for (uint32_t y = 0; y < (size >> 1); y++)
+                    row(img.Bytes() + y * (size >> 1) * 4, src.Bytes(), info, y << 1);
+            };
+        };
+        allMatch &= IRun("Mip level", count, src, mip(&K::filter_row_fpu), mip(K::filter_row.call));
+
+        auto filter = [&](K::filter_row_ptr row) -> ImageOp {
+            return [&, row](Image& img) {
+                K::FilterInfo info { mask.data(), 2, size * 4, size, size, size, 1 };
+                for (uint32_t y = 0; y < size; y++)
+                    row(img.Bytes() + y * size * 4, src.Bytes(), info, y);
+            };
+        };
+        allMatch &= IRun("Filter", count, src, filter(&K::filter_row_fpu), filter(K::filter_row.call));
+
+        ST::printf("\n");
+    }
+
+    if (!allMatch) {
+        ST::printf(stderr, "The dispatched kernels did not match the scalar ones!\n");
+        return 1;
+    }
+
+    ST::printf("Have a nice day!\n");
+    return 0;
+}
@@ -0,0 +1,334 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include <chrono>
+#include <memory>
+#include <string_theory/stdio>
+#include <vector>
+#include <zlib.h>
+
+#include "HeadSpin.h"
+#include "hsBitVector.h"
+#include "hsStream.h"
+#include "plCmdParser.h"
+#include "plFileSystem.h"
+
+#include "plCompression/plLZ4Compress.h"
+#include "plCompression/plZlibCompress.h"
+#include "plNetMessage/plNetMessage.h"
+#include "plResMgr/plResManager.h"
+#include "plResMgr/plResMgrSettings.h"
+#include "plSDL/plSDL.h"
+
+enum CmdLineArgs
+{
+    kArgCount,
+    kArgRecording,
+};
+
+static const plCmdArgDef s_cmdLineArgs[] = {
+    { (kCmdTypeUint | kCmdArgFlagged), "Count", kArgCount },
+    { (kCmdTypeString | kCmdArgRequired), "Recording", kArgRecording },
+};
+
+using ClockT = std::chrono::steady_clock;
+
+// Same as plNetMsgStreamHelper, the creatable index is never compressed
+static constexpr int kStreamOffset = 2;
+
+//// Payloads ////////////////////////////////////////////////////////////////
+
+struct Payload
+{
+    std::vector<uint8_t> fData;
+    bool fIsSDL;
+};
+
+// Pulls the (uncompressed) stream out of every SDL and game message in a
+// plNetClientStreamRecorder recording.
+static bool ReadPayloads(const plFileName& path, std::vector<Payload>& payloads)
+{
+    hsUNIXStream stream;
+    if (!stream.Open(path, "rb"))
+        return false;
+
+    hsBitVector contentFlags;
+    contentFlags.Read(&stream);
+    if (contentFlags.IsBitSet(0))   // kNetClientRecSDLDesc
+        plSDLMgr::GetInstance()->Read(&stream);
+
+    stream.ReadLEDouble();
+    while (!stream.AtEnd())
+    {
+        plNetMessage* msg = plNetMessage::ConvertNoRef(hsgResMgr::ResMgr()->ReadCreatableVersion(&stream));
+        if (!msg)
+            return false;
+
+        const plNetMsgStreamHelper* helper = nullptr;
+        bool isSDL = false;
+        if (plNetMsgSDLState* sdlMsg = plNetMsgSDLState::ConvertNoRef(msg))
+        {
+            helper = sdlMsg->StreamInfo();
+            isSDL = true;
+        }
+        else if (plNetMsgGameMessage* gameMsg = plNetMsgGameMessage::ConvertNoRef(msg))
+            helper = gameMsg->StreamInfo();
+
+        if (helper)
+        {
+            // Streams are recorded however they arrived
+            plNetMsgStreamHelper uncompressed;
+            uncompressed.CopyFrom(helper);
+            if (uncompressed.Uncompress() && uncompressed.GetStreamLen() > kStreamOffset)
+            {
+                Payload& payload = payloads.emplace_back();
+                payload.fData.assign(uncompressed.GetStreamBuf(),
+                                     uncompressed.GetStreamBuf() + uncompressed.GetStreamLen());
+                payload.fIsSDL = isSDL;
+            }
+        }
+
+        hsRefCnt_SafeUnRef(msg);
+        stream.ReadLEDouble();
+    }
+
+    return true;
+}
+
+//// Codecs //////////////////////////////////////////////////////////////////
+
+struct CodecResult
+{
+    uint64_t fBytesIn;
+    uint64_t fBytesOut;
+    uint32_t fCompressed;
+    uint32_t fFailures;
+    ClockT::duration fCompressTime;
+    ClockT::duration fUncompressTime;
+
+    CodecResult()
+        : fBytesIn(), fBytesOut(), fCompressed(), fFailures(),
+          fCompressTime(ClockT::duration::zero()), fUncompressTime(ClockT::duration::zero())
+    { }
+};
+
+// What plNetMsgStreamHelper used to do: a fresh zlib state and a 1.1x output
+// buffer for every stream, plus the copy into the final buffer.
+class plOneShotZlibCompress : public plCompress
+{
+public:
+    bool Uncompress(uint8_t* bufOut, uint32_t* bufLenOut, const uint8_t* bufIn, uint32_t bufLenIn) override
+    {
+        uLongf len = *bufLenOut;
+        bool result = (uncompress(bufOut, &len, bufIn, bufLenIn) == Z_OK);
+        *bufLenOut = len;
+        return result;
+    }
+
+    bool Compress(uint8_t* bufOut, uint32_t* bufLenOut, const uint8_t* bufIn, uint32_t bufLenIn) override
+    {
+        uLongf len = *bufLenOut;
+        bool result = (compress(bufOut, &len, bufIn, bufLenIn) == Z_OK);
+        *bufLenOut = len;
+        return result;
+    }
+
+    bool Uncompress(uint8_t** bufIn, uint32_t* bufLenIn, uint32_t bufLenOut, int offset) override
+    {
+        auto bufOut = std::make_unique<uint8_t[]>(bufLenOut);
+        if (!Uncompress(bufOut.get(), &bufLenOut, *bufIn + offset, *bufLenIn - offset))
+            return false;
+        return ICopy(bufIn, bufLenIn, bufOut.get(), bufLenOut, offset);
+    }
+
+    bool Compress(uint8_t** bufIn, uint32_t* bufLenIn, int offset) override
+    {
+        uint32_t adjBufLenIn = *bufLenIn - offset;
+        uint32_t bufLenOut = (uint32_t)(adjBufLenIn * 1.1 + 12);
+        auto bufOut = std::make_unique<uint8_t[]>(bufLenOut);
+        if (!Compress(bufOut.get(), &bufLenOut, *bufIn + offset, adjBufLenIn) || bufLenOut >= adjBufLenIn)
+            return false;
+        return ICopy(bufIn, bufLenIn, bufOut.get(), bufLenOut, offset);
+    }
+
+private:
+    static bool ICopy(uint8_t** bufIn, uint32_t* bufLenIn, const uint8_t* bufOut, uint32_t bufLenOut, int offset)
+    {
+        uint8_t* newBuf = new uint8_t[bufLenOut + offset];
+        memcpy(newBuf, *bufIn, offset);
+        memcpy(newBuf + offset, bufOut, bufLenOut);
+        delete [] *bufIn;
+        *bufIn = newBuf;
+        *bufLenIn = bufLenOut + offset;
+        return true;
+    }
+};
+
+static void RunCodec(plCompress& codec, const std::vector<Payload>& payloads, uint32_t threshold, CodecResult& result)
+{
+    for (const Payload& payload : payloads)
+    {
+        uint32_t len = (uint32_t)payload.fData.size();
+        if (len <= threshold)
+            continue;
+
+        uint8_t* buf = new uint8_t[len];
+        memcpy(buf, payload.fData.data(), len);
+        uint32_t bufLen = len;
+
+        result.fBytesIn += len;
+
+        auto begin = ClockT::now();
+        bool compressed = codec.Compress(&buf, &bufLen, kStreamOffset);
+        result.fCompressTime += ClockT::now() - begin;
+
+        if (compressed)
+        {
+            result.fCompressed++;
+            result.fBytesOut += bufLen;
+
+            begin = ClockT::now();
+            bool ok = codec.Uncompress(&buf, &bufLen, len - kStreamOffset, kStreamOffset);
+            result.fUncompressTime += ClockT::now() - begin;
+
+            if (!ok || bufLen != len || memcmp(buf, payload.fData.data(), len) != 0)
+                result.fFailures++;
+        }
+        else
+        {
+            // sent as is
+            result.fBytesOut += len;
+        }
+
+        delete [] buf;
+    }
+}
+
+static double MBPerSec(uint64_t bytes, ClockT::duration time)
+{
+    double secs = std::chrono::duration_cast<std::chrono::duration<double>>(time).count();
+    return secs > 0.0 ? (bytes / (1024.0 * 1024.0)) / secs : 0.0;
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<ST::string> args;
+    for (int i = 0; i < argc; ++i)
+        args.emplace_back(argv[i]);
+
+    plCmdParser parser(s_cmdLineArgs, std::size(s_cmdLineArgs));
+    if (!parser.Parse(args)) {
+        ST::printf(stderr, "Usage: plNetCompressionBenchmark [--count n] recording.rec\n");
+        return 1;
+    }
+
+    plFileName recording = parser.GetString(kArgRecording);
+    if (!plFileInfo(recording).Exists()) {
+        ST::printf(stderr, "The recording '{}' does not exist.\n", recording);
+        return 1;
+    }
+
+    int32_t count = 100;
+    if (parser.IsSpecified(kArgCount))
+        count = parser.GetInt(kArgCount);
+    if (count <= 0) {
+        ST::printf(stderr, "Cannot iterate less than 1 time.\n");
+        return 1;
+    }
+
+    // The messages are only read, nothing they refer to has to be loaded
+    plResMgrSettings::Get().SetLoadPagesOnInit(false);
+    hsgResMgr::Init(new plResManager);
+
+    ST::printf("Reading message streams from '{}'...\n", recording);
+    std::vector<Payload> payloads;
+    bool readOk = ReadPayloads(recording, payloads);
+    hsgResMgr::Shutdown();
+
+    if (!readOk) {
+        ST::printf(stderr, "Failed to read the recording.\n");
+        return 1;
+    }
+
+    uint32_t numSDL = 0;
+    uint64_t totalBytes = 0;
+    for (const Payload& payload : payloads) {
+        numSDL += payload.fIsSDL ? 1 : 0;
+        totalBytes += payload.fData.size();
+    }
+    ST::printf("... {} streams ({} SDL, {} game messages), {} bytes\n\n",
+               payloads.size(), numSDL, payloads.size() - numSDL, totalBytes);
+
+    struct Codec
+    {
+        const char* fName;
+        std::unique_ptr<plCompress> fCodec;
+        uint32_t fThreshold;
+    };
+    std::vector<Codec> codecs;
+    codecs.push_back({ "zlib one-shot (old)", std::make_unique<plOneShotZlibCompress>(), plNetMsgStreamHelper::kDefaultCompressionThreshold });
+    codecs.push_back({ "zlib level 1", std::make_unique<plZlibCompress>(plZlibCompress::kFastestLevel), plNetMsgStreamHelper::kDefaultCompressionThreshold });
+    codecs.push_back({ "zlib default", std::make_unique<plZlibCompress>(), plNetMsgStreamHelper::kDefaultCompressionThreshold });
+    codecs.push_back({ "zlib level 9", std::make_unique<plZlibCompress>(plZlibCompress::kSmallestLevel), plNetMsgStreamHelper::kDefaultCompressionThreshold });
+    if (plLZ4Compress::IsAvailable())
+        codecs.push_back({ "lz4", std::make_unique<plLZ4Compress>(), plNetMsgStreamHelper::kDefaultCompressionThreshold });
+    else
+        ST::printf("Not built with LZ4, skipping it.\n\n");
+
+    ST::printf("{<20} {>8} {>12} {>12} {>7} {>12} {>12} {>6}\n",
+               "Codec", "Streams", "Bytes In", "Bytes Out", "Ratio", "Comp MB/s", "Decomp MB/s", "Fails");
+    for (Codec& codec : codecs) {
+        CodecResult result;
+        for (int32_t i = 0; i < count; ++i)
+            RunCodec(*codec.fCodec, payloads, codec.fThreshold, result);
+
+        ST::printf("{<20} {>8} {>12} {>12} {>7.3f} {>12.1f} {>12.1f} {>6}\n",
+                   codec.fName, result.fCompressed / count,
+                   result.fBytesIn / count, result.fBytesOut / count,
+                   result.fBytesIn ? double(result.fBytesOut) / result.fBytesIn : 1.0,
+                   MBPerSec(result.fBytesIn, result.fCompressTime),
+                   MBPerSec(result.fBytesIn, result.fUncompressTime),
+                   result.fFailures);
+    }
+
+    return 0;
+}
@@ -0,0 +1,209 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string_theory/stdio>
+
+#include "HeadSpin.h"
+#include "hsTimer.h"
+#include "plCmdParser.h"
+#include "plFileSystem.h"
+
+#include "pnFactory/plFactory.h"
+#include "pnKeyedObject/plFixedKey.h"
+
+#include "plNetClient/plNetClientMgr.h"
+#include "plNetClientRecorder/plNetClientRecorder.h"
+#include "plResMgr/plResManager.h"
+#include "plSDL/plSDL.h"
+
+// Every heap allocation made while the benchmark runs is counted, so the
+// report can show which messages are churning the allocator.
+static std::atomic<uint64_t> s_numAllocs;
+
+void* operator new(size_t size)
+{
+    ++s_numAllocs;
+    if (void* ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+static uint64_t GetNumAllocs()
+{
+    return s_numAllocs.load();
+}
+
+enum CmdLineArgs
+{
+    kArgRecording,
+    kArgRate,
+    kArgCount,
+    kArgData,
+    kArgSDL,
+};
+
+static const plCmdArgDef s_cmdLineArgs[] = {
+    { (kCmdTypeString | kCmdArgRequired), "Recording", kArgRecording },
+    { (kCmdTypeFloat | kCmdArgFlagged), "Rate", kArgRate },
+    { (kCmdTypeUint | kCmdArgFlagged), "Count", kArgCount },
+    { (kCmdTypeString | kCmdArgFlagged), "Data", kArgData },
+    { (kCmdTypeString | kCmdArgFlagged), "SDL", kArgSDL },
+};
+
+static void PrintHelp()
+{
+    ST::printf("plNetReplayBenchmark - Plays back a network recording and measures the cost\n");
+    ST::printf("of handling each kind of message.\n\n");
+    ST::printf("Usage: plNetReplayBenchmark [--rate n] [--count n] [--data dir] [--sdl dir] recording\n\n");
+    ST::printf("  recording  Name of a recording in the Recordings folder\n");
+    ST::printf("  --rate     Multiple of the recorded speed to play at (default 0, as fast as possible)\n");
+    ST::printf("  --count    Number of times to play the recording (default 1)\n");
+    ST::printf("  --data     Directory containing the age pages (default current directory)\n");
+    ST::printf("  --sdl      Directory containing the SDL descriptors (default SDL)\n");
+}
+
+static void PrintReport(const plNetClientReplayStats& stats, int32_t count)
+{
+    double totalSecs = hsTimer::GetSeconds<double>(stats.fTotalTicks);
+
+    ST::printf("Results:\n");
+    ST::printf("Messages: {} in {.4f} seconds", stats.fNumMsgs, totalSecs);
+    if (totalSecs > 0.0)
+        ST::printf(" ({.1f} msgs/sec)", stats.fNumMsgs / totalSecs);
+    ST::printf("\n\n");
+
+    ST::printf("{<32} {>8} {>10} {>10} {>10} {>10}\n", "Class", "Count", "Read ms", "Handle ms", "Disp ms", "Allocs/msg");
+    for (const auto& it : stats.fClasses)
+    {
+        const plNetClientReplayStats::ClassStats& classStats = it.second;
+        const char* className = plFactory::GetNameOfClass(it.first);
+        ST::printf("{<32} {>8} {>10.3f} {>10.3f} {>10.3f} {>10.1f}\n",
+                   className ? className : "<unknown>",
+                   classStats.fCount / count,
+                   hsTimer::GetMilliSeconds<double>(classStats.fReadTicks) / count,
+                   hsTimer::GetMilliSeconds<double>(classStats.fHandleTicks) / count,
+                   hsTimer::GetMilliSeconds<double>(classStats.fDispatchTicks) / count,
+                   double(classStats.fAllocs) / classStats.fCount);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<ST::string> args;
+    for (int i = 0; i < argc; ++i)
+        args.emplace_back(argv[i]);
+
+    plCmdParser parser(s_cmdLineArgs, std::size(s_cmdLineArgs));
+    if (!parser.Parse(args)) {
+        PrintHelp();
+        return 1;
+    }
+
+    ST::string recName = parser.GetString(kArgRecording);
+
+    double rate = 0.0;
+    if (parser.IsSpecified(kArgRate))
+        rate = parser.GetFloat(kArgRate);
+
+    int32_t count = 1;
+    if (parser.IsSpecified(kArgCount))
+        count = parser.GetInt(kArgCount);
+    if (count <= 0) {
+        ST::printf(stderr, "Cannot iterate less than 1 time.\n");
+        return 1;
+    }
+
+    // Game messages are read against the real age keys, so the pages have to
+    // be available, even though nothing is ever loaded
+    plResManager* resMgr = new plResManager;
+    if (parser.IsSpecified(kArgData))
+        resMgr->SetDataPath(parser.GetString(kArgData));
+    hsgResMgr::Init(resMgr);
+
+    plNetClientMgr::SetInstance(new plNetClientMgr);
+    plNetClientMgr* netClient = plNetClientMgr::GetInstance();
+    netClient->RegisterAs(kNetClientMgr_KEY);
+
+    // Recordings made without the SDL descriptors need them from disk
+    if (parser.IsSpecified(kArgSDL))
+        plSDLMgr::GetInstance()->SetSDLDir(parser.GetString(kArgSDL));
+    plSDLMgr::GetInstance()->SetNetApp(netClient);
+    plSDLMgr::GetInstance()->Init(plSDL::kDisallowTimeStamping);
+
+    ST::printf("Playing back '{}'...\n", recName);
+
+    plNetClientReplayStats stats;
+    stats.fAllocCountProc = GetNumAllocs;
+    int result = 0;
+    for (int32_t i = 0; i < count; ++i) {
+        ST::printf("\r... Running iteration {} of {}", i + 1, count);
+        if (!netClient->BenchmarkPlayback(recName.c_str(), rate, stats)) {
+            ST::printf(stderr, "\nUnable to play back the recording '{}'.\n", recName);
+            result = 1;
+            break;
+        }
+    }
+
+    if (result == 0) {
+        ST::printf("\n... Done!\n\n");
+        PrintReport(stats, count);
+    }
+
+    plSDLMgr::GetInstance()->DeInit();
+    netClient->UnRegisterAs(kNetClientMgr_KEY);
+    hsgResMgr::Shutdown();
+
+    return result;
+}
@@ -0,0 +1,397 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string_theory/stdio>
+#include <vector>
+
+#include "HeadSpin.h"
+#include "hsBounds.h"
+#include "hsGeometry3.h"
+#include "hsMatrix44.h"
+#include "plCmdParser.h"
+#include "plViewTransform.h"
+
+#include "plScene/plSoftOcclusion.h"
+
+enum CmdLineArgs
+{
+    kArgCount,
+    kArgPath,
+};
+
+static const plCmdArgDef s_cmdLineArgs[] = {
+    { (kCmdTypeUint | kCmdArgFlagged), "Count", kArgCount },
+    { (kCmdTypeString | kCmdArgFlagged), "Path", kArgPath },
+};
+
+using ClockT = std::chrono::steady_clock;
+
+// A city block grid, Z up. Buildings fill each block but the streets
+// around it, and all the props sit out in the streets.
+static const int kBlocks = 24;
+static const float kBlockSize = 40.f;
+static const float kStreetHalfWidth = 6.f;
+static const uint32_t kNumProps = 10000;
+static const uint32_t kNumFrames = 60;
+
+struct plBenchView
+{
+    hsPoint3    fPos;
+    hsVector3   fDir;
+};
+
+static void IBuildCity(std::vector<hsBounds3Ext>& buildings, std::vector<hsBounds3Ext>& props, std::mt19937& rng)
+{
+    std::uniform_real_distribution<float> height(10.f, 60.f);
+    for (int i = 0; i < kBlocks; i++) {
+        for (int j = 0; j < kBlocks; j++) {
+            hsPoint3 lo(i * kBlockSize + kStreetHalfWidth, j * kBlockSize + kStreetHalfWidth, 0.f);
+            hsPoint3 hi((i + 1) * kBlockSize - kStreetHalfWidth, (j + 1) * kBlockSize - kStreetHalfWidth, height(rng));
+            hsBounds3Ext bnd;
+            bnd.Reset(&lo);
+            bnd.Union(&hi);
+            buildings.push_back(bnd);
+        }
+    }
+
+    std::uniform_real_distribution<float> along(0.f, kBlocks * kBlockSize);
+    std::uniform_real_distribution<float> across(-kStreetHalfWidth + 1.5f, kStreetHalfWidth - 1.5f);
+    std::uniform_int_distribution<int> street(0, kBlocks);
+    std::uniform_real_distribution<float> size(0.25f, 1.f);
+    std::uniform_real_distribution<float> lift(0.f, 3.f);
+    for (uint32_t i = 0; i < kNumProps; i++) {
+        float x = along(rng), y = street(rng) * kBlockSize + across(rng);
+        if (rng() & 1)
+            std::swap(x, y);
+        float s = size(rng), z = lift(rng);
+
+        hsPoint3 lo(x - s, y - s, z), hi(x + s, y + s, z + 2.f * s);
+        hsBounds3Ext bnd;
+        bnd.Reset(&lo);
+        bnd.Union(&hi);
+        props.push_back(bnd);
+    }
+}
+
+// Walks down the middle street, looking around a bit
+static void IBuildPath(std::vector<plBenchView>& path)
+{
+    for (uint32_t i = 0; i < kNumFrames; i++) {
+        float t = float(i) / kNumFrames;
+        float heading = 0.8f * std::sin(t * 6.f);
+        plBenchView view;
+        view.fPos.Set(kBlocks / 2 * kBlockSize, 10.f + t * (kBlocks - 2) * kBlockSize, 1.7f);
+        view.fDir.Set(std::sin(heading), std::cos(heading), 0.f);
+        path.push_back(view);
+    }
+}
+
+// One "x y z dx dy dz" view per line
+static bool IReadPath(const ST::string& fileName, std::vector<plBenchView>& path)
+{
+    FILE* file = fopen(fileName.c_str(), "r");
+    if (!file)
+        return false;
+
+    plBenchView view;
+    while (fscanf(file, "%f %f %f %f %f %f", &view.fPos.fX, &view.fPos.fY, &view.fPos.fZ,
+                  &view.fDir.fX, &view.fDir.fY, &view.fDir.fZ) == 6)
+        path.push_back(view);
+    fclose(file);
+    return !path.empty();
+}
+
+static void ISetView(plViewTransform& vt, const plBenchView& view)
+{
+    hsPoint3 at = view.fPos + view.fDir;
+    hsVector3 up(0.f, 0.f, 1.f);
+    if (std::fabs(view.fDir.fZ) > 0.99f * view.fDir.Magnitude())
+        up.Set(0.f, 1.f, 0.f);
+
+    hsMatrix44 w2c, c2w;
+    hsMatrix44::MakeCameraMatrices(view.fPos, at, up, w2c, c2w);
+    vt.SetCameraTransform(w2c, c2w);
+}
+
+static inline hsPoint4 IToClip(const hsMatrix44& m, const hsPoint3& pt)
+{
+    hsPoint4 clip;
+    for (int i = 0; i < 4; i++)
+        clip[i] = m.fMap[i][0] * pt.fX + m.fMap[i][1] * pt.fY + m.fMap[i][2] * pt.fZ + m.fMap[i][3];
+    return clip;
+}
+
+// Rejects boxes with every corner outside the same frustum plane, like the
+// pipeline's own cull does before anything reaches occlusion
+static bool IInFrustum(const plViewTransform& vt, const hsBounds3Ext& bnd)
+{
+    hsPoint3 corners[8];
+    bnd.GetCorners(corners);
+
+    uint32_t allOut = 0x3F;
+    for (const hsPoint3& pt : corners) {
+        hsPoint4 clip = IToClip(vt.GetWorldToNDC(), pt);
+        uint32_t out = 0;
+        out |= clip.fX < -clip.fW ? 0x01 : 0;
+        out |= clip.fX > clip.fW ? 0x02 : 0;
+        out |= clip.fY < -clip.fW ? 0x04 : 0;
+        out |= clip.fY > clip.fW ? 0x08 : 0;
+        out |= clip.fZ < 0.f ? 0x10 : 0;
+        out |= clip.fZ > clip.fW ? 0x20 : 0;
+        allOut &= out;
+    }
+    return !allOut;
+}
+
+static void IAddBuilding(plSoftOcclusion& occ, const hsBounds3Ext& bnd)
+{
+    static const int kFaces[6][4] = {
+        { 0, 1, 3, 2 }, { 4, 5, 7, 6 }, { 0, 1, 5, 4 },
+        { 2, 3, 7, 6 }, { 0, 2, 6, 4 }, { 1, 3, 7, 5 },
+    };
+
+    hsPoint3 corners[8];
+    bnd.GetCorners(corners);
+    for (const auto& face : kFaces) {
+        hsPoint3 quad[4] = { corners[face[0]], corners[face[1]], corners[face[2]], corners[face[3]] };
+        occ.AddPolygon(quad, 4);
+    }
+}
+
+// True if the segment from the eye to pt passes through the box
+static bool ISegmentHits(const hsPoint3& eye, const hsPoint3& pt, const hsBounds3Ext& bnd)
+{
+    float tMin = 0.f, tMax = 1.f;
+    for (int i = 0; i < 3; i++) {
+        float d = pt[i] - eye[i];
+        float lo = bnd.GetMins()[i], hi = bnd.GetMaxs()[i];
+        if (std::fabs(d) < 1.e-6f) {
+            if (eye[i] < lo || eye[i] > hi)
+                return false;
+            continue;
+        }
+        float t0 = (lo - eye[i]) / d, t1 = (hi - eye[i]) / d;
+        if (t0 > t1)
+            std::swap(t0, t1);
+        tMin = std::max(tMin, t0);
+        tMax = std::min(tMax, t1);
+        if (tMin > tMax)
+            return false;
+    }
+    return true;
+}
+
+// Samples points over a culled prop and checks every one the camera could
+// see is really behind a building
+static bool IReallyHidden(const plViewTransform& vt, const hsPoint3& eye, const hsBounds3Ext& prop,
+                          const std::vector<hsBounds3Ext>& buildings)
+{
+    const int kSteps = 2;
+    for (int i = 0; i <= kSteps; i++) {
+        for (int j = 0; j <= kSteps; j++) {
+            for (int k = 0; k <= kSteps; k++) {
+                hsPoint3 pt;
+                for (int a = 0; a < 3; a++) {
+                    int step = a == 0 ? i : (a == 1 ? j : k);
+                    pt[a] = prop.GetMins()[a] + (prop.GetMaxs()[a] - prop.GetMins()[a]) * step / kSteps;
+                }
+
+                hsPoint4 clip = IToClip(vt.GetWorldToNDC(), pt);
+                if (clip.fW <= 0.f || std::fabs(clip.fX) > clip.fW || std::fabs(clip.fY) > clip.fW)
+                    continue;
+
+                auto hits = [&](const hsBounds3Ext& bnd) { return ISegmentHits(eye, pt, bnd); };
+                if (std::none_of(buildings.begin(), buildings.end(), hits))
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+template <typename Op>
+static double ITime(int32_t count, Op op)
+{
+    auto elapsed = ClockT::duration::zero();
+    for (int32_t i = 0; i < count; ++i) {
+        auto begin = ClockT::now();
+        op();
+        elapsed += ClockT::now() - begin;
+    }
+    return std::chrono::duration<double, std::milli>(elapsed).count() / count;
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<ST::string> args;
+    for (int i = 0; i < argc; ++i)
+        args.emplace_back(argv[i]);
+
+    plCmdParser parser(s_cmdLineArgs, std::size(s_cmdLineArgs));
+    parser.Parse(args);
+
+    int32_t count = 5;
+    if (parser.IsSpecified(kArgCount))
+        count = parser.GetInt(kArgCount);
+    if (count <= 0) {
+        ST::printf(stderr, "Cannot iterate less than 1 time.\n");
+        return 1;
+    }
+
+    std::mt19937 rng(0x4F4343);
+    std::vector<hsBounds3Ext> buildings, props;
+    IBuildCity(buildings, props, rng);
+
+    std::vector<plBenchView> path;
+    if (parser.IsSpecified(kArgPath)) {
+        if (!IReadPath(parser.GetString(kArgPath), path)) {
+            ST::printf(stderr, "Could not read a camera path from {}\n", parser.GetString(kArgPath));
+            return 1;
+        }
+    } else {
+        IBuildPath(path);
+    }
+
+    plViewTransform vt;
+    vt.SetScreenSize(uint16_t(1280), uint16_t(720));
+    vt.SetPerspective(true);
+    vt.SetFovDeg(90.f, 58.7f);
+    vt.SetDepth(0.3f, 2000.f);
+
+    ST::printf("{} buildings, {} props, {} views\n", buildings.size(), props.size(), path.size());
+    ST::printf("{>8} {>12} {>12} {>12} {>10} {>10}\n\n", "Kernel", "Raster ms", "Test ms", "Frame ms", "Visible", "Culled");
+
+    using RasterDispatch = hsCpuFunctionDispatcher<plSoftOcclusion::raster_row_ptr>;
+    using TestDispatch = hsCpuFunctionDispatcher<plSoftOcclusion::test_row_ptr>;
+    const struct {
+        const char* fName;
+        plSoftOcclusion::raster_row_ptr fRaster;
+        plSoftOcclusion::test_row_ptr fTest;
+    } kernels[] = {
+        { "fpu", &plSoftOcclusion::raster_row_fpu, &plSoftOcclusion::test_row_fpu },
+        { "sse2", &plSoftOcclusion::raster_row_sse2, &plSoftOcclusion::test_row_sse2 },
+    };
+
+    plSoftOcclusion occ;
+    std::vector<std::vector<float>> firstDepths(path.size());
+    std::vector<std::vector<bool>> firstCulled(path.size());
+    std::vector<bool> culled;
+    bool allMatch = true;
+    bool allHidden = true;
+
+    for (const auto& kernel : kernels) {
+        plSoftOcclusion::raster_row = RasterDispatch(kernel.fRaster);
+        plSoftOcclusion::test_row = TestDispatch(kernel.fTest);
+
+        double rasterMs = 0., testMs = 0.;
+        size_t numCulled = 0, numVisible = 0;
+        bool match = true;
+
+        for (size_t v = 0; v < path.size(); v++) {
+            ISetView(vt, path[v]);
+
+            std::vector<const hsBounds3Ext*> inView;
+            for (const hsBounds3Ext& prop : props) {
+                if (IInFrustum(vt, prop))
+                    inView.push_back(&prop);
+            }
+
+            rasterMs += ITime(count, [&]() {
+                occ.Begin(vt.GetWorldToNDC());
+                for (const hsBounds3Ext& bnd : buildings)
+                    IAddBuilding(occ, bnd);
+                occ.End();
+            });
+
+            culled.assign(inView.size(), false);
+            testMs += ITime(count, [&]() {
+                for (size_t i = 0; i < inView.size(); i++)
+                    culled[i] = occ.IsOccluded(*inView[i]);
+            });
+
+            size_t frameCulled = size_t(std::count(culled.begin(), culled.end(), true));
+            numCulled += frameCulled;
+            numVisible += inView.size() - frameCulled;
+
+            // The other kernels only need to match the first, which is
+            // checked against the buildings themselves
+            const float* depth = occ.GetDepthBuffer();
+            std::vector<float> frameDepth(depth, depth + occ.GetWidth() * occ.GetHeight());
+            if (!firstDepths[v].empty()) {
+                match &= firstDepths[v] == frameDepth && firstCulled[v] == culled;
+                continue;
+            }
+            firstDepths[v] = std::move(frameDepth);
+            firstCulled[v] = culled;
+
+            for (size_t i = 0; i < inView.size(); i++) {
+                if (culled[i] && !IReallyHidden(vt, path[v].fPos, *inView[i], buildings)) {
+                    ST::printf(stderr, "View {}: a visible prop was culled\n", v);
+                    allHidden = false;
+                }
+            }
+        }
+
+        allMatch &= match;
+        ST::printf("{>8} {>12.3f} {>12.3f} {>12.3f} {>10} {>10} {}\n", kernel.fName,
+                   rasterMs / path.size(), testMs / path.size(), (rasterMs + testMs) / path.size(),
+                   numVisible, numCulled, match ? "" : "MISMATCH");
+    }
+
+    if (!allMatch) {
+        ST::printf(stderr, "The kernels did not fill the depth buffer the same!\n");
+        return 1;
+    }
+    if (!allHidden) {
+        ST::printf(stderr, "Some props were culled that should have been drawn!\n");
+        return 1;
+    }
+
+    ST::printf("Have a nice day!\n");
+    return 0;
+}
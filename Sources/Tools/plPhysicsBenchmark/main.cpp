@@ -0,0 +1,294 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <string_theory/stdio>
+#include <vector>
+
+#include "HeadSpin.h"
+#include "hsMatrix44.h"
+#include "plCmdParser.h"
+
+#include "plPhysX/plPhysXAPI.h"
+#include "plPhysX/plPXConvert.h"
+#include "plPhysX/plPXSimulation.h"
+
+enum CmdLineArgs
+{
+    kArgCount,
+};
+
+static const plCmdArgDef s_cmdLineArgs[] = {
+    { (kCmdTypeUint | kCmdArgFlagged), "Count", kArgCount },
+};
+
+using ClockT = std::chrono::steady_clock;
+
+// An age's worth of physicals: mostly static scenery, a lot of clutter that
+// has settled and fallen asleep, a few platforms and doors moving around on
+// their animations, and a few things tumbling through the air.
+static const uint32_t kNumStatics = 8000;
+static const uint32_t kNumSleepers = 1500;
+static const uint32_t kNumMovers = 40;
+static const uint32_t kNumFallers = 10;
+static const float kAgeSize = 1000.f;
+static const uint32_t kNumFrames = 240;
+static const float kFrameTime = 1.f / 60.f;
+
+// Stands in for everything else in a frame: culling, drawing, and so on
+static const double kFrameWorkMs = 4.;
+
+// The actors aren't backed by any physicals, so they skip AddToWorld() and
+// go straight into the main world.
+class plBenchSimulation : public plPXSimulation
+{
+public:
+    physx::PxScene* GetMainWorld()
+    {
+        physx::PxScene* scene = FindScene(nullptr);
+        return scene ? scene : InitSubworld(nullptr);
+    }
+};
+
+struct plBenchActor
+{
+    physx::PxRigidActor*    fActor;
+    physx::PxTransform      fStart;
+    hsMatrix44              fCached[2];
+};
+
+static physx::PxRigidActor* IMakeActor(plBenchSimulation& sim, const hsPoint3& pos, float size, plPXActorType type)
+{
+    physx::PxBoxGeometry box(size, size, size);
+    physx::PxTransform pose(plPXConvert::Point(pos));
+    physx::PxRigidActor* actor = sim.CreateRigidActor(box, pose, physx::PxTransform(physx::PxIdentity),
+                                                      0.5f, 0.5f, 0.f, type);
+    sim.GetMainWorld()->addActor(*actor);
+    return actor;
+}
+
+static hsPoint3 IMoverPos(uint32_t i, uint32_t frame)
+{
+    float t = float(frame) / kNumFrames * 6.2832f;
+    float x = float(i * 7919 % 997) / 997.f * kAgeSize;
+    float y = float(i * 104729 % 991) / 991.f * kAgeSize;
+    return hsPoint3(x + 10.f * std::cos(t + i), y + 10.f * std::sin(t + i), 5.f);
+}
+
+// Puts everything back where it started, after letting any step that's
+// still running finish
+static void IResetActors(plBenchSimulation& sim, std::vector<plBenchActor>& actors)
+{
+    sim.Advance(0.f);
+    for (plBenchActor& actor : actors) {
+        physx::PxRigidDynamic* dynamic = actor.fActor->is<physx::PxRigidDynamic>();
+        if (!dynamic)
+            continue;
+        dynamic->setGlobalPose(actor.fStart);
+        if (dynamic->getRigidBodyFlags() & physx::PxRigidBodyFlag::eKINEMATIC)
+            continue;
+        dynamic->setLinearVelocity(physx::PxVec3(physx::PxZero));
+        dynamic->setAngularVelocity(physx::PxVec3(physx::PxZero));
+        if (actor.fStart.p.z < 100.f)
+            dynamic->putToSleep();
+    }
+}
+
+// Picks up an actor's pose the way plPXPhysical::SendNewLocation() does,
+// returning whether it had moved since last time.
+static bool IUpdateCached(plBenchActor& actor, int which)
+{
+    hsMatrix44 l2w = plPXConvert::Transform(actor.fActor->getGlobalPose());
+    if (l2w.Compare(actor.fCached[which], .0001f))
+        return false;
+    actor.fCached[which] = l2w;
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<ST::string> args;
+    for (int i = 0; i < argc; ++i)
+        args.emplace_back(argv[i]);
+
+    plCmdParser parser(s_cmdLineArgs, std::size(s_cmdLineArgs));
+    parser.Parse(args);
+
+    int32_t count = 1;
+    if (parser.IsSpecified(kArgCount))
+        count = parser.GetInt(kArgCount);
+    if (count <= 0) {
+        ST::printf(stderr, "Cannot iterate less than 1 time.\n");
+        return 1;
+    }
+
+    plBenchSimulation sim;
+    if (!sim.Init()) {
+        ST::printf(stderr, "Could not start PhysX.\n");
+        return 1;
+    }
+
+    std::mt19937 rng(0x505853);
+    std::uniform_real_distribution<float> along(0.f, kAgeSize);
+    std::uniform_real_distribution<float> size(0.25f, 4.f);
+
+    std::vector<plBenchActor> actors;
+    std::vector<physx::PxRigidDynamic*> movers;
+    for (uint32_t i = 0; i < kNumStatics; i++) {
+        hsPoint3 pos(along(rng), along(rng), 0.f);
+        actors.push_back({ IMakeActor(sim, pos, size(rng), plPXActorType::kStaticActor) });
+    }
+    for (uint32_t i = 0; i < kNumSleepers; i++) {
+        hsPoint3 pos(along(rng), along(rng), 2.f);
+        physx::PxRigidActor* actor = IMakeActor(sim, pos, size(rng), plPXActorType::kDynamicActor);
+        actor->is<physx::PxRigidDynamic>()->putToSleep();
+        actors.push_back({ actor });
+    }
+    for (uint32_t i = 0; i < kNumMovers; i++) {
+        physx::PxRigidActor* actor = IMakeActor(sim, IMoverPos(i, 0), 2.f, plPXActorType::kKinematicActor);
+        movers.push_back(actor->is<physx::PxRigidDynamic>());
+        actors.push_back({ actor });
+    }
+    for (uint32_t i = 0; i < kNumFallers; i++) {
+        hsPoint3 pos(along(rng), along(rng), 500.f);
+        actors.push_back({ IMakeActor(sim, pos, size(rng), plPXActorType::kDynamicActor) });
+    }
+
+    for (plBenchActor& actor : actors) {
+        actor.fActor->userData = &actor;
+        actor.fStart = actor.fActor->getGlobalPose();
+        IUpdateCached(actor, 0);
+        IUpdateCached(actor, 1);
+    }
+
+    ST::printf("{} actors, {} frames\n\n", actors.size(), kNumFrames);
+
+    // Every frame, sending new locations by checking every actor against
+    // checking only the ones PhysX says are active. Both must end up with
+    // the same poses cached.
+    double stepMs = 0., fullMs = 0., activeMs = 0.;
+    size_t fullChecked = 0, activeChecked = 0, fullMoved = 0, activeMoved = 0;
+    bool match = true;
+    for (int32_t c = 0; c < count; c++) {
+        for (uint32_t f = 0; f < kNumFrames; f++) {
+            for (uint32_t i = 0; i < kNumMovers; i++)
+                movers[i]->setKinematicTarget(physx::PxTransform(plPXConvert::Point(IMoverPos(i, f + 1))));
+
+            auto begin = ClockT::now();
+            sim.Advance(kFrameTime);
+            auto stepped = ClockT::now();
+            for (plBenchActor& actor : actors)
+                fullMoved += IUpdateCached(actor, 0);
+            auto full = ClockT::now();
+            for (physx::PxRigidActor* actor : sim.GetActiveActors())
+                activeMoved += IUpdateCached(*static_cast<plBenchActor*>(actor->userData), 1);
+            auto active = ClockT::now();
+
+            stepMs += std::chrono::duration<double, std::milli>(stepped - begin).count();
+            fullMs += std::chrono::duration<double, std::milli>(full - stepped).count();
+            activeMs += std::chrono::duration<double, std::milli>(active - full).count();
+            fullChecked += actors.size();
+            activeChecked += sim.GetActiveActors().size();
+
+            for (plBenchActor& actor : actors)
+                match &= actor.fCached[0].Compare(actor.fCached[1], .0001f);
+        }
+    }
+
+    uint32_t numFrames = kNumFrames * count;
+    ST::printf("{>10} {>10.4f}\n\n", "Step ms", stepMs / numFrames);
+    ST::printf("{>10} {>10} {>10} {>10}\n\n", "Send", "Send ms", "Checked", "Moved");
+    ST::printf("{>10} {>10.4f} {>10} {>10}\n", "all", fullMs / numFrames, fullChecked / numFrames, fullMoved / numFrames);
+    ST::printf("{>10} {>10.4f} {>10} {>10} {}\n", "active", activeMs / numFrames, activeChecked / numFrames,
+               activeMoved / numFrames, match ? "" : "MISMATCH");
+    ST::printf("\n");
+
+    // Stepping: the whole step inside Advance() against leaving it running
+    // on a step thread while the rest of the frame goes on. Both must take
+    // the same steps and leave everything in the same place.
+    {
+        ST::printf("{>10} {>12} {>10}\n\n", "Threads", "Advance ms", "Frame ms");
+
+        std::vector<hsMatrix44> firstPoses;
+        for (uint32_t numThreads : { 1, 2 }) {
+            plPXSimulation::SetStepThreads(numThreads);
+
+            double advanceMs = 0., frameMs = 0.;
+            bool posesMatch = true;
+            for (int32_t c = 0; c < count; c++) {
+                IResetActors(sim, actors);
+                for (uint32_t f = 0; f < kNumFrames; f++) {
+                    for (uint32_t i = 0; i < kNumMovers; i++)
+                        movers[i]->setKinematicTarget(physx::PxTransform(plPXConvert::Point(IMoverPos(i, f + 1))));
+
+                    auto begin = ClockT::now();
+                    sim.Advance(kFrameTime);
+                    auto stepped = ClockT::now();
+                    while (std::chrono::duration<double, std::milli>(ClockT::now() - stepped).count() < kFrameWorkMs)
+                        ;
+                    advanceMs += std::chrono::duration<double, std::milli>(stepped - begin).count();
+                    frameMs += std::chrono::duration<double, std::milli>(ClockT::now() - begin).count();
+                }
+                sim.Advance(0.f);
+
+                for (size_t i = 0; i < actors.size(); i++) {
+                    hsMatrix44 l2w = plPXConvert::Transform(actors[i].fActor->getGlobalPose());
+                    if (firstPoses.size() < actors.size())
+                        firstPoses.push_back(l2w);
+                    else
+                        posesMatch &= l2w.Compare(firstPoses[i], .0001f);
+                }
+            }
+
+            match &= posesMatch;
+            ST::printf("{>10} {>12.4f} {>10.4f} {}\n", numThreads, advanceMs / numFrames, frameMs / numFrames,
+                       posesMatch ? "" : "MISMATCH");
+        }
+        ST::printf("\n");
+
+        plPXSimulation::SetStepThreads(1);
+    }
+
+    return match ? 0 : 1;
+}
@@ -0,0 +1,421 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <string_theory/stdio>
+#include <vector>
+
+#include "HeadSpin.h"
+#include "hsBitVector.h"
+#include "hsBounds.h"
+#include "hsGeometry3.h"
+#include "hsMatrix44.h"
+#include "plCmdParser.h"
+
+#include "plDrawable/plSpaceTree.h"
+#include "plDrawable/plSpaceTreeMaker.h"
+#include "plIntersect/plVolumeIsect.h"
+
+enum CmdLineArgs
+{
+    kArgCount,
+};
+
+static const plCmdArgDef s_cmdLineArgs[] = {
+    { (kCmdTypeUint | kCmdArgFlagged), "Count", kArgCount },
+};
+
+using ClockT = std::chrono::steady_clock;
+
+// About as many spans as one big page puts in a single drawable, scattered
+// over a square of ground, Z up. A few are rotated so their bounds aren't
+// axis aligned, some start out disabled, and some move around every frame.
+static const uint32_t kNumLeaves = 12000;
+static const float kPageSize = 1000.f;
+static const uint32_t kRotateEvery = 10;
+static const uint32_t kDisableEvery = 20;
+static const uint32_t kMoveEvery = 50;
+static const uint32_t kNumFrames = 120;
+
+static hsBounds3Ext IMakeLeaf(const hsPoint3& center, float size, float angle)
+{
+    hsPoint3 lo(-size, -size, 0.f), hi(size, size, 2.f * size);
+    hsBounds3Ext bnd;
+    bnd.Reset(&lo);
+    bnd.Union(&hi);
+    if (angle != 0.f) {
+        hsMatrix44 xfm;
+        xfm.MakeZRotation(angle);
+        hsVector3 pos(center.fX, center.fY, center.fZ);
+        xfm.SetTranslate(&pos);
+        bnd.Transform(&xfm);
+    } else {
+        hsPoint3 lo(center.fX - size, center.fY - size, center.fZ);
+        hsPoint3 hi(center.fX + size, center.fY + size, center.fZ + 2.f * size);
+        bnd.Reset(&lo);
+        bnd.Union(&hi);
+    }
+    return bnd;
+}
+
+struct plBenchLeaf
+{
+    hsBounds3Ext    fBounds;
+    bool            fDisabled;
+};
+
+static void IMakeLeaves(std::vector<plBenchLeaf>& leaves, std::mt19937& rng)
+{
+    std::uniform_real_distribution<float> along(0.f, kPageSize);
+    std::uniform_real_distribution<float> lift(0.f, 20.f);
+    std::uniform_real_distribution<float> size(0.5f, 8.f);
+    std::uniform_real_distribution<float> angle(0.1f, 1.4f);
+
+    for (uint32_t i = 0; i < kNumLeaves; i++) {
+        hsPoint3 center(along(rng), along(rng), lift(rng));
+        float s = size(rng);
+        float a = angle(rng);
+        leaves.push_back({ IMakeLeaf(center, s, i % kRotateEvery ? 0.f : a), !(i % kDisableEvery) });
+    }
+}
+
+static plSpaceTree* IBuildTree(const std::vector<plBenchLeaf>& leaves, size_t numLeaves)
+{
+    plSpaceTreeMaker maker;
+    maker.Reset();
+    for (size_t i = 0; i < numLeaves; i++)
+        maker.AddLeaf(leaves[i].fBounds, leaves[i].fDisabled);
+    plSpaceTree* tree = maker.MakeTree();
+    maker.Cleanup();
+    return tree;
+}
+
+// The movers circle around where they started, so every pass through the
+// frames leaves the tree in the same state for the same frame. A small
+// radius stays in the neighborhood, a big one drives across the page.
+static void IMoveLeaves(plSpaceTree* tree, uint32_t frame, float radius, bool relocate)
+{
+    float t = float(frame) / kNumFrames * 6.2832f;
+    for (uint32_t i = 1; i < kNumLeaves; i += kMoveEvery) {
+        float x = float(i * 7919 % 997) / 997.f * kPageSize;
+        float y = float(i * 104729 % 991) / 991.f * kPageSize;
+        hsPoint3 center(x + radius * std::cos(t + i), y + radius * std::sin(t + i), 2.f);
+        hsBounds3Ext bnd = IMakeLeaf(center, 2.f, i % kRotateEvery ? 0.f : t);
+        if (relocate)
+            tree->RelocateLeaf(int16_t(i), bnd);
+        else
+            tree->MoveLeaf(int16_t(i), bnd);
+    }
+    tree->Refresh();
+}
+
+// A directional light's influence, a long box tipped over to follow the
+// sun around the sky
+static void ISetLightVolume(plParallelIsect& isect, uint32_t frame)
+{
+    float t = float(frame) / kNumFrames * 6.2832f;
+    hsPoint3 center(kPageSize * 0.5f + 200.f * std::cos(t), kPageSize * 0.5f + 200.f * std::sin(t), 10.f);
+    hsVector3 axes[3] = {
+        hsVector3(std::cos(t), std::sin(t), 0.3f),
+        hsVector3(-std::sin(t), std::cos(t), 0.f),
+        hsVector3(-0.3f * std::cos(t), -0.3f * std::sin(t), 1.f),
+    };
+    const float halfSize[3] = { 250.f, 120.f, 40.f };
+
+    isect.SetNumPlanes(3);
+    for (int i = 0; i < 3; i++) {
+        hsPoint3 one = center + axes[i] * halfSize[i];
+        hsPoint3 two = center - axes[i] * halfSize[i];
+        isect.SetPlane(i, one, two);
+    }
+    hsMatrix44 ident;
+    ident.Reset();
+    isect.SetTransform(ident, ident);
+}
+
+// A camera's view frustum, like a cutter or a visregion would use, sweeping
+// across the page at eye level
+static void ISetFrustumVolume(plConvexIsect& isect, uint32_t frame)
+{
+    float t = float(frame) / kNumFrames;
+    float heading = t * 6.2832f;
+    hsPoint3 eye(50.f + t * (kPageSize - 100.f), kPageSize * 0.5f, 2.f);
+    hsVector3 fwd(std::cos(heading), std::sin(heading), 0.f);
+    hsVector3 side(-fwd.fY, fwd.fX, 0.f);
+    hsVector3 up(0.f, 0.f, 1.f);
+
+    isect.ClearPlanes();
+    isect.AddPlane(-fwd, eye + fwd * 0.3f);
+    isect.AddPlane(fwd, eye + fwd * 400.f);
+    isect.AddPlane(side - fwd * 0.8f, eye);
+    isect.AddPlane(-side - fwd * 0.8f, eye);
+    isect.AddPlane(up - fwd * 0.5f, eye);
+    isect.AddPlane(-up - fwd * 0.5f, eye);
+    hsMatrix44 ident;
+    ident.Reset();
+    isect.SetTransform(ident, ident);
+}
+
+template <typename Op>
+static double ITime(int32_t count, Op op)
+{
+    auto elapsed = ClockT::duration::zero();
+    for (int32_t i = 0; i < count; ++i) {
+        auto begin = ClockT::now();
+        op();
+        elapsed += ClockT::now() - begin;
+    }
+    return std::chrono::duration<double, std::milli>(elapsed).count() / count;
+}
+
+// Harvests one frame with both volumes, returning the time taken. The first
+// pass through a frame keeps its leaves, later ones are checked against them.
+struct plBenchFrames
+{
+    plParallelIsect                     fLight;
+    plConvexIsect                       fFrustum;
+    std::vector<std::vector<int16_t>>   fLeaves[2];
+    std::vector<int16_t>                fScratch;
+
+    plBenchFrames()
+    {
+        fLeaves[0].resize(kNumFrames);
+        fLeaves[1].resize(kNumFrames);
+    }
+
+    double Harvest(int32_t count, plSpaceTree* tree, uint32_t frame, bool first, bool& match, size_t& numLeaves)
+    {
+        ISetLightVolume(fLight, frame);
+        ISetFrustumVolume(fFrustum, frame);
+
+        plVolumeIsect* isects[2] = { &fLight, &fFrustum };
+        double ms = 0.;
+        for (int i = 0; i < 2; i++) {
+            ms += ITime(count, [&]() {
+                fScratch.clear();
+                tree->HarvestLeaves(isects[i], fScratch);
+            });
+            numLeaves += fScratch.size();
+
+            if (first)
+                fLeaves[i][frame] = fScratch;
+            else
+                match &= fLeaves[i][frame] == fScratch;
+        }
+        return ms;
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    std::vector<ST::string> args;
+    for (int i = 0; i < argc; ++i)
+        args.emplace_back(argv[i]);
+
+    plCmdParser parser(s_cmdLineArgs, std::size(s_cmdLineArgs));
+    parser.Parse(args);
+
+    int32_t count = 20;
+    if (parser.IsSpecified(kArgCount))
+        count = parser.GetInt(kArgCount);
+    if (count <= 0) {
+        ST::printf(stderr, "Cannot iterate less than 1 time.\n");
+        return 1;
+    }
+
+    std::mt19937 rng(0x535054);
+    std::vector<plBenchLeaf> benchLeaves;
+    IMakeLeaves(benchLeaves, rng);
+
+    ST::printf("{} leaves, {} frames\n\n", kNumLeaves, kNumFrames);
+
+    bool allMatch = true;
+
+    // Building: the old median split against the binned one, on one thread
+    // and on all of them. The same volumes must find the same leaves in all.
+    {
+        const struct {
+            const char* fName;
+            bool fBinned;
+            uint32_t fThreads;
+        } builds[] = {
+            { "median", false, 1 },
+            { "binned", true, 1 },
+            { "binned mt", true, 0 },
+        };
+
+        ST::printf("{>10} {>10} {>10} {>12} {>10}\n\n", "Build", "Build ms", "SAH cost", "Harvest ms", "Leaves");
+
+        plBenchFrames frames;
+        for (const auto& build : builds) {
+            plSpaceTreeMaker::SetBinnedBuild(build.fBinned);
+            plSpaceTreeMaker::SetBuildThreads(build.fThreads);
+
+            double buildMs = ITime(count, [&]() { delete IBuildTree(benchLeaves, kNumLeaves); });
+            plSpaceTree* tree = IBuildTree(benchLeaves, kNumLeaves);
+            tree->Refresh();
+
+            double harvestMs = 0.;
+            size_t numLeaves = 0;
+            bool match = true;
+            for (uint32_t f = 0; f < kNumFrames; f++)
+                harvestMs += frames.Harvest(count, tree, f, !build.fBinned, match, numLeaves);
+
+            allMatch &= match;
+            ST::printf("{>10} {>10.3f} {>10.2f} {>12.4f} {>10} {}\n", build.fName, buildMs, tree->ComputeSAHCost(),
+                       harvestMs / kNumFrames, numLeaves / kNumFrames, match ? "" : "MISMATCH");
+            delete tree;
+        }
+        ST::printf("\n");
+
+        plSpaceTreeMaker::SetBinnedBuild(true);
+        plSpaceTreeMaker::SetBuildThreads(1);
+    }
+
+    // Harvesting: one node at a time against the packed copy, with each
+    // kernel, while a few of the leaves shuffle around
+    {
+        using TestDispatch = hsCpuFunctionDispatcher<plSpaceTree::test_packed_ptr>;
+        const struct {
+            const char* fName;
+            bool fPacked;
+            plSpaceTree::test_packed_ptr fTest;
+        } modes[] = {
+            { "node", false, nullptr },
+            { "fpu", true, &plSpaceTree::test_packed_fpu },
+            { "sse2", true, &plSpaceTree::test_packed_sse2 },
+        };
+
+        ST::printf("{>10} {>12} {>10}\n\n", "Harvest", "Harvest ms", "Leaves");
+
+        plSpaceTree* tree = IBuildTree(benchLeaves, kNumLeaves);
+        plBenchFrames frames;
+        for (const auto& mode : modes) {
+            plSpaceTree::SetPackedHarvest(mode.fPacked);
+            if (mode.fTest)
+                plSpaceTree::test_packed = TestDispatch(mode.fTest);
+
+            double harvestMs = 0.;
+            size_t numLeaves = 0;
+            bool match = true;
+            for (uint32_t f = 0; f < kNumFrames; f++) {
+                IMoveLeaves(tree, f, 30.f, false);
+                harvestMs += frames.Harvest(count, tree, f, !mode.fPacked, match, numLeaves);
+            }
+
+            allMatch &= match;
+            ST::printf("{>10} {>12.4f} {>10} {}\n", mode.fName, harvestMs / kNumFrames,
+                       numLeaves / kNumFrames, match ? "" : "MISMATCH");
+        }
+        delete tree;
+        ST::printf("\n");
+    }
+
+    // Updating: movers driving all over the page, either just stretching
+    // the nodes above them or being reinserted where they end up
+    {
+        ST::printf("{>10} {>10} {>10} {>12} {>10}\n\n", "Update", "Update ms", "SAH cost", "Harvest ms", "Leaves");
+
+        plBenchFrames frames;
+        for (bool relocate : { false, true }) {
+            plSpaceTree* tree = IBuildTree(benchLeaves, kNumLeaves);
+
+            double updateMs = 0., harvestMs = 0.;
+            size_t numLeaves = 0;
+            bool match = true;
+            for (uint32_t f = 0; f < kNumFrames; f++) {
+                auto begin = ClockT::now();
+                IMoveLeaves(tree, f, 400.f, relocate);
+                updateMs += std::chrono::duration<double, std::milli>(ClockT::now() - begin).count();
+                harvestMs += frames.Harvest(count, tree, f, !relocate, match, numLeaves);
+            }
+
+            allMatch &= match;
+            ST::printf("{>10} {>10.3f} {>10.2f} {>12.4f} {>10} {}\n", relocate ? "relocate" : "move",
+                       updateMs / kNumFrames, tree->ComputeSAHCost(), harvestMs / kNumFrames,
+                       numLeaves / kNumFrames, match ? "" : "MISMATCH");
+            delete tree;
+        }
+        ST::printf("\n");
+    }
+
+    // Adding: half the leaves built, the other half added one at a time,
+    // against building them all at once
+    {
+        ST::printf("{>10} {>10} {>10} {>12} {>10}\n\n", "Add", "Build ms", "SAH cost", "Harvest ms", "Leaves");
+
+        plBenchFrames frames;
+        for (bool incremental : { false, true }) {
+            plSpaceTree* tree = nullptr;
+            double buildMs = ITime(1, [&]() {
+                tree = IBuildTree(benchLeaves, incremental ? kNumLeaves / 2 : kNumLeaves);
+                for (size_t i = tree->GetNumLeaves(); i < kNumLeaves; i++)
+                    tree->AddLeaf(benchLeaves[i].fBounds, benchLeaves[i].fDisabled);
+                tree->Refresh();
+            });
+
+            double harvestMs = 0.;
+            size_t numLeaves = 0;
+            bool match = tree->GetNumLeaves() == kNumLeaves;
+            for (uint32_t f = 0; f < kNumFrames; f++)
+                harvestMs += frames.Harvest(count, tree, f, !incremental, match, numLeaves);
+
+            allMatch &= match;
+            ST::printf("{>10} {>10.3f} {>10.2f} {>12.4f} {>10} {}\n", incremental ? "add" : "rebuild",
+                       buildMs, tree->ComputeSAHCost(), harvestMs / kNumFrames,
+                       numLeaves / kNumFrames, match ? "" : "MISMATCH");
+            delete tree;
+        }
+        ST::printf("\n");
+    }
+
+    if (!allMatch) {
+        ST::printf(stderr, "The trees did not find the same leaves!\n");
+        return 1;
+    }
+
+    ST::printf("Have a nice day!\n");
+    return 0;
+}
@@ -0,0 +1,287 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <string_theory/stdio>
+#include <vector>
+
+#include "HeadSpin.h"
+#include "hsStream.h"
+#include "plCmdParser.h"
+#include "plFileSystem.h"
+
+#include "plGImage/plFont.h"
+
+enum CmdLineArgs
+{
+    kArgCount,
+    kArgFont,
+};
+
+static const plCmdArgDef s_cmdLineArgs[] = {
+    { (kCmdTypeUint | kCmdArgFlagged), "Count", kArgCount },
+    { (kCmdTypeString | kCmdArgFlagged), "Font", kArgFont },
+};
+
+using ClockT = std::chrono::steady_clock;
+
+// Roughly a KI message line's worth of characters before pfGUIMultiLineEditCtrl wraps
+static const size_t kWrapChars = 64;
+
+static const wchar_t kTypedText[] =
+    L"Meet me by the fountain in the city when you get this, and bring the journal. ";
+
+// Only the glyph widths matter for measuring, so the bitmap is left blank.
+static bool IMakeFont(plFont& font)
+{
+    const uint16_t firstChar = 32, numChars = 96;
+    const uint32_t width = 16, charHeight = 18;
+
+    hsRAMStream stream;
+    char face[256] = "Benchmark";
+    stream.Write(sizeof(face), face);
+    stream.WriteByte((uint8_t)12);
+    stream.WriteLE32((uint32_t)0);
+    stream.WriteLE32(width);
+    stream.WriteLE32(charHeight * numChars);
+    stream.WriteLE32(charHeight);
+    stream.WriteByte((uint8_t)8);
+
+    std::vector<uint8_t> bitmap(width * charHeight * numChars);
+    stream.Write((uint32_t)bitmap.size(), bitmap.data());
+
+    stream.WriteLE16(firstChar);
+    stream.WriteLE32((uint32_t)numChars);
+    for (uint16_t ch = 0; ch < numChars; ch++) {
+        stream.WriteLE32((uint32_t)(ch * width * charHeight));
+        stream.WriteLE32(charHeight);
+        stream.WriteLE32(charHeight - 4);
+        stream.WriteLEFloat(0.f);
+        stream.WriteLEFloat(-(float)(width - 5 - ch % 7));
+    }
+
+    stream.Rewind();
+    return font.ReadRaw(&stream);
+}
+
+// A document of about the given size, in the coded form the control keeps
+// (null terminated), with the line starts a wrap at kWrapChars would give.
+static void IMakeDocument(size_t size, std::vector<wchar_t>& text, std::vector<int32_t>& lineStarts)
+{
+    text.clear();
+    while (text.size() < size)
+        text.insert(text.end(), std::begin(kTypedText), std::end(kTypedText) - 1);
+    text.resize(size);
+    text.push_back(0);
+
+    lineStarts.clear();
+    for (size_t i = 0; i + 1 < text.size(); i += kWrapChars)
+        lineStarts.push_back((int32_t)i);
+}
+
+// The contiguous run pfGUIMultiLineEditCtrl::fBuffer is
+struct ContiguousText
+{
+    std::vector<wchar_t> fText;
+
+    void Insert(int32_t pos, wchar_t c) { fText.insert(fText.begin() + pos, c); }
+    void Erase(int32_t pos) { fText.erase(fText.begin() + pos); }
+    void CopyOut(int32_t start, int32_t end, wchar_t* dest) const
+    {
+        std::copy(fText.begin() + start, fText.begin() + end, dest);
+    }
+    std::vector<wchar_t> Get() const { return fText; }
+};
+
+// The same text with a gap at the last edit, so edits next to each other
+// don't move the rest of the document
+struct GapText
+{
+    std::vector<wchar_t> fText;
+    size_t fGapStart, fGapEnd;
+
+    explicit GapText(const std::vector<wchar_t>& text)
+        : fText(text), fGapStart(text.size()), fGapEnd(text.size()) { }
+
+    void IMoveGap(size_t pos)
+    {
+        if (pos < fGapStart)
+            std::move_backward(fText.begin() + pos, fText.begin() + fGapStart, fText.begin() + fGapEnd);
+        else if (pos > fGapStart)
+            std::move(fText.begin() + fGapEnd, fText.begin() + fGapEnd + (pos - fGapStart), fText.begin() + fGapStart);
+        fGapEnd = pos + (fGapEnd - fGapStart);
+        fGapStart = pos;
+    }
+
+    void Insert(int32_t pos, wchar_t c)
+    {
+        if (fGapStart == fGapEnd) {
+            size_t grow = std::max<size_t>(fText.size() / 2, 64);
+            fText.insert(fText.begin() + fGapStart, grow, 0);
+            fGapEnd += grow;
+        }
+        IMoveGap(pos);
+        fText[fGapStart++] = c;
+    }
+
+    void Erase(int32_t pos)
+    {
+        IMoveGap(pos);
+        fGapEnd++;
+    }
+
+    void CopyOut(int32_t start, int32_t end, wchar_t* dest) const
+    {
+        for (int32_t i = start; i < end; ++i)
+            *dest++ = fText[(size_t)i < fGapStart ? i : i + (fGapEnd - fGapStart)];
+    }
+
+    std::vector<wchar_t> Get() const
+    {
+        std::vector<wchar_t> text(fText.begin(), fText.begin() + fGapStart);
+        text.insert(text.end(), fText.begin() + fGapEnd, fText.end());
+        return text;
+    }
+};
+
+// Types into the document the way InsertChar() and DeleteChar() edit the
+// control: change the buffer, offset the line starts after the cursor and
+// measure the cursor's line again for the re-wrap. Every so often it
+// backspaces, and now and then the cursor jumps somewhere else, as when the
+// player clicks into another paragraph. Returns microseconds per keystroke.
+template <class TextT>
+static double ITimeTyping(plFont& font, TextT& text, std::vector<int32_t> lineStarts, int32_t count)
+{
+    std::vector<wchar_t> line(kWrapChars * 4 + 1);
+    int32_t length = (int32_t)text.Get().size() - 1; // not counting the terminator
+    int32_t cursor = length / 2;
+    uint32_t seed = 12345;
+    volatile uint32_t widths = 0;
+
+    auto begin = ClockT::now();
+    for (int32_t i = 0; i < count; ++i) {
+        if (i % 200 == 199) {
+            seed = seed * 1664525U + 1013904223U;
+            cursor = (int32_t)((seed >> 8) % (uint32_t)length);
+        }
+
+        int32_t editPos, offset;
+        if (i % 8 == 7 && cursor > 0) {
+            editPos = --cursor;
+            text.Erase(editPos);
+            offset = -1;
+        } else {
+            editPos = cursor++;
+            text.Insert(editPos, kTypedText[i % (std::size(kTypedText) - 1)]);
+            offset = 1;
+        }
+        length += offset;
+
+        auto lineIt = std::upper_bound(lineStarts.begin(), lineStarts.end(), editPos) - 1;
+        for (auto it = lineIt + 1; it != lineStarts.end(); ++it)
+            *it += offset;
+
+        int32_t start = *lineIt;
+        int32_t end = std::min(lineIt + 1 != lineStarts.end() ? *(lineIt + 1) : length, start + (int32_t)line.size() - 1);
+        text.CopyOut(start, end, line.data());
+        line[end - start] = 0;
+        widths += font.CalcStringWidth(line.data());
+    }
+    return std::chrono::duration<double, std::micro>(ClockT::now() - begin).count() / count;
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<ST::string> args;
+    for (int i = 0; i < argc; ++i)
+        args.emplace_back(argv[i]);
+
+    plCmdParser parser(s_cmdLineArgs, std::size(s_cmdLineArgs));
+    parser.Parse(args);
+
+    int32_t count = 20000;
+    if (parser.IsSpecified(kArgCount))
+        count = parser.GetInt(kArgCount);
+    if (count <= 0) {
+        ST::printf(stderr, "Cannot type less than 1 key.\n");
+        return 1;
+    }
+
+    plFont font;
+    if (parser.IsSpecified(kArgFont)) {
+        plFileName path = parser.GetString(kArgFont);
+        if (!font.LoadFromP2FFile(path)) {
+            ST::printf(stderr, "Could not load font {}\n", path.AsString());
+            return 1;
+        }
+    } else
+        IMakeFont(font);
+
+    ST::printf("Font {} {}pt, {} keystrokes per document\n", font.GetFace(), (int)font.GetSize(), count);
+    ST::printf("{>10} {>16} {>16} {>8}\n\n", "Document", "Contiguous", "Gap buffer", "Speedup");
+
+    bool allMatch = true;
+    for (size_t size : { 1024, 4096, 16384, 65536, 262144 }) {
+        std::vector<wchar_t> doc;
+        std::vector<int32_t> lineStarts;
+        IMakeDocument(size, doc, lineStarts);
+
+        ContiguousText contiguous { doc };
+        double contiguousUs = ITimeTyping(font, contiguous, lineStarts, count);
+
+        GapText gap(doc);
+        double gapUs = ITimeTyping(font, gap, lineStarts, count);
+
+        bool match = contiguous.Get() == gap.Get();
+        allMatch &= match;
+        ST::printf("{>7} KB {>13.3f} us {>13.3f} us {>7.2f}x  {}\n", size / 1024, contiguousUs, gapUs,
+                   gapUs > 0. ? contiguousUs / gapUs : 0., match ? "exact" : "MISMATCH");
+    }
+
+    if (!allMatch) {
+        ST::printf(stderr, "The gap buffer's text did not match the contiguous one!\n");
+        return 1;
+    }
+
+    ST::printf("\nHave a nice day!\n");
+    return 0;
+}
@@ -0,0 +1,22 @@
+find_package(lz4 CONFIG QUIET)
+
+if(NOT TARGET lz4::lz4)
+    include(FindPackageHandleStandardArgs)
+
+    find_path(LZ4_INCLUDE_DIR NAMES lz4.h
+            PATHS /usr/local/include /usr/include)
+
+    find_library(LZ4_LIBRARY NAMES lz4 liblz4
+                PATHS /usr/local/lib /usr/lib)
+
+    find_package_handle_standard_args(LZ4 REQUIRED_VARS LZ4_INCLUDE_DIR LZ4_LIBRARY)
+
+    if(LZ4_FOUND AND NOT TARGET lz4::lz4)
+        add_library(lz4::lz4 UNKNOWN IMPORTED)
+        set_target_properties(
+            lz4::lz4 PROPERTIES
+            INTERFACE_INCLUDE_DIRECTORIES ${LZ4_INCLUDE_DIR}
+            IMPORTED_LOCATION ${LZ4_LIBRARY}
+        )
+    endif()
+endif()
@@ -56,6 +56,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #cmakedefine HAVE_SSE1
 
 /* External library usage */
+#cmakedefine USE_LZ4
 #cmakedefine USE_SPEEX
 #cmakedefine USE_OPUS
 #cmakedefine USE_VPX